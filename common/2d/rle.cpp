@@ -36,6 +36,9 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "dxxerror.h"
 #include "rle.h"
 #include "byteutil.h"
+#ifndef OGL
+#include "texmap.h"
+#endif
 
 #include "compiler-range_for.h"
 
@@ -441,6 +444,10 @@ grs_bitmap *_rle_expand_texture(const grs_bitmap &bmp)
 		}
 	}
 
+#ifndef OGL
+	//queued polygons may still be drawing from the old bitmap
+	tmap_batch_retire(std::move(rle_cache[least_recently_used].expanded_bitmap));
+#endif
 	rle_cache[least_recently_used].expanded_bitmap = gr_create_bitmap(bmp.bm_w, bmp.bm_h);
 	rle_expand_texture_sub(bmp, *rle_cache[least_recently_used].expanded_bitmap.get());
 	rle_cache[least_recently_used].rle_bitmap = &bmp;
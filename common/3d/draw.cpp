@@ -83,6 +83,7 @@ void g3_draw_line(g3s_point &p0,g3s_point &p1,temporary_points_t &tp)
 
 	if (p1.p3_flags&PF_OVERFLOW)
 		return must_clip_line(&p0,&p1,codes_or,tp);
+	tmap_batch_flush();
 	(*line_drawer_ptr)(p0.p3_sx,p0.p3_sy,p1.p3_sx,p1.p3_sy);
 }
 #endif
@@ -274,12 +275,14 @@ void g3_draw_sphere(g3s_point &pnt,fix rad)
 #ifndef __powerc
 			if (checkmuldiv(&t,r2,Canv_w2,pnt.p3_z))
 			{
+				tmap_batch_flush();
 				gr_disk(pnt.p3_sx,pnt.p3_sy,t);
 				return;
 			}
 #else
 			if (pnt.p3_z == 0)
 				return;
+			tmap_batch_flush();
 			gr_disk(pnt.p3_sx, pnt.p3_sy, fl2f(((f2fl(r2) * fCanv_w2) / f2fl(pnt.p3_z))));
 			return;
 #endif
@@ -16,6 +16,7 @@
 #include "maths.h"
 #ifndef OGL
 #include "gr.h"
+#include "texmap.h"
 #endif
 
 #include "compiler-range_for.h"
@@ -161,6 +162,7 @@ void g3_draw_bitmap(const vms_vector &pos,fix width,fix height,grs_bitmap &bm)
 		{blob1x, blob0y},
 		{blob1x, pnt.p3_sy + h},
 	}};
+	tmap_batch_flush();
 	scale_bitmap(bm, blob_vertices, 0);
 }
 #endif
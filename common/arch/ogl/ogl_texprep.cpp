@@ -0,0 +1,250 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Preparation of texture images in memory, ready to be given to OpenGL.
+ *
+ */
+
+#include <algorithm>
+#include "dxxerror.h"
+#include "byteutil.h"
+#include "rle.h"
+#include "ogl_texprep.h"
+
+std::size_t ogl_rle_size(const uint8_t *const src, const unsigned h, const int bm_flags)
+{
+	std::size_t size;
+	if (bm_flags & BM_FLAG_RLE_BIG)
+	{
+		size = 4 + h * 2;
+		for (unsigned i = 0; i != h; ++i)
+			size += GET_INTEL_SHORT(&src[4 + i * 2]);
+	}
+	else
+	{
+		size = 4 + h;
+		for (unsigned i = 0; i != h; ++i)
+			size += src[4 + i];
+	}
+	return size;
+}
+
+void ogl_rle_decode(const uint8_t *const src, const unsigned w, const unsigned h, const int bm_flags, uint8_t *dest)
+{
+	const unsigned data_offset = (bm_flags & BM_FLAG_RLE_BIG) ? 2 : 1;
+	const rle_position_t e{src + ogl_rle_size(src, h, bm_flags), dest + w * h};
+	auto sbits = &src[4 + h * data_offset];
+	for (unsigned i = 0; i != h; ++i)
+	{
+		gr_rle_decode({sbits, dest}, e);
+		if (bm_flags & BM_FLAG_RLE_BIG)
+			sbits += GET_INTEL_SHORT(&src[4 + i * data_offset]);
+		else
+			sbits += src[4 + i];
+		dest += w;
+	}
+}
+
+void ogl_filltexbuf(const uint8_t *data, GLubyte *texp, unsigned truewidth, unsigned width, unsigned height, int dxo, int dyo, unsigned twidth, unsigned theight, int type, int bm_flags, int data_format, const palette_array_t &pal)
+{
+	for (unsigned y=0;y<theight;y++)
+	{
+		int i=dxo+truewidth*(y+dyo);
+		for (unsigned x=0;x<twidth;x++)
+		{
+			int c;
+			if (x<width && y<height)
+			{
+				if (data_format)
+				{
+					int j;
+
+					for (j = 0; j < data_format; ++j)
+						(*(texp++)) = data[i * data_format + j];
+					i++;
+					continue;
+				}
+				else
+				{
+					c = data[i++];
+				}
+			}
+			else if (x == width && y < height) // end of bitmap reached - fill this pixel with last color to make a clean border when filtering this texture
+			{
+				c = data[(width*(y+1))-1];
+			}
+			else if (y == height && x < width) // end of bitmap reached - fill this row with color or last row to make a clean border when filtering this texture
+			{
+				c = data[(width*(height-1))+x];
+			}
+			else
+			{
+				c = 256; // fill the pad space with transparency (or blackness)
+			}
+
+			if (c == 254 && (bm_flags & BM_FLAG_SUPER_TRANSPARENT))
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++)) = 255;
+						(*(texp++)) = 0;
+						break;
+					case GL_RGBA:
+						(*(texp++)) = 255;
+						(*(texp++)) = 255;
+						(*(texp++)) = 255;
+						(*(texp++)) = 0; // transparent pixel
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unhandled super-transparent texformat\n");
+						break;
+				}
+			}
+			else if ((c == 255 && (bm_flags & BM_FLAG_TRANSPARENT)) || c == 256)
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE:
+						(*(texp++))=0;
+						break;
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++))=0;
+						(*(texp++))=0;
+						break;
+					case GL_RGB:
+						(*(texp++)) = 0;
+						(*(texp++)) = 0;
+						(*(texp++)) = 0;
+						break;
+					case GL_RGBA:
+						(*(texp++))=0;
+						(*(texp++))=0;
+						(*(texp++))=0;
+						(*(texp++))=0;//transparent pixel
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unknown texformat\n");
+						break;
+				}
+			}
+			else
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE://these could prolly be done to make the intensity based upon the intensity of the resulting color, but its not needed for anything (yet?) so no point. :)
+						(*(texp++))=255;
+						break;
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++))=255;
+						(*(texp++))=255;
+						break;
+					case GL_RGB:
+						(*(texp++)) = pal[c].r * 4;
+						(*(texp++)) = pal[c].g * 4;
+						(*(texp++)) = pal[c].b * 4;
+						break;
+					case GL_RGBA:
+						(*(texp++))=pal[c].r*4;
+						(*(texp++))=pal[c].g*4;
+						(*(texp++))=pal[c].b*4;
+						(*(texp++))=255;//not transparent
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unknown texformat\n");
+						break;
+				}
+			}
+		}
+	}
+}
+
+unsigned ogl_texture_format_bytes(const GLenum format)
+{
+	switch (format)
+	{
+		case GL_LUMINANCE:
+			return 1;
+		case GL_LUMINANCE_ALPHA:
+			return 2;
+		case GL_RGB:
+			return 3;
+		case GL_RGBA:
+			return 4;
+#ifndef OGLES
+		case GL_COLOR_INDEX:
+			return 1;
+#endif
+		default:
+			Error("ogl_texture_format_bytes unknown texformat %u\n", static_cast<unsigned>(format));
+	}
+}
+
+std::size_t ogl_mipmap_chain_size(unsigned w, unsigned h, const unsigned bytes_per_pixel)
+{
+	std::size_t size = w * h;
+	while (w > 1 || h > 1)
+	{
+		w = std::max(w / 2, 1u);
+		h = std::max(h / 2, 1u);
+		size += w * h;
+	}
+	return size * bytes_per_pixel;
+}
+
+void ogl_build_mipmaps(uint8_t *pixels, unsigned w, unsigned h, const unsigned bytes_per_pixel)
+{
+	while (w > 1 || h > 1)
+	{
+		const uint8_t *const src = pixels;
+		const std::size_t stride = w * bytes_per_pixel;
+		uint8_t *dest = pixels + stride * h;
+		const unsigned nw = std::max(w / 2, 1u), nh = std::max(h / 2, 1u);
+		if (w > 1 && h > 1)
+		{
+			//each texel is the rounded mean of a 2x2 block
+			for (unsigned y = 0; y != nh; ++y)
+				for (unsigned x = 0; x != nw; ++x)
+				{
+					const auto s = &src[2 * y * stride + 2 * x * bytes_per_pixel];
+					for (unsigned c = 0; c != bytes_per_pixel; ++c)
+						*dest++ = (s[c] + s[c + bytes_per_pixel] + s[c + stride] + s[c + stride + bytes_per_pixel] + 2) / 4;
+				}
+		}
+		else
+		{
+			//a single row or column: pairs of texels are next to each
+			//other, and GLU truncates their mean
+			for (unsigned i = 0, n = nw * nh; i != n; ++i)
+			{
+				const auto s = &src[2 * i * bytes_per_pixel];
+				for (unsigned c = 0; c != bytes_per_pixel; ++c)
+					*dest++ = (s[c] + s[c + bytes_per_pixel]) / 2;
+			}
+		}
+		pixels += stride * h;
+		w = nw;
+		h = nh;
+	}
+}
@@ -0,0 +1,412 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Developer check of ogl_texprep.cpp.  Sample bitmaps are made into
+ * textures as ogl_preload_level_textures does, and compared with the
+ * code ogl_texprep.cpp replaced: the RLE decoding and ogl_filltexbuf of
+ * ogl.cpp, and gluBuild2DMipmaps.  The first two need no display.  The
+ * mipmaps need an OpenGL context, and are not compared if one cannot be
+ * made.  Exits with status 1 if anything differs.
+ *
+ * Built when register_texprep_check=1 is given to scons.
+ *
+ */
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <SDL.h>
+#include "dxxerror.h"
+#include "byteutil.h"
+#include "rle.h"
+#include "ogl_texprep.h"
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/glu.h>
+#else
+#include <GL/glu.h>
+#endif
+
+#include "compiler-range_for.h"
+
+/* rle.cpp refers to these from functions which are not called here.
+ * The real ones would bring in the rest of the 2D library.
+ */
+void (Error_puts)(const char *const file, const unsigned line, const char *const func, const char *const str)
+{
+	fprintf(stderr, "%s:%u: %s: %s\n", file, line, func, str);
+	exit(2);
+}
+
+void (Error)(const char *const file, const unsigned line, const char *const func, const char *const fmt, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	(Error_puts)(file, line, func, buf);
+}
+
+void gr_bm_pixel(grs_bitmap &, uint_fast32_t, uint_fast32_t, uint8_t)
+{
+	abort();
+}
+
+grs_bitmap_ptr gr_create_bitmap(uint16_t, uint16_t)
+{
+	abort();
+}
+
+void gr_free_bitmap_data(grs_bitmap &)
+{
+	abort();
+}
+
+static const palette_array_t *ogl_pal;
+
+//	As ogl_loadbmtexture_f decoded RLE bitmaps.
+static void old_rle_decode(grs_bitmap *bm, uint8_t *decodebuf)
+{
+	unsigned char * dbits;
+	int i, data_offset;
+
+	data_offset = 1;
+	if (bm->bm_flags & BM_FLAG_RLE_BIG)
+		data_offset = 2;
+
+	auto sbits = &bm->get_bitmap_data()[4 + (bm->bm_h * data_offset)];
+	dbits = decodebuf;
+
+	for (i=0; i < bm->bm_h; i++ )    {
+		gr_rle_decode({sbits, dbits}, {end(*bm), decodebuf + bm->bm_w * bm->bm_h});
+		if ( bm->bm_flags & BM_FLAG_RLE_BIG )
+			sbits += GET_INTEL_SHORT(&bm->bm_data[4 + (i * data_offset)]);
+		else
+			sbits += (int)bm->bm_data[4+i];
+		dbits += bm->bm_w;
+	}
+}
+
+//	ogl_filltexbuf as it was in ogl.cpp, without the size check.
+static void old_filltexbuf(const uint8_t *data, GLubyte *texp, unsigned truewidth, unsigned width, unsigned height, int dxo, int dyo, unsigned twidth, unsigned theight, int type, int bm_flags, int data_format)
+{
+	for (unsigned y=0;y<theight;y++)
+	{
+		int i=dxo+truewidth*(y+dyo);
+		for (unsigned x=0;x<twidth;x++)
+		{
+			int c;
+			if (x<width && y<height)
+			{
+				if (data_format)
+				{
+					int j;
+
+					for (j = 0; j < data_format; ++j)
+						(*(texp++)) = data[i * data_format + j];
+					i++;
+					continue;
+				}
+				else
+				{
+					c = data[i++];
+				}
+			}
+			else if (x == width && y < height) // end of bitmap reached - fill this pixel with last color to make a clean border when filtering this texture
+			{
+				c = data[(width*(y+1))-1];
+			}
+			else if (y == height && x < width) // end of bitmap reached - fill this row with color or last row to make a clean border when filtering this texture
+			{
+				c = data[(width*(height-1))+x];
+			}
+			else
+			{
+				c = 256; // fill the pad space with transparency (or blackness)
+			}
+
+			if (c == 254 && (bm_flags & BM_FLAG_SUPER_TRANSPARENT))
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++)) = 255;
+						(*(texp++)) = 0;
+						break;
+					case GL_RGBA:
+						(*(texp++)) = 255;
+						(*(texp++)) = 255;
+						(*(texp++)) = 255;
+						(*(texp++)) = 0; // transparent pixel
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unhandled super-transparent texformat\n");
+						break;
+				}
+			}
+			else if ((c == 255 && (bm_flags & BM_FLAG_TRANSPARENT)) || c == 256)
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE:
+						(*(texp++))=0;
+						break;
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++))=0;
+						(*(texp++))=0;
+						break;
+					case GL_RGB:
+						(*(texp++)) = 0;
+						(*(texp++)) = 0;
+						(*(texp++)) = 0;
+						break;
+					case GL_RGBA:
+						(*(texp++))=0;
+						(*(texp++))=0;
+						(*(texp++))=0;
+						(*(texp++))=0;//transparent pixel
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unknown texformat\n");
+						break;
+				}
+			}
+			else
+			{
+				switch (type)
+				{
+					case GL_LUMINANCE://these could prolly be done to make the intensity based upon the intensity of the resulting color, but its not needed for anything (yet?) so no point. :)
+						(*(texp++))=255;
+						break;
+					case GL_LUMINANCE_ALPHA:
+						(*(texp++))=255;
+						(*(texp++))=255;
+						break;
+					case GL_RGB:
+						(*(texp++)) = (*ogl_pal)[c].r * 4;
+						(*(texp++)) = (*ogl_pal)[c].g * 4;
+						(*(texp++)) = (*ogl_pal)[c].b * 4;
+						break;
+					case GL_RGBA:
+						(*(texp++))=(*ogl_pal)[c].r*4;
+						(*(texp++))=(*ogl_pal)[c].g*4;
+						(*(texp++))=(*ogl_pal)[c].b*4;
+						(*(texp++))=255;//not transparent
+						break;
+#ifndef OGLES
+					case GL_COLOR_INDEX:
+						(*(texp++)) = c;
+						break;
+#endif
+					default:
+						Error("ogl_filltexbuf unknown texformat\n");
+						break;
+				}
+			}
+		}
+	}
+}
+
+namespace {
+
+struct texture_format
+{
+	GLenum format;
+	const char *name;
+};
+
+const texture_format texture_formats[] = {
+	{GL_RGBA, "RGBA"},
+	{GL_RGB, "RGB"},
+	{GL_LUMINANCE_ALPHA, "LUMINANCE_ALPHA"},
+	{GL_LUMINANCE, "LUMINANCE"},
+};
+
+struct sample_size
+{
+	uint16_t w, h;
+};
+
+//	Wall textures, sprites and fonts, and sizes which need padding.
+const sample_size sample_sizes[] = {
+	{64, 64}, {128, 128}, {32, 32}, {64, 32}, {16, 64},
+	{37, 23}, {1, 1}, {3, 1}, {1, 5}, {320, 200},
+};
+
+const int sample_flags[] = {
+	0,
+	BM_FLAG_TRANSPARENT,
+	BM_FLAG_SUPER_TRANSPARENT,
+	BM_FLAG_TRANSPARENT | BM_FLAG_SUPER_TRANSPARENT,
+};
+
+unsigned Seed = 1;
+
+unsigned next_random()
+{
+	Seed = Seed * 1103515245 + 12345;
+	return Seed >> 16;
+}
+
+unsigned Failures;
+
+void report(const bool same, const char *const stage, const sample_size &s, const int flags, const char *const format)
+{
+	if (same)
+		return;
+	++Failures;
+	printf("%s differs: %ux%u flags %#x %s\n", stage, s.w, s.h, flags, format);
+}
+
+unsigned pow2_at_least(const unsigned n)
+{
+	unsigned r = 1;
+	while (r < n)
+		r <<= 1;
+	return r;
+}
+
+}
+
+//	Runs of 1 to 8 pixels, so that most rows can be compressed.
+static void make_sample(std::vector<uint8_t> &pixels, const sample_size &s)
+{
+	pixels.resize(s.w * s.h);
+	for (std::size_t i = 0; i != pixels.size();)
+	{
+		const uint8_t c = next_random();
+		for (unsigned n = 1 + next_random() % 8; n && i != pixels.size(); --n)
+			pixels[i++] = c;
+	}
+}
+
+static void check_mipmaps(const uint8_t *const level0, unsigned tw, unsigned th, const texture_format &f, const sample_size &s, const int flags)
+{
+	const unsigned bpp = ogl_texture_format_bytes(f.format);
+	std::vector<uint8_t> mine(ogl_mipmap_chain_size(tw, th, bpp));
+	std::copy_n(level0, tw * th * bpp, mine.begin());
+	ogl_build_mipmaps(mine.data(), tw, th, bpp);
+	GLuint handle;
+	glGenTextures(1, &handle);
+	glBindTexture(GL_TEXTURE_2D, handle);
+	gluBuild2DMipmaps(GL_TEXTURE_2D, f.format, tw, th, f.format, GL_UNSIGNED_BYTE, level0);
+	bool same = true;
+	std::vector<uint8_t> glu;
+	const uint8_t *p = mine.data();
+	for (GLint level = 0;; ++level)
+	{
+		glu.resize(tw * th * bpp);
+		glGetTexImage(GL_TEXTURE_2D, level, f.format, GL_UNSIGNED_BYTE, glu.data());
+		same = same && !memcmp(glu.data(), p, glu.size());
+		p += glu.size();
+		if (tw == 1 && th == 1)
+			break;
+		tw = std::max(tw / 2, 1u);
+		th = std::max(th / 2, 1u);
+	}
+	glDeleteTextures(1, &handle);
+	report(same, "mipmaps", s, flags, f.name);
+}
+
+static bool make_gl_context()
+{
+	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		return false;
+#if SDL_MAJOR_VERSION == 1
+	if (!SDL_SetVideoMode(16, 16, 0, SDL_OPENGL))
+		return false;
+#else
+	const auto window = SDL_CreateWindow("ogl_texprep_check", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 16, 16, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!window || !SDL_GL_CreateContext(window))
+		return false;
+#endif
+	//	rows of 1 and 2 pixel RGB levels are not padded in either
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	return true;
+}
+
+int main(int, char **)
+{
+	const bool have_gl = make_gl_context();
+	if (!have_gl)
+		printf("No OpenGL context (%s); mipmaps are not compared.\n", SDL_GetError());
+	palette_array_t pal;
+	range_for (auto &c, pal)
+	{
+		c.r = next_random() % 64;
+		c.g = next_random() % 64;
+		c.b = next_random() % 64;
+	}
+	ogl_pal = &pal;
+	unsigned checked = 0;
+	std::vector<uint8_t> pixels, rle, mine, old;
+	range_for (auto &s, sample_sizes)
+	{
+		make_sample(pixels, s);
+		const unsigned tw = pow2_at_least(s.w), th = pow2_at_least(s.h);
+		range_for (const auto sample_flag, sample_flags)
+		{
+			int flags = sample_flag;
+			const uint8_t *data = pixels.data();
+			std::vector<uint8_t> decoded;
+			//	Compressed in place, as the RLE header needs room.
+			rle.assign(pixels.begin(), pixels.end());
+			rle.resize(rle.size() + 4 + 2 * s.h);
+			grs_bitmap bm{};
+			bm.bm_w = bm.bm_rowsize = s.w;
+			bm.bm_h = s.h;
+			bm.bm_flags = flags;
+			bm.bm_mdata = rle.data();
+			if (gr_bitmap_rle_compress(bm))
+			{
+				flags = bm.bm_flags;
+				decoded.resize(s.w * s.h);
+				ogl_rle_decode(rle.data(), s.w, s.h, flags, decoded.data());
+				old.assign(s.w * s.h, 0);
+				old_rle_decode(&bm, old.data());
+				report(decoded == old, "RLE decoding", s, flags, "-");
+				report(decoded == pixels, "RLE round trip", s, flags, "-");
+				data = decoded.data();
+			}
+			range_for (auto &f, texture_formats)
+			{
+				//	Both versions reject super-transparency in formats
+				//	without alpha, and the game never asks for it.
+				if ((flags & BM_FLAG_SUPER_TRANSPARENT) && f.format != GL_RGBA && f.format != GL_LUMINANCE_ALPHA)
+					continue;
+				const unsigned bpp = ogl_texture_format_bytes(f.format);
+				mine.assign(tw * th * bpp, 0);
+				old.assign(tw * th * bpp, 0);
+				ogl_filltexbuf(data, mine.data(), s.w, s.w, s.h, 0, 0, tw, th, f.format, flags, 0, pal);
+				old_filltexbuf(data, old.data(), s.w, s.w, s.h, 0, 0, tw, th, f.format, flags, 0);
+				report(mine == old, "ogl_filltexbuf", s, flags, f.name);
+				if (have_gl)
+					check_mipmaps(old.data(), tw, th, f, s, flags);
+				++checked;
+			}
+		}
+	}
+	printf("%u textures checked, %u differences\n", checked, Failures);
+	SDL_Quit();
+	return Failures ? 1 : 0;
+}
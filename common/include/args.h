@@ -46,6 +46,8 @@ typedef enum {
 
 #endif
 
+#define TEXMERGE_CACHE_KB_DEFAULT	1024
+
 // Struct that keeps all variables used by FindArg
 // Prefixes are:
 //   Sys - System Options
@@ -80,6 +82,7 @@ struct Arg : prohibit_void_ptr<Arg>
 	std::string SysMissionDir;
 	std::string SysPilot;
 	std::string SysRecordDemoNameTemplate;
+	std::string SysTimeDemo;
 	bool SysShowCmdHelp;
 	bool SysNoNiceFPS;
 #if defined(__unix__)
@@ -97,10 +100,12 @@ struct Arg : prohibit_void_ptr<Arg>
 	bool SndNoMusic;
 #ifdef USE_SDLMIXER
 	bool SndDisableSdlMixer;
+	bool SndPreconvert;
 #else
 	static constexpr tt::true_type SndDisableSdlMixer{};
 #endif
 	bool GfxSkipHiresFNT;
+	unsigned GfxTexmergeCacheKB;
 #ifdef DXX_BUILD_DESCENT_I
 	bool EdiNoBm;
 #endif
@@ -119,6 +124,12 @@ struct Arg : prohibit_void_ptr<Arg>
 	std::string MplUdpHostAddr;
 	uint16_t MplUdpHostPort;
 	uint16_t MplUdpMyPort;
+	bool MplUdpNoThread;
+	unsigned MplUdpInterpDelay;
+	unsigned MplUdpSynthClients;
+	unsigned MplUdpSynthPps;
+	unsigned MplUdpSynthFire;
+	unsigned MplUdpSynthMdata;
 #ifdef USE_TRACKER
 	uint16_t MplTrackerPort;
 	std::string MplTrackerAddr;
@@ -144,6 +155,8 @@ struct Arg : prohibit_void_ptr<Arg>
 #else
 	int DbgSdlHWSurface;
 	int DbgSdlASyncBlit;
+	unsigned DbgTmapThreads;
+	bool DbgTmapVerify;
 #endif
 };
 
@@ -24,6 +24,12 @@ void digi_mixer_reset();
 void digi_mixer_stop_all_channels();
 void digi_mixer_set_digi_volume(int);
 void digi_mixer_debug();
+//convert all loaded sounds to the output format in the background
+void digi_mixer_preconvert_sounds();
+//wait for that and release its buffer
+void digi_mixer_preconvert_stop();
+//GameSounds[i] was replaced, so forget any conversion of the old sound
+void digi_mixer_sound_changed(int i);
 
 #endif
 
@@ -311,6 +311,10 @@ void gr_bitmap_check_transparency(grs_bitmap * bmp);
 // Given: r,g,b, each in range of 0-63, return the color index that
 // best matches the input.
 color_t gr_find_closest_color(int r, int g, int b);
+// Given n pixels of 8 bit r,g,b, each bytes_per_pixel after the last,
+// store the index of pal that best matches each in out.  Safe to call
+// from any thread.
+void gr_find_closest_colors(const palette_array_t &pal, const uint8_t *rgb, std::size_t n, unsigned bytes_per_pixel, color_t *out);
 int gr_find_closest_color_15bpp(int rgb);
 
 void gr_flip();
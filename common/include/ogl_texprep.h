@@ -0,0 +1,38 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * The CPU side of making an OpenGL texture from a bitmap: RLE decoding,
+ * palette expansion and mipmap generation.  Nothing here calls OpenGL
+ * or reads global state, so it may run on any thread, and without a
+ * GL context.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include "ogl_init.h"
+
+//Bytes of RLE data, row table included, for the h rows at src.
+std::size_t ogl_rle_size(const uint8_t *src, unsigned h, int bm_flags);
+//Expand the RLE data at src into the w*h bytes at dest.
+void ogl_rle_decode(const uint8_t *src, unsigned w, unsigned h, int bm_flags, uint8_t *dest);
+//Convert width*height palettized pixels to texture format type in
+//twidth*theight at texp.  Data outside the bitmap is padded.
+void ogl_filltexbuf(const uint8_t *data, GLubyte *texp, unsigned truewidth, unsigned width, unsigned height, int dxo, int dyo, unsigned twidth, unsigned theight, int type, int bm_flags, int data_format, const palette_array_t &pal);
+unsigned ogl_texture_format_bytes(GLenum format);
+//Bytes for a w*h image followed by all of its mipmaps.
+std::size_t ogl_mipmap_chain_size(unsigned w, unsigned h, unsigned bytes_per_pixel);
+//Fill in the mipmaps after the w*h image at pixels, down to 1x1, as
+//gluBuild2DMipmaps makes them from an image which needs no scaling.
+void ogl_build_mipmaps(uint8_t *pixels, unsigned w, unsigned h, unsigned bytes_per_pixel);
+
+#endif
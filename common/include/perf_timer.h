@@ -0,0 +1,77 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Wall clock accounting of time spent in selected subsystems.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <chrono>
+#include <cstdint>
+#include "dxxsconf.h"
+#include "compiler-array.h"
+
+enum class perf_subsystem : uint8_t
+{
+	render,
+	object_lists,
+	lighting,
+	texture_map,
+	sound,
+};
+
+static const std::size_t perf_subsystem_count = static_cast<std::size_t>(perf_subsystem::sound) + 1;
+
+typedef std::chrono::steady_clock perf_clock;
+typedef array<perf_clock::duration, perf_subsystem_count> perf_durations;
+
+/* Set by whoever wants the numbers.  When clear, perf_scope does not
+ * read the clock.
+ */
+extern bool Perf_timers_enabled;
+/* Time accumulated since the last perf_timers_take() */
+extern perf_durations Perf_accumulated;
+
+const char *perf_subsystem_name(perf_subsystem);
+
+static inline perf_durations perf_timers_take()
+{
+	const auto r = Perf_accumulated;
+	Perf_accumulated = {};
+	return r;
+}
+
+/* Add the lifetime of this object to the named subsystem.  Scopes may
+ * nest, so a subsystem's total includes time spent in any subsystems
+ * it calls.
+ */
+class perf_scope
+{
+	perf_clock::time_point m_start;
+	const perf_subsystem m_subsystem;
+	const bool m_enabled;
+public:
+	perf_scope(const perf_subsystem s) :
+		m_subsystem(s), m_enabled(Perf_timers_enabled)
+	{
+		if (m_enabled)
+			m_start = perf_clock::now();
+	}
+	perf_scope(const perf_scope &) = delete;
+	perf_scope &operator=(const perf_scope &) = delete;
+	~perf_scope()
+	{
+		if (m_enabled)
+			Perf_accumulated[static_cast<std::size_t>(m_subsystem)] += perf_clock::now() - m_start;
+	}
+};
+
+#endif
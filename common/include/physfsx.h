@@ -493,6 +493,67 @@ extern PHYSFS_sint64 PHYSFSX_getFreeDiskSpace();
 #define PHYSFSX_exists(F,I)	((I) ? PHYSFSX_exists_ignorecase(F) : PHYSFS_exists(F))
 int PHYSFSX_exists_ignorecase(const char *filename);
 RAIIPHYSFS_File PHYSFSX_openReadBuffered(const char *filename);
+
+/* A view of a whole file, mapped into memory.  The pages are private
+ * to this process, so writes through data() never reach the file.
+ */
+class PHYSFSX_mapped_file
+{
+	uint8_t *m_data;
+	std::size_t m_size;
+	void unmap();
+public:
+	PHYSFSX_mapped_file() :
+		m_data(nullptr), m_size(0)
+	{
+	}
+	PHYSFSX_mapped_file(uint8_t *d, std::size_t s) :
+		m_data(d), m_size(s)
+	{
+	}
+	PHYSFSX_mapped_file(PHYSFSX_mapped_file &&rhs) :
+		m_data(rhs.m_data), m_size(rhs.m_size)
+	{
+		rhs.m_data = nullptr;
+		rhs.m_size = 0;
+	}
+	PHYSFSX_mapped_file &operator=(PHYSFSX_mapped_file &&rhs)
+	{
+		if (this != &rhs)
+		{
+			unmap();
+			std::swap(m_data, rhs.m_data);
+			std::swap(m_size, rhs.m_size);
+		}
+		return *this;
+	}
+	~PHYSFSX_mapped_file()
+	{
+		unmap();
+	}
+	explicit operator bool() const
+	{
+		return m_data;
+	}
+	uint8_t *data() const
+	{
+		return m_data;
+	}
+	std::size_t size() const
+	{
+		return m_size;
+	}
+	void reset()
+	{
+		unmap();
+	}
+};
+
+/* Map filename if PhysFS finds it in a plain directory.  Files inside
+ * archives, and platforms without file mapping, give an empty result,
+ * and must be read through PhysFS instead.
+ */
+PHYSFSX_mapped_file PHYSFSX_mapRead(const char *filename);
 RAIIPHYSFS_File PHYSFSX_openWriteBuffered(const char *filename);
 extern void PHYSFSX_addArchiveContent();
 extern void PHYSFSX_removeArchiveContent();
@@ -0,0 +1,123 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Decoding of little endian data which has already been read into memory.
+ *
+ * Every read is checked against the end of the buffer.  Reading past it
+ * is fatal, as it is for the PHYSFSX_read* helpers, which this replaces
+ * where a file is decoded field by field.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include "byteutil.h"
+#include "dxxerror.h"
+#include "maths.h"
+#include "vecmat.h"
+
+class read_cursor
+{
+	const uint8_t *const m_begin, *const m_end;
+	const uint8_t *m_pos;
+	//what is being decoded, for the error message
+	const char *const m_name;
+	__noreturn
+	void overrun(const std::size_t n) const
+	{
+		Error("reading %lu bytes past the end of %s at %lu", static_cast<unsigned long>(n), m_name, static_cast<unsigned long>(tell()));
+	}
+	const uint8_t *take(const std::size_t n)
+	{
+		if (static_cast<std::size_t>(m_end - m_pos) < n)
+			overrun(n);
+		const auto p = m_pos;
+		m_pos += n;
+		return p;
+	}
+public:
+	read_cursor(const uint8_t *const b, const std::size_t size, const char *const name) :
+		m_begin(b), m_end(b + size), m_pos(b), m_name(name)
+	{
+	}
+	std::size_t tell() const
+	{
+		return m_pos - m_begin;
+	}
+	std::size_t size() const
+	{
+		return m_end - m_begin;
+	}
+	void seek(const std::size_t offset)
+	{
+		if (offset > size())
+			Error("seeking to %lu past the end of %s", static_cast<unsigned long>(offset), m_name);
+		m_pos = m_begin + offset;
+	}
+	void skip(const std::size_t n)
+	{
+		take(n);
+	}
+	uint8_t read_u8()
+	{
+		return *take(1);
+	}
+	int8_t read_s8()
+	{
+		return read_u8();
+	}
+	uint16_t read_u16()
+	{
+		return GET_INTEL_SHORT(take(2));
+	}
+	int16_t read_s16()
+	{
+		return read_u16();
+	}
+	uint32_t read_u32()
+	{
+		return GET_INTEL_INT(take(4));
+	}
+	int32_t read_s32()
+	{
+		return read_u32();
+	}
+	fix read_fix()
+	{
+		return read_s32();
+	}
+	fixang read_fixang()
+	{
+		return read_s16();
+	}
+	void read_vector(vms_vector &v)
+	{
+		const auto p = take(12);
+		v.x = static_cast<int32_t>(GET_INTEL_INT(p));
+		v.y = static_cast<int32_t>(GET_INTEL_INT(p + 4));
+		v.z = static_cast<int32_t>(GET_INTEL_INT(p + 8));
+	}
+	void read_matrix(vms_matrix &m)
+	{
+		read_vector(m.rvec);
+		read_vector(m.uvec);
+		read_vector(m.fvec);
+	}
+	void read_angvec(vms_angvec &a)
+	{
+		a.p = read_fixang();
+		a.b = read_fixang();
+		a.h = read_fixang();
+	}
+};
+
+#endif
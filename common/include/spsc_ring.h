@@ -0,0 +1,69 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "dxxsconf.h"
+#include "compiler-array.h"
+
+/* Fixed size queue between exactly one producer thread and one consumer
+ * thread.  The producer fills slots in place and then publishes them, so
+ * that elements need not be copied.  clear() may only be used while no
+ * other thread is using the ring.
+ */
+template <typename T, std::size_t N>
+class spsc_ring
+{
+	static_assert(N && !(N & (N - 1)), "ring size must be a power of 2");
+	array<T, N> slots;
+	//head is only written by the producer, tail only by the consumer
+	std::atomic<std::size_t> head, tail;
+public:
+	spsc_ring() :
+		head(0), tail(0)
+	{
+	}
+	static std::size_t capacity()
+	{
+		return N;
+	}
+	//producer: number of slots which may be filled
+	std::size_t writable() const
+	{
+		return N - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+	}
+	//producer: the i'th slot after the last published one; i < writable()
+	T &slot(const std::size_t i)
+	{
+		return slots[(head.load(std::memory_order_relaxed) + i) & (N - 1)];
+	}
+	//producer: make the next n slots visible to the consumer
+	void publish(const std::size_t n)
+	{
+		head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+	//consumer: number of published slots not yet consumed
+	std::size_t readable() const
+	{
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+	}
+	//consumer: the i'th published slot; i < readable()
+	T &front(const std::size_t i = 0)
+	{
+		return slots[(tail.load(std::memory_order_relaxed) + i) & (N - 1)];
+	}
+	//consumer: release the first n published slots to the producer
+	void consume(const std::size_t n = 1)
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+	void clear()
+	{
+		tail.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+};
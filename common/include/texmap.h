@@ -37,6 +37,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #ifdef __cplusplus
 #include "dxxsconf.h"
+#include "fwd-gr.h"
 #include "compiler-array.h"
 
 const unsigned MAX_TMAP_VERTS = 25;
@@ -89,9 +90,9 @@ extern unsigned Current_seg_depth;
 //	These are pointers to texture maps.  If you want to render texture map #7, then you will render
 //	the texture map defined by Texmap_ptrs[7].
 
-extern int Transparency_on;
+extern thread_local int Transparency_on;
 
-extern int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top;
+extern thread_local int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top;
 
 // for ugly hack put in to be sure we don't overflow render buffer
 
@@ -100,4 +101,32 @@ extern int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top
 
 extern void init_interface_vars_to_assembler(void);
 
+#ifndef OGL
+/* While a batch is open, polygons are queued instead of drawn.  When the
+ * batch is flushed, the canvas is split into horizontal bands and each
+ * band is drawn by its own thread.  Anything which draws to the canvas
+ * by other means must flush first.
+ */
+void tmap_batch_begin();
+void tmap_batch_flush();
+//Flush and stop queueing.
+void tmap_batch_end();
+/* Keep bm alive until the open batch is flushed, since queued polygons
+ * may still read it.  Without a batch, bm is freed at once.
+ */
+void tmap_batch_retire(grs_bitmap_ptr &&bm);
+/* Use threads to draw batches, or the number of CPUs if 0.  If verify
+ * is set, every batch is also drawn by one thread and the results are
+ * compared.
+ */
+void tmap_band_init(unsigned threads, bool verify);
+
+struct tmap_band_stats
+{
+	unsigned threads;
+	unsigned long batches, commands, verified_batches, mismatched_batches, mismatched_pixels;
+};
+const tmap_band_stats &get_tmap_band_stats();
+#endif
+
 #endif
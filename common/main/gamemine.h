@@ -31,6 +31,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define TMAP_NUM_MASK 0x3FFF
 
 #ifdef __cplusplus
+#include "perf_timer.h"
+
+class read_cursor;
 
 #if defined(DXX_BUILD_DESCENT_I)
 #define MINE_VERSION					17	// Current version expected
@@ -135,7 +138,9 @@ extern struct me mine_editor;
 // loads from an already-open file
 // returns 0=everything ok, 1=old version, -1=error
 int load_mine_data(PHYSFS_file *LoadFile);
-int load_mine_data_compiled(PHYSFS_file *LoadFile);
+// decodes a compiled mine which has been read into memory, and says how
+// long finding the side types and normals took
+int load_mine_data_compiled(read_cursor &c, perf_clock::duration &validate_time);
 
 #define TMAP_NUM_MASK 0x3FFF
 
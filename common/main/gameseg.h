@@ -144,10 +144,26 @@ segmasks get_seg_masks(const vms_vector &checkp, vcsegptr_t segnum, fix rad);
 //Tries to find a segment for a point, in the following way:
 // 1. Check the given segment
 // 2. Recursively trace through attached segments
-// 3. Check all the segmentns
+// 3. Check all the segments whose bounding box contains the point
 //Returns segnum if found, or -1
 segptridx_t find_point_seg(const vms_vector &p,segptridx_t segnum);
 
+//Index the bounding boxes of all segments for find_point_seg, and
+//record their bounding spheres.  Must be called again whenever
+//vertices move or segments are added.
+void build_segment_grid();
+void invalidate_segment_grid();
+
+struct segment_bounding_sphere
+{
+	vms_vector center;
+	fix radius;
+};
+
+//The sphere about the center of seg which holds all of its vertices.
+//Taken from build_segment_grid when it is valid, else computed.
+segment_bounding_sphere get_segment_bounding_sphere(vcsegptridx_t seg);
+
 //      ----------------------------------------------------------------------------------------------------------
 //      Determine whether seg0 and seg1 are reachable using wid_flag to go through walls.
 //      For example, set to WID_RENDPAST_FLAG to see if sound can get from one segment to the other.
@@ -157,6 +173,17 @@ segptridx_t find_point_seg(const vms_vector &p,segptridx_t segnum);
 struct WALL_IS_DOORWAY_mask_t;
 vm_distance find_connected_distance(const vms_vector &p0, vcsegptridx_t seg0, const vms_vector &p1, vcsegptridx_t seg1, int max_depth, WALL_IS_DOORWAY_mask_t wid_flag);
 
+//	The part of a find_connected_distance result which does not depend on
+//	p1, so that the distance to several points in seg1 needs one search.
+struct connected_route
+{
+	bool reachable, direct;		//	direct: the distance is that from p0 to p1
+	vms_vector p0, near_p1;
+	vm_distance p0_distance;	//	from p0 along the path to near_p1
+};
+connected_route find_connected_route(const vms_vector &p0, vcsegptridx_t seg0, vcsegptridx_t seg1, int max_depth, WALL_IS_DOORWAY_mask_t wid_flag);
+vm_distance connected_route_distance(const connected_route &r, const vms_vector &p1);
+
 //create a matrix that describes the orientation of the given segment
 void extract_orient_from_segment(vms_matrix *m,vcsegptr_t seg);
 
@@ -194,7 +221,14 @@ static inline vms_vector pick_random_point_in_seg(vcsegptr_t sp)
 
 void validate_segment_side(vsegptridx_t sp, int sidenum);
 int check_segment_connections(void);
+//	Forget cached find_connected_distance results.  Must be called
+//	whenever a wall changes in a way which could change WALL_IS_DOORWAY.
 void flush_fcd_cache(void);
+struct fcd_cache_stats
+{
+	unsigned hits, misses;
+};
+fcd_cache_stats get_fcd_cache_stats();
 unsigned set_segment_depths(int start_seg, array<ubyte, MAX_SEGMENTS> *limit, segment_depth_array_t &depths);
 void apply_all_changed_light(void);
 void	set_ambient_sound_flags(void);
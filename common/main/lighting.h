@@ -50,4 +50,9 @@ g3s_lrgb compute_object_light(vobjptridx_t obj,const vms_vector *rotated_pnt);
 void toggle_headlight_active(void);
 void start_lighting_frame(vobjptr_t viewer);
 
+// find the brightest light an object can give off with the current
+// vclips, weapons, robots and powerups.  Call after loading a level and
+// its robot replacements.
+void compute_max_object_light();
+
 #endif
@@ -0,0 +1,23 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Cache of the side types and normals which validate_segment_all derives
+ * from the vertices and the shape of a mine.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+
+//Fill in the side types and normals of the mine which was just decoded,
+//from the cache when it has this mine, else by validate_segment_all.
+void mine_cache_validate_segment_all(const char *level_filename);
+
+#endif
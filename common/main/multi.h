@@ -93,7 +93,7 @@ extern int multi_protocol; // set and determinate used protocol
 #define MULTI_PROTO_UDP 1 // UDP protocol
 
 // What version of the multiplayer protocol is this? Increment each time something drastic changes in Multiplayer without the version number changes. Reset to 0 each time the version of the game changes
-#define MULTI_PROTO_VERSION	static_cast<uint16_t>(23)
+#define MULTI_PROTO_VERSION	static_cast<uint16_t>(26)
 // PROTOCOL VARIABLES AND DEFINES - END
 
 // limits for Packets (i.e. positional updates) per sec
@@ -560,7 +560,6 @@ extern array<grs_main_bitmap, 2> Orb_icons;
 
 // IMPORTANT: These variables needed for player rejoining done by protocol-specific code
 extern int Network_send_objects;
-extern int Network_send_object_mode;
 extern int Network_send_objnum;
 extern int Network_rejoined;
 extern int Network_sending_extras;
@@ -799,6 +798,7 @@ struct netgame_info : prohibit_void_ptr<netgame_info>, ignore_window_pointer_t
 	short						PacketsPerSec;
 	ubyte						PacketLossPrevention;
 	ubyte						NoFriendlyFire;
+	ubyte						PdataDelta;
 	array<callsign_t, 2>					team_name;
 	array<uint32_t, MAX_PLAYERS>						locations;
 	array<array<uint16_t, MAX_PLAYERS>, MAX_PLAYERS>						kills;
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Smooth drawing of objects moved by other players.
+ *
+ * Each position received for a remote ship or robot is kept with the
+ * time it arrived.  While a frame is drawn, such objects are put where
+ * they were a fixed delay ago, interpolated between the positions
+ * received around that time.  Only when no newer position has arrived
+ * yet is the position extrapolated.  The delay is set with -udp_interp
+ * and is 0 (off) by default.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include "maths.h"
+#include "fwd-object.h"
+
+const unsigned MULTI_INTERP_SNAPSHOTS = 8;
+
+struct multi_interp_object_stats
+{
+	unsigned snapshots;
+	//average time between arrivals, and average deviation from it
+	fix64 interval, jitter;
+	//how far the last frame was extrapolated, and the most since the stats were reset
+	fix64 extrapolation, max_extrapolation;
+};
+
+struct multi_interp_stats
+{
+	unsigned objects, frames, extrapolated_frames;
+	fix64 max_jitter, max_extrapolation;
+};
+
+//record a position of objp, which has just been applied to it
+void multi_interp_add(vobjptridx_t objp, const quaternionpos &qpp);
+void multi_interp_reset();
+//move interpolated objects to where they should be drawn, and back
+void multi_interp_begin_render();
+void multi_interp_end_render();
+//false if objnum is not interpolated
+bool multi_interp_get_object_stats(objnum_t objnum, multi_interp_object_stats &stats);
+//counters since the last call
+multi_interp_stats multi_interp_get_stats();
+#endif
@@ -60,7 +60,7 @@ const uint16_t TRACKER_PORT_DEFAULT = 42420;
 #define UDP_NETGAMES_PPAGE 12 // Netgames on one page of Netlist
 #define UDP_NETGAMES_PAGES 75 // Pages available on Netlist (UDP_MAX_NETGAMES/UDP_NETGAMES_PPAGE)
 #define UDP_TIMEOUT (5*F1_0) // 5 seconds disconnect timeout
-#define UDP_MDATA_STOR_QUEUE_SIZE 1024 // Store up to 1024 MDATA packets
+#define UDP_MDATA_STOR_QUEUE_SIZE 1024 // Store up to 1024 MDATA packets. Must be a power of 2.
 #define UDP_MDATA_STOR_MIN_FREE_2JOIN 384 // have at least this many free packet slots before we let someone join the game
 #define UDP_MDATA_PKT_NUM_MIN 1 // start from pkt_num 1 (0 is used to initialize the trace list)
 #define UDP_MDATA_PKT_NUM_MAX (UDP_MDATA_STOR_QUEUE_SIZE*100) // the max value for pkt_num. roll over when we go any higher. this should be smaller than INT_MAX
@@ -83,7 +83,7 @@ const uint16_t TRACKER_PORT_DEFAULT = 42420;
 #define UPID_QUIT_JOINING			  9 // Packet from a player who suddenly quits joining.
 #define UPID_SEQUENCE_SIZE			 (3 + (CALLSIGN_LEN+1))
 #define UPID_SYNC				 10 // Packet from host containing full netgame info to sync players up.
-#define UPID_OBJECT_DATA			 11 // Packet from host containing object buffer.
+#define UPID_SNAPSHOT_DATA			 11 // Packet from host containing part of the compressed level state for a player joining the game.
 #define UPID_PING				 12 // Packet from host containing his GameTime and the Ping list. Client returns this time to host as UPID_PONG and adapts the ping list.
 #define UPID_PING_SIZE				 37
 #define UPID_PONG				 13 // Packet answer from client to UPID_PING. Contains the time the initial ping packet was sent.
@@ -101,6 +101,9 @@ const uint16_t TRACKER_PORT_DEFAULT = 42420;
 #  define UPID_TRACKER_VERIFY			 21 // The tracker has successfully gotten a hold of us
 #  define UPID_TRACKER_INCGAME			 22 // The tracker is sending us some game info
 #endif
+#define UPID_PDATA_DELTA			 23 // Packet from player containing his movement data, delta coded against the last state acknowledged by the receiver.
+#define UPID_MDATA_PNEEDACK_MULTI		 24 // Several UPID_MDATA_PNEEDACK packets resent to one player at once.
+#define UPID_SNAPSHOT_ACK			 25 // Packet from joining player telling which parts of the level state it has.
 
 // Structure keeping lite game infos (for netlist, etc.)
 #if defined(DXX_BUILD_DESCENT_I) || defined(DXX_BUILD_DESCENT_II)
@@ -145,18 +148,18 @@ struct UDP_mdata_store : prohibit_void_ptr<UDP_mdata_store>
 	fix64				pkt_initial_timestamp;			// initial timestamp to see if packet is outdated
 	array<fix64, MAX_PLAYERS>		pkt_timestamp;		// Packet timestamp
 	array<uint32_t, MAX_PLAYERS>	pkt_num;			// Packet number
-	sbyte				used;
+	uint8_t				pending_ack;				// one bit for each player who has not ACK'd this packet, yet
 	ubyte				Player_num;				// sender of this packet
 	uint16_t			data_size;
-	array<uint8_t, MAX_PLAYERS>		player_ack; 		// 0 if player has not ACK'd this packet, 1 if ACK'd or not connected
 	array<uint8_t, UPID_MDATA_BUF_SIZE> data;		// extra data of a packet - contains all multibuf data we don't want to loose
 };
 
 // structure to keep track of MDATA packets we already got, which we expect from another player and the pkt_num for the next packet we want to send to another player
 struct UDP_mdata_check : public prohibit_void_ptr<UDP_mdata_check>
 {
-	array<uint32_t, UDP_MDATA_STOR_QUEUE_SIZE>			pkt_num; 	// all those we got just recently, so we can ignore them if we get them again
-	int				cur_slot; 				// index we can use for a new pkt_num
+	array<uint32_t, UDP_MDATA_STOR_QUEUE_SIZE>			pkt_num; 	// all those we got just recently, indexed by pkt_num, so we can ignore them if we get them again
+	array<uint32_t, UDP_MDATA_STOR_QUEUE_SIZE>			queue_pos; 	// position in the store queue of each pkt_num we sent to this player, indexed by pkt_num
+	fix64				next_resend; 				// earliest time a packet to this player may need to be resent
 	uint32_t			pkt_num_torecv; 			// the next pkt_num we await for this player
 	uint32_t			pkt_num_tosend; 			// the next pkt_num we want to send to another player
 };
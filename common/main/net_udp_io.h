@@ -0,0 +1,85 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Background thread which moves UDP packets between the sockets and the
+ * game thread.
+ *
+ * The thread receives every packet as soon as it arrives, stamps it, and
+ * queues it for the game thread, which drains the queue when it listens.
+ * Packets sent by the game thread are queued and written by the thread
+ * in batches, after each kick.  Host pings are answered by the thread
+ * itself, so that the measured ping does not include how long the game
+ * thread took to get around to them.
+ *
+ */
+
+#pragma once
+
+#include "multi.h"
+
+#ifdef __cplusplus
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "maths.h"
+#include "compiler-array.h"
+
+#ifdef _WIN32
+typedef SOCKET udp_io_socket_t;
+#else
+typedef int udp_io_socket_t;
+#endif
+
+//Largest packet passed through the thread; same as UPID_MAX_SIZE
+const std::size_t UDP_IO_MAX_PACKET = 1024;
+
+struct udp_io_packet
+{
+	udp_io_socket_t socket;
+	_sockaddr addr;
+	socklen_t addrlen;
+	uint16_t size;
+	//set when the thread already answered this packet
+	bool answered;
+	std::chrono::steady_clock::time_point time;
+	//one more byte, so that a received packet can be terminated
+	array<uint8_t, UDP_IO_MAX_PACKET + 1> data;
+};
+
+struct udp_io_stats
+{
+	unsigned received, receive_calls, sent, send_calls, answered, overflows;
+	//how long drained packets waited for the game thread
+	unsigned drained, max_queued;
+	fix64 total_wait, max_wait;
+};
+
+bool net_udp_io_start(const udp_io_socket_t *sockets, unsigned count);
+void net_udp_io_stop();
+bool net_udp_io_running();
+
+/* The next received packet, or nullptr.  The packet stays valid until
+ * net_udp_io_pop.  wait is set to how long it has been queued.
+ */
+const udp_io_packet *net_udp_io_peek(fix64 &wait);
+void net_udp_io_pop();
+void net_udp_io_discard();
+
+//Queue a packet to be sent after the next kick.  Returns false if the caller must send it itself.
+bool net_udp_io_send(udp_io_socket_t socket, const void *msg, std::size_t len, const sockaddr &to, socklen_t tolen);
+//Wake the thread to send what has been queued
+void net_udp_io_kick();
+
+//Answer pings from host with pongs carrying player_num; clear when not a client
+void net_udp_io_set_ping_reply(const _sockaddr &host, uint8_t player_num);
+void net_udp_io_clear_ping_reply();
+
+//Counters since the last call
+udp_io_stats net_udp_io_get_stats();
+#endif
@@ -0,0 +1,82 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Delta coding of player position packets.
+ *
+ * Each stream of positions from one player to one receiver is coded
+ * against the newest state which the receiver has acknowledged.  Fields
+ * which did not change are left out, small changes are sent in fewer
+ * bytes, and velocities are quantized.  The sender keeps the state as
+ * the receiver will rebuild it, so quantization errors do not add up.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include "object.h"
+#include "compiler-array.h"
+
+//how many sent states are remembered; older acks fall back to a keyframe
+const unsigned UDP_PDATA_HISTORY = 16;
+//largest block pdata_delta_encode can write
+const std::size_t UDP_PDATA_DELTA_MAX_BLOCK = 50;
+
+struct pdata_delta_tx
+{
+	uint8_t next_seq, acked_seq;
+	bool have_ack;
+	array<uint8_t, UDP_PDATA_HISTORY> history_seq;
+	array<quaternionpos, UDP_PDATA_HISTORY> history;
+	/* The sequence keeps counting, so that blocks sent before the reset
+	 * cannot be mistaken for later ones.
+	 */
+	void reset()
+	{
+		have_ack = false;
+	}
+	void ack(uint8_t seq);
+	void nack()
+	{
+		have_ack = false;
+	}
+};
+
+struct pdata_delta_rx
+{
+	uint8_t last_seq;
+	bool have_last, ack_pending, nack_pending;
+	array<bool, UDP_PDATA_HISTORY> history_valid;
+	array<uint8_t, UDP_PDATA_HISTORY> history_seq;
+	array<quaternionpos, UDP_PDATA_HISTORY> history;
+	void reset()
+	{
+		last_seq = 0;
+		have_last = ack_pending = nack_pending = false;
+		history_valid = {};
+	}
+};
+
+enum class pdata_delta_result
+{
+	ok,
+	//older than a state already decoded; drop it
+	stale,
+	//coded against a state this receiver does not have; ask for a keyframe
+	missing_base,
+	malformed,
+};
+
+//code qpp into buf, which must hold UDP_PDATA_DELTA_MAX_BLOCK bytes, and return the length
+std::size_t pdata_delta_encode(pdata_delta_tx &tx, const quaternionpos &qpp, uint8_t *buf);
+//decode a block which fills all of buf; on success, the decoded state is stored in qpp
+pdata_delta_result pdata_delta_decode(pdata_delta_rx &rx, const uint8_t *buf, std::size_t len, quaternionpos &qpp);
+#endif
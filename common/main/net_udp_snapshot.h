@@ -0,0 +1,180 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Transfer of the level state to a player joining a game in progress.
+ *
+ * The host serializes the state once, compresses it, and sends it in
+ * numbered chunks.  Up to a window of chunks may be unacknowledged at a
+ * time.  The joining player acknowledges chunks with a bitmap of all the
+ * chunks it has, so only the chunks which were lost are sent again.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "maths.h"
+#include "compiler-array.h"
+
+//compressed bytes carried by one chunk
+const std::size_t UDP_SNAPSHOT_CHUNK_SIZE = 1000;
+//chunk header: id, index, chunk count, raw size, compressed size
+const std::size_t UDP_SNAPSHOT_CHUNK_HEADER = 13;
+const unsigned UDP_SNAPSHOT_MAX_CHUNKS = 256;
+//chunks which may be sent and not acknowledged
+const unsigned UDP_SNAPSHOT_WINDOW = 32;
+//largest ack: id, bitmap of the chunks received
+const std::size_t UDP_SNAPSHOT_ACK_MAX = 1 + UDP_SNAPSHOT_MAX_CHUNKS / 8;
+
+class snapshot_writer
+{
+	std::vector<uint8_t> &v;
+public:
+	snapshot_writer(std::vector<uint8_t> &o) :
+		v(o)
+	{
+	}
+	void put8(const uint8_t b)
+	{
+		v.push_back(b);
+	}
+	void put16(const uint16_t w)
+	{
+		put8(w);
+		put8(w >> 8);
+	}
+	void put32(const uint32_t d)
+	{
+		put16(d);
+		put16(d >> 16);
+	}
+	void put(const void *p, std::size_t n)
+	{
+		const auto b = reinterpret_cast<const uint8_t *>(p);
+		v.insert(v.end(), b, b + n);
+	}
+};
+
+class snapshot_reader
+{
+	const uint8_t *p, *const end;
+	bool overrun;
+public:
+	snapshot_reader(const uint8_t *const buf, const std::size_t len) :
+		p(buf), end(buf + len), overrun(false)
+	{
+	}
+	//true if a get ran past the end; such gets return 0
+	bool failed() const
+	{
+		return overrun;
+	}
+	bool done() const
+	{
+		return !overrun && p == end;
+	}
+	uint8_t get8()
+	{
+		if (p == end)
+		{
+			overrun = true;
+			return 0;
+		}
+		return *p++;
+	}
+	uint16_t get16()
+	{
+		const uint16_t l = get8();
+		return l | (get8() << 8);
+	}
+	uint32_t get32()
+	{
+		const uint32_t l = get16();
+		return l | (static_cast<uint32_t>(get16()) << 16);
+	}
+	bool get(void *o, std::size_t n)
+	{
+		if (static_cast<std::size_t>(end - p) < n)
+		{
+			overrun = true;
+			return false;
+		}
+		std::copy(p, p + n, reinterpret_cast<uint8_t *>(o));
+		p += n;
+		return true;
+	}
+};
+
+//LZ77 coding, good at the runs of zeros in object records
+void snapshot_compress(const uint8_t *in, std::size_t len, std::vector<uint8_t> &out);
+//false unless in decodes to exactly raw_size bytes
+bool snapshot_decompress(const uint8_t *in, std::size_t len, std::size_t raw_size, std::vector<uint8_t> &out);
+
+struct snapshot_tx
+{
+	uint8_t id;
+	unsigned chunks;
+	uint32_t raw_size;
+	std::vector<uint8_t> data;
+	array<bool, UDP_SNAPSHOT_MAX_CHUNKS> acked;
+	array<uint8_t, UDP_SNAPSHOT_MAX_CHUNKS> times_sent;
+	array<fix64, UDP_SNAPSHOT_MAX_CHUNKS> sent_time;
+	//smoothed round trip time, and when the receiver last made progress
+	fix64 srtt, last_progress;
+	unsigned acked_chunks, packets, resent;
+	//compress raw into a new snapshot; false if it does not fit in UDP_SNAPSHOT_MAX_CHUNKS
+	bool start(const std::vector<uint8_t> &raw, fix64 time);
+	void clear();
+	/* Write the next chunk which is due into buf, which must hold
+	 * UDP_SNAPSHOT_CHUNK_HEADER + UDP_SNAPSHOT_CHUNK_SIZE bytes, and return
+	 * its length.  Returns 0 if nothing should be sent now.
+	 */
+	std::size_t next_chunk(fix64 time, uint8_t *buf);
+	void ack(const uint8_t *buf, std::size_t len, fix64 time);
+	bool done() const
+	{
+		return chunks && acked_chunks == chunks;
+	}
+};
+
+struct snapshot_rx
+{
+	uint8_t id;
+	bool active;
+	unsigned chunks, received, unacked;
+	uint32_t raw_size;
+	std::vector<uint8_t> data;
+	array<bool, UDP_SNAPSHOT_MAX_CHUNKS> have;
+	fix64 last_ack;
+	void clear()
+	{
+		active = false;
+		received = unacked = 0;
+		data.clear();
+	}
+	//store a chunk; true when it completed the snapshot
+	bool add(const uint8_t *buf, std::size_t len);
+	bool complete() const
+	{
+		return active && received == chunks;
+	}
+	//whether an ack should be sent now
+	bool want_ack(fix64 time) const;
+	//write an ack into buf, which must hold UDP_SNAPSHOT_ACK_MAX bytes, and return its length
+	std::size_t make_ack(fix64 time, uint8_t *buf);
+	bool decompress(std::vector<uint8_t> &raw) const
+	{
+		return snapshot_decompress(data.data(), data.size(), raw_size, raw);
+	}
+};
+#endif
@@ -0,0 +1,49 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Synthetic clients for load testing the host.
+ *
+ * With -udp_synth <n>, the host of a game adds n scripted players of its
+ * own.  Each has its own socket on the loopback interface and speaks the
+ * same packets as a real client: it asks to join, takes the level state,
+ * then sends positions, shots and acknowledged messages at the rates
+ * given by -udp_synth_pps, -udp_synth_fire and -udp_synth_mdata, and
+ * acknowledges what the host sends it.  They are run from the host's
+ * network frame and draw nothing, so one process can load the host with
+ * a full game.
+ *
+ */
+
+#pragma once
+
+#include "multi.h"
+
+#ifdef __cplusplus
+#include "maths.h"
+#include "perf_timer.h"
+
+struct udp_synth_stats
+{
+	unsigned clients, playing;
+	//host network frames, and the time spent in them apart from the clients
+	unsigned frames;
+	perf_clock::duration host_time, host_max;
+	//what the clients sent and resent
+	unsigned pdata, fires, mdata, acks, resent;
+};
+
+//Run the clients; starts them when this is the host of a game in progress
+void net_udp_synth_frame(fix64 time, uint16_t host_port);
+void net_udp_synth_stop();
+bool net_udp_synth_active();
+//Account for the time the host spent in one network frame
+void net_udp_synth_host_frame(perf_clock::duration d);
+//Counters since the last call
+udp_synth_stats net_udp_synth_get_stats();
+#endif
@@ -126,6 +126,8 @@ extern void newdemo_object_move_all();
 extern void newdemo_playback_one_frame();
 extern void newdemo_goto_end(int to_rewrite);
 extern void newdemo_goto_beginning();
+// Seek by delta of recorded time, indexing the demo first if it has no index
+void newdemo_seek_relative(fix delta);
 
 // Interactive functions to control playback/record;
 extern void newdemo_start_playback( const char * filename );
@@ -134,8 +136,12 @@ extern void newdemo_start_recording();
 extern void newdemo_stop_recording();
 
 extern int newdemo_swap_endian(const char *filename);
+// Write the frame index of a demo in DEMO_DIR beside it
+int newdemo_write_index(const char *filename);
 
 extern int newdemo_get_percent_done();
+// Length of the most recently read demo frame, as recorded
+fix newdemo_get_recorded_frame_time();
 
 extern void newdemo_record_link_sound_to_object3( int soundno, short objnum, fix max_volume, fix  max_distance, int loop_start, int loop_end );
 cobjptridx_t newdemo_find_object(object_signature_t signature);
@@ -0,0 +1,111 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Frame index of a demo, kept beside it in a .dmi file.
+ *
+ * Demos can only be decoded forward, since most of what a frame changes
+ * (walls, player stats, the reactor) is recorded as events.  The index
+ * holds where every frame ends in the demo and the recorded time up to
+ * it, and every few seconds of recorded time a keyframe: all the state
+ * those events change.  To seek, the nearest keyframe before the target
+ * is restored and only the frames after it are decoded.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#include <vector>
+#include "maths.h"
+#include "physfsx.h"
+#include "player.h"
+#include "weapon.h"
+#include "compiler-array.h"
+
+#define DEMO_INDEX_EXT	"dmi"
+
+struct demo_index_frame
+{
+	//position just after the frame
+	uint32_t offset;
+	//recorded time up to and including the frame
+	fix time;
+	int8_t level;
+};
+
+struct demo_keyframe_player
+{
+	callsign_t callsign;
+	int8_t connected;
+	uint32_t flags;
+	fix energy, shields;
+	uint8_t laser_level;
+	uint16_t primary_weapon_flags, secondary_weapon_flags, vulcan_ammo;
+	array<uint8_t, MAX_SECONDARY_WEAPONS> secondary_ammo;
+	int32_t score;
+	int16_t net_killed_total, net_kills_total;
+	uint8_t hostages_on_board;
+};
+
+struct demo_keyframe_wall
+{
+	uint8_t type, flags, state;
+	int8_t cloak_value;
+	int16_t tmap_num, tmap_num2;
+	//side light, which cloaking walls fade
+	array<fix, 4> light;
+};
+
+struct demo_keyframe
+{
+	//the frame after which the state was taken
+	uint32_t frame;
+	int8_t level;
+	//playback state which newdemo.cpp keeps to itself
+	uint8_t cntrlcen_destroyed, dead, rear, guided;
+	int8_t primary_weapon, secondary_weapon;
+	uint8_t n_players;
+	int32_t control_center_destroyed, countdown_seconds_left;
+	fix afterburner_charge;
+	array<demo_keyframe_player, MAX_PLAYERS> players;
+	std::vector<demo_keyframe_wall> walls;
+	//tmap_num2 of every side which has one but no wall, in segment
+	//order, since blowing up monitors and lights changes it
+	std::vector<int16_t> side_tmap_num2;
+};
+
+struct demo_index
+{
+	//the demo it was built from
+	uint32_t demo_size, demo_hash;
+	std::vector<demo_index_frame> frames;
+	std::vector<demo_keyframe> keyframes;
+	void clear();
+	bool read(const char *filename, uint32_t demo_size, uint32_t demo_hash);
+	bool write(const char *filename) const;
+	//the frame at which fp is now, or the one before it
+	unsigned frame_at_offset(uint32_t offset) const;
+	//the first frame which reaches time t, or the last frame
+	unsigned frame_at_time(fix t) const;
+	//the latest keyframe taken before frame, or null
+	const demo_keyframe *keyframe_before(unsigned frame) const;
+};
+
+//how much recorded time there is between keyframes
+const fix DEMO_KEYFRAME_INTERVAL = i2f(5);
+
+//identifies a demo by its size, start and end; leaves fp where it was
+uint32_t demo_index_hash(PHYSFS_File *fp);
+void demo_index_filename(char *index_name, const char *demo_name);
+//the game state of a keyframe
+void demo_keyframe_capture(demo_keyframe &k);
+//false if the keyframe was taken in a level other than this one
+bool demo_keyframe_restore(const demo_keyframe &k);
+#endif
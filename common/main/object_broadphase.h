@@ -0,0 +1,46 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Find objects near a point or a set of segments by walking segment
+ * adjacency and the per-segment object lists, instead of scanning every
+ * object in the level.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <vector>
+#include "fwd-segment.h"
+#include "fwd-object.h"
+#include "segnum.h"
+#include "objnum.h"
+
+#if defined(DXX_BUILD_DESCENT_I) || defined(DXX_BUILD_DESCENT_II)
+/* Append every segment which can be reached from start through
+ * connected sides, and which has some point within radius of pos.
+ * Wall state is ignored, so callers which care about walls must still
+ * check visibility.  Any straight line from pos of length at most
+ * radius stays within the returned segments.
+ */
+void find_segments_within_radius(std::vector<segnum_t> &result, vcsegptridx_t start, const vms_vector &pos, fix radius);
+
+/* Replace result with the objects linked into the given segments, in
+ * increasing object number so that callers see objects in the same
+ * order as a scan of highest_valid(Objects).
+ */
+void gather_objects_in_segments(std::vector<objnum_t> &result, const std::vector<segnum_t> &segments);
+
+/* Objects which might be within radius of pos, starting the search in
+ * the segment containing pos.
+ */
+void find_objects_within_radius(std::vector<objnum_t> &result, vcsegptridx_t start, const vms_vector &pos, fix radius);
+#endif
+
+#endif
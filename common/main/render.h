@@ -121,6 +121,9 @@ void render_frame(fix eye_offset, window_rendered_data &);  //draws the world in
 
 void render_mine(segnum_t start_seg_num, fix eye_offset, window_rendered_data &);
 
+// Number of times render_mine has had to grow its reusable buffers
+unsigned get_render_state_heap_allocations();
+
 #if defined(DXX_BUILD_DESCENT_II)
 void update_rendered_data(window_rendered_data &window, vobjptr_t viewer, int rear_view_flag);
 #endif
@@ -1,10 +1,11 @@
 #pragma once
 
-#include <unordered_map>
+#include <limits>
 #include <vector>
 #include "dxxsconf.h"
 #include "fwd-segment.h"
 #include "compiler-array.h"
+#include "partial_range.h"
 #include "segnum.h"
 #include "objnum.h"
 
@@ -23,22 +24,81 @@ struct render_state_t
 		{
 			objnum_t objnum;
 		};
-		std::vector<distant_object> objects;
+		uint16_t generation;	//value of render_state_t::generation when this entry was last reset
+		short render_pos;	//where in Render_list does this segment appear?
 		uint16_t Seg_depth;		//depth for this seg in Render_list
 		bool processed;		//whether this entry has been processed
 		rect render_window;
-		per_segment_state_t() :
-			Seg_depth(0), processed(false)
+		uint16_t first_object, num_objects;	//slice of object_arena holding the objects in this seg
+	};
+	typedef per_segment_state_t::distant_object distant_object;
+	typedef partial_range_t<distant_object *> object_range;
+	struct pending_object
+	{
+		segnum_t segnum;
+		objnum_t objnum;
+	};
+	/* Dense table indexed by segment number.  Entries are reset lazily
+	 * on first access in a frame, so starting a frame only increments
+	 * the generation counter instead of clearing every entry.
+	 */
+	class segment_state_table
+	{
+		array<per_segment_state_t, MAX_SEGMENTS> a;
+		uint16_t generation;
+	public:
+		segment_state_table() :
+			a{}, generation(0)
+		{
+		}
+		void next_generation()
 		{
+			if (generation == std::numeric_limits<decltype(generation)>::max())
+			{
+				a = {};
+				generation = 0;
+			}
+			++ generation;
+		}
+		per_segment_state_t &operator[](segnum_t segnum)
+		{
+			auto &s = a[segnum];
+			if (s.generation != generation)
+			{
+				s.generation = generation;
+				s.render_pos = -1;
+				s.Seg_depth = 0;
+				s.processed = false;
+				s.first_object = s.num_objects = 0;
+			}
+			return s;
 		}
 	};
 	unsigned N_render_segs;
+	/* Number of times object_arena or pending_objects had to grow.
+	 * Both are kept across frames, so after the first few frames
+	 * this should stop increasing.
+	 */
+	unsigned heap_allocations;
 	array<segnum_t, MAX_RENDER_SEGS> Render_list;
-	array<short, MAX_SEGMENTS> render_pos;	//where in render_list does this segment appear?
-	std::unordered_map<segnum_t, per_segment_state_t> render_seg_map;
+	segment_state_table render_seg_map;
+	std::vector<pending_object> pending_objects;
+	std::vector<distant_object> object_arena;
 	render_state_t() :
-		N_render_segs(0)
+		N_render_segs(0), heap_allocations(0)
+	{
+	}
+	void begin_frame()
+	{
+		N_render_segs = 0;
+		render_seg_map.next_generation();
+		pending_objects.clear();
+		object_arena.clear();
+	}
+	object_range objects(const per_segment_state_t &s)
 	{
+		const auto b = object_arena.data() + s.first_object;
+		return {b, b + s.num_objects};
 	}
 };
 
@@ -34,6 +34,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #ifdef __cplusplus
 #include <cassert>
 #include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include "countarray.h"
 #include "valptridx.h"
@@ -407,4 +408,41 @@ public:
 		return this->template make_maskproxy<const_bitproxy_t>(this->a, segnum);
 	}
 };
+
+/* Like visited_segment_bitarray_t, but meant to be kept across
+ * searches.  Starting a new search only bumps the generation instead
+ * of clearing every entry.
+ */
+class visited_segment_generation_t
+{
+	array<uint16_t, MAX_SEGMENTS> a;
+	uint16_t generation;
+public:
+	visited_segment_generation_t() :
+		a{}, generation(0)
+	{
+	}
+	void next_generation()
+	{
+		if (generation == std::numeric_limits<decltype(generation)>::max())
+		{
+			a = {};
+			generation = 0;
+		}
+		++ generation;
+	}
+	bool operator[](const segnum_t segnum) const
+	{
+		return a[segnum] == generation;
+	}
+	//returns true if segnum was not already marked
+	bool mark(const segnum_t segnum)
+	{
+		auto &g = a[segnum];
+		if (g == generation)
+			return false;
+		g = generation;
+		return true;
+	}
+};
 #endif
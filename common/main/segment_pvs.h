@@ -0,0 +1,56 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Per-segment potentially visible sets, used to bound the portal walk
+ * in build_segment_list.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#include "segnum.h"
+
+/* One row of the PVS: the set of segments which might be seen from
+ * anywhere inside a given segment.  A default constructed row means
+ * that no PVS is available and every segment must be assumed visible.
+ */
+class segment_pvs_row
+{
+	const uint8_t *bits;
+public:
+	segment_pvs_row() :
+		bits(nullptr)
+	{
+	}
+	explicit segment_pvs_row(const uint8_t *b) :
+		bits(b)
+	{
+	}
+	explicit operator bool() const
+	{
+		return bits;
+	}
+	bool operator[](const segnum_t s) const
+	{
+		return bits[s >> 3] & (1 << (s & 7));
+	}
+};
+
+//Load the PVS for the level which was just loaded from the cache, or
+//start computing it on a worker thread.  Until the worker is done,
+//segment_pvs_get returns rows which allow every segment.
+void segment_pvs_load_level(const char *level_name, uint16_t segments_checksum);
+//Discard the PVS, stopping the worker if it is running.  Called whenever
+//the mine is about to change, and at exit.
+void segment_pvs_invalidate();
+segment_pvs_row segment_pvs_get(segnum_t);
+
+#endif
@@ -62,6 +62,10 @@ enum class blind_save
 };
 
 int state_save_all_sub(const char *filename, const char *desc);
+//	The file is written out by a worker after state_save_all_sub returns.
+//	Wait for it before touching savegames; poll to report it once done.
+void state_save_wait();
+void state_save_poll();
 
 int state_get_save_file(char *fname, char * dsc, blind_save);
 int state_get_restore_file(char *fname, blind_save);
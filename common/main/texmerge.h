@@ -28,13 +28,24 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define _TEXMERGE_H
 
 #ifdef __cplusplus
+#include <cstddef>
 
 struct grs_bitmap;
 
-int texmerge_init(int num_cached_textures);
+struct texmerge_cache_stats
+{
+	unsigned hits, misses, entries;
+	//Merged bitmaps which were freed or given to another pair
+	unsigned evictions;
+	std::size_t bytes, budget;
+};
+
+//Keep at most budget_bytes of merged bitmaps, and at least one.
+int texmerge_init(std::size_t budget_bytes);
 grs_bitmap &texmerge_get_cached_bitmap(unsigned tmap_bottom, unsigned tmap_top);
 void texmerge_close();
 void texmerge_flush();
+texmerge_cache_stats texmerge_get_stats();
 
 #endif
 
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Unthrottled demo playback benchmark
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include "maths.h"
+
+#if defined(DXX_BUILD_DESCENT_I) || defined(DXX_BUILD_DESCENT_II)
+extern bool Timedemo_active;
+
+// Start playing the demo named by -timedemo.  Does nothing if there is none.
+void timedemo_start();
+// Called by calc_frame_time instead of waiting.  Records the wall time
+// of the frame that just finished and returns the game time the next
+// frame should advance by.
+fix timedemo_frame();
+// Print the results and ask the program to quit.
+void timedemo_finish();
+#endif
+
+#endif
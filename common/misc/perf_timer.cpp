@@ -0,0 +1,29 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+#include "perf_timer.h"
+
+bool Perf_timers_enabled;
+perf_durations Perf_accumulated;
+
+const char *perf_subsystem_name(const perf_subsystem s)
+{
+	switch (s)
+	{
+		case perf_subsystem::render:
+			return "render";
+		case perf_subsystem::object_lists:
+			return "object_lists";
+		case perf_subsystem::lighting:
+			return "lighting";
+		case perf_subsystem::texture_map:
+			return "texture_map";
+		case perf_subsystem::sound:
+			return "sound";
+	}
+	return "unknown";
+}
@@ -23,6 +23,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  *
  */
 
+#include <algorithm>
 #include "pstypes.h"
 #include "maths.h"
 #include "vecmat.h"
@@ -35,6 +36,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "rle.h"
 #include "scanline.h"
 #include "u_mem.h"
+#include "perf_timer.h"
 
 #include "dxxsconf.h"
 #include "compiler-integer_sequence.h"
@@ -54,16 +56,16 @@ unsigned	Current_seg_depth;		// HACK INTERFACE: how far away the current segment
 // These variables are the interface to assembler.  They get set for each texture map, which is a real waste of time.
 //	They should be set only when they change, which is generally when the window bounds change.  And, even still, it's
 //	a pretty bad interface.
-int	bytes_per_row=-1;
-unsigned char *write_buffer;
+thread_local int	bytes_per_row=-1;
+thread_local unsigned char *write_buffer;
 
-fix fx_l, fx_u, fx_v, fx_z, fx_du_dx, fx_dv_dx, fx_dz_dx, fx_dl_dx;
-int fx_xleft, fx_xright, fx_y;
-const unsigned char *pixptr;
-int Transparency_on = 0;
+thread_local fix fx_l, fx_u, fx_v, fx_z, fx_du_dx, fx_dv_dx, fx_dz_dx, fx_dl_dx;
+thread_local int fx_xleft, fx_xright, fx_y;
+thread_local const unsigned char *pixptr;
+thread_local int Transparency_on = 0;
 
-ubyte tmap_flat_color;
-ubyte tmap_flat_shade_value;
+thread_local ubyte tmap_flat_color;
+thread_local ubyte tmap_flat_shade_value;
 
 
 
@@ -105,7 +107,8 @@ void init_interface_vars_to_assembler(void)
 }
 
 #ifndef OGL
-static int Lighting_enabled;
+thread_local int Lighting_enabled;
+thread_local int Tmap_band_top = INT_MIN, Tmap_band_bot = INT_MAX;
 // -------------------------------------------------------------------------------------
 //                             VARIABLES
 
@@ -318,8 +321,12 @@ static void ntmap_scanline_lighted(const grs_bitmap &srcb, int y, fix xleft, fix
 
 	switch (Lighting_enabled) {
 		case 0:
+			//the scanline functions always apply fx_l, so draw unlit spans at full brightness instead of with the light left over from the last span
+			fx_l = MAX_LIGHTING_VALUE*NUM_LIGHTING_LEVELS;
+			fx_dl_dx = 0;
 			//added 05/17/99 Matt Mueller - prevent writing before the buffer
-            if ((fx_y == 0) && (fx_xleft < 0))
+			//clamp on every row, so that no span wraps into the row above
+            if (fx_xleft < 0)
 				fx_xleft = 0;
 			//end addition -MM
 			if (fx_xright > Window_clip_right)
@@ -346,7 +353,8 @@ static void ntmap_scanline_lighted(const grs_bitmap &srcb, int y, fix xleft, fix
 				fx_dl_dx -= 12;
 
 			//added 05/17/99 Matt Mueller - prevent writing before the buffer
-            if ((fx_y == 0) && (fx_xleft < 0))
+			//clamp on every row, so that no span wraps into the row above
+            if (fx_xleft < 0)
 				fx_xleft = 0;
 			//end addition -MM
 			if (fx_xright > Window_clip_right)
@@ -401,7 +409,7 @@ static void ntexture_map_lighted(const grs_bitmap &srcb, const g3ds_tmap &t)
 	// Set top and bottom (of entire texture map) y coordinates.
 	topy = f2i(v3d[vlt].y2d);
 	boty = f2i(v3d[max_y_vertex].y2d);
-	if (topy > Window_clip_bot)
+	if (topy > Window_clip_bot || topy > Tmap_band_bot)
 		return;
 	if (boty > Window_clip_bot)
 		boty = Window_clip_bot;
@@ -448,6 +456,9 @@ static void ntexture_map_lighted(const grs_bitmap &srcb, const g3ds_tmap &t)
 	next_break_right = f2i(v3d[vrb].y2d);
 
 	for (int y = topy; y < boty; y++) {
+		//rows below the band belong to another thread
+		if (y > Tmap_band_bot)
+			return;
 
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
@@ -517,12 +528,12 @@ static void ntexture_map_lighted(const grs_bitmap &srcb, const g3ds_tmap &t)
 		}
 
 		if (Lighting_enabled) {
-			if (y >= Window_clip_top)
+			if (y >= Window_clip_top && y >= Tmap_band_top)
 				ntmap_scanline_lighted(srcb,y,xleft,xright,uleft,uright,vleft,vright,zleft,zright,lleft,lright);
 			lleft += dl_dy_left;
 			lright += dl_dy_right;
 		} else
-			if (y >= Window_clip_top)
+			if (y >= Window_clip_top && y >= Tmap_band_top)
 				ntmap_scanline_lighted(srcb,y,xleft,xright,uleft,uright,vleft,vright,zleft,zright,lleft,lright);
 
 		uleft += du_dy_left;
@@ -542,7 +553,8 @@ static void ntexture_map_lighted(const grs_bitmap &srcb, const g3ds_tmap &t)
 	// We can get lleft or lright out of bounds here because we compute dl_dy using fixed point values,
 	//	but we plot an integer number of scanlines, therefore doing an integer number of additions of the delta.
 
-	ntmap_scanline_lighted(srcb,boty,xleft,xright,uleft,uright,vleft,vright,zleft,zright,lleft,lright);
+	if (boty >= Tmap_band_top && boty <= Tmap_band_bot)
+		ntmap_scanline_lighted(srcb,boty,xleft,xright,uleft,uright,vleft,vright,zleft,zright,lleft,lright);
 }
 
 
@@ -578,6 +590,9 @@ static void ntmap_scanline_lighted_linear(const grs_bitmap &srcb, int y, fix xle
 				if (fx_xleft < 0)
 					fx_xleft = 0;
 				//end addition -adb
+				//do not wrap into the next row
+				if (fx_xright > Window_clip_right)
+					fx_xright = Window_clip_right;
 				
 				cur_tmap_scanline_lin_nolight();
 				break;
@@ -596,6 +611,9 @@ static void ntmap_scanline_lighted_linear(const grs_bitmap &srcb, int y, fix xle
 				if (fx_xleft < 0)
 					fx_xleft = 0;
 				//end addition -adb
+				//do not wrap into the next row
+				if (fx_xright > Window_clip_right)
+					fx_xright = Window_clip_right;
 
 {
 			fix mul_thing;
@@ -660,7 +678,7 @@ static void ntexture_map_lighted_linear(const grs_bitmap &srcb, const g3ds_tmap
 	topy = f2i(v3d[vlt].y2d);
 	boty = f2i(v3d[max_y_vertex].y2d);
 
-	if (topy > Window_clip_bot)
+	if (topy > Window_clip_bot || topy > Tmap_band_bot)
 		return;
 	if (boty > Window_clip_bot)
 		boty = Window_clip_bot;
@@ -703,6 +721,9 @@ static void ntexture_map_lighted_linear(const grs_bitmap &srcb, const g3ds_tmap
 	next_break_right = f2i(v3d[vrb].y2d);
 
 	for (int y = topy; y < boty; y++) {
+		//rows below the band belong to another thread
+		if (y > Tmap_band_bot)
+			return;
 
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
@@ -767,11 +788,13 @@ static void ntexture_map_lighted_linear(const grs_bitmap &srcb, const g3ds_tmap
 		}
 
 		if (Lighting_enabled) {
-			ntmap_scanline_lighted_linear(srcb,y,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
+			if (y >= Tmap_band_top)
+				ntmap_scanline_lighted_linear(srcb,y,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
 			lleft += dl_dy_left;
 			lright += dl_dy_right;
 		} else
-			ntmap_scanline_lighted_linear(srcb,y,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
+			if (y >= Tmap_band_top)
+				ntmap_scanline_lighted_linear(srcb,y,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
 
 		uleft += du_dy_left;
 		vleft += dv_dy_left;
@@ -787,11 +810,65 @@ static void ntexture_map_lighted_linear(const grs_bitmap &srcb, const g3ds_tmap
 	// We can get lleft or lright out of bounds here because we compute dl_dy using fixed point values,
 	//	but we plot an integer number of scanlines, therefore doing an integer number of additions of the delta.
 
-	ntmap_scanline_lighted_linear(srcb,boty,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
+	if (boty >= Tmap_band_top && boty <= Tmap_band_bot)
+		ntmap_scanline_lighted_linear(srcb,boty,xleft,xright,uleft,uright,vleft,vright,lleft,lright);
 }
 
 // fix	DivNum = F1_0*12;
 
+// -------------------------------------------------------------------------------------
+//	Record where c should be drawn, and which rows it may touch.
+// -------------------------------------------------------------------------------------
+void tmap_command_capture(tmap_command &c)
+{
+	c.clip_left = Window_clip_left;
+	c.clip_top = Window_clip_top;
+	c.clip_right = Window_clip_right;
+	c.clip_bot = Window_clip_bot;
+	c.bytes_per_row = bytes_per_row;
+	c.write_buffer = write_buffer;
+	int top = INT_MAX, bot = INT_MIN;
+	for (int i = 0; i < c.tmap.nv; i++)
+	{
+		const int y = f2i(c.tmap.verts[i].y2d);
+		top = std::min(top, y);
+		bot = std::max(bot, y);
+	}
+	c.top = top;
+	c.bot = bot;
+}
+
+// -------------------------------------------------------------------------------------
+//	Load the interface variables of this thread from c, and draw it.
+// -------------------------------------------------------------------------------------
+void tmap_command_execute(const tmap_command &c, const int top, const int bot)
+{
+	Window_clip_left = c.clip_left;
+	Window_clip_top = c.clip_top;
+	Window_clip_right = c.clip_right;
+	Window_clip_bot = c.clip_bot;
+	bytes_per_row = c.bytes_per_row;
+	write_buffer = c.write_buffer;
+	Transparency_on = c.transparency;
+	Lighting_enabled = c.lighting;
+	tmap_flat_color = c.flat_color;
+	tmap_flat_fade_level = c.fade_level;
+	Tmap_band_top = top;
+	Tmap_band_bot = bot;
+	switch (c.type)
+	{
+		case tmap_command_type::flat:
+			texture_map_flat(c.tmap);
+			break;
+		case tmap_command_type::linear:
+			ntexture_map_lighted_linear(*c.bitmap, c.tmap);
+			break;
+		case tmap_command_type::perspective:
+			ntexture_map_lighted(*c.bitmap, c.tmap);
+			break;
+	}
+}
+
 // -------------------------------------------------------------------------------------
 // Interface from Matt's data structures to Mike's texture mapper.
 // -------------------------------------------------------------------------------------
@@ -799,7 +876,7 @@ void draw_tmap(const grs_bitmap &rbp,uint_fast32_t nverts,const g3s_point *const
 {
 	//	These variables are used in system which renders texture maps which lie on one scanline as a line.
 	// fix	div_numerator;
-	int	lighting_on_save = Lighting_on;
+	perf_scope perf(perf_subsystem::texture_map);
 
 	Assert(nverts <= MAX_TMAP_VERTS);
 
@@ -812,83 +889,55 @@ void draw_tmap(const grs_bitmap &rbp,uint_fast32_t nverts,const g3s_point *const
 
 	bp = rle_expand_texture(*bp);		// Expand if rle'd
 
-	Transparency_on = bp->bm_flags & BM_FLAG_TRANSPARENT;
-	if (bp->bm_flags & BM_FLAG_NO_LIGHTING)
-		Lighting_on = 0;
-
-
-	// Setup texture map in Tmap1
-	g3ds_tmap Tmap1;
-	Tmap1.nv = nverts;						// Initialize number of vertices
-
-// 	div_numerator = DivNum;	//f1_0*3;
+	const int lighting = (bp->bm_flags & BM_FLAG_NO_LIGHTING) ? 0 : Lighting_on;
+	Assert(lighting < 3);
 
-	for (int i=0; i<nverts; i++) {
-		g3ds_vertex	*tvp = &Tmap1.verts[i];
-		auto vp = vertbuf[i];
+	tmap_command_type type;
+	switch (Interpolation_method) {	// 0 = choose, 1 = linear, 2 = /8 perspective, 3 = full perspective
+		case 0:								// choose best interpolation
+			type = (Current_seg_depth > Max_perspective_depth) ? tmap_command_type::linear : tmap_command_type::perspective;
+			break;
+		case 1:								// linear interpolation
+			type = tmap_command_type::linear;
+			break;
+		case 2:								// perspective every 8th pixel interpolation
+		case 3:								// perspective every pixel interpolation
+			type = tmap_command_type::perspective;
+			break;
+		default:
+			Assert(0);				// Illegal value for Interpolation_method, must be 0,1,2,3
+			return;
+	}
 
-		tvp->x2d = vp->p3_sx;
-		tvp->y2d = vp->p3_sy;
+	tmap_command_submit([=](tmap_command &c) {
+		c.type = type;
+		c.lighting = lighting;
+		c.transparency = bp->bm_flags & BM_FLAG_TRANSPARENT;
+		c.bitmap = bp;
 
-		//	Check for overflow on fixdiv.  Will overflow on vp->z <= something small.  Allow only as low as 256.
-		auto clipped_p3_z = std::max(256, vp->p3_z);
-		tvp->z = fixdiv(F1_0*12, clipped_p3_z);
-		tvp->u = vp->p3_u << 6; //* bp->bm_w;
-		tvp->v = vp->p3_v << 6; //* bp->bm_h;
+		// Setup texture map in Tmap1
+		auto &Tmap1 = c.tmap;
+		Tmap1.nv = nverts;						// Initialize number of vertices
 
-		Assert(Lighting_on < 3);
+// 	div_numerator = DivNum;	//f1_0*3;
 
-		if (Lighting_on)
-			tvp->l = vp->p3_l * NUM_LIGHTING_LEVELS;
-	}
+		for (int i=0; i<nverts; i++) {
+			g3ds_vertex	*tvp = &Tmap1.verts[i];
+			auto vp = vertbuf[i];
 
+			tvp->x2d = vp->p3_sx;
+			tvp->y2d = vp->p3_sy;
 
-	Lighting_enabled = Lighting_on;
+			//	Check for overflow on fixdiv.  Will overflow on vp->z <= something small.  Allow only as low as 256.
+			auto clipped_p3_z = std::max(256, vp->p3_z);
+			tvp->z = fixdiv(F1_0*12, clipped_p3_z);
+			tvp->u = vp->p3_u << 6; //* bp->bm_w;
+			tvp->v = vp->p3_v << 6; //* bp->bm_h;
 
-	// Now, call my texture mapper.
-	if (Lighting_on) {
-		switch (Interpolation_method) {	// 0 = choose, 1 = linear, 2 = /8 perspective, 3 = full perspective
-			case 0:								// choose best interpolation
-				if (Current_seg_depth > Max_perspective_depth)
-					ntexture_map_lighted_linear(*bp, Tmap1);
-				else
-					ntexture_map_lighted(*bp, Tmap1);
-				break;
-			case 1:								// linear interpolation
-				ntexture_map_lighted_linear(*bp, Tmap1);
-				break;
-			case 2:								// perspective every 8th pixel interpolation
-				ntexture_map_lighted(*bp, Tmap1);
-				break;
-			case 3:								// perspective every pixel interpolation
-				ntexture_map_lighted(*bp, Tmap1);
-				break;
-			default:
-				Assert(0);				// Illegal value for Interpolation_method, must be 0,1,2,3
+			if (lighting)
+				tvp->l = vp->p3_l * NUM_LIGHTING_LEVELS;
 		}
-	} else {
-		switch (Interpolation_method) {	// 0 = choose, 1 = linear, 2 = /8 perspective, 3 = full perspective
-			case 0:								// choose best interpolation
-				if (Current_seg_depth > Max_perspective_depth)
-					ntexture_map_lighted_linear(*bp, Tmap1);
-				else
-					ntexture_map_lighted(*bp, Tmap1);
-				break;
-			case 1:								// linear interpolation
-				ntexture_map_lighted_linear(*bp, Tmap1);
-				break;
-			case 2:								// perspective every 8th pixel interpolation
-				ntexture_map_lighted(*bp, Tmap1);
-				break;
-			case 3:								// perspective every pixel interpolation
-				ntexture_map_lighted(*bp, Tmap1);
-				break;
-			default:
-				Assert(0);				// Illegal value for Interpolation_method, must be 0,1,2,3
-		}
-	}
-
-	Lighting_on = lighting_on_save;
-
+		tmap_command_capture(c);
+	});
 }
 #endif
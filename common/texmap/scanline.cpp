@@ -29,6 +29,8 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
 #include "maths.h"
 #include "gr.h"
 #include "grdef.h"
@@ -37,6 +39,31 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "scanline.h"
 #include "strutil.h"
 #include "dxxerror.h"
+#include "console.h"
+
+#include "compiler-range_for.h"
+#include "partial_range.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DXX_TMAP_HAVE_SSE2	1
+#else
+#define DXX_TMAP_HAVE_SSE2	0
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DXX_TMAP_HAVE_AVX2	1
+#else
+#define DXX_TMAP_HAVE_AVX2	0
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define DXX_TMAP_HAVE_NEON	1
+#else
+#define DXX_TMAP_HAVE_NEON	0
+#endif
 
 tmap_scanline_function_table tmap_scanline_functions;
 
@@ -757,11 +784,329 @@ static void c_tmap_scanline_quad()
 	}
 }
 
+namespace {
+
+/* Interpolants of a perspective span.  They are stepped with wrapping
+ * unsigned arithmetic, which gives the same bits as the fix additions in
+ * c_tmap_scanline_per.
+ */
+struct perspective_span
+{
+	uint32_t u, v, z, dudx, dvdx, dzdx;
+	perspective_span() :
+		u(fx_u), v(static_cast<uint32_t>(fx_v) * 64), z(fx_z), dudx(fx_du_dx), dvdx(static_cast<uint32_t>(fx_dv_dx) * 64), dzdx(fx_dz_dx)
+	{
+	}
+	void advance(const uint32_t n)
+	{
+		u += n * dudx;
+		v += n * dvdx;
+		z += n * dzdx;
+	}
+};
+
+}
+
+//Pixels per call to a texel_offsets function
+static const unsigned tmap_per_block = 32;
+//Widest vector used by any texel_offsets function
+static const unsigned tmap_per_max_lanes = 8;
+
+/* Number of pixels c_tmap_scanline_per writes for the current span.  It
+ * stops short of the last byte of the screen.
+ */
+static int tmap_span_length()
+{
+	const int x = fx_xright - fx_xleft + 1;
+	const int remaining = SWIDTH*SHEIGHT - 1 - (fx_xleft + (bytes_per_row * fx_y));
+	return std::min(x, remaining);
+}
+
+/* The vector kernels below compute the texel offset of each pixel with
+ * the same per-pixel divide as c_tmap_scanline_per.  The divide is done
+ * in double precision, which is exact for 32-bit operands: the rounding
+ * error of the quotient is always smaller than its distance to the next
+ * integer, so truncating gives the integer quotient.
+ */
+#if DXX_TMAP_HAVE_SSE2
+static inline __m128i tmap_quotient_sse2(const __m128i n, const __m128i d)
+{
+	const auto high = [](const __m128i i) { return _mm_shuffle_epi32(i, _MM_SHUFFLE(1, 0, 3, 2)); };
+	const __m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(n), _mm_cvtepi32_pd(d)));
+	const __m128i hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(high(n)), _mm_cvtepi32_pd(high(d))));
+	return _mm_unpacklo_epi64(lo, hi);
+}
+
+static void tmap_texel_offsets_sse2(perspective_span &s, uint32_t *const out, const unsigned count)
+{
+	const auto start = [](const uint32_t i, const uint32_t di) {
+		return _mm_set_epi32(i + 3 * di, i + 2 * di, i + di, i);
+	};
+	__m128i u = start(s.u, s.dudx), v = start(s.v, s.dvdx), z = start(s.z, s.dzdx);
+	const __m128i du = _mm_set1_epi32(4 * s.dudx), dv = _mm_set1_epi32(4 * s.dvdx), dz = _mm_set1_epi32(4 * s.dzdx);
+	const __m128i umask = _mm_set1_epi32(63), vmask = _mm_set1_epi32(64 * 63);
+	for (unsigned i = 0; i < count; i += 4)
+	{
+		const __m128i offset = _mm_add_epi32(_mm_and_si128(tmap_quotient_sse2(v, z), vmask), _mm_and_si128(tmap_quotient_sse2(u, z), umask));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), offset);
+		u = _mm_add_epi32(u, du);
+		v = _mm_add_epi32(v, dv);
+		z = _mm_add_epi32(z, dz);
+	}
+	s.advance(count);
+}
+#endif
+
+#if DXX_TMAP_HAVE_AVX2
+//Built for AVX2 regardless of the target flags; only used if the CPU supports it.
+__attribute__((target("avx2")))
+static inline __m256i tmap_start_avx2(const uint32_t i, const uint32_t di)
+{
+	return _mm256_add_epi32(_mm256_set1_epi32(i), _mm256_mullo_epi32(_mm256_set1_epi32(di), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i tmap_quotient_avx2(const __m256i n, const __m256i d)
+{
+	const __m128i lo = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(n)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(d))));
+	const __m128i hi = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(d, 1))));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+__attribute__((target("avx2")))
+static void tmap_texel_offsets_avx2(perspective_span &s, uint32_t *const out, const unsigned count)
+{
+	__m256i u = tmap_start_avx2(s.u, s.dudx), v = tmap_start_avx2(s.v, s.dvdx), z = tmap_start_avx2(s.z, s.dzdx);
+	const __m256i du = _mm256_set1_epi32(8 * s.dudx), dv = _mm256_set1_epi32(8 * s.dvdx), dz = _mm256_set1_epi32(8 * s.dzdx);
+	const __m256i umask = _mm256_set1_epi32(63), vmask = _mm256_set1_epi32(64 * 63);
+	for (unsigned i = 0; i < count; i += 8)
+	{
+		const __m256i offset = _mm256_add_epi32(_mm256_and_si256(tmap_quotient_avx2(v, z), vmask), _mm256_and_si256(tmap_quotient_avx2(u, z), umask));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), offset);
+		u = _mm256_add_epi32(u, du);
+		v = _mm256_add_epi32(v, dv);
+		z = _mm256_add_epi32(z, dz);
+	}
+	s.advance(count);
+}
+#endif
+
+#if DXX_TMAP_HAVE_NEON
+static inline int32x4_t tmap_quotient_neon(const int32x4_t n, const int32x4_t d)
+{
+	const float64x2_t lo = vdivq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(n))), vcvtq_f64_s64(vmovl_s32(vget_low_s32(d))));
+	const float64x2_t hi = vdivq_f64(vcvtq_f64_s64(vmovl_high_s32(n)), vcvtq_f64_s64(vmovl_high_s32(d)));
+	return vcombine_s32(vmovn_s64(vcvtq_s64_f64(lo)), vmovn_s64(vcvtq_s64_f64(hi)));
+}
+
+static void tmap_texel_offsets_neon(perspective_span &s, uint32_t *const out, const unsigned count)
+{
+	const int32x4_t lane = {0, 1, 2, 3};
+	const auto start = [lane](const uint32_t i, const uint32_t di) {
+		return vmlaq_s32(vdupq_n_s32(i), lane, vdupq_n_s32(di));
+	};
+	int32x4_t u = start(s.u, s.dudx), v = start(s.v, s.dvdx), z = start(s.z, s.dzdx);
+	const int32x4_t du = vdupq_n_s32(4 * s.dudx), dv = vdupq_n_s32(4 * s.dvdx), dz = vdupq_n_s32(4 * s.dzdx);
+	const int32x4_t umask = vdupq_n_s32(63), vmask = vdupq_n_s32(64 * 63);
+	for (unsigned i = 0; i < count; i += 4)
+	{
+		const int32x4_t offset = vaddq_s32(vandq_s32(tmap_quotient_neon(v, z), vmask), vandq_s32(tmap_quotient_neon(u, z), umask));
+		vst1q_u32(out + i, vreinterpretq_u32_s32(offset));
+		u = vaddq_s32(u, du);
+		v = vaddq_s32(v, dv);
+		z = vaddq_s32(z, dz);
+	}
+	s.advance(count);
+}
+#endif
+
+#if DXX_TMAP_HAVE_SSE2 || DXX_TMAP_HAVE_AVX2 || DXX_TMAP_HAVE_NEON
+/* Same output as c_tmap_scanline_per.  The texel offsets of a block of
+ * pixels are computed by a vector kernel, then the texture and fade
+ * table lookups are done one pixel at a time.
+ */
+template <void (*texel_offsets)(perspective_span &, uint32_t *, unsigned)>
+static void tmap_scanline_per_vector()
+{
+	const int x = tmap_span_length();
+	if (x <= 0)
+		return;
+	perspective_span s;
+	fix l = fx_l>>8;
+	const fix dldx = fx_dl_dx/256;
+	ubyte *dest = write_buffer + fx_xleft + (bytes_per_row * fx_y);
+	const auto pix = pixptr;
+	array<uint32_t, tmap_per_block + tmap_per_max_lanes> offsets;
+	for (unsigned done = 0; done < static_cast<unsigned>(x);)
+	{
+		const unsigned n = std::min(static_cast<unsigned>(x) - done, tmap_per_block);
+		texel_offsets(s, offsets.data(), n);
+		if (!Transparency_on)
+		{
+			range_for (const auto o, partial_range(offsets, n))
+			{
+				*dest++ = gr_fade_table[(l >> 8) & 0x7f][pix[o]];
+				l += dldx;
+			}
+		}
+		else
+		{
+			range_for (const auto o, partial_range(offsets, n))
+			{
+				const auto c = pix[o];
+				if (c != TRANSPARENCY_COLOR)
+					*dest = gr_fade_table[(l >> 8) & 0x7f][c];
+				dest++;
+				l += dldx;
+			}
+		}
+		done += n;
+	}
+}
+#endif
+
+/* Perspective divide every tmap_subdiv_span pixels with affine steps in
+ * between, as in Quake.  Faster than c_tmap_scanline_per, but texels
+ * between the divides may differ from it by one.
+ */
+static void c_tmap_scanline_per_sub()
+{
+	static const unsigned tmap_subdiv_span = 16;
+	int x = tmap_span_length();
+	if (x <= 0)
+		return;
+	perspective_span s;
+	fix l = fx_l>>8;
+	const fix dldx = fx_dl_dx/256;
+	ubyte *dest = write_buffer + fx_xleft + (bytes_per_row * fx_y);
+	//texel coordinates with 16 bits of fraction
+	const auto divide = [](const uint32_t n, const uint32_t d) -> int64_t {
+		return (static_cast<int64_t>(static_cast<int32_t>(n)) << 16) / static_cast<int32_t>(d);
+	};
+	int64_t u = divide(s.u, s.z), v = divide(s.v, s.z);
+	while (x > 0)
+	{
+		const unsigned n = std::min(static_cast<unsigned>(x), tmap_subdiv_span);
+		s.advance(n);
+		const int64_t u_end = divide(s.u, s.z), v_end = divide(s.v, s.z);
+		const int64_t dudx = (u_end - u) / static_cast<int>(n), dvdx = (v_end - v) / static_cast<int>(n);
+		for (unsigned i = n; i; --i)
+		{
+			const uint_fast32_t c = pixptr[((v >> 16) & (64 * 63)) + ((u >> 16) & 63)];
+			if (!Transparency_on || c != TRANSPARENCY_COLOR)
+				*dest = gr_fade_table[(l >> 8) & 0x7f][c];
+			dest++;
+			l += dldx;
+			u += dudx;
+			v += dvdx;
+		}
+		u = u_end;
+		v = v_end;
+		x -= n;
+	}
+}
+
+static tmap_scanline_function_table::per *Tmap_compare_candidate;
+static tmap_compare_stats Tmap_compare;
+
+//Draw each span with c_tmap_scanline_per and with the candidate, and count the pixels which differ.
+static void tmap_scanline_per_compare()
+{
+	const int x = tmap_span_length();
+	if (x <= 0)
+		return;
+	ubyte *const dest = write_buffer + fx_xleft + (bytes_per_row * fx_y);
+	static std::vector<ubyte> original, expected;
+	original.assign(dest, dest + x);
+	c_tmap_scanline_per();
+	expected.assign(dest, dest + x);
+	std::copy(original.begin(), original.end(), dest);
+	(*Tmap_compare_candidate)();
+	unsigned long mismatched = 0;
+	for (int i = 0; i < x; ++i)
+		if (dest[i] != expected[i])
+			++ mismatched;
+	++ Tmap_compare.spans;
+	Tmap_compare.pixels += x;
+	if (mismatched)
+	{
+		if (!Tmap_compare.mismatched_spans)
+			con_printf(CON_URGENT, "tmap compare: first mismatch in row %i, columns %i-%i", fx_y, fx_xleft, fx_xright);
+		++ Tmap_compare.mismatched_spans;
+		Tmap_compare.mismatched_pixels += mismatched;
+	}
+}
+
+const tmap_compare_stats &get_tmap_compare_stats()
+{
+	return Tmap_compare;
+}
+
+bool tmap_compare_enabled()
+{
+	return cur_tmap_scanline_per == tmap_scanline_per_compare;
+}
+
+//Vector kernel named by type, or nullptr if it is not built in or the CPU does not support it.
+static tmap_scanline_function_table::per *find_vector_tmap(const std::string &type)
+{
+#if DXX_TMAP_HAVE_AVX2
+	if (type == "avx2")
+		return __builtin_cpu_supports("avx2") ? tmap_scanline_per_vector<tmap_texel_offsets_avx2> : nullptr;
+#endif
+#if DXX_TMAP_HAVE_SSE2
+	if (type == "sse2")
+		return tmap_scanline_per_vector<tmap_texel_offsets_sse2>;
+#endif
+#if DXX_TMAP_HAVE_NEON
+	if (type == "neon")
+		return tmap_scanline_per_vector<tmap_texel_offsets_neon>;
+#endif
+	(void)type;
+	return nullptr;
+}
+
 //runtime selection of optimized tmappers.  12/07/99  Matthew Mueller
 //the reason I did it this way rather than having a *tmap_funcs that then points to a c_tmap or fp_tmap struct thats already filled in, is to avoid a second pointer dereference.
 void select_tmap(const std::string &type)
 {
-	if (type == "fp")
+	static const char compare_prefix[] = "compare:";
+	if (!type.compare(0, sizeof(compare_prefix) - 1, compare_prefix))
+	{
+		select_tmap(type.substr(sizeof(compare_prefix) - 1));
+		Tmap_compare_candidate = cur_tmap_scanline_per;
+		Tmap_compare = {};
+		cur_tmap_scanline_per = tmap_scanline_per_compare;
+		return;
+	}
+	if (type.empty())
+	{
+		/* Use a kernel which draws the same pixels as c.  AVX2 is
+		 * tried last since its wider divide is not faster than SSE2's
+		 * on current CPUs.
+		 */
+		for (const char *const v : {"sse2", "neon", "avx2"})
+			if (const auto f = find_vector_tmap(v))
+			{
+				cur_tmap_scanline_per = f;
+				return;
+			}
+		cur_tmap_scanline_per = c_tmap_scanline_per;
+	}
+	else if (const auto f = find_vector_tmap(type))
+	{
+		cur_tmap_scanline_per = f;
+	}
+	else if (type == "avx2" || type == "sse2" || type == "neon")
+	{
+		con_printf(CON_NORMAL, "Texmapper %s is not supported here, using c", type.c_str());
+		cur_tmap_scanline_per = c_tmap_scanline_per;
+	}
+	else if (type == "sub")
+	{
+		cur_tmap_scanline_per = c_tmap_scanline_per_sub;
+	}
+	else if (type == "fp")
 	{
 		cur_tmap_scanline_per=c_fp_tmap_scanline_per;
 	}
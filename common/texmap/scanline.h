@@ -48,4 +48,16 @@ struct tmap_scanline_function_table
 extern tmap_scanline_function_table tmap_scanline_functions;
 void select_tmap(const std::string &type);
 
+/* Counts kept when the texmapper is selected as "compare:<name>", which
+ * draws every perspective span with both c and <name>, and keeps the
+ * output of <name>.
+ */
+struct tmap_compare_stats
+{
+	unsigned long spans, pixels, mismatched_spans, mismatched_pixels;
+};
+const tmap_compare_stats &get_tmap_compare_stats();
+//True if the texmapper was selected as "compare:<name>".
+bool tmap_compare_enabled();
+
 #endif
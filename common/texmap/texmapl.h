@@ -30,11 +30,11 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "pstypes.h"
 
 #ifdef __cplusplus
+#include <climits>
 #include <cstddef>
 #include "dxxsconf.h"
 #include "compiler-array.h"
-
-struct g3ds_tmap;
+#include "texmap.h"
 
 #ifndef OGL
 extern	int prevmod(int val,int modulus);
@@ -44,28 +44,81 @@ fix compute_dx_dy(const g3ds_tmap &t, int top_vertex,int bottom_vertex, fix reci
 void compute_y_bounds(const g3ds_tmap &t, int &vlt, int &vlb, int &vrt, int &vrb,int &bottom_y_ind);
 #endif
 
-extern int	fx_y,fx_xleft,fx_xright;
-extern unsigned char tmap_flat_color;
-extern const unsigned char *pixptr;
+/* The interface variables are per thread, so that several threads can
+ * each draw a different band of the same canvas.
+ */
+extern thread_local int	fx_y,fx_xleft,fx_xright;
+extern thread_local const unsigned char *pixptr;
 
 // texture mapper scanline renderers
 extern	void asm_tmap_scanline_per(void);
 
 // Interface variables to assembler code
-extern	fix	fx_u,fx_v,fx_z,fx_du_dx,fx_dv_dx,fx_dz_dx;
-extern	fix	fx_dl_dx,fx_l;
-extern	int	fx_r,fx_g,fx_b,fx_dr_dx,fx_dg_dx,fx_db_dx;
+extern thread_local fix	fx_u,fx_v,fx_z,fx_du_dx,fx_dv_dx,fx_dz_dx;
+extern thread_local fix	fx_dl_dx,fx_l;
 
-extern	int	bytes_per_row;
-extern  unsigned char *write_buffer;
+extern thread_local int	bytes_per_row;
+extern thread_local unsigned char *write_buffer;
 
-extern ubyte tmap_flat_color;
-extern ubyte tmap_flat_shade_value;
+extern thread_local ubyte tmap_flat_color;
+extern thread_local ubyte tmap_flat_shade_value;
 
 static const std::size_t FIX_RECIP_TABLE_SIZE = 641;	//increased from 321 to 641, since this res is now quite achievable.. slight fps boost -MM
 extern const array<fix, FIX_RECIP_TABLE_SIZE> fix_recip_table;
 
 #ifndef OGL
+extern thread_local ubyte tmap_flat_fade_level;
+extern thread_local int Lighting_enabled;
+//Only rows from Tmap_band_top to Tmap_band_bot, inclusive, are drawn.
+extern thread_local int Tmap_band_top, Tmap_band_bot;
+
+enum class tmap_command_type : uint8_t
+{
+	flat,
+	linear,
+	perspective,
+};
+
+/* Everything needed to draw one polygon, so that it can be drawn later
+ * and on another thread.  top and bot are the first and last rows the
+ * polygon may touch.
+ */
+struct tmap_command
+{
+	tmap_command_type type;
+	uint8_t lighting, transparency, flat_color, fade_level;
+	int top, bot;
+	int clip_left, clip_top, clip_right, clip_bot;
+	int bytes_per_row;
+	unsigned char *write_buffer;
+	const grs_bitmap *bitmap;
+	g3ds_tmap tmap;
+};
+
+//Copy the state shared by every command type from the interface variables.
+void tmap_command_capture(tmap_command &c);
+//Draw the rows of c which lie between top and bot, inclusive.
+void tmap_command_execute(const tmap_command &c, int top, int bot);
+void texture_map_flat(const g3ds_tmap &t);
+
+/* Next free command of the open batch, or nullptr if no batch is open
+ * and the caller should draw at once.
+ */
+tmap_command *tmap_batch_reserve();
+//Let f fill in a command, then queue it, or draw it at once if no batch is open.
+template <typename F>
+static inline void tmap_command_submit(F &&f)
+{
+	if (const auto queued = tmap_batch_reserve())
+		f(*queued);
+	else
+	{
+		tmap_command c;
+		f(c);
+		tmap_command_execute(c, INT_MIN, INT_MAX);
+	}
+}
+
 static inline fix fix_recip(unsigned i)
 {
 	if (i < fix_recip_table.size())
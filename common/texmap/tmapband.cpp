@@ -0,0 +1,379 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Band-parallel texture mapping.
+ *
+ * While a batch is open, draw_tmap and the flat polygon drawer record
+ * what they would draw instead of drawing it.  When the batch is
+ * flushed, the canvas is cut into one horizontal band per thread, and
+ * every thread draws, in the order they were recorded, the rows of each
+ * command which lie inside its band.  Each row is written by exactly one
+ * thread, and sees the commands in the same order as if they had been
+ * drawn at once, so the result does not depend on the number of threads.
+ *
+ */
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gr.h"
+#include "console.h"
+#include "texmap.h"
+#include "texmapl.h"
+#include "scanline.h"
+#include "perf_timer.h"
+
+#include "compiler-range_for.h"
+#include "partial_range.h"
+
+#ifndef OGL
+
+static const unsigned MAX_TMAP_BANDS = 16;
+//Bands are not made shorter than this, so small canvases use fewer threads.
+static const int MIN_TMAP_BAND_HEIGHT = 16;
+
+namespace {
+
+struct tmap_band
+{
+	int top, bot;
+	std::vector<uint32_t> commands;
+};
+
+/* commands only grows, so that slots are reused from one batch to the
+ * next instead of being constructed again.
+ */
+struct tmap_batch
+{
+	bool open;
+	std::size_t count;
+	unsigned char *write_buffer;
+	int bytes_per_row, width, height;
+	std::vector<tmap_command> commands;
+	std::vector<grs_bitmap_ptr> retired;
+	std::vector<long> row_cost;
+	std::vector<unsigned char> before, expected;
+};
+
+/* The calling thread draws band 0 and waits for the workers, which draw
+ * one band each.
+ */
+class tmap_band_workers
+{
+	std::mutex mutex;
+	std::condition_variable wake, finished;
+	std::vector<std::thread> threads;
+	unsigned generation, active, pending;
+	bool exiting;
+	void worker(unsigned band);
+	void stop();
+public:
+	tmap_band_workers() :
+		generation(0), active(0), pending(0), exiting(false)
+	{
+	}
+	~tmap_band_workers()
+	{
+		stop();
+	}
+	unsigned size() const
+	{
+		return threads.size() + 1;
+	}
+	void resize(unsigned n);
+	void draw(unsigned n);
+};
+
+/* Save the interface variables of the calling thread, since drawing a
+ * batch leaves them set for the last command drawn.
+ */
+class saved_interface_vars
+{
+	int clip_left, clip_top, clip_right, clip_bot;
+	int saved_bytes_per_row;
+	unsigned char *saved_write_buffer;
+	int saved_transparency_on;
+public:
+	saved_interface_vars() :
+		clip_left(Window_clip_left), clip_top(Window_clip_top),
+		clip_right(Window_clip_right), clip_bot(Window_clip_bot),
+		saved_bytes_per_row(bytes_per_row), saved_write_buffer(write_buffer),
+		saved_transparency_on(Transparency_on)
+	{
+	}
+	~saved_interface_vars()
+	{
+		Window_clip_left = clip_left;
+		Window_clip_top = clip_top;
+		Window_clip_right = clip_right;
+		Window_clip_bot = clip_bot;
+		bytes_per_row = saved_bytes_per_row;
+		write_buffer = saved_write_buffer;
+		Transparency_on = saved_transparency_on;
+		Tmap_band_top = INT_MIN;
+		Tmap_band_bot = INT_MAX;
+	}
+};
+
+}
+
+static tmap_batch Batch;
+static array<tmap_band, MAX_TMAP_BANDS> Bands;
+static tmap_band_workers Workers;
+static bool Verify;
+static tmap_band_stats Stats;
+
+static void draw_band(const tmap_band &b)
+{
+	const auto commands = Batch.commands.data();
+	range_for (const auto i, b.commands)
+		tmap_command_execute(commands[i], b.top, b.bot);
+}
+
+void tmap_band_workers::worker(const unsigned band)
+{
+	unsigned seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen]{ return exiting || generation != seen; });
+			if (exiting)
+				return;
+			seen = generation;
+			if (band >= active)
+				continue;
+		}
+		draw_band(Bands[band]);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!--pending)
+			finished.notify_one();
+	}
+}
+
+void tmap_band_workers::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		exiting = true;
+	}
+	wake.notify_all();
+	range_for (auto &t, threads)
+		t.join();
+	threads.clear();
+	exiting = false;
+}
+
+void tmap_band_workers::resize(const unsigned n)
+{
+	stop();
+	for (unsigned band = 1; band < n; ++band)
+		threads.emplace_back(&tmap_band_workers::worker, this, band);
+}
+
+void tmap_band_workers::draw(const unsigned n)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		active = n;
+		pending = n - 1;
+		++ generation;
+	}
+	wake.notify_all();
+	draw_band(Bands[0]);
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]{ return !pending; });
+}
+
+/* Cut the canvas into n bands of about the same cost, where the cost of
+ * a row is the summed width of the commands which touch it, and give
+ * each band the commands which touch it.  The first and last bands are
+ * open ended, so that every row belongs to some band.
+ */
+static void split_bands(const unsigned n)
+{
+	const auto height = Batch.height;
+	const auto commands = partial_range(Batch.commands, Batch.count);
+	const auto clamp_row = [height](const int y) {
+		return std::min(std::max(y, 0), height - 1);
+	};
+	auto &cost = Batch.row_cost;
+	cost.assign(height + 1, 0);
+	range_for (auto &c, commands)
+	{
+		fix left = INT_MAX, right = INT_MIN;
+		for (int i = 0; i < c.tmap.nv; ++i)
+		{
+			left = std::min(left, c.tmap.verts[i].x2d);
+			right = std::max(right, c.tmap.verts[i].x2d);
+		}
+		const long width = f2i(right) - f2i(left) + 1;
+		cost[clamp_row(c.top)] += width;
+		cost[clamp_row(c.bot) + 1] -= width;
+	}
+	long running = 0;
+	range_for (auto &r, cost)
+		r = (running += r);
+	long total = 0;
+	for (int y = 0; y < height; ++y)
+		total += cost[y];
+	long sum = 0;
+	int y = 0;
+	for (unsigned i = 0; i < n; ++i)
+	{
+		auto &b = Bands[i];
+		b.commands.clear();
+		b.top = i ? y : INT_MIN;
+		if (i == n - 1)
+		{
+			b.bot = INT_MAX;
+			break;
+		}
+		const long target = (total * (i + 1)) / n;
+		while (y < height - 1 && sum + cost[y] <= target)
+			sum += cost[y++];
+		b.bot = y - 1;
+	}
+	for (uint32_t i = 0; i < Batch.count; ++i)
+	{
+		const auto &c = Batch.commands[i];
+		range_for (auto &b, partial_range(Bands, n))
+		{
+			if (c.top > b.bot)
+				continue;
+			if (c.bot < b.top)
+				break;
+			b.commands.emplace_back(i);
+		}
+	}
+}
+
+static void draw_batch(const unsigned n)
+{
+	split_bands(n);
+	if (n == 1)
+		draw_band(Bands[0]);
+	else
+		Workers.draw(n);
+}
+
+/* Draw the batch with one thread, then again from the same starting
+ * canvas with n threads, and count the pixels which differ.
+ */
+static void verify_batch(const unsigned n)
+{
+	const auto buffer = Batch.write_buffer;
+	const std::size_t size = (Batch.height - 1) * Batch.bytes_per_row + Batch.width;
+	auto &before = Batch.before, &expected = Batch.expected;
+	before.assign(buffer, buffer + size);
+	draw_batch(1);
+	expected.assign(buffer, buffer + size);
+	std::copy(before.begin(), before.end(), buffer);
+	draw_batch(n);
+	unsigned long mismatched = 0;
+	std::size_t first = 0;
+	for (std::size_t i = size; i--;)
+		if (buffer[i] != expected[i])
+		{
+			++ mismatched;
+			first = i;
+		}
+	++ Stats.verified_batches;
+	if (mismatched)
+	{
+		if (!Stats.mismatched_batches)
+			con_printf(CON_URGENT, "tmap bands: first mismatch in row %u, column %u", static_cast<unsigned>(first / Batch.bytes_per_row), static_cast<unsigned>(first % Batch.bytes_per_row));
+		++ Stats.mismatched_batches;
+		Stats.mismatched_pixels += mismatched;
+	}
+}
+
+tmap_command *tmap_batch_reserve()
+{
+	auto &b = Batch;
+	if (!b.open)
+		return nullptr;
+	if (b.count && (b.write_buffer != write_buffer || b.bytes_per_row != bytes_per_row))
+		tmap_batch_flush();
+	if (!b.count)
+	{
+		b.write_buffer = write_buffer;
+		b.bytes_per_row = bytes_per_row;
+		b.width = grd_curcanv->cv_bitmap.bm_w;
+		b.height = grd_curcanv->cv_bitmap.bm_h;
+	}
+	if (b.count == b.commands.size())
+		b.commands.resize(b.count + 256);
+	return &b.commands[b.count++];
+}
+
+void tmap_batch_retire(grs_bitmap_ptr &&bm)
+{
+	if (Batch.count)
+		Batch.retired.emplace_back(std::move(bm));
+	else
+		bm.reset();
+}
+
+void tmap_batch_begin()
+{
+	Batch.open = true;
+}
+
+void tmap_batch_flush()
+{
+	auto &b = Batch;
+	if (b.count)
+	{
+		perf_scope perf(perf_subsystem::texture_map);
+		const saved_interface_vars saved;
+		/* Compare mode keeps shared state in the scanline function, so
+		 * it must only run on one thread.
+		 */
+		const auto n = tmap_compare_enabled()
+			? 1u
+			: std::max(1u, std::min(Workers.size(), static_cast<unsigned>(b.height / MIN_TMAP_BAND_HEIGHT)));
+		++ Stats.batches;
+		Stats.commands += b.count;
+		if (Verify && n > 1)
+			verify_batch(n);
+		else
+			draw_batch(n);
+		b.count = 0;
+	}
+	b.retired.clear();
+}
+
+void tmap_batch_end()
+{
+	tmap_batch_flush();
+	Batch.open = false;
+}
+
+void tmap_band_init(unsigned threads, const bool verify)
+{
+	if (!threads)
+		threads = std::thread::hardware_concurrency();
+	threads = std::min(std::max(threads, 1u), MAX_TMAP_BANDS);
+	Workers.resize(threads);
+	Verify = verify;
+	Stats = {};
+	Stats.threads = threads;
+	con_printf(CON_VERBOSE, "Drawing software texture maps with %u thread%s%s", threads, threads == 1 ? "" : "s", verify ? ", verifying against one thread" : "");
+}
+
+const tmap_band_stats &get_tmap_band_stats()
+{
+	return Stats;
+}
+
+#endif
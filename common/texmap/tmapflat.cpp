@@ -23,6 +23,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  *
  */
 
+#include <algorithm>
 #include "maths.h"
 #include "vecmat.h"
 #include "gr.h"
@@ -40,6 +41,8 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 static void gr_upoly_tmap_ylr(uint_fast32_t nverts, const int *vert);
 
+thread_local ubyte tmap_flat_fade_level;
+
 // -------------------------------------------------------------------------------------
 //	Texture map current scanline.
 //	Uses globals Du_dx and Dv_dx to incrementally compute u,v coordinates
@@ -48,17 +51,24 @@ static void tmap_scanline_flat(int y, fix xleft, fix xright)
 {
 	if (xright < xleft)
 		return;
+	if (y < Tmap_band_top || y > Tmap_band_bot)
+		return;
 
 	// setup to call assembler scanline renderer
 
 	fx_y = y;
 	fx_xleft = xleft/F1_0;		// (xleft >> 16) != xleft/F1_0 for negative numbers, f2i caused random crashes
 	fx_xright = xright/F1_0;
+	//do not wrap into the neighbouring rows
+	if (fx_xleft < 0)
+		fx_xleft = 0;
+	if (fx_xright >= bytes_per_row)
+		fx_xright = bytes_per_row - 1;
 
-	if ( grd_curcanv->cv_fade_level >= GR_FADE_OFF )
+	if ( tmap_flat_fade_level >= GR_FADE_OFF )
 		cur_tmap_scanline_flat();
 	else	{
-		tmap_flat_shade_value = grd_curcanv->cv_fade_level;
+		tmap_flat_shade_value = tmap_flat_fade_level;
 		cur_tmap_scanline_shaded();
 	}	
 }
@@ -84,7 +94,7 @@ static void tmap_scanline_flat(int y, fix xleft, fix xright)
 //	Render a texture map.
 // Linear in outer loop, linear in inner loop.
 // -------------------------------------------------------------------------------------
-static void texture_map_flat(const g3ds_tmap &t, int color, void (*scanline_func)(int,fix,fix))
+void texture_map_flat(const g3ds_tmap &t)
 {
 	int	vlt,vrt,vlb,vrb;	// vertex left top, vertex right top, vertex left bottom, vertex right bottom
 	int	topy,boty,dy;
@@ -94,14 +104,14 @@ static void texture_map_flat(const g3ds_tmap &t, int color, void (*scanline_func
 	fix	recip_dy;
 	auto &v3d = t.verts;
 
-	tmap_flat_color = color;
-
 	// Determine top and bottom y coords.
 	compute_y_bounds(t,vlt,vlb,vrt,vrb,max_y_vertex);
 
 	// Set top and bottom (of entire texture map) y coordinates.
 	topy = f2i(v3d[vlt].y2d);
 	boty = f2i(v3d[max_y_vertex].y2d);
+	if (topy > Tmap_band_bot)
+		return;
 
 	// Set amount to change x coordinate for each advance to next scanline.
 	dy = f2i(t.verts[vlb].y2d) - f2i(t.verts[vlt].y2d);
@@ -122,6 +132,9 @@ static void texture_map_flat(const g3ds_tmap &t, int color, void (*scanline_func
 	// @mk: Should we render the scanline for y==boty?  This violates Matt's spec.
 
 	for (int y = topy; y < boty; y++) {
+		//rows below the band belong to another thread
+		if (y > Tmap_band_bot)
+			return;
 
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
@@ -158,15 +171,13 @@ static void texture_map_flat(const g3ds_tmap &t, int color, void (*scanline_func
 
 		}
 
-		//tmap_scanline_flat(y, xleft, xright);
-		(*scanline_func)(y, xleft, xright);
+		tmap_scanline_flat(y, xleft, xright);
 
 		xleft += dx_dy_left;
 		xright += dx_dy_right;
 
 	}
-	//tmap_scanline_flat(y, xleft, xright);
-	(*scanline_func)(boty, xleft, xright);
+	tmap_scanline_flat(boty, xleft, xright);
 }
 
 
@@ -224,16 +235,21 @@ void draw_tmap_flat(const grs_bitmap &bp,uint_fast32_t nverts,const g3s_point *c
 //function with ylr values
 static void gr_upoly_tmap_ylr(uint_fast32_t nverts, const int *vert)
 {
-	auto &ylr_func = tmap_scanline_flat;
-	g3ds_tmap	my_tmap;
-	my_tmap.nv = nverts;
-
-	range_for (auto &i, partial_range(my_tmap.verts, nverts))
-	{
-		i.x2d = *vert++;
-		i.y2d = *vert++;
-	}
-	texture_map_flat(my_tmap, COLOR, ylr_func);
+	tmap_command_submit([=](tmap_command &c) {
+		c.type = tmap_command_type::flat;
+		c.flat_color = COLOR;
+		c.fade_level = std::min(grd_curcanv->cv_fade_level, GR_FADE_OFF);
+		auto &my_tmap = c.tmap;
+		my_tmap.nv = nverts;
+
+		auto v = vert;
+		range_for (auto &i, partial_range(my_tmap.verts, nverts))
+		{
+			i.x2d = *v++;
+			i.y2d = *v++;
+		}
+		tmap_command_capture(c);
+	});
 }
 
 #endif //!OGL
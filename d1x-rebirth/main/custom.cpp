@@ -21,6 +21,10 @@
 #include "u_mem.h"
 #include "custom.h"
 #include "physfsx.h"
+#include "args.h"
+#ifdef USE_SDLMIXER
+#include "digi_mixer.h"
+#endif
 
 #include "compiler-begin.h"
 #include "compiler-make_unique.h"
@@ -85,6 +89,17 @@ struct custom_info
 static array<grs_bitmap, MAX_BITMAP_FILES> BitmapOriginal;
 static array<snd_info, MAX_SOUND_FILES> SoundOriginal;
 
+//Converted copies of the sound that was there are now wrong.
+static void custom_sound_changed(const unsigned i)
+{
+#ifdef USE_SDLMIXER
+	if (!GameArg.SndDisableSdlMixer)
+		digi_mixer_sound_changed(i);
+#else
+	(void)i;
+#endif
+}
+
 static int load_pig1(PHYSFS_file *f, unsigned num_bitmaps, unsigned num_sounds, unsigned &num_custom, std::unique_ptr<custom_info[]> &ci)
 {
 	int data_ofs;
@@ -347,6 +362,7 @@ static int load_pigpog(const d_fname &pogname)
 				snd->length = j;
 #endif
 			snd->data = p;
+			custom_sound_changed(x & 0x7fffffff);
 
 			if (PHYSFS_read(f, p, j, 1) < 1)
 			{
@@ -587,6 +603,7 @@ static void custom_remove()
 			GameSounds[i].length = SoundOriginal[i].length & 0x7fffffff;
 #endif
 			SoundOriginal[i].length = 0;
+			custom_sound_changed(i);
 		}
 }
 
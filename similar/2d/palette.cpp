@@ -24,6 +24,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
 
 #include <algorithm>
+#include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -43,16 +44,13 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #define SQUARE(x) ((x)*(x))
 
-#define	MAX_COMPUTED_COLORS	32
-
-static unsigned Num_computed_colors;
-
-struct color_record {
-	ubyte	r,g,b;
-	color_t color_num;
-};
-
-static array<color_record, MAX_COMPUTED_COLORS> Computed_colors;
+//	Inverse palette: for every color of 6 bits per channel, the closest
+//	entry of gr_palette.  Entries are searched for the first time they are
+//	asked for, and all are forgotten when gr_palette changes.
+static const color_t inverse_palette_unknown = 255;	//never a search result
+static array<color_t, 64 * 64 * 64> Inverse_palette;
+static palette_array_t Inverse_palette_source;
+static bool Inverse_palette_valid;
 
 palette_array_t gr_palette;
 palette_array_t gr_current_pal;
@@ -118,7 +116,7 @@ void gr_copy_palette(palette_array_t &gr_palette, const palette_array_t &pal)
 {
 	gr_palette = pal;
 
-	        Num_computed_colors = 0;
+	init_computed_colors();
 }
 #endif
 
@@ -152,8 +150,8 @@ void gr_use_palette_table(const char * filename )
 	// This is the TRANSPARENCY COLOR
 	range_for (auto &i, gr_fade_table)
 		i[255] = 255;
+	init_computed_colors();	//	Flush palette cache.
 #if defined(DXX_BUILD_DESCENT_II)
-	Num_computed_colors = 0;	//	Flush palette cache.
 // swap colors 0 and 255 of the palette along with fade table entries
 
 #ifdef SWAP_0_255
@@ -174,83 +172,58 @@ void gr_use_palette_table(const char * filename )
 #endif
 }
 
-//	Add a computed color (by gr_find_closest_color) to list of computed colors in Computed_colors.
-//	If list wasn't full already, increment Num_computed_colors.
-//	If was full, replace a random one.
-static void add_computed_color(int r, int g, int b, color_t color_num)
-{
-	int	add_index;
-
-	if (Num_computed_colors < MAX_COMPUTED_COLORS) {
-		add_index = Num_computed_colors;
-		Num_computed_colors++;
-	} else
-		add_index = (d_rand() * MAX_COMPUTED_COLORS) >> 15;
-
-	Computed_colors[add_index].r = r;
-	Computed_colors[add_index].g = g;
-	Computed_colors[add_index].b = b;
-	Computed_colors[add_index].color_num = color_num;
-}
-
+//	Forget the inverse palette if gr_palette is not what it was built from.
 void init_computed_colors(void)
 {
-	int	i;
-
-	for (i=0; i<MAX_COMPUTED_COLORS; i++)
-		Computed_colors[i].r = 255;		//	Make impossible to match.
+	if (Inverse_palette_valid && Inverse_palette_source == gr_palette)
+		return;
+	Inverse_palette.fill(inverse_palette_unknown);
+	Inverse_palette_source = gr_palette;
+	Inverse_palette_valid = true;
 }
 
-color_t gr_find_closest_color( int r, int g, int b )
+static color_t closest_color_search(const palette_array_t &pal, int r, int g, int b)
 {
-	int j;
-	int best_value, value;
-
-	if (Num_computed_colors == 0)
-		init_computed_colors();
-
-	//	If we've already computed this color, return it!
-	for (unsigned i=0; i<Num_computed_colors; i++)
-	{
-		auto &c = Computed_colors[i];
-		if (r == c.r && g == c.g && b == c.b)
-		{
-			const auto color_num = c.color_num;
-					if (i > 4) {
-						std::swap(Computed_colors[i-1], c);
-					}
-					return color_num;
-				}
-	}
-
-//	r &= 63;
-//	g &= 63;
-//	b &= 63;
-
-	best_value = SQUARE(r-gr_palette[0].r)+SQUARE(g-gr_palette[0].g)+SQUARE(b-gr_palette[0].b);
+	int best_value = SQUARE(r-pal[0].r)+SQUARE(g-pal[0].g)+SQUARE(b-pal[0].b);
 	color_t best_index = 0;
-	if (best_value==0) {
-		add_computed_color(r, g, b, best_index);
- 		return best_index;
-	}
-	j=0;
 	// only go to 255, 'cause we dont want to check the transparent color.
-	for (color_t i=1; i < 254; i++ )	{
-		++j;
-		value = SQUARE(r-gr_palette[j].r)+SQUARE(g-gr_palette[j].g)+SQUARE(b-gr_palette[j].b);
+	for (color_t i=1; best_value && i < 254; i++ )	{
+		const int value = SQUARE(r-pal[i].r)+SQUARE(g-pal[i].g)+SQUARE(b-pal[i].b);
 		if ( value < best_value )	{
-			if (value==0) {
-				add_computed_color(r, g, b, i);
-				return i;
-			}
 			best_value = value;
 			best_index = i;
 		}
 	}
-	add_computed_color(r, g, b, best_index);
 	return best_index;
 }
 
+static color_t inverse_palette_lookup(color_t *const table, const palette_array_t &pal, const unsigned r, const unsigned g, const unsigned b)
+{
+	auto &c = table[(r << 12) | (g << 6) | b];
+	if (c == inverse_palette_unknown)
+		c = closest_color_search(pal, r, g, b);
+	return c;
+}
+
+color_t gr_find_closest_color( int r, int g, int b )
+{
+	if (!Inverse_palette_valid)
+		init_computed_colors();
+	//	Out of range colors have no entry; search for them every time.
+	if ((r | g | b) & ~63)
+		return closest_color_search(gr_palette, r, g, b);
+	return inverse_palette_lookup(Inverse_palette.data(), gr_palette, r, g, b);
+}
+
+//	Fills a table of its own rather than Inverse_palette, so it may run on
+//	any thread while the game changes gr_palette.
+void gr_find_closest_colors(const palette_array_t &pal, const uint8_t *rgb, std::size_t n, const unsigned bytes_per_pixel, color_t *out)
+{
+	std::vector<color_t> table(Inverse_palette.size(), inverse_palette_unknown);
+	for (; n; --n, rgb += bytes_per_pixel)
+		*out++ = inverse_palette_lookup(table.data(), pal, rgb[0] >> 2, rgb[1] >> 2, rgb[2] >> 2);
+}
+
 int gr_find_closest_color_15bpp( int rgb )
 {
 	return gr_find_closest_color( ((rgb>>10)&31)*2, ((rgb>>5)&31)*2, (rgb&31)*2 );
@@ -10,7 +10,11 @@
  *
  */
 
+#include <atomic>
 #include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 #ifdef _WIN32
 #include <windows.h>
 #include <stddef.h>
@@ -42,6 +46,7 @@
 #include "u_mem.h"
 
 #include "segment.h"
+#include "gameseg.h"
 #include "textures.h"
 #include "texmerge.h"
 #include "effects.h"
@@ -56,7 +61,10 @@
 #include "gauges.h"
 #include "playsave.h"
 #include "object.h"
+#include "render.h"
 #include "args.h"
+#include "perf_timer.h"
+#include "ogl_texprep.h"
 
 #include "compiler-exchange.h"
 #include "compiler-make_unique.h"
@@ -114,6 +122,8 @@ static int ogl_texture_list_cur;
 #define GL_TEXTURE0_ARB 0x84C0
 static int ogl_loadtexture(const uint8_t *data, int dxo, int dyo, ogl_texture &tex, int bm_flags, int data_format, int texfilt) __attribute_nonnull();
 static void ogl_freetexture(ogl_texture &gltexture);
+static void ogl_set_texture_pow2_size(ogl_texture &tex);
+static void ogl_load_prepared_texture(grs_bitmap &bm, const ogl_texture &prepared, const uint8_t *pixels, int texfilt);
 
 static void ogl_loadbmtexture(grs_bitmap &bm)
 {
@@ -311,6 +321,12 @@ static void ogl_texture_stats(void)
 	gr_printf(fspacx2, fspacy1 + line_spacing, "%i(%i,%i,%i,%i) %iK(%iK wasted) (%i postcachedtex)", used, usedrgba, usedrgb, usedidx, usedother, truebytes / 1024, (truebytes - databytes) / 1024, r_texcount - r_cachedtexcount);
 	gr_printf(fspacx2, fspacy1 + (line_spacing * 2), "%ibpp(r%i,g%i,b%i,a%i)x%i=%iK depth%i=%iK", idx, r, g, b, a, dbl, colorsize / 1024, depth, depthsize / 1024);
 	gr_printf(fspacx2, fspacy1 + (line_spacing * 3), "total=%iK", (colorsize + depthsize + truebytes) / 1024);
+	gr_printf(fspacx2, fspacy1 + (line_spacing * 4), "%u render state allocs", get_render_state_heap_allocations());
+	const auto fcd = get_fcd_cache_stats();
+	gr_printf(fspacx2, fspacy1 + (line_spacing * 5), "%u/%u connected distance cache hits/misses", fcd.hits, fcd.misses);
+	const auto tm = texmerge_get_stats();
+	const unsigned tm_lookups = tm.hits + tm.misses;
+	gr_printf(fspacx2, fspacy1 + (line_spacing * 6), "%u%% of %u texmerge lookups hit, %u textures in %uK/%uK", tm_lookups ? static_cast<unsigned>((tm.hits * 100ull) / tm_lookups) : 0, tm_lookups, tm.entries, static_cast<unsigned>(tm.bytes / 1024), static_cast<unsigned>(tm.budget / 1024));
 }
 
 static void ogl_bindbmtex(grs_bitmap &bm){
@@ -383,25 +399,110 @@ static void ogl_cache_weapon_textures(int weapon_type)
 	}
 }
 
-void ogl_cache_level_textures(void)
+namespace {
+
+/* A level texture whose image is made on a worker thread.  The source
+ * data is copied, as paging in or merging the textures which follow it
+ * may move or reuse the bitmap's data.
+ */
+struct ogl_prepared_texture
 {
-	int side;
-	short tmap1,tmap2;
-	struct side *sidep;
-	int max_efx=0,ef;
-	
-	ogl_reset_texture_stats_internal();//loading a new lev should reset textures
-	
-	range_for (eclip &ec, partial_range(Effects, Num_effects))
+	grs_bitmap *bm;
+	ogl_texture tex;
+	uint16_t bm_w, bm_h;
+	int bm_flags;
+	//From the texture merge cache, which may have freed it since
+	bool merged;
+	std::vector<uint8_t> source;
+	//The texture, then its mipmaps
+	std::vector<uint8_t> pixels;
+};
+
+}
+
+static void ogl_prepare_add(std::vector<ogl_prepared_texture> &textures, std::unordered_set<const grs_bitmap *> &seen, grs_bitmap &rbm, const bool merged)
+{
+	grs_bitmap *bm = &rbm;
+	while (bm->bm_parent)
+		bm=bm->bm_parent;
+	if (bm->gltexture && bm->gltexture->handle > 0)
+		return;
+	if (!seen.insert(bm).second)
+		return;
+	textures.emplace_back();
+	auto &t = textures.back();
+	t.bm = bm;
+	t.bm_w = bm->bm_w;
+	t.bm_h = bm->bm_h;
+	t.bm_flags = bm->bm_flags;
+	t.merged = merged;
+	//bm->gltexture is not taken until the upload, in case this is dropped
+	if (bm->gltexture)
 	{
-		ogl_cache_vclipn_textures(ec.dest_vclip);
-		if ((ec.changing_wall_texture == -1) && (ec.changing_object_texture==-1) )
-			continue;
-		if (ec.vc.num_frames>max_efx)
-			max_efx=ec.vc.num_frames;
+		t.tex = *bm->gltexture;
+		if (t.tex.w == 0)
+		{
+			t.tex.lw = t.tex.w = bm->bm_w;
+			t.tex.h = bm->bm_h;
+		}
 	}
-	glmprintf((0,"max_efx:%i\n",max_efx));
-	for (ef=0;ef<max_efx;ef++){
+	else
+		ogl_init_texture(t.tex, bm->bm_w, bm->bm_h, ((bm->bm_flags & (BM_FLAG_TRANSPARENT | BM_FLAG_SUPER_TRANSPARENT))? OGL_FLAG_ALPHA : 0));
+	ogl_set_texture_pow2_size(t.tex);
+	//as ogl_loadtexture, checked here since Error cannot be called from the workers
+	if ((t.tex.w > max(static_cast<int>(grd_curscreen->get_screen_width()), 1024)) ||
+		(t.tex.h > max(static_cast<int>(grd_curscreen->get_screen_height()), 256)))
+		Error("Texture is too big: %ix%i", t.tex.w, t.tex.h);
+	const auto data = bm->get_bitmap_data();
+	t.source.assign(data, data + ((bm->bm_flags & BM_FLAG_RLE) ? ogl_rle_size(data, bm->bm_h, bm->bm_flags) : t.bm_w * t.bm_h));
+}
+
+//What ogl_loadbmtexture_f and ogl_loadtexture do before the upload.
+static void ogl_prepare_texture(ogl_prepared_texture &t, const palette_array_t &pal, const bool mipmaps)
+{
+	const uint8_t *data = t.source.data();
+	std::vector<uint8_t> decoded;
+	if (t.bm_flags & BM_FLAG_RLE)
+	{
+		decoded.resize(t.bm_w * t.bm_h);
+		ogl_rle_decode(data, t.bm_w, t.bm_h, t.bm_flags, decoded.data());
+		data = decoded.data();
+	}
+	const unsigned bpp = ogl_texture_format_bytes(t.tex.format);
+	t.pixels.resize(mipmaps ? ogl_mipmap_chain_size(t.tex.tw, t.tex.th, bpp) : t.tex.tw * t.tex.th * bpp);
+	ogl_filltexbuf(data, t.pixels.data(), t.tex.lw, t.tex.w, t.tex.h, 0, 0, t.tex.tw, t.tex.th, t.tex.format, t.bm_flags, 0, pal);
+	if (mipmaps)
+		ogl_build_mipmaps(t.pixels.data(), t.tex.tw, t.tex.th, bpp);
+	t.source = {};
+}
+
+//	Find each distinct wall texture of the level once, over all frames of
+//	its effects, then make their images on all cores, so that only the
+//	upload is left for this thread.  Paging in and merging are not safe
+//	on other threads, so they are done here while finding the textures.
+static void ogl_preload_level_textures(const int max_efx)
+{
+	const auto start = perf_clock::now();
+	std::vector<std::pair<short, short>> tmaps;
+	{
+		std::unordered_set<uint32_t> seen_tmaps;
+		range_for (auto &seg, partial_range(Segments, Num_segments))
+			range_for (auto &side, seg.sides)
+			{
+				const short tmap1 = side.tmap_num;
+				const short tmap2 = side.tmap_num2;
+				if (tmap1<0 || tmap1>=NumTextures){
+					glmprintf((0,"ogl_cache_level_textures %i %i %i\n",&seg-&Segments[0],tmap1,NumTextures));
+					continue;
+				}
+				if (seen_tmaps.insert((static_cast<uint32_t>(static_cast<uint16_t>(tmap1)) << 16) | static_cast<uint16_t>(tmap2)).second)
+					tmaps.emplace_back(tmap1, tmap2);
+			}
+	}
+	std::vector<ogl_prepared_texture> textures;
+	std::unordered_set<const grs_bitmap *> seen;
+	const auto evictions = texmerge_get_stats().evictions;
+	for (int ef=0;ef<max_efx;ef++){
 		range_for (eclip &ec, partial_range(Effects, Num_effects))
 		{
 			if ((ec.changing_wall_texture == -1) && (ec.changing_object_texture==-1) )
@@ -410,32 +511,89 @@ void ogl_cache_level_textures(void)
 		}
 		do_special_effects();
 
-		for (uint_fast32_t seg=0;seg < Num_segments;seg++){
-			for (side=0;side<MAX_SIDES_PER_SEGMENT;side++){
-				sidep=&Segments[seg].sides[side];
-				tmap1=sidep->tmap_num;
-				tmap2=sidep->tmap_num2;
-				if (tmap1<0 || tmap1>=NumTextures){
-					glmprintf((0,"ogl_cache_level_textures %i %i %i %i\n",seg,side,tmap1,NumTextures));
-					//				tmap1=0;
-					continue;
-				}
-				PIGGY_PAGE_IN(Textures[tmap1]);
-				grs_bitmap *bm = &GameBitmaps[Textures[tmap1].index];
-				if (tmap2 != 0){
-					PIGGY_PAGE_IN(Textures[tmap2&0x3FFF]);
-					auto &bm2 = GameBitmaps[Textures[tmap2&0x3FFF].index];
-					if (GameArg.DbgUseOldTextureMerge || (bm2.bm_flags & BM_FLAG_SUPER_TRANSPARENT))
-						bm = &texmerge_get_cached_bitmap( tmap1, tmap2 );
-					else {
-						ogl_loadbmtexture(bm2);
-					}
+		range_for (auto &t, tmaps)
+		{
+			const auto tmap1 = t.first;
+			const auto tmap2 = t.second;
+			PIGGY_PAGE_IN(Textures[tmap1]);
+			grs_bitmap *bm = &GameBitmaps[Textures[tmap1].index];
+			bool merged = false;
+			if (tmap2 != 0){
+				PIGGY_PAGE_IN(Textures[tmap2&0x3FFF]);
+				auto &bm2 = GameBitmaps[Textures[tmap2&0x3FFF].index];
+				if (GameArg.DbgUseOldTextureMerge || (bm2.bm_flags & BM_FLAG_SUPER_TRANSPARENT))
+				{
+					bm = &texmerge_get_cached_bitmap( tmap1, tmap2 );
+					merged = true;
 				}
-				ogl_loadbmtexture(*bm);
+				else
+					ogl_prepare_add(textures, seen, bm2, false);
 			}
+			ogl_prepare_add(textures, seen, *bm, merged);
 		}
 		glmprintf((0,"finished ef:%i\n",ef));
 	}
+	const auto found = perf_clock::now();
+
+	const int texfilt = GameCfg.TexFilt;
+#ifdef OGLES
+	//GL_GENERATE_MIPMAP makes them from the first level
+	const bool mipmaps = false;
+#else
+	const bool mipmaps = texfilt;
+#endif
+	const palette_array_t pal = *ogl_pal;
+	const unsigned num_textures = textures.size();
+	std::atomic<unsigned> next_texture(0);
+	const auto prepare_textures = [&textures, &pal, mipmaps, num_textures, &next_texture]() {
+		for (unsigned i; (i = next_texture++) < num_textures;)
+			ogl_prepare_texture(textures[i], pal, mipmaps);
+	};
+	const unsigned threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), num_textures);
+	std::vector<std::thread> helpers;
+	for (unsigned i = 1; i < threads; ++i)
+		helpers.emplace_back(prepare_textures);
+	prepare_textures();
+	range_for (auto &t, helpers)
+		t.join();
+	const auto prepared = perf_clock::now();
+
+	//	A merged bitmap which was freed or reused while later pairs were
+	//	merged no longer holds what was copied from it, and may be gone.
+	//	Those are left for ogl_loadbmtexture to make when first drawn.
+	const bool merged_valid = texmerge_get_stats().evictions == evictions;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	//rows of small mipmaps are not padded
+	unsigned uploaded = 0;
+	range_for (auto &t, textures)
+	{
+		if (t.merged && !merged_valid)
+			continue;
+		ogl_load_prepared_texture(*t.bm, t.tex, t.pixels.data(), texfilt);
+		++ uploaded;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	const auto done = perf_clock::now();
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+	con_printf(CON_VERBOSE, "Loaded %u of %u level textures for %u side textures in %u us: %u us finding, %u us preparing on %u threads, %u us uploading", uploaded, num_textures, static_cast<unsigned>(tmaps.size()), static_cast<unsigned>(duration_cast<microseconds>(done - start).count()), static_cast<unsigned>(duration_cast<microseconds>(found - start).count()), static_cast<unsigned>(duration_cast<microseconds>(prepared - found).count()), threads, static_cast<unsigned>(duration_cast<microseconds>(done - prepared).count()));
+}
+
+void ogl_cache_level_textures(void)
+{
+	int max_efx=0;
+	
+	ogl_reset_texture_stats_internal();//loading a new lev should reset textures
+	
+	range_for (eclip &ec, partial_range(Effects, Num_effects))
+	{
+		ogl_cache_vclipn_textures(ec.dest_vclip);
+		if ((ec.changing_wall_texture == -1) && (ec.changing_object_texture==-1) )
+			continue;
+		if (ec.vc.num_frames>max_efx)
+			max_efx=ec.vc.num_frames;
+	}
+	glmprintf((0,"max_efx:%i\n",max_efx));
+	ogl_preload_level_textures(max_efx);
 	reset_special_effects();
 	init_special_effects();
 	{
@@ -905,6 +1063,7 @@ void _g3_draw_poly(uint_fast32_t nv,const g3s_point *const *const pointlist)
  */ 
 void _g3_draw_tmap(unsigned nv, const g3s_point *const *const pointlist, const g3s_uvl *uvl_list, const g3s_lrgb *light_rgb, grs_bitmap &bm)
 {
+	perf_scope perf(perf_subsystem::texture_map);
 	int c, index2, index3, index4;
 	GLfloat color_alpha = 1.0;
 
@@ -1308,139 +1467,6 @@ void ogl_close_pixel_buffers(void)
 	texbuf.reset();
 }
 
-static void ogl_filltexbuf(const uint8_t *data, GLubyte *texp, unsigned truewidth, unsigned width, unsigned height, int dxo, int dyo, unsigned twidth, unsigned theight, int type, int bm_flags, int data_format)
-{
-	if ((width > max(static_cast<unsigned>(grd_curscreen->get_screen_width()), 1024u)) ||
-		(height > max(static_cast<unsigned>(grd_curscreen->get_screen_height()), 256u)))
-		Error("Texture is too big: %ix%i", width, height);
-
-	for (unsigned y=0;y<theight;y++)
-	{
-		int i=dxo+truewidth*(y+dyo);
-		for (unsigned x=0;x<twidth;x++)
-		{
-			int c;
-			if (x<width && y<height)
-			{
-				if (data_format)
-				{
-					int j;
-
-					for (j = 0; j < data_format; ++j)
-						(*(texp++)) = data[i * data_format + j];
-					i++;
-					continue;
-				}
-				else
-				{
-					c = data[i++];
-				}
-			}
-			else if (x == width && y < height) // end of bitmap reached - fill this pixel with last color to make a clean border when filtering this texture
-			{
-				c = data[(width*(y+1))-1];
-			}
-			else if (y == height && x < width) // end of bitmap reached - fill this row with color or last row to make a clean border when filtering this texture
-			{
-				c = data[(width*(height-1))+x];
-			}
-			else
-			{
-				c = 256; // fill the pad space with transparency (or blackness)
-			}
-
-			if (c == 254 && (bm_flags & BM_FLAG_SUPER_TRANSPARENT))
-			{
-				switch (type)
-				{
-					case GL_LUMINANCE_ALPHA:
-						(*(texp++)) = 255;
-						(*(texp++)) = 0;
-						break;
-					case GL_RGBA:
-						(*(texp++)) = 255;
-						(*(texp++)) = 255;
-						(*(texp++)) = 255;
-						(*(texp++)) = 0; // transparent pixel
-						break;
-#ifndef OGLES
-					case GL_COLOR_INDEX:
-						(*(texp++)) = c;
-						break;
-#endif
-					default:
-						Error("ogl_filltexbuf unhandled super-transparent texformat\n");
-						break;
-				}
-			}
-			else if ((c == 255 && (bm_flags & BM_FLAG_TRANSPARENT)) || c == 256)
-			{
-				switch (type)
-				{
-					case GL_LUMINANCE:
-						(*(texp++))=0;
-						break;
-					case GL_LUMINANCE_ALPHA:
-						(*(texp++))=0;
-						(*(texp++))=0;
-						break;
-					case GL_RGB:
-						(*(texp++)) = 0;
-						(*(texp++)) = 0;
-						(*(texp++)) = 0;
-						break;
-					case GL_RGBA:
-						(*(texp++))=0;
-						(*(texp++))=0;
-						(*(texp++))=0;
-						(*(texp++))=0;//transparent pixel
-						break;
-#ifndef OGLES
-					case GL_COLOR_INDEX:
-						(*(texp++)) = c;
-						break;
-#endif
-					default:
-						Error("ogl_filltexbuf unknown texformat\n");
-						break;
-				}
-			}
-			else
-			{
-				switch (type)
-				{
-					case GL_LUMINANCE://these could prolly be done to make the intensity based upon the intensity of the resulting color, but its not needed for anything (yet?) so no point. :)
-						(*(texp++))=255;
-						break;
-					case GL_LUMINANCE_ALPHA:
-						(*(texp++))=255;
-						(*(texp++))=255;
-						break;
-					case GL_RGB:
-						(*(texp++)) = (*ogl_pal)[c].r * 4;
-						(*(texp++)) = (*ogl_pal)[c].g * 4;
-						(*(texp++)) = (*ogl_pal)[c].b * 4;
-						break;
-					case GL_RGBA:
-						(*(texp++))=(*ogl_pal)[c].r*4;
-						(*(texp++))=(*ogl_pal)[c].g*4;
-						(*(texp++))=(*ogl_pal)[c].b*4;
-						(*(texp++))=255;//not transparent
-						break;
-#ifndef OGLES
-					case GL_COLOR_INDEX:
-						(*(texp++)) = c;
-						break;
-#endif
-					default:
-						Error("ogl_filltexbuf unknown texformat\n");
-						break;
-				}
-			}
-		}
-	}
-}
-
 static void tex_set_size1(ogl_texture &tex,unsigned dbits,unsigned bits,unsigned w, unsigned h)
 {
 	int u;
@@ -1508,7 +1534,7 @@ static void tex_set_size(ogl_texture &tex)
 //In theory this could be a problem for repeating textures, but all real
 //textures (not sprites, etc) in descent are 64x64, so we are ok.
 //stores OpenGL textured id in *texid and u/v values required to get only the real data in *u/*v
-static int ogl_loadtexture (const uint8_t *data, int dxo, int dyo, ogl_texture &tex, int bm_flags, int data_format, int texfilt)
+static void ogl_set_texture_pow2_size(ogl_texture &tex)
 {
 	tex.tw = pow2ize (tex.w);
 	tex.th = pow2ize (tex.h);//calculate smallest texture size that can accomodate us (must be multiples of 2)
@@ -1516,34 +1542,11 @@ static int ogl_loadtexture (const uint8_t *data, int dxo, int dyo, ogl_texture &
 	//calculate u/v values that would make the resulting texture correctly sized
 	tex.u = (float) ((double) tex.w / (double) tex.tw);
 	tex.v = (float) ((double) tex.h / (double) tex.th);
+}
 
-	const uint8_t *outP = texbuf.get();
-	if (data) {
-		if (bm_flags >= 0)
-			ogl_filltexbuf (data, texbuf.get(), tex.lw, tex.w, tex.h, dxo, dyo, tex.tw, tex.th, 
-								 tex.format, bm_flags, data_format);
-		else {
-			if (!dxo && !dyo && (tex.w == tex.tw) && (tex.h == tex.th))
-				outP = data;
-			else {
-				int h, w, tw;
-				
-				h = tex.lw / tex.w;
-				w = (tex.w - dxo) * h;
-				data += tex.lw * dyo + h * dxo;
-				auto *bufP = texbuf.get();
-				tw = tex.tw * h;
-				h = tw - w;
-				for (; dyo < tex.h; dyo++, data += tex.lw) {
-					memcpy (bufP, data, w);
-					bufP += w;
-					memset (bufP, 0, h);
-					bufP += h;
-				}
-				memset (bufP, 0, tex.th * tw - (bufP - texbuf.get()));
-			}
-		}
-	}
+//Make a texture name for tex, bind it, and set its filtering.
+static void ogl_gen_texture(ogl_texture &tex, int texfilt)
+{
 	// Generate OpenGL texture IDs.
 	glGenTextures (1, &tex.handle);
 #ifndef OGLES
@@ -1571,8 +1574,47 @@ static int ogl_loadtexture (const uint8_t *data, int dxo, int dyo, ogl_texture &
 		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	}
+}
+
+static int ogl_loadtexture (const uint8_t *data, int dxo, int dyo, ogl_texture &tex, int bm_flags, int data_format, int texfilt)
+{
+	ogl_set_texture_pow2_size(tex);
+
+	const uint8_t *outP = texbuf.get();
+	if (data) {
+		if (bm_flags >= 0)
+		{
+			if ((tex.w > max(static_cast<int>(grd_curscreen->get_screen_width()), 1024)) ||
+				(tex.h > max(static_cast<int>(grd_curscreen->get_screen_height()), 256)))
+				Error("Texture is too big: %ix%i", tex.w, tex.h);
+			ogl_filltexbuf (data, texbuf.get(), tex.lw, tex.w, tex.h, dxo, dyo, tex.tw, tex.th, 
+								 tex.format, bm_flags, data_format, *ogl_pal);
+		}
+		else {
+			if (!dxo && !dyo && (tex.w == tex.tw) && (tex.h == tex.th))
+				outP = data;
+			else {
+				int h, w, tw;
+				
+				h = tex.lw / tex.w;
+				w = (tex.w - dxo) * h;
+				data += tex.lw * dyo + h * dxo;
+				auto *bufP = texbuf.get();
+				tw = tex.tw * h;
+				h = tw - w;
+				for (; dyo < tex.h; dyo++, data += tex.lw) {
+					memcpy (bufP, data, w);
+					bufP += w;
+					memset (bufP, 0, h);
+					bufP += h;
+				}
+				memset (bufP, 0, tex.th * tw - (bufP - texbuf.get()));
+			}
+		}
+	}
+	ogl_gen_texture(tex, texfilt);
 
-#ifndef OGLES // see comment above
+#ifndef OGLES // see comment in ogl_gen_texture
 	if (texfilt)
 	{
 		gluBuild2DMipmaps (
@@ -1621,29 +1663,41 @@ void ogl_loadbmtexture_f(grs_bitmap &rbm, int texfilt)
 	}
 
 	if (bm->bm_flags & BM_FLAG_RLE){
-		unsigned char * dbits;
-		int i, data_offset;
-
-		data_offset = 1;
-		if (bm->bm_flags & BM_FLAG_RLE_BIG)
-			data_offset = 2;
-
-		auto sbits = &bm->get_bitmap_data()[4 + (bm->bm_h * data_offset)];
-		dbits = decodebuf;
-
-		for (i=0; i < bm->bm_h; i++ )    {
-			gr_rle_decode({sbits, dbits}, rle_end(*bm, decodebuf));
-			if ( bm->bm_flags & BM_FLAG_RLE_BIG )
-				sbits += GET_INTEL_SHORT(&bm->bm_data[4 + (i * data_offset)]);
-			else
-				sbits += (int)bm->bm_data[4+i];
-			dbits += bm->bm_w;
-		}
+		ogl_rle_decode(bm->bm_data, bm->bm_w, bm->bm_h, bm->bm_flags, decodebuf);
 		buf=decodebuf;
 	}
 	ogl_loadtexture(buf, 0, 0, *bm->gltexture, bm->bm_flags, 0, texfilt);
 }
 
+//Upload the image and mipmaps which ogl_prepare_texture made for bm.
+static void ogl_load_prepared_texture(grs_bitmap &bm, const ogl_texture &prepared, const uint8_t *pixels, int texfilt)
+{
+	if (!bm.gltexture)
+		bm.gltexture = ogl_get_free_texture();
+	auto &tex = *bm.gltexture;
+	tex = prepared;
+	ogl_gen_texture(tex, texfilt);
+	const unsigned bpp = ogl_texture_format_bytes(tex.format);
+	unsigned w = tex.tw, h = tex.th;
+	for (GLint level = 0;; ++level)
+	{
+		glTexImage2D (
+			GL_TEXTURE_2D, level, tex.internalformat,
+			w, h, 0, tex.format,
+			GL_UNSIGNED_BYTE,
+			pixels);
+#ifndef OGLES
+		if (!texfilt || (w == 1 && h == 1))
+#endif
+			break;
+		pixels += w * h * bpp;
+		w = max(w / 2, 1u);
+		h = max(h / 2, 1u);
+	}
+	tex_set_size(tex);
+	r_texcount++;
+}
+
 static void ogl_freetexture(ogl_texture &gltexture)
 {
 	if (gltexture.handle>0) {
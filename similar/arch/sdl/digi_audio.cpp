@@ -14,7 +14,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <SDL.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <digi_audio.h>
 #include "dxxerror.h"
 #include "vecmat.h"
@@ -26,138 +31,248 @@
 
 #include "compiler-range_for.h"
 
+/*
+ * The mixer runs in the audio thread and never waits for the game.  Each
+ * slot is published to it under a sequence number, which is odd while
+ * the game is changing the sound; the mixer picks up a new sound only
+ * when it reads the same even number before and after.  Volume and pan
+ * are single values, so they are simply stored.  The mixer reports that
+ * a sound ran out by storing its sequence number in ended.
+ */
+
 //changed on 980905 by adb to increase number of concurrent sounds
-#define MAX_SOUND_SLOTS 32
+#define MAX_SOUND_SLOTS 64
 //end changes by adb
 #define SOUND_BUFFER_SIZE 1024
+//frames mixed at a time
+#define MIX_CHUNK 256
 
 #define MIN_VOLUME 10
 
-/* This table is used to add two sound values together and pin
- * the value to avoid overflow.  (used with permission from ARDI)
- * DPH: Taken from SDL/src/SDL_mixer.c.
- */
-static const Uint8 mix8[] =
-{
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
-  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
-  0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
-  0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
-  0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
-  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
-  0x3B, 0x3C, 0x3D, 0x3E, 0x3F, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45,
-  0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50,
-  0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B,
-  0x5C, 0x5D, 0x5E, 0x5F, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66,
-  0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70, 0x71,
-  0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C,
-  0x7D, 0x7E, 0x7F, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
-  0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91, 0x92,
-  0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D,
-  0x9E, 0x9F, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8,
-  0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF, 0xB0, 0xB1, 0xB2, 0xB3,
-  0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE,
-  0xBF, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9,
-  0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF, 0xD0, 0xD1, 0xD2, 0xD3, 0xD4,
-  0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
-  0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA,
-  0xEB, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5,
-  0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-};
-
 static int digi_initialised = 0;
 
+namespace {
+
 struct sound_slot {
 	int soundno;
-	bool playing;   // Is there a sample playing on this channel?
-	bool looped;    // Play this sample looped?
+	bool active;     // Was a sound started here and not stopped?
 	bool persistent; // This can't be pre-empted
 	fix pan;       // 0 = far left, 1 = far right
 	fix volume;    // 0 = nothing, 1 = fully on
-	//changed on 980905 by adb from char * to unsigned char *
-	unsigned char *samples;
 	sound_object *soundobj;   // Which soundobject is on this channel
-	//end changes by adb
-	unsigned int length; // Length of the sample
-	unsigned int position; // Position we are at at the moment.
+	//read by the mixer
+	std::atomic<uint32_t> sequence, ended;
+	std::atomic<const uint8_t *> samples;
+	std::atomic<unsigned> length;
+	std::atomic<unsigned> step; // Source samples per output frame, 16.16
+	std::atomic<bool> looped;
+	std::atomic<int> gain_left, gain_right; // 4.12
 };
 
+//the mixer's own copy of a slot
+struct mix_voice {
+	uint32_t sequence;
+	const uint8_t *samples;
+	unsigned length, step;
+	unsigned index, frac; // Position we are at at the moment.
+	bool looped, done;
+};
+
+}
+
 static array<sound_slot, MAX_SOUND_SLOTS> SoundSlots;
+static array<mix_voice, MAX_SOUND_SLOTS> MixVoices;
 static SDL_AudioSpec WaveSpec;
+static unsigned sound_step;
 static int next_channel = 0;
 
-/* Audio mixing callback */
-//changed on 980905 by adb to cleanup, add pan support and optimize mixer
-static void audio_mixcallback(void *, Uint8 *stream, int len)
+static void slot_set_gain(sound_slot &sl)
 {
-	Uint8 *streamend = stream + len;
-	if (!digi_initialised)
-		return;
+	fix vl, vr;
+	const fix x = sl.pan;
+	if (x & 0x8000) {
+		vl = 0x20000 - x * 2;
+		vr = 0x10000;
+	} else {
+		vl = 0x10000;
+		vr = x * 2;
+	}
+	const auto gain = [&sl](const fix v) {
+		return std::min(fixmul(v, sl.volume) >> 4, 0x7fff);
+	};
+	sl.gain_left.store(gain(vl), std::memory_order_relaxed);
+	sl.gain_right.store(gain(vr), std::memory_order_relaxed);
+}
 
-	memset(stream, 0x80, len); // fix "static" sound bug on Mac OS X
+static void slot_publish(sound_slot &sl, const uint8_t *const samples, const unsigned length, const bool looped)
+{
+	const auto s = sl.sequence.load(std::memory_order_relaxed);
+	sl.sequence.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	sl.samples.store(samples, std::memory_order_relaxed);
+	sl.length.store(length, std::memory_order_relaxed);
+	sl.step.store(sound_step, std::memory_order_relaxed);
+	sl.looped.store(looped, std::memory_order_relaxed);
+	sl.sequence.store(s + 2, std::memory_order_release);
+}
 
-	SDL_LockAudio();
+static bool slot_playing(const sound_slot &sl)
+{
+	return sl.active && sl.ended.load(std::memory_order_acquire) != sl.sequence.load(std::memory_order_relaxed);
+}
 
-	range_for (auto &sl, SoundSlots)
+static void voice_update(const sound_slot &sl, mix_voice &v)
+{
+	const auto s = sl.sequence.load(std::memory_order_acquire);
+	if ((s & 1) || s == v.sequence)
+		return;
+	const auto samples = sl.samples.load(std::memory_order_relaxed);
+	const auto length = sl.length.load(std::memory_order_relaxed);
+	const auto step = sl.step.load(std::memory_order_relaxed);
+	const auto looped = sl.looped.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (sl.sequence.load(std::memory_order_relaxed) != s)
+		return;
+	v.sequence = s;
+	v.samples = samples;
+	v.length = length;
+	v.step = step;
+	v.looped = looped;
+	v.index = v.frac = 0;
+	v.done = !samples || !length || !step;
+}
+
+/* Convert up to n frames of the voice to signed 16 bit mono at the
+ * device rate, interpolating linearly between source samples.  Returns
+ * fewer than n if the sound runs out.
+ */
+static unsigned voice_resample(mix_voice &v, int16_t *const out, const unsigned n)
+{
+	const uint8_t *const samples = v.samples;
+	const unsigned length = v.length;
+	unsigned i = 0;
+	if (v.step == 0x10000 && !v.frac)
 	{
-		if (sl.playing) {
-			Uint8 *sldata = sl.samples + sl.position, *slend = sl.samples + sl.length;
-			Uint8 *sp = stream, s;
-			signed char v;
-			fix vl, vr;
-			int x;
-
-			if ((x = sl.pan) & 0x8000) {
-				vl = 0x20000 - x * 2;
-				vr = 0x10000;
-			} else {
-				vl = 0x10000;
-				vr = x * 2;
-			}
-			vl = fixmul(vl, (x = sl.volume));
-			vr = fixmul(vr, x);
-			while (sp < streamend) {
-				if (sldata == slend) {
-					if (!sl.looped) {
-						sl.playing = 0;
-						break;
-					}
-					sldata = sl.samples;
+		//same rate; only the format changes
+		while (i < n)
+		{
+			const unsigned run = std::min(n - i, length - v.index);
+			const uint8_t *const p = samples + v.index;
+			for (unsigned k = 0; k < run; ++k)
+				out[i + k] = (p[k] - 0x80) << 8;
+			i += run;
+			v.index += run;
+			if (v.index == length)
+			{
+				if (!v.looped)
+				{
+					v.done = true;
+					break;
 				}
-				v = *(sldata++) - 0x80;
-				s = *sp;
-				*(sp++) = mix8[ s + fixmul(v, vl) + 0x80 ];
-				s = *sp;
-				*(sp++) = mix8[ s + fixmul(v, vr) + 0x80 ];
+				v.index = 0;
+			}
+		}
+		return i;
+	}
+	for (; i < n; ++i)
+	{
+		const int a = samples[v.index] - 0x80;
+		const unsigned next = v.index + 1;
+		const int b = (next < length ? samples[next] : (v.looped ? samples[0] : 0x80)) - 0x80;
+		out[i] = (a << 8) + (((b - a) * static_cast<int>(v.frac)) >> 8);
+		v.frac += v.step;
+		v.index += v.frac >> 16;
+		v.frac &= 0xffff;
+		if (v.index >= length)
+		{
+			if (!v.looped)
+			{
+				v.done = true;
+				++i;
+				break;
 			}
-			sl.position = sldata - sl.samples;
+			v.index %= length;
 		}
 	}
+	return i;
+}
+
+//acc[2i], acc[2i+1] += mono[i] * left, mono[i] * right
+static void mix_add_stereo(int32_t *const acc, const int16_t *const mono, const unsigned n, const int16_t left, const int16_t right)
+{
+	unsigned i = 0;
+#if defined(__SSE2__)
+	const __m128i gain = _mm_set_epi16(right, left, right, left, right, left, right, left);
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&mono[i]));
+		const auto half = [&gain](const __m128i d, int32_t *const a) {
+			const __m128i lo = _mm_mullo_epi16(d, gain), hi = _mm_mulhi_epi16(d, gain);
+			const auto add = [](int32_t *const p, const __m128i v) {
+				__m128i *const q = reinterpret_cast<__m128i *>(p);
+				_mm_storeu_si128(q, _mm_add_epi32(_mm_loadu_si128(q), _mm_srai_epi32(v, 12)));
+			};
+			add(a, _mm_unpacklo_epi16(lo, hi));
+			add(a + 4, _mm_unpackhi_epi16(lo, hi));
+		};
+		half(_mm_unpacklo_epi16(x, x), &acc[i * 2]);
+		half(_mm_unpackhi_epi16(x, x), &acc[i * 2 + 8]);
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		acc[i * 2] += (mono[i] * left) >> 12;
+		acc[i * 2 + 1] += (mono[i] * right) >> 12;
+	}
+}
 
-	SDL_UnlockAudio();
+static void mix_pack(int16_t *const out, const int32_t *const acc, const unsigned n)
+{
+	unsigned i = 0;
+#if defined(__SSE2__)
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&acc[i]));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&acc[i + 4]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&out[i]), _mm_packs_epi32(a, b));
+	}
+#endif
+	for (; i < n; ++i)
+		out[i] = std::min(std::max(acc[i], -32768), 32767);
+}
+
+/* Audio mixing callback */
+//changed on 980905 by adb to cleanup, add pan support and optimize mixer
+static void audio_mixcallback(void *, Uint8 *stream, int len)
+{
+	if (!digi_initialised)
+	{
+		memset(stream, 0, len);
+		return;
+	}
+	array<int32_t, MIX_CHUNK * 2> acc;
+	array<int16_t, MIX_CHUNK> mono;
+	for (unsigned i = 0; i < MAX_SOUND_SLOTS; ++i)
+		voice_update(SoundSlots[i], MixVoices[i]);
+	const unsigned frames = len / (2 * sizeof(int16_t));
+	int16_t *out = reinterpret_cast<int16_t *>(stream);
+	for (unsigned first = 0; first < frames; first += MIX_CHUNK, out += MIX_CHUNK * 2)
+	{
+		const unsigned n = std::min<unsigned>(MIX_CHUNK, frames - first);
+		std::fill_n(acc.begin(), n * 2, 0);
+		for (unsigned i = 0; i < MAX_SOUND_SLOTS; ++i)
+		{
+			auto &v = MixVoices[i];
+			if (v.done)
+				continue;
+			const auto &sl = SoundSlots[i];
+			const unsigned produced = voice_resample(v, mono.data(), n);
+			mix_add_stereo(acc.data(), mono.data(), produced, sl.gain_left.load(std::memory_order_relaxed), sl.gain_right.load(std::memory_order_relaxed));
+			if (v.done)
+				SoundSlots[i].ended.store(v.sequence, std::memory_order_release);
+		}
+		mix_pack(out, acc.data(), n * 2);
+	}
 }
 //end changes by adb
 
@@ -168,13 +283,15 @@ int digi_audio_init()
 		Error("SDL audio initialisation failed: %s.",SDL_GetError());
 	}
 
+	//sounds are resampled to the device rate as they are mixed
 #if defined(DXX_BUILD_DESCENT_I)
-	WaveSpec.freq = digi_sample_rate;
+	const unsigned sound_rate = digi_sample_rate;
 #elif defined(DXX_BUILD_DESCENT_II)
-	WaveSpec.freq = GameArg.SndDigiSampleRate;
+	const unsigned sound_rate = GameArg.SndDigiSampleRate;
 #endif
+	WaveSpec.freq = SAMPLE_RATE_44K;
 	//added/changed by Sam Lantinga on 12/01/98 for new SDL version
-	WaveSpec.format = AUDIO_U8;
+	WaveSpec.format = AUDIO_S16SYS;
 	WaveSpec.channels = 2;
 	//end this section addition/change - SL
 	WaveSpec.samples = SOUND_BUFFER_SIZE;
@@ -187,6 +304,9 @@ int digi_audio_init()
 		return 1;
 		//end edit -MM
 	}
+	sound_step = (sound_rate << 16) / WaveSpec.freq;
+	range_for (auto &v, MixVoices)
+		v.done = true;
 	SDL_PauseAudio(0);
 
 	digi_initialised = 1;
@@ -225,32 +345,27 @@ int digi_audio_start_sound(short soundnum, fix volume, int pan, int looping, int
 
 	if (soundnum < 0) return -1;
 
-	SDL_LockAudio();
-
 	Assert(GameSounds[soundnum].data != (void *)-1);
 
 	starting_channel = next_channel;
 
 	while(1)
 	{
-		if (!SoundSlots[next_channel].playing)
+		if (!slot_playing(SoundSlots[next_channel]))
 			break;
 
 		if (!SoundSlots[next_channel].persistent)
 			break;	// use this channel!
 
 		next_channel++;
-		if (next_channel >= digi_max_channels)
+		if (next_channel >= MAX_SOUND_SLOTS)
 			next_channel = 0;
 		if (next_channel == starting_channel)
-		{
-			SDL_UnlockAudio();
 			return -1;
-		}
 	}
-	if (SoundSlots[next_channel].playing)
+	if (slot_playing(SoundSlots[next_channel]))
 	{
-		SoundSlots[next_channel].playing = 0;
+		SoundSlots[next_channel].active = false;
 		if (SoundSlots[next_channel].soundobj != sound_object_none)
 		{
 			digi_end_soundobj(*SoundSlots[next_channel].soundobj);
@@ -263,26 +378,21 @@ int digi_audio_start_sound(short soundnum, fix volume, int pan, int looping, int
 	verify_sound_channel_free(next_channel);
 #endif
 
-	SoundSlots[next_channel].soundno = soundnum;
-	SoundSlots[next_channel].samples = GameSounds[soundnum].data;
-	SoundSlots[next_channel].length = GameSounds[soundnum].length;
-	SoundSlots[next_channel].volume = fixmul(digi_volume, volume);
-	SoundSlots[next_channel].pan = pan;
-	SoundSlots[next_channel].position = 0;
-	SoundSlots[next_channel].looped = looping;
-	SoundSlots[next_channel].playing = 1;
-	SoundSlots[next_channel].soundobj = soundobj;
-	SoundSlots[next_channel].persistent = 0;
-	if (soundobj || looping || volume > F1_0)
-		SoundSlots[next_channel].persistent = 1;
+	auto &sl = SoundSlots[next_channel];
+	sl.soundno = soundnum;
+	sl.volume = fixmul(digi_volume, volume);
+	sl.pan = pan;
+	slot_set_gain(sl);
+	slot_publish(sl, GameSounds[soundnum].data, GameSounds[soundnum].length, looping);
+	sl.active = true;
+	sl.soundobj = soundobj;
+	sl.persistent = (soundobj || looping || volume > F1_0);
 
 	i = next_channel;
 	next_channel++;
-	if (next_channel >= digi_max_channels)
+	if (next_channel >= MAX_SOUND_SLOTS)
 		next_channel = 0;
 
-	SDL_UnlockAudio();
-
 	return i;
 }
 
@@ -308,7 +418,7 @@ int digi_audio_is_channel_playing(int channel)
 	if (!digi_initialised)
 		return 0;
 
-	return SoundSlots[channel].playing;
+	return slot_playing(SoundSlots[channel]);
 }
 
 void digi_audio_set_channel_volume(int channel, int volume)
@@ -316,10 +426,12 @@ void digi_audio_set_channel_volume(int channel, int volume)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	auto &sl = SoundSlots[channel];
+	if (!slot_playing(sl))
 		return;
 
-	SoundSlots[channel].volume = fixmuldiv(volume, digi_volume, F1_0);
+	sl.volume = fixmuldiv(volume, digi_volume, F1_0);
+	slot_set_gain(sl);
 }
 
 void digi_audio_set_channel_pan(int channel, int pan)
@@ -327,15 +439,20 @@ void digi_audio_set_channel_pan(int channel, int pan)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	auto &sl = SoundSlots[channel];
+	if (!slot_playing(sl))
 		return;
 
-	SoundSlots[channel].pan = pan;
+	sl.pan = pan;
+	slot_set_gain(sl);
 }
 
 void digi_audio_stop_sound(int channel)
 {
-	SoundSlots[channel].playing=0;
+	auto &sl = SoundSlots[channel];
+	if (sl.active)
+		slot_publish(sl, nullptr, 0, false);
+	sl.active = false;
 	SoundSlots[channel].soundobj = sound_object_none;
 	SoundSlots[channel].persistent = 0;
 }
@@ -345,7 +462,7 @@ void digi_audio_end_sound(int channel)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	if (!slot_playing(SoundSlots[channel]))
 		return;
 
 	SoundSlots[channel].soundobj = sound_object_none;
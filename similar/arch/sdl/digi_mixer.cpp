@@ -17,6 +17,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
+#include <bitset>
+#include <thread>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_audio.h>
@@ -31,12 +35,16 @@
 #include "console.h"
 #include "config.h"
 #include "args.h"
+#include "physfsx.h"
+#include "makesig.h"
+#include "perf_timer.h"
 
 #include "maths.h"
 #include "piggy.h"
 #include "u_mem.h"
 
 #include "compiler-make_unique.h"
+#include "compiler-range_for.h"
 
 #define MIX_DIGI_DEBUG 0
 #define MIX_OUTPUT_FORMAT	AUDIO_S16
@@ -50,13 +58,63 @@
 #endif
 #define MIN_VOLUME 10
 
+#define SOUND_CACHE_DIR	"cache/"
+#define SOUND_CACHE_ID	MAKE_SIG('A','C','P','D') //DPCA
+#define SOUND_CACHE_VERSION	1
+
 namespace {
 
 struct RAIIMix_Chunk : public Mix_Chunk
 {
 	~RAIIMix_Chunk()
 	{
-		delete [] abuf;
+		//chunks in the arena are not allocated
+		if (allocated)
+			delete [] abuf;
+	}
+};
+
+struct mixdigi_spec
+{
+	int freq;
+	Uint16 format;
+	int channels;
+};
+
+/* All sounds converted to the output format, end to end in one buffer.
+ * It is filled by a worker thread from its own copy of the sounds, and
+ * belongs to the game once ready is set.
+ */
+struct mixdigi_arena
+{
+	struct source
+	{
+		uint32_t offset, length, freq;
+	};
+	struct chunk
+	{
+		uint32_t offset, length;
+	};
+	mixdigi_spec spec;
+	array<source, MAX_SOUNDS> sources;
+	std::vector<uint8_t> source_data;
+	array<chunk, MAX_SOUNDS> chunks;
+	std::unique_ptr<uint8_t[]> data;
+	std::thread thread;
+	std::atomic<bool> ready, cancel;
+	//reported by the game once ready
+	bool from_cache, cache_written, joined;
+	//sounds changed by the game since the worker copied them
+	std::bitset<MAX_SOUNDS> replaced;
+	perf_clock::duration elapsed;
+	uint32_t size;
+	~mixdigi_arena()
+	{
+		if (thread.joinable())
+		{
+			cancel.store(true, std::memory_order_relaxed);
+			thread.join();
+		}
 	}
 };
 
@@ -67,6 +125,7 @@ static int digi_mixer_max_channels = MAX_SOUND_SLOTS;
 static inline int fix2byte(fix f) { return (f / 256) % 256; }
 static array<RAIIMix_Chunk, MAX_SOUNDS> SoundChunks;
 static array<uint8_t, MAX_SOUND_SLOTS> channels;
+static mixdigi_arena SoundArena;
 
 /* Initialise audio */
 int digi_mixer_init()
@@ -102,6 +161,7 @@ int digi_mixer_init()
 void digi_mixer_close() {
 	if (MIX_DIGI_DEBUG) con_printf(CON_DEBUG,"digi_close (SDL_Mixer)");
 	if (!digi_initialised) return;
+	digi_mixer_preconvert_stop();
 	digi_initialised = 0;
 	Mix_CloseAudio();
 }
@@ -120,6 +180,235 @@ static void digi_mixer_free_channel(int channel_num)
 	channels[channel_num] = 0;
 }
 
+static mixdigi_spec mixdigi_output_spec()
+{
+	mixdigi_spec r;
+#if defined(DXX_BUILD_DESCENT_I)
+	r.freq = digi_sample_rate;
+	r.format = MIX_OUTPUT_FORMAT;
+	r.channels = MIX_OUTPUT_CHANNELS;
+#elif defined(DXX_BUILD_DESCENT_II)
+	Mix_QuerySpec(&r.freq, &r.format, &r.channels); // get current output settings
+#endif
+	return r;
+}
+
+static int mixdigi_sound_freq(int i)
+{
+#if defined(DXX_BUILD_DESCENT_I)
+	return GameSounds[i].freq;
+#elif defined(DXX_BUILD_DESCENT_II)
+	(void)i;
+	return GameArg.SndDigiSampleRate;
+#endif
+}
+
+static uint32_t mixdigi_arena_hash(const mixdigi_arena &a)
+{
+	//FNV-1a over the source sounds, so that the cache follows the data files
+	uint32_t h = 2166136261u;
+	const auto add = [&h](const uint8_t *p, std::size_t n) {
+		for (; n; --n)
+			h = (h ^ *p++) * 16777619u;
+	};
+	range_for (auto &s, a.sources)
+	{
+		const uint32_t header[2] = {s.length, s.freq};
+		add(reinterpret_cast<const uint8_t *>(header), sizeof(header));
+	}
+	add(a.source_data.data(), a.source_data.size());
+	return h;
+}
+
+static void mixdigi_arena_cache_filename(const mixdigi_arena &a, array<char, PATH_MAX> &filename)
+{
+	snprintf(filename.data(), filename.size(), SOUND_CACHE_DIR "sounds-%d-%04x-%d.pcm", a.spec.freq, a.spec.format, a.spec.channels);
+}
+
+static bool mixdigi_arena_read_cache(mixdigi_arena &a, const char *const filename, const uint32_t hash)
+{
+	auto fp = PHYSFSX_openReadBuffered(filename);
+	if (!fp)
+		return false;
+	uint32_t id, version, h, n, size;
+	if (!PHYSFS_readULE32(fp, &id) || id != SOUND_CACHE_ID ||
+		!PHYSFS_readULE32(fp, &version) || version != SOUND_CACHE_VERSION ||
+		!PHYSFS_readULE32(fp, &h) || h != hash ||
+		!PHYSFS_readULE32(fp, &n) || n != a.chunks.size() ||
+		!PHYSFS_readULE32(fp, &size))
+		return false;
+	range_for (auto &c, a.chunks)
+		if (!PHYSFS_readULE32(fp, &c.offset) || !PHYSFS_readULE32(fp, &c.length) || c.offset > size || c.length > size - c.offset)
+			return false;
+	a.data = make_unique<uint8_t[]>(size);
+	a.size = size;
+	return PHYSFS_read(fp, a.data.get(), 1, size) == static_cast<PHYSFS_sint64>(size);
+}
+
+static bool mixdigi_arena_write_cache(const mixdigi_arena &a, const char *const filename, const uint32_t hash)
+{
+	PHYSFS_mkdir(SOUND_CACHE_DIR);	//try making directory
+	auto fp = PHYSFSX_openWriteBuffered(filename);
+	if (!fp)
+		return false;
+	bool ok = PHYSFS_writeULE32(fp, SOUND_CACHE_ID) &&
+		PHYSFS_writeULE32(fp, SOUND_CACHE_VERSION) &&
+		PHYSFS_writeULE32(fp, hash) &&
+		PHYSFS_writeULE32(fp, a.chunks.size()) &&
+		PHYSFS_writeULE32(fp, a.size);
+	range_for (auto &c, a.chunks)
+		ok = ok && PHYSFS_writeULE32(fp, c.offset) && PHYSFS_writeULE32(fp, c.length);
+	ok = ok && PHYSFS_write(fp, a.data.get(), 1, a.size) == static_cast<PHYSFS_sint64>(a.size);
+	if (!fp.close() || !ok)
+	{
+		PHYSFS_delete(filename);
+		return false;
+	}
+	return true;
+}
+
+static void mixdigi_arena_convert(mixdigi_arena &a)
+{
+	array<SDL_AudioCVT, MAX_SOUNDS> cvts;
+	//first find where each sound goes, then convert it there
+	uint32_t size = 0;
+	for (unsigned i = 0; i < MAX_SOUNDS; ++i)
+	{
+		const auto &s = a.sources[i];
+		auto &c = a.chunks[i];
+		c.offset = size;
+		c.length = 0;
+		if (!s.length)
+			continue;
+		if (SDL_BuildAudioCVT(&cvts[i], AUDIO_U8, 1, s.freq, a.spec.format, a.spec.channels, a.spec.freq) < 0)
+		{
+			cvts[i].len_mult = 0;
+			continue;
+		}
+		size += s.length * cvts[i].len_mult;
+	}
+	a.data = make_unique<uint8_t[]>(size);
+	a.size = size;
+	for (unsigned i = 0; i < MAX_SOUNDS && !a.cancel.load(std::memory_order_relaxed); ++i)
+	{
+		const auto &s = a.sources[i];
+		auto &cvt = cvts[i];
+		if (!s.length || !cvt.len_mult)
+			continue;
+		auto &c = a.chunks[i];
+		cvt.buf = &a.data[c.offset];
+		cvt.len = s.length;
+		memcpy(cvt.buf, &a.source_data[s.offset], s.length);
+		if (!SDL_ConvertAudio(&cvt))
+			c.length = cvt.len_cvt;
+	}
+}
+
+static void mixdigi_arena_run(mixdigi_arena &a)
+{
+	const auto start = perf_clock::now();
+	const uint32_t hash = mixdigi_arena_hash(a);
+	array<char, PATH_MAX> filename;
+	mixdigi_arena_cache_filename(a, filename);
+	a.from_cache = mixdigi_arena_read_cache(a, filename.data(), hash);
+	if (!a.from_cache)
+	{
+		mixdigi_arena_convert(a);
+		if (a.cancel.load(std::memory_order_relaxed))
+			return;
+		a.cache_written = mixdigi_arena_write_cache(a, filename.data(), hash);
+	}
+	std::vector<uint8_t>().swap(a.source_data);
+	a.elapsed = perf_clock::now() - start;
+	a.ready.store(true, std::memory_order_release);
+}
+
+/* Point sound i at its place in the arena, if the arena is done.  The
+ * first call after it is done reports how long it took.
+ */
+static bool mixdigi_arena_take(const int i)
+{
+	auto &a = SoundArena;
+	if (a.replaced[i] || !a.ready.load(std::memory_order_acquire))
+		return false;
+	if (!a.joined)
+	{
+		a.thread.join();
+		a.joined = true;
+		con_printf(CON_VERBOSE, "%s %u KiB of sounds in %u ms%s", a.from_cache ? "Loaded" : "Converted", a.size / 1024, static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(a.elapsed).count()), a.from_cache || a.cache_written ? "" : " (could not write the cache)");
+	}
+	const auto &c = a.chunks[i];
+	if (!c.length)
+		return false;
+	auto &chunk = SoundChunks[i];
+	chunk.abuf = &a.data[c.offset];
+	chunk.alen = c.length;
+	chunk.allocated = 0;
+	chunk.volume = 128; // Max volume = 128
+	return true;
+}
+
+void digi_mixer_preconvert_stop()
+{
+	auto &a = SoundArena;
+	if (a.thread.joinable())
+	{
+		a.cancel.store(true, std::memory_order_relaxed);
+		a.thread.join();
+	}
+	if (!a.data)
+		return;
+	if (digi_initialised)
+		Mix_HaltChannel(-1);
+	channels = {};
+	range_for (auto &chunk, SoundChunks)
+		if (chunk.abuf && !chunk.allocated)
+			chunk.abuf = nullptr;
+	a.data.reset();
+	a.ready.store(false, std::memory_order_relaxed);
+}
+
+void digi_mixer_sound_changed(const int i)
+{
+	SoundArena.replaced[i] = true;
+	auto &chunk = SoundChunks[i];
+	if (!chunk.abuf)
+		return;
+	if (digi_initialised)
+		Mix_HaltChannel(-1);
+	channels = {};
+	if (chunk.allocated)
+		delete [] chunk.abuf;
+	chunk.abuf = nullptr;
+	chunk.allocated = 0;
+}
+
+void digi_mixer_preconvert_sounds()
+{
+	digi_mixer_preconvert_stop();
+	if (!digi_initialised || !GameArg.SndPreconvert)
+		return;
+	auto &a = SoundArena;
+	a.spec = mixdigi_output_spec();
+	a.source_data.clear();
+	for (unsigned i = 0; i < MAX_SOUNDS; ++i)
+	{
+		auto &s = a.sources[i];
+		const auto &g = GameSounds[i];
+		const bool loaded = g.data && g.data != reinterpret_cast<ubyte *>(-1) && g.length > 0;
+		s.offset = a.source_data.size();
+		s.length = loaded ? g.length : 0;
+		s.freq = loaded ? mixdigi_sound_freq(i) : 0;
+		if (loaded)
+			a.source_data.insert(a.source_data.end(), g.data, g.data + g.length);
+	}
+	a.cancel.store(false, std::memory_order_relaxed);
+	a.from_cache = a.cache_written = a.joined = false;
+	a.replaced.reset();
+	a.size = 0;
+	a.thread = std::thread(mixdigi_arena_run, std::ref(a));
+}
+
 /*
  * Play-time conversion. Performs output conversion only once per sound effect used.
  * Once the sound sample has been converted, it is cached in SoundChunks[]
@@ -129,21 +418,14 @@ static void mixdigi_convert_sound(int i)
 	SDL_AudioCVT cvt;
 	Uint8 *data = GameSounds[i].data;
 	Uint32 dlen = GameSounds[i].length;
-	int freq;
-	int out_freq;
-	Uint16 out_format;
-	int out_channels;
-#if defined(DXX_BUILD_DESCENT_I)
-	out_freq = digi_sample_rate;
-	out_format = MIX_OUTPUT_FORMAT;
-	out_channels = MIX_OUTPUT_CHANNELS;
-	freq = GameSounds[i].freq;
-#elif defined(DXX_BUILD_DESCENT_II)
-	Mix_QuerySpec(&out_freq, &out_format, &out_channels); // get current output settings
-	freq = GameArg.SndDigiSampleRate;
-#endif
+	const int freq = mixdigi_sound_freq(i);
+	const auto out = mixdigi_output_spec();
+	const int out_freq = out.freq;
+	const Uint16 out_format = out.format;
+	const int out_channels = out.channels;
 
 	if (SoundChunks[i].abuf) return; //proceed only if not converted yet
+	if (mixdigi_arena_take(i)) return;
 
 	if (data)
 	{
@@ -28,6 +28,7 @@
 #include "args.h"
 #include "config.h"
 #include "palette.h"
+#include "texmerge.h"
 
 #include "compiler-make_unique.h"
 
@@ -37,10 +38,23 @@ static int sdl_video_flags = SDL_SWSURFACE | SDL_HWPALETTE | SDL_DOUBLEBUF;
 SDL_Surface *screen,*canvas;
 static int gr_installed;
 
+static void sdl_render_stats()
+{
+	gr_set_current_canvas(NULL);
+	gr_set_curfont( GAME_FONT );
+	gr_set_fontcolor( BM_XRGB(255,255,255),-1 );
+	const auto tm = texmerge_get_stats();
+	const unsigned tm_lookups = tm.hits + tm.misses;
+	gr_printf(FSPACX(2), FSPACY(1), "%u%% of %u texmerge lookups hit, %u textures in %uK/%uK", tm_lookups ? static_cast<unsigned>((tm.hits * 100ull) / tm_lookups) : 0, tm_lookups, tm.entries, static_cast<unsigned>(tm.bytes / 1024), static_cast<unsigned>(tm.budget / 1024));
+}
+
 void gr_flip()
 {
 	SDL_Rect src, dest;
 
+	if (GameArg.DbgRenderStats)
+		sdl_render_stats();
+
 	dest.x = src.x = dest.y = src.y = 0;
 	dest.w = src.w = canvas->w;
 	dest.h = src.h = canvas->h;
@@ -276,6 +290,7 @@ void gr_palette_load( palette_array_t &pal )
 	if (palette == NULL)
 		return; // Display is not palettised
 
+	init_computed_colors();
 	for (int i=0;i<64;i++)
 		gamma[i] = (int)((pow(((double)(14)/(double)(32)), 1.0)*i) + 0.5);
 
@@ -291,7 +306,6 @@ void gr_palette_load( palette_array_t &pal )
 	}
 
 	SDL_SetColors(canvas, colors.data(), 0, colors.size());
-	init_computed_colors();
 	gr_remap_color_fonts();
 	gr_remap_mono_fonts();
 }
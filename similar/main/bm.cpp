@@ -60,6 +60,10 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "physfsx.h"
 #include "internal.h"
 #include "strutil.h"
+#include "args.h"
+#ifdef USE_SDLMIXER
+#include "digi_mixer.h"
+#endif
 
 #ifdef EDITOR
 #include "editor/texpage.h"
@@ -155,6 +159,10 @@ int gamedata_init()
 		gamedata_read_tbl(retval == PIGGY_PC_SHAREWARE);
 
 	piggy_read_sounds(retval == PIGGY_PC_SHAREWARE);
+#ifdef USE_SDLMIXER
+	if (!GameArg.SndDisableSdlMixer)
+		digi_mixer_preconvert_sounds();
+#endif
 	
 	return 0;
 }
@@ -288,6 +296,10 @@ int gamedata_init()
 				Error("Cannot open ham file\n");
 
 	piggy_read_sounds();
+#ifdef USE_SDLMIXER
+	if (!GameArg.SndDisableSdlMixer)
+		digi_mixer_preconvert_sounds();
+#endif
 
 	return 0;
 }
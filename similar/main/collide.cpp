@@ -671,6 +671,7 @@ int check_effect_blowup(const vsegptridx_t seg,int side,const vms_vector &pnt, c
 		  			digi_link_sound_to_pos( SOUND_LIGHT_BLOWNUP, seg, 0, pnt,  0, F1_0 );
 				}
 #endif
+				flush_fcd_cache();
 
 				return 1;		//blew up!
 			}
@@ -44,6 +44,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "text.h"
 #include "kconfig.h"
 #include "config.h"
+#include "perf_timer.h"
 
 #include "compiler-begin.h"
 #include "compiler-range_for.h"
@@ -66,6 +67,8 @@ struct sound_object
 	vm_distance max_distance;	// The max distance that this sound can be heard at...
 	int			volume;			// Volume that this sound is playing at
 	int			pan;				// Pan value that this sound is playing at
+	int			target_volume, target_pan;	// Where volume and pan are heading
+	int			volume_step, pan_step;	// How far they move each frame
 	int			channel;			// What channel this is playing on, -1 if not playing
 	short			soundnum;		// The sound number that is playing
 	int			loop_start;		// The start point of the loop. -1 means no loop
@@ -132,7 +135,46 @@ static int digi_unxlat_sound(int soundno)
 	throw std::invalid_argument("sound not loaded");
 }
 
-static void digi_get_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const vms_vector &sound_pos, segnum_t sound_seg, fix max_volume, int *volume, int *pan, vm_distance max_distance)
+namespace {
+
+struct sound_route
+{
+	unsigned generation;
+	segnum_t segnum;
+	int max_depth;
+	connected_route route;
+};
+
+}
+
+/* Routes from the listener found by this call of digi_sync_sounds.
+ * Sounds in the same segment share one search.
+ */
+static array<sound_route, 256> Sound_routes;
+static unsigned Sound_route_generation;
+
+static connected_route digi_find_sound_route(const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const segnum_t sound_seg, const int max_depth)
+{
+	const std::size_t mask = Sound_routes.size() - 1;
+	for (std::size_t n = 0, i = (sound_seg * 31u + max_depth) & mask; n != Sound_routes.size(); ++n, i = (i + 1) & mask)
+	{
+		auto &r = Sound_routes[i];
+		if (r.generation != Sound_route_generation)
+		{
+			r.generation = Sound_route_generation;
+			r.segnum = sound_seg;
+			r.max_depth = max_depth;
+			r.route = find_connected_route(listener_pos, listener_seg, sound_seg, max_depth, WID_RENDPAST_FLAG|WID_FLY_FLAG);
+			return r.route;
+		}
+		if (r.segnum == sound_seg && r.max_depth == max_depth)
+			return r.route;
+	}
+	return find_connected_route(listener_pos, listener_seg, sound_seg, max_depth, WID_RENDPAST_FLAG|WID_FLY_FLAG);
+}
+
+//If shared_route, the path may come from Sound_routes
+static void digi_get_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const vms_vector &sound_pos, segnum_t sound_seg, fix max_volume, int *volume, int *pan, vm_distance max_distance, const bool shared_route = false)
 {
 
 	vms_vector	vector_to_sound;
@@ -149,7 +191,9 @@ static void digi_get_sound_loc(const vms_matrix &listener, const vms_vector &lis
 		int num_search_segs = f2i(max_distance/20);
 		if ( num_search_segs < 1 ) num_search_segs = 1;
 
-		auto path_distance = find_connected_distance(listener_pos, listener_seg, sound_pos, sound_seg, num_search_segs, WID_RENDPAST_FLAG|WID_FLY_FLAG );
+		const auto path_distance = shared_route
+			? connected_route_distance(digi_find_sound_route(listener_pos, listener_seg, sound_seg, num_search_segs), sound_pos)
+			: find_connected_distance(listener_pos, listener_seg, sound_pos, sound_seg, num_search_segs, WID_RENDPAST_FLAG|WID_FLY_FLAG );
 		if ( path_distance > -1 )	{
 			*volume = max_volume - fixdiv(path_distance,max_distance);
 			if (*volume > 0 )	{
@@ -332,8 +376,9 @@ static void digi_link_sound_common(cobjptr_t viewer, sound_object &so, const vms
 	so.soundnum = soundnum;
 	so.max_volume = max_volume;
 	so.max_distance = max_distance;
-	so.volume = 0;
-	so.pan = 0;
+	so.volume = so.target_volume = 0;
+	so.pan = so.target_pan = 0;
+	so.volume_step = so.pan_step = 0;
 	if (Dont_start_sound_objects) {		//started at level start
 		so.flags |= SOF_PERMANENT;
 		so.channel =  -1;
@@ -343,6 +388,9 @@ static void digi_link_sound_common(cobjptr_t viewer, sound_object &so, const vms
 		digi_get_sound_loc(viewer->orient, viewer->pos, viewer->segnum,
                        pos, segnum, so.max_volume,
                        &so.volume, &so.pan, so.max_distance);
+		so.target_volume = so.volume;
+		so.target_pan = so.pan;
+		so.volume_step = so.pan_step = 0;
 		digi_start_sound_object(so);
 		// If it's a one-shot sound effect, and it can't start right away, then
 		// just cancel it and be done with it.
@@ -518,9 +566,48 @@ static void digi_record_sound_objects()
 
 static int was_recording = 0;
 
+//sounds further than half their range are brought up to date every
+//SOUND_FAR_BATCHES frames, a share of them each frame, and move toward
+//that in steps between
+#define SOUND_FAR_BATCHES 4
+
+static unsigned Sound_sync_frame;
+
+static int digi_sound_approach(const int value, const int target, const int step)
+{
+	if (!step)
+		return target;
+	const int r = value + step;
+	return (step > 0 ? r > target : r < target) ? target : r;
+}
+
+static void digi_update_sound_loc(sound_object &s, const vcobjptr_t viewer, const vms_vector &pos, const segnum_t segnum, const unsigned batch)
+{
+	const fix range = (s.max_distance * 5) / 4;
+	const bool nearby = vm_vec_dist_quick(viewer->pos, pos) < range / 2;
+	if (nearby || static_cast<uint16_t>(s.signature) % SOUND_FAR_BATCHES == batch)
+	{
+		digi_get_sound_loc(viewer->orient, viewer->pos, viewer->segnum,
+			pos, segnum, s.max_volume,
+			&s.target_volume, &s.target_pan, s.max_distance, true);
+		if (nearby)
+		{
+			s.volume = s.target_volume;
+			s.pan = s.target_pan;
+			s.volume_step = s.pan_step = 0;
+			return;
+		}
+		s.volume_step = (s.target_volume - s.volume) / SOUND_FAR_BATCHES;
+		s.pan_step = (s.target_pan - s.pan) / SOUND_FAR_BATCHES;
+	}
+	s.volume = digi_sound_approach(s.volume, s.target_volume, s.volume_step);
+	s.pan = digi_sound_approach(s.pan, s.target_pan, s.pan_step);
+}
+
 void digi_sync_sounds()
 {
 	int oldvolume, oldpan;
+	perf_scope perf(perf_subsystem::sound);
 
 	if ( Newdemo_state == ND_STATE_RECORDING)	{
 		if ( !was_recording )	{
@@ -535,6 +622,13 @@ void digi_sync_sounds()
 	if (!Viewer)
 		return;
 	const vcobjptr_t viewer{Viewer};
+	if (!++Sound_route_generation)
+	{
+		range_for (auto &r, Sound_routes)
+			r.generation = 0;
+		Sound_route_generation = 1;
+	}
+	const unsigned batch = Sound_sync_frame++ % SOUND_FAR_BATCHES;
 	range_for (auto &s, SoundObjects)
 	{
 		if (s.flags & SOF_USED)
@@ -555,9 +649,7 @@ void digi_sync_sounds()
 			}
 
 			if ( s.flags & SOF_LINK_TO_POS )	{
-				digi_get_sound_loc( viewer->orient, viewer->pos, viewer->segnum,
-                                s.link_type.pos.position, s.link_type.pos.segnum, s.max_volume,
-                                &s.volume, &s.pan, s.max_distance );
+				digi_update_sound_loc(s, viewer, s.link_type.pos.position, s.link_type.pos.segnum, batch);
 
 			} else if ( s.flags & SOF_LINK_TO_OBJ )	{
 				const auto objp = [&s]{
@@ -581,9 +673,7 @@ void digi_sync_sounds()
 					s.flags = 0;	// Mark as dead, so some other sound can use this sound
 					continue;		// Go on to next sound...
 				} else {
-					digi_get_sound_loc( viewer->orient, viewer->pos, viewer->segnum,
-	                                objp->pos, objp->segnum, s.max_volume,
-                                   &s.volume, &s.pan, s.max_distance );
+					digi_update_sound_loc(s, viewer, objp->pos, objp->segnum, batch);
 				}
 			}
 
@@ -40,6 +40,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "physfs-serial.h"
 #include "cntrlcen.h"
 #include "segment.h"
+#include "gameseg.h"
 #include "dxxerror.h"
 
 #include "compiler-range_for.h"
@@ -96,6 +97,7 @@ void do_special_effects()
 					Segments[ec.segnum].sides[ec.sidenum].tmap_num2 = ec.dest_bm_num | (Segments[ec.segnum].sides[ec.sidenum].tmap_num2&0xc000);		//replace with destoyed
 					ec.flags &= ~EF_ONE_SHOT;
 					ec.segnum = segment_none;		//done with this
+					flush_fcd_cache();
 				}
 
 				ec.frame_count = 0;
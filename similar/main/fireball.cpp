@@ -24,6 +24,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
 
 #include <algorithm>
+#include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -63,6 +64,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "gameseg.h"
 #include "automap.h"
 #include "byteutil.h"
+#include "object_broadphase.h"
 
 #include "compiler-range_for.h"
 #include "highest_valid.h"
@@ -102,7 +104,15 @@ static objptridx_t object_create_explosion_sub(const objptridx_t objp, const vse
 		fix damage;
 		// -- now legal for badass explosions on a wall. Assert(objp != NULL);
 
-		range_for (const auto i, highest_valid(Objects))
+		//	Only objects which the explosion can see are affected, so everything
+		//	of interest is linked into a segment within maxdistance.  The quick
+		//	distance below can be about 10% short of the true distance, so
+		//	search a little further than maxdistance.
+		//	This function recurses when a proximity bomb is set off, so the
+		//	candidate list cannot be shared between calls.
+		std::vector<objnum_t> candidates;
+		find_objects_within_radius(candidates, segnum, position, maxdistance + maxdistance / 4);
+		range_for (const auto i, candidates)
 		{
 			auto obj0p = vobjptridx(i);
 			sbyte parent_check = 0;
@@ -1308,6 +1318,7 @@ void do_exploding_wall_frame()
 
 				Walls[seg->sides[sidenum].wall_num].flags |= WALL_BLASTED;
 				Walls[csegp->sides[cside].wall_num].flags |= WALL_BLASTED;
+				flush_fcd_cache();
 
 			}
 
@@ -91,6 +91,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "cntrlcen.h"
 #include "pcx.h"
 #include "state.h"
+#include "segment_pvs.h"
 #include "piggy.h"
 #include "multibot.h"
 #include "fvi.h"
@@ -104,6 +105,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "movie.h"
 #endif
 #include "event.h"
+#include "timedemo.h"
 #include "window.h"
 
 #ifdef EDITOR
@@ -446,22 +448,31 @@ void calc_frame_time()
 {
 	fix last_frametime = FrameTime;
 
-	const auto vsync = CGameCfg.VSync;
-	const auto bound = f1_0 / (likely(vsync) ? MAXIMUM_FPS : GameArg.SysMaxFPS);
-	const auto may_sleep = !GameArg.SysNoNiceFPS && !vsync;
-	for (;;)
+	if (unlikely(Timedemo_active))
 	{
-		const auto timer_value = timer_update();
-		FrameTime = timer_value - last_timer_value;
-		if (FrameTime >= bound)
+		// Run as fast as possible, but advance the game as recorded
+		FrameTime = timedemo_frame();
+		last_timer_value = timer_update();
+	}
+	else
+	{
+		const auto vsync = CGameCfg.VSync;
+		const auto bound = f1_0 / (likely(vsync) ? MAXIMUM_FPS : GameArg.SysMaxFPS);
+		const auto may_sleep = !GameArg.SysNoNiceFPS && !vsync;
+		for (;;)
 		{
-			last_timer_value = timer_value;
-			break;
+			const auto timer_value = timer_update();
+			FrameTime = timer_value - last_timer_value;
+			if (FrameTime >= bound)
+			{
+				last_timer_value = timer_value;
+				break;
+			}
+			if (Game_mode & GM_MULTI)
+				multi_do_frame(); // during long wait, keep packets flowing
+			if (may_sleep)
+				timer_delay(F1_0>>8);
 		}
-		if (Game_mode & GM_MULTI)
-			multi_do_frame(); // during long wait, keep packets flowing
-		if (may_sleep)
-			timer_delay(F1_0>>8);
 	}
 
 	if ( cheats.turbo )
@@ -971,6 +982,8 @@ void show_netgame_help()
 	DXX_##VERB##_TEXT("SHIFT-LEFT\t  FAST BACKWARD", DEMOHELP_FAST_BACKWARD)	\
 	DXX_##VERB##_TEXT("CTRL-RIGHT\t  JUMP TO END", DEMOHELP_JUMP_END)	\
 	DXX_##VERB##_TEXT("CTRL-LEFT\t  JUMP TO START", DEMOHELP_JUMP_START)	\
+	DXX_##VERB##_TEXT("PGUP\t  BACK 10 SECONDS", DEMOHELP_SEEK_BACK)	\
+	DXX_##VERB##_TEXT("PGDN\t  AHEAD 10 SECONDS", DEMOHELP_SEEK_AHEAD)	\
 	_DXX_HELP_MENU_HINT_CMD_KEY(VERB, DEMOHELP)	\
 
 enum {
@@ -1253,6 +1266,8 @@ void game()
 //called at the end of the program
 void close_game()
 {
+	state_save_wait();
+	segment_pvs_invalidate();
 	close_gauges();
 	restore_effect_bitmap_icons();
 }
@@ -1324,6 +1339,7 @@ void GameProcessFrame(void)
 	fix player_shields = get_local_player().shields;
 	int player_was_dead = Player_is_dead;
 
+	state_save_poll();
 	update_player_stats();
 	diminish_palette_towards_normal();		//	Should leave palette effect up for as long as possible by putting right before render.
 	do_afterburner_stuff();
@@ -491,6 +491,12 @@ static int HandleDemoKey(int key)
 		case KEY_CTRLED + KEY_LEFT:
 			newdemo_goto_beginning();
 			break;
+		case KEY_PAGEUP:
+			newdemo_seek_relative(-i2f(10));
+			break;
+		case KEY_PAGEDOWN:
+			newdemo_seek_relative(i2f(10));
+			break;
 
 		KEY_MAC(case KEY_COMMAND+KEY_P:)
 		case KEY_PAUSE:
@@ -51,6 +51,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "key.h"
 #include "piggy.h"
 #include "gamesave.h"
+#include "read_cursor.h"
+#include "mine_cache.h"
 #include "poison.h"
 #include "compiler-range_for.h"
 #include "highest_valid.h"
@@ -805,32 +807,32 @@ int load_mine_data(PHYSFS_file *LoadFile)
 
 #define COMPILED_MINE_VERSION 0
 
-static void read_children(const vsegptr_t segp,ubyte bit_mask,PHYSFS_file *LoadFile)
+static void read_children(const vsegptr_t segp,ubyte bit_mask,read_cursor &c)
 {
 	for (int bit=0; bit<MAX_SIDES_PER_SEGMENT; bit++) {
 		if (bit_mask & (1 << bit)) {
-			segp->children[bit] = PHYSFSX_readShort(LoadFile);
+			segp->children[bit] = c.read_s16();
 		} else
 			segp->children[bit] = segment_none;
 	}
 }
 
-static void read_verts(const vsegptr_t segp,PHYSFS_file *LoadFile)
+static void read_verts(const vsegptr_t segp,read_cursor &c)
 {
 	// Read short Segments[segnum].verts[MAX_VERTICES_PER_SEGMENT]
 	range_for (auto &i, segp->verts)
-		i = PHYSFSX_readShort(LoadFile);
+		i = c.read_s16();
 }
 
-static void read_special(const vsegptr_t segp,ubyte bit_mask,PHYSFS_file *LoadFile)
+static void read_special(const vsegptr_t segp,ubyte bit_mask,read_cursor &c)
 {
 	if (bit_mask & (1 << MAX_SIDES_PER_SEGMENT)) {
 		// Read ubyte	Segments[segnum].special
-		segp->special = PHYSFSX_readByte(LoadFile);
+		segp->special = c.read_u8();
 		// Read byte	Segments[segnum].matcen_num
-		segp->matcen_num = PHYSFSX_readByte(LoadFile);
+		segp->matcen_num = c.read_s8();
 		// Read short	Segments[segnum].value
-		segp->value = PHYSFSX_readShort(LoadFile);
+		segp->value = c.read_s16();
 	} else {
 		segp->special = 0;
 		segp->matcen_num = -1;
@@ -838,23 +840,27 @@ static void read_special(const vsegptr_t segp,ubyte bit_mask,PHYSFS_file *LoadFi
 	}
 }
 
-#if defined(DXX_BUILD_DESCENT_I)
 /*
- * reads a segment2 structure from a PHYSFS_file
+ * reads a segment2 structure of a compiled mine
  */
-static void segment2_read(const vsegptr_t s2, PHYSFS_file *fp)
+static void read_segment2(const vsegptr_t s2, read_cursor &c)
 {
-	s2->special = PHYSFSX_readByte(fp);
+	s2->special = c.read_u8();
+#if defined(DXX_BUILD_DESCENT_I)
 	if (s2->special >= MAX_CENTER_TYPES)
 		s2->special = SEGMENT_IS_NOTHING; // remove goals etc.
-	s2->matcen_num = PHYSFSX_readByte(fp);
-	s2->value = PHYSFSX_readByte(fp);
-	/*s2->s2_flags =*/ PHYSFSX_readByte(fp);	// descent 2 ambient sound handling
-	s2->static_light = PHYSFSX_readFix(fp);
-}
 #endif
+	s2->matcen_num = c.read_s8();
+	s2->value = c.read_s8();
+#if defined(DXX_BUILD_DESCENT_I)
+	/*s2->s2_flags =*/ c.read_u8();	// descent 2 ambient sound handling
+#elif defined(DXX_BUILD_DESCENT_II)
+	s2->s2_flags = c.read_u8();
+#endif
+	s2->static_light = c.read_fix();
+}
 
-int load_mine_data_compiled(PHYSFS_file *LoadFile)
+int load_mine_data_compiled(read_cursor &c, perf_clock::duration &validate_time)
 {
 	ubyte   compiled_version;
 	short   temp_short;
@@ -883,24 +889,24 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 	fuelcen_reset();
 
 	//=============================== Reading part ==============================
-	compiled_version = PHYSFSX_readByte(LoadFile);
+	compiled_version = c.read_u8();
 	(void)compiled_version;
 
 	DXX_MAKE_MEM_UNDEFINED(Vertices.begin(), Vertices.end());
 	if (New_file_format_load)
-		Num_vertices = PHYSFSX_readShort(LoadFile);
+		Num_vertices = c.read_s16();
 	else
-		Num_vertices = PHYSFSX_readInt(LoadFile);
+		Num_vertices = c.read_s32();
 	Assert( Num_vertices <= MAX_VERTICES );
 
 	if (New_file_format_load)
-		Num_segments = PHYSFSX_readShort(LoadFile);
+		Num_segments = c.read_s16();
 	else
-		Num_segments = PHYSFSX_readInt(LoadFile);
+		Num_segments = c.read_s32();
 	Assert( Num_segments <= MAX_SEGMENTS );
 
 	range_for (auto &i, partial_range(Vertices, Num_vertices))
-		PHYSFSX_readVector(LoadFile, i);
+		c.read_vector(i);
 
 	DXX_MAKE_MEM_UNDEFINED(Segments.begin(), Segments.end());
 	for (segnum_t segnum=0; segnum < Num_segments; segnum++ )	{
@@ -912,19 +918,19 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 		#endif
 
 		if (New_file_format_load)
-			bit_mask = PHYSFSX_readByte(LoadFile);
+			bit_mask = c.read_u8();
 		else
 			bit_mask = 0x7f; // read all six children and special stuff...
 
 		if (Gamesave_current_version == 5) { // d2 SHAREWARE level
-			read_special(segp,bit_mask,LoadFile);
-			read_verts(segp,LoadFile);
-			read_children(segp,bit_mask,LoadFile);
+			read_special(segp,bit_mask,c);
+			read_verts(segp,c);
+			read_children(segp,bit_mask,c);
 		} else {
-			read_children(segp,bit_mask,LoadFile);
-			read_verts(segp,LoadFile);
+			read_children(segp,bit_mask,c);
+			read_verts(segp,c);
 			if (Gamesave_current_version <= 1) { // descent 1 level
-				read_special(segp,bit_mask,LoadFile);
+				read_special(segp,bit_mask,c);
 			}
 		}
 
@@ -932,21 +938,21 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 
 		if (Gamesave_current_version <= 5) { // descent 1 thru d2 SHAREWARE level
 			// Read fix	Segments[segnum].static_light (shift down 5 bits, write as short)
-			temp_ushort = PHYSFSX_readShort(LoadFile);
+			temp_ushort = c.read_u16();
 			segp->static_light	= ((fix)temp_ushort) << 4;
 			//PHYSFS_read( LoadFile, &Segments[segnum].static_light, sizeof(fix), 1 );
 		}
 
 		// Read the walls as a 6 byte array
 		if (New_file_format_load)
-			bit_mask = PHYSFSX_readByte(LoadFile);
+			bit_mask = c.read_u8();
 		else
 			bit_mask = 0x3f; // read all six sides
 		for (int sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) {
 			ubyte byte_wallnum;
 
 			if (bit_mask & (1 << sidenum)) {
-				byte_wallnum = PHYSFSX_readByte(LoadFile);
+				byte_wallnum = c.read_u8();
 				if ( byte_wallnum == 255 )
 					segp->sides[sidenum].wall_num = wall_none;
 				else
@@ -958,7 +964,7 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 		for (int sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++ ) {
 			if (segp->children[sidenum] == segment_none || segp->sides[sidenum].wall_num != wall_none)	{
 				// Read short Segments[segnum].sides[sidenum].tmap_num;
-				temp_ushort = PHYSFSX_readShort(LoadFile);
+				temp_ushort = c.read_u16();
 #if defined(DXX_BUILD_DESCENT_I)
 				segp->sides[sidenum].tmap_num = convert_tmap(temp_ushort & 0x7fff);
 
@@ -966,7 +972,7 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 					segp->sides[sidenum].tmap_num2 = 0;
 				else {
 					// Read short Segments[segnum].sides[sidenum].tmap_num2;
-					segp->sides[sidenum].tmap_num2 = PHYSFSX_readShort(LoadFile);
+					segp->sides[sidenum].tmap_num2 = c.read_s16();
 					segp->sides[sidenum].tmap_num2 =
 						(convert_tmap(segp->sides[sidenum].tmap_num2 & 0x3fff)) |
 						(segp->sides[sidenum].tmap_num2 & 0xc000);
@@ -984,7 +990,7 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 					segp->sides[sidenum].tmap_num2 = 0;
 				else {
 					// Read short Segments[segnum].sides[sidenum].tmap_num2;
-					segp->sides[sidenum].tmap_num2 = PHYSFSX_readShort(LoadFile);
+					segp->sides[sidenum].tmap_num2 = c.read_s16();
 					if (Gamesave_current_version <= 1 && segp->sides[sidenum].tmap_num2 != 0)
 						segp->sides[sidenum].tmap_num2 = convert_d1_tmap_num(segp->sides[sidenum].tmap_num2);
 				}
@@ -992,11 +998,11 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 
 				// Read uvl Segments[segnum].sides[sidenum].uvls[4] (u,v>>5, write as short, l>>1 write as short)
 				range_for (auto &i, segp->sides[sidenum].uvls) {
-					temp_short = PHYSFSX_readShort(LoadFile);
+					temp_short = c.read_s16();
 					i.u = ((fix)temp_short) << 5;
-					temp_short = PHYSFSX_readShort(LoadFile);
+					temp_short = c.read_s16();
 					i.v = ((fix)temp_short) << 5;
-					temp_ushort = PHYSFSX_readShort(LoadFile);
+					temp_ushort = c.read_u16();
 					i.l = ((fix)temp_ushort) << 1;
 					//PHYSFS_read( LoadFile, &i.l, sizeof(fix), 1 );
 				}
@@ -1015,12 +1021,14 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 	Highest_vertex_index = Num_vertices-1;
 	Highest_segment_index = Num_segments-1;
 
-	validate_segment_all();			// Fill in side type and normals.
+	const auto validate_start = perf_clock::now();
+	mine_cache_validate_segment_all(Gamesave_current_filename);	// Fill in side type and normals.
+	validate_time = perf_clock::now() - validate_start;
 
 	range_for (auto &i, partial_range(Segments, Num_segments)) {
 		const auto &&pi = vsegptridx(&i);
 		if (Gamesave_current_version > 5)
-			segment2_read(pi, LoadFile);
+			read_segment2(pi, c);
 		fuelcen_activate(pi, i.special );
 	}
 
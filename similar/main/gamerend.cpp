@@ -48,6 +48,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "newdemo.h"
 #include "text.h"
 #include "multi.h"
+#include "multiinterp.h"
 #include "hudmsg.h"
 #include "endlevel.h"
 #include "cntrlcen.h"
@@ -846,7 +847,9 @@ void game_render_frame()
 {
 	set_screen_mode( SCREEN_GAME );
 	play_homing_warning();
+	multi_interp_begin_render();
 	game_render_frame_mono();
+	multi_interp_end_render();
 }
 
 //show a message in a nice little box
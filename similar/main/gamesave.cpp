@@ -70,6 +70,10 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "multi.h"
 #include "makesig.h"
 #include "textures.h"
+#include "segment_pvs.h"
+#include "read_cursor.h"
+#include "perf_timer.h"
+#include "u_mem.h"
 
 #include "dxxsconf.h"
 #include "compiler-range_for.h"
@@ -350,60 +354,60 @@ static void verify_object(const vobjptr_t obj)
 //	PHYSFSX_fseek(file,len,SEEK_CUR);
 //}
 
-//reads one object of the given version from the given file
-static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
+//reads one object of the given version from the level data
+static void read_object(const vobjptr_t obj,read_cursor &c,int version)
 {
 
-	obj->type           = PHYSFSX_readByte(f);
-	obj->id             = PHYSFSX_readByte(f);
+	obj->type           = c.read_s8();
+	obj->id             = c.read_s8();
 
 #if defined(DXX_BUILD_DESCENT_I)
 	if (obj->type == OBJ_ROBOT && get_robot_id(obj) > 23) {
 		set_robot_id(obj, get_robot_id(obj) % 24);
 	}
 #endif
-	obj->control_type   = PHYSFSX_readByte(f);
-	obj->movement_type  = PHYSFSX_readByte(f);
-	obj->render_type    = PHYSFSX_readByte(f);
-	obj->flags          = PHYSFSX_readByte(f);
+	obj->control_type   = c.read_s8();
+	obj->movement_type  = c.read_s8();
+	obj->render_type    = c.read_s8();
+	obj->flags          = c.read_s8();
 
-	obj->segnum         = PHYSFSX_readShort(f);
+	obj->segnum         = c.read_s16();
 	obj->attached_obj   = object_none;
 
-	PHYSFSX_readVector(f, obj->pos);
-	PHYSFSX_readMatrix(&obj->orient,f);
+	c.read_vector(obj->pos);
+	c.read_matrix(obj->orient);
 
-	obj->size           = PHYSFSX_readFix(f);
-	obj->shields        = PHYSFSX_readFix(f);
+	obj->size           = c.read_fix();
+	obj->shields        = c.read_fix();
 
-	PHYSFSX_readVector(f, obj->last_pos);
+	c.read_vector(obj->last_pos);
 
-	obj->contains_type  = PHYSFSX_readByte(f);
-	obj->contains_id    = PHYSFSX_readByte(f);
-	obj->contains_count = PHYSFSX_readByte(f);
+	obj->contains_type  = c.read_s8();
+	obj->contains_id    = c.read_s8();
+	obj->contains_count = c.read_s8();
 
 	switch (obj->movement_type) {
 
 		case MT_PHYSICS:
 
-			PHYSFSX_readVector(f, obj->mtype.phys_info.velocity);
-			PHYSFSX_readVector(f, obj->mtype.phys_info.thrust);
+			c.read_vector(obj->mtype.phys_info.velocity);
+			c.read_vector(obj->mtype.phys_info.thrust);
 
-			obj->mtype.phys_info.mass		= PHYSFSX_readFix(f);
-			obj->mtype.phys_info.drag		= PHYSFSX_readFix(f);
-			PHYSFSX_readFix(f);	/* brakes */
+			obj->mtype.phys_info.mass		= c.read_fix();
+			obj->mtype.phys_info.drag		= c.read_fix();
+			c.read_fix();	/* brakes */
 
-			PHYSFSX_readVector(f, obj->mtype.phys_info.rotvel);
-			PHYSFSX_readVector(f, obj->mtype.phys_info.rotthrust);
+			c.read_vector(obj->mtype.phys_info.rotvel);
+			c.read_vector(obj->mtype.phys_info.rotthrust);
 
-			obj->mtype.phys_info.turnroll	= PHYSFSX_readFixAng(f);
-			obj->mtype.phys_info.flags		= PHYSFSX_readShort(f);
+			obj->mtype.phys_info.turnroll	= c.read_fixang();
+			obj->mtype.phys_info.flags		= c.read_s16();
 
 			break;
 
 		case MT_SPINNING:
 
-			PHYSFSX_readVector(f, obj->mtype.spin_rate);
+			c.read_vector(obj->mtype.spin_rate);
 			break;
 
 		case MT_NONE:
@@ -416,19 +420,19 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 	switch (obj->control_type) {
 
 		case CT_AI: {
-			obj->ctype.ai_info.behavior				= static_cast<ai_behavior>(PHYSFSX_readByte(f));
+			obj->ctype.ai_info.behavior				= static_cast<ai_behavior>(c.read_s8());
 
 			range_for (auto &i, obj->ctype.ai_info.flags)
-				i = PHYSFSX_readByte(f);
+				i = c.read_s8();
 
-			obj->ctype.ai_info.hide_segment			= PHYSFSX_readShort(f);
-			obj->ctype.ai_info.hide_index			= PHYSFSX_readShort(f);
-			obj->ctype.ai_info.path_length			= PHYSFSX_readShort(f);
-			obj->ctype.ai_info.cur_path_index		= PHYSFSX_readShort(f);
+			obj->ctype.ai_info.hide_segment			= c.read_s16();
+			obj->ctype.ai_info.hide_index			= c.read_s16();
+			obj->ctype.ai_info.path_length			= c.read_s16();
+			obj->ctype.ai_info.cur_path_index		= c.read_s16();
 
 			if (version <= 25) {
-				PHYSFSX_readShort(f);	//				obj->ctype.ai_info.follow_path_start_seg	= 
-				PHYSFSX_readShort(f);	//				obj->ctype.ai_info.follow_path_end_seg		= 
+				c.read_s16();	//				obj->ctype.ai_info.follow_path_start_seg	= 
+				c.read_s16();	//				obj->ctype.ai_info.follow_path_end_seg		= 
 			}
 
 			break;
@@ -436,9 +440,9 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 
 		case CT_EXPLOSION:
 
-			obj->ctype.expl_info.spawn_time		= PHYSFSX_readFix(f);
-			obj->ctype.expl_info.delete_time		= PHYSFSX_readFix(f);
-			obj->ctype.expl_info.delete_objnum	= PHYSFSX_readShort(f);
+			obj->ctype.expl_info.spawn_time		= c.read_fix();
+			obj->ctype.expl_info.delete_time		= c.read_fix();
+			obj->ctype.expl_info.delete_objnum	= c.read_s16();
 			obj->ctype.expl_info.next_attach = obj->ctype.expl_info.prev_attach = obj->ctype.expl_info.attach_parent = object_none;
 
 			break;
@@ -447,9 +451,9 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 
 			//do I really need to read these?  Are they even saved to disk?
 
-			obj->ctype.laser_info.parent_type		= PHYSFSX_readShort(f);
-			obj->ctype.laser_info.parent_num		= PHYSFSX_readShort(f);
-			obj->ctype.laser_info.parent_signature	= object_signature_t{static_cast<uint16_t>(PHYSFSX_readInt(f))};
+			obj->ctype.laser_info.parent_type		= c.read_s16();
+			obj->ctype.laser_info.parent_num		= c.read_s16();
+			obj->ctype.laser_info.parent_signature	= object_signature_t{static_cast<uint16_t>(c.read_s32())};
 #if defined(DXX_BUILD_DESCENT_II)
 			obj->ctype.laser_info.last_afterburner_time = 0;
 #endif
@@ -458,13 +462,13 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 
 		case CT_LIGHT:
 
-			obj->ctype.light_info.intensity = PHYSFSX_readFix(f);
+			obj->ctype.light_info.intensity = c.read_fix();
 			break;
 
 		case CT_POWERUP:
 
 			if (version >= 25)
-				obj->ctype.powerup_info.count = PHYSFSX_readInt(f);
+				obj->ctype.powerup_info.count = c.read_s32();
 			else
 				obj->ctype.powerup_info.count = 1;
 
@@ -511,17 +515,17 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 			int tmo;
 
 #if defined(DXX_BUILD_DESCENT_I)
-			obj->rtype.pobj_info.model_num		= convert_polymod(PHYSFSX_readInt(f));
+			obj->rtype.pobj_info.model_num		= convert_polymod(c.read_s32());
 #elif defined(DXX_BUILD_DESCENT_II)
-			obj->rtype.pobj_info.model_num		= PHYSFSX_readInt(f);
+			obj->rtype.pobj_info.model_num		= c.read_s32();
 #endif
 
 			range_for (auto &i, obj->rtype.pobj_info.anim_angles)
-				PHYSFSX_readAngleVec(&i, f);
+				c.read_angvec(i);
 
-			obj->rtype.pobj_info.subobj_flags	= PHYSFSX_readInt(f);
+			obj->rtype.pobj_info.subobj_flags	= c.read_s32();
 
-			tmo = PHYSFSX_readInt(f);
+			tmo = c.read_s32();
 
 			#ifndef EDITOR
 #if defined(DXX_BUILD_DESCENT_I)
@@ -553,12 +557,12 @@ static void read_object(const vobjptr_t obj,PHYSFS_file *f,int version)
 		case RT_FIREBALL:
 
 #if defined(DXX_BUILD_DESCENT_I)
-			obj->rtype.vclip_info.vclip_num	= convert_vclip(PHYSFSX_readInt(f));
+			obj->rtype.vclip_info.vclip_num	= convert_vclip(c.read_s32());
 #elif defined(DXX_BUILD_DESCENT_II)
-			obj->rtype.vclip_info.vclip_num	= PHYSFSX_readInt(f);
+			obj->rtype.vclip_info.vclip_num	= c.read_s32();
 #endif
-			obj->rtype.vclip_info.frametime	= PHYSFSX_readFix(f);
-			obj->rtype.vclip_info.framenum	= PHYSFSX_readByte(f);
+			obj->rtype.vclip_info.frametime	= c.read_fix();
+			obj->rtype.vclip_info.framenum	= c.read_s8();
 
 			break;
 
@@ -776,7 +780,7 @@ static void write_object(const vcobjptr_t obj, short version, PHYSFS_file *f)
 // If level != -1, it loads the filename with extension changed to .min
 // Otherwise it loads the appropriate level mine.
 // returns 0=everything ok, 1=old version, -1=error
-static int load_game_data(PHYSFS_file *LoadFile)
+static int load_game_data(PHYSFS_file *LoadFile, read_cursor &c)
 {
 	short game_top_fileinfo_version;
 	int object_offset;
@@ -867,17 +871,19 @@ static int load_game_data(PHYSFS_file *LoadFile)
 	Gamesave_num_players = 0;
 
 	if (object_offset > -1) {
-		if (PHYSFSX_fseek( LoadFile, object_offset, SEEK_SET ))
-			Error( "Error seeking to object_offset in gamesave.c" );
+		c.seek(object_offset);
 
 		range_for (auto &i, partial_range(Objects, gs_num_objects))
 		{
 			const auto &&o = vobjptr(&i);
-			read_object(o, LoadFile, game_top_fileinfo_version);
+			read_object(o, c, game_top_fileinfo_version);
 			i.signature = obj_get_signature();
 			verify_object(o);
 		}
 
+		//	The rest is read a record at a time, which needs no cursor.
+		if (PHYSFSX_fseek(LoadFile, c.tell(), SEEK_SET))
+			Error( "Error seeking past objects in gamesave.c" );
 	}
 
 	//===================== READ WALL INFO ============================
@@ -1166,6 +1172,7 @@ int load_level(const char * filename_passed)
 	char filename[PATH_MAX];
 	int sig, minedata_offset, gamedata_offset;
 	int mine_err, game_err;
+	const auto load_start = perf_clock::now();
 
    if (Game_mode & GM_NETWORK)
 	 {
@@ -1178,6 +1185,9 @@ int load_level(const char * filename_passed)
 	#endif
 
 	strcpy(filename,filename_passed);
+	segment_pvs_invalidate();
+	invalidate_segment_grid();
+	flush_fcd_cache();
 
 #ifdef EDITOR
 	//if we have the editor, try the LVL first, no matter what was passed.
@@ -1216,6 +1226,19 @@ int load_level(const char * filename_passed)
 
 	strcpy( Gamesave_current_filename, filename );
 
+	//	Read all of the file at once; the mine and the objects are decoded
+	//	from memory.
+	const auto file_size = PHYSFS_fileLength(LoadFile);
+	if (file_size < 0)
+		Error("Can't get length of file <%s>", filename);
+	RAIIdmem<uint8_t[]> level_data;
+	MALLOC(level_data, uint8_t[], file_size);
+	if (PHYSFS_read(LoadFile, level_data.get(), 1, file_size) != file_size)
+		Error("Can't read file <%s>", filename);
+	read_cursor level_cursor(level_data.get(), file_size, filename);
+	const auto read_time = perf_clock::now() - load_start;
+	PHYSFSX_fseek(LoadFile, 0, SEEK_SET);
+
 	sig                      = PHYSFSX_readInt(LoadFile);
 	Gamesave_current_version = PHYSFSX_readInt(LoadFile);
 	minedata_offset          = PHYSFSX_readInt(LoadFile);
@@ -1282,9 +1305,11 @@ int load_level(const char * filename_passed)
 	}
 #endif
 
-	PHYSFSX_fseek(LoadFile,minedata_offset,SEEK_SET);
+	const auto mine_start = perf_clock::now();
+	perf_clock::duration validate_time{};
 	#ifdef EDITOR
 	if (!use_compiled_level) {
+		PHYSFSX_fseek(LoadFile,minedata_offset,SEEK_SET);
 		mine_err = load_mine_data(LoadFile);
 #if 0 // get from d1src if needed
 		// Compress all uv coordinates in mine, improves texmap precision. --MK, 02/19/96
@@ -1292,8 +1317,12 @@ int load_level(const char * filename_passed)
 #endif
 	} else
 	#endif
+	{
 		//NOTE LINK TO ABOVE!!
-		mine_err = load_mine_data_compiled(LoadFile);
+		level_cursor.seek(minedata_offset);
+		mine_err = load_mine_data_compiled(level_cursor, validate_time);
+	}
+	const auto mine_time = perf_clock::now() - mine_start;
 
 	/* !!!HACK!!!
 	 * Descent 1 - Level 19: OBERON MINE has some ugly overlapping rooms (segment 484).
@@ -1335,13 +1364,22 @@ int load_level(const char * filename_passed)
 	if (mine_err == -1) {   //error!!
 		return 2;
 	}
+	build_segment_grid();
 
 	PHYSFSX_fseek(LoadFile,gamedata_offset,SEEK_SET);
-	game_err = load_game_data(LoadFile);
+	const auto game_start = perf_clock::now();
+	game_err = load_game_data(LoadFile, level_cursor);
+	const auto load_end = perf_clock::now();
 
 	if (game_err == -1) {   //error!!
 		return 3;
 	}
+	{
+		const auto us = [](const perf_clock::duration d) {
+			return static_cast<unsigned>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+		};
+		con_printf(CON_VERBOSE, "Level %s loaded in %u us: %u us reading, %u us decoding, %u us validating segments", filename, us(load_end - load_start), us(read_time), us(mine_time - validate_time + (load_end - game_start)), us(validate_time));
+	}
 
 	//======================== CLOSE FILE =============================
 	LoadFile.reset();
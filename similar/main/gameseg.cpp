@@ -24,7 +24,13 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>	//	for memset()
@@ -593,10 +599,189 @@ static segptridx_t trace_segs(const vms_vector &p0, const vsegptridx_t oldsegnum
 	return segment_none;		//we haven't found a segment
 }
 
+namespace {
+
+/* Uniform grid over the bounding boxes of all segments, so that
+ * find_point_seg can first run the plane tests on only the segments
+ * whose box contains the point.  Each cell holds the segments
+ * overlapping it in increasing segment number, so the first match is
+ * the same segment the linear scan would have returned.
+ */
+class segment_grid_t
+{
+	static const unsigned max_cells_per_axis = 64;
+	array<fix, 3> mins;
+	array<int64_t, 3> cell_size;
+	array<unsigned, 3> dims;
+	std::vector<uint32_t> cell_start;
+	std::vector<segnum_t> cell_segments;
+	unsigned axis_cell(unsigned axis, fix v) const
+	{
+		const auto c = (static_cast<int64_t>(v) - mins[axis]) / cell_size[axis];
+		return std::min(static_cast<unsigned>(c), dims[axis] - 1);
+	}
+	static array<fix, 3> coords(const vms_vector &v)
+	{
+		return {{v.x, v.y, v.z}};
+	}
+public:
+	typedef partial_range_t<const segnum_t *> candidate_range;
+	bool valid() const
+	{
+		return !cell_start.empty();
+	}
+	void clear()
+	{
+		cell_start.clear();
+		cell_segments.clear();
+	}
+	void build();
+	candidate_range candidates(const vms_vector &p) const;
+};
+
+}
+
+static segment_grid_t Segment_grid;
+static std::vector<segment_bounding_sphere> Segment_bounding_spheres;
+
+static segment_bounding_sphere compute_segment_bounding_sphere(const vcsegptr_t seg)
+{
+	segment_bounding_sphere b;
+	compute_segment_center(b.center, seg);
+	b.radius = 0;
+	range_for (const auto v, seg->verts)
+		b.radius = std::max(b.radius, static_cast<fix>(vm_vec_dist(b.center, Vertices[v])));
+	return b;
+}
+
+void segment_grid_t::build()
+{
+	clear();
+	const unsigned num_segments = Highest_segment_index + 1;
+	if (!num_segments)
+		return;
+	/* Segments with non-planar sides can extend slightly past their
+	 * vertices as far as get_seg_masks is concerned.
+	 */
+	const fix margin = F1_0;
+	struct box
+	{
+		array<fix, 3> lo, hi;
+	};
+	std::vector<box> boxes(num_segments);
+	array<fix, 3> maxs;
+	mins.fill(std::numeric_limits<fix>::max());
+	maxs.fill(std::numeric_limits<fix>::min());
+	for (segnum_t s = 0; s < num_segments; ++s)
+	{
+		auto &b = boxes[s];
+		b.lo.fill(std::numeric_limits<fix>::max());
+		b.hi.fill(std::numeric_limits<fix>::min());
+		range_for (const auto v, vcsegptr(s)->verts)
+		{
+			const auto c = coords(Vertices[v]);
+			for (unsigned a = 0; a < 3; ++a)
+			{
+				b.lo[a] = std::min(b.lo[a], c[a]);
+				b.hi[a] = std::max(b.hi[a], c[a]);
+			}
+		}
+		for (unsigned a = 0; a < 3; ++a)
+		{
+			b.lo[a] = (b.lo[a] > std::numeric_limits<fix>::min() + margin) ? b.lo[a] - margin : std::numeric_limits<fix>::min();
+			b.hi[a] = (b.hi[a] < std::numeric_limits<fix>::max() - margin) ? b.hi[a] + margin : std::numeric_limits<fix>::max();
+			mins[a] = std::min(mins[a], b.lo[a]);
+			maxs[a] = std::max(maxs[a], b.hi[a]);
+		}
+	}
+	//aim for roughly one segment per cell
+	array<int64_t, 3> extent;
+	double volume = 1;
+	for (unsigned a = 0; a < 3; ++a)
+	{
+		extent[a] = static_cast<int64_t>(maxs[a]) - mins[a] + 1;
+		volume *= extent[a];
+	}
+	const double ideal = std::cbrt(volume / num_segments);
+	unsigned total_cells = 1;
+	for (unsigned a = 0; a < 3; ++a)
+	{
+		const auto d = static_cast<unsigned>(std::ceil(extent[a] / ideal));
+		dims[a] = std::max(1u, std::min(d, max_cells_per_axis));
+		cell_size[a] = (extent[a] + dims[a] - 1) / dims[a];
+		total_cells *= dims[a];
+	}
+	cell_start.assign(total_cells + 1, 0);
+	const auto for_each_cell = [this](const box &b, const std::function<void(unsigned)> &f) {
+		array<unsigned, 3> lo, hi;
+		for (unsigned a = 0; a < 3; ++a)
+		{
+			lo[a] = axis_cell(a, b.lo[a]);
+			hi[a] = axis_cell(a, b.hi[a]);
+		}
+		for (unsigned z = lo[2]; z <= hi[2]; ++z)
+			for (unsigned y = lo[1]; y <= hi[1]; ++y)
+				for (unsigned x = lo[0]; x <= hi[0]; ++x)
+					f((z * dims[1] + y) * dims[0] + x);
+	};
+	range_for (auto &b, boxes)
+		for_each_cell(b, [this](unsigned c) { ++ cell_start[c + 1]; });
+	for (unsigned c = 0; c < total_cells; ++c)
+		cell_start[c + 1] += cell_start[c];
+	cell_segments.resize(cell_start.back());
+	std::vector<uint32_t> fill(cell_start.begin(), std::prev(cell_start.end()));
+	for (segnum_t s = 0; s < num_segments; ++s)
+		for_each_cell(boxes[s], [this, &fill, s](unsigned c) { cell_segments[fill[c]++] = s; });
+	con_printf(CON_VERBOSE, "Segment grid: %ux%ux%u cells, %u entries for %u segments", dims[0], dims[1], dims[2], static_cast<unsigned>(cell_segments.size()), num_segments);
+}
+
+segment_grid_t::candidate_range segment_grid_t::candidates(const vms_vector &p) const
+{
+	const auto c = coords(p);
+	unsigned idx[3];
+	for (unsigned a = 0; a < 3; ++a)
+	{
+		if (c[a] < mins[a] || static_cast<int64_t>(c[a]) - mins[a] >= cell_size[a] * dims[a])
+			return {nullptr, nullptr};
+		idx[a] = axis_cell(a, c[a]);
+	}
+	const auto cell = (idx[2] * dims[1] + idx[1]) * dims[0] + idx[0];
+	const auto b = cell_segments.data();
+	return {b + cell_start[cell], b + cell_start[cell + 1]};
+}
+
+void build_segment_grid()
+{
+	Segment_grid.build();
+	Segment_bounding_spheres.clear();
+	range_for (const auto s, highest_valid(Segments))
+		Segment_bounding_spheres.emplace_back(compute_segment_bounding_sphere(vcsegptr(static_cast<segnum_t>(s))));
+}
+
+void invalidate_segment_grid()
+{
+	Segment_grid.clear();
+	Segment_bounding_spheres.clear();
+}
+
+segment_bounding_sphere get_segment_bounding_sphere(const vcsegptridx_t seg)
+{
+	//the editor may have moved vertices since the spheres were found
+	const segnum_t segnum = seg;
+	if (segnum < Segment_bounding_spheres.size()
+#ifdef EDITOR
+		&& !(Game_mode & GM_EDITOR)
+#endif
+		)
+		return Segment_bounding_spheres[segnum];
+	return compute_segment_bounding_sphere(seg);
+}
+
 //Tries to find a segment for a point, in the following way:
 // 1. Check the given segment
 // 2. Recursively trace through attached segments
-// 3. Check all the segmentns
+// 3. Check all the segments whose bounding box contains the point
+// 4. Check every segment
 //Returns segnum if found, or -1
 segptridx_t find_point_seg(const vms_vector &p,const segptridx_t segnum)
 {
@@ -616,6 +801,22 @@ segptridx_t find_point_seg(const vms_vector &p,const segptridx_t segnum)
 	//	slowing down lighting, and in about 98% of cases, it would just return -1 anyway.
 	//	Matt: This really should be fixed, though.  We're probably screwing up our lighting in a few places.
 	if (!Doing_lighting_hack_flag) {
+		//the editor may have moved vertices since the grid was built
+		if (Segment_grid.valid()
+#ifdef EDITOR
+			&& !(Game_mode & GM_EDITOR)
+#endif
+			)
+		{
+			range_for (const auto newseg, Segment_grid.candidates(p))
+			{
+				const auto segp = vsegptridx(newseg);
+				if (get_seg_masks(p, segp, 0).centermask == 0)
+					return segp;
+			}
+			//a badly warped segment may reach past its padded box, so
+			//a miss is confirmed by the full scan
+		}
 		range_for (const auto newseg, highest_valid(Segments))
 		{
 			const auto segp = vsegptridx(newseg);
@@ -702,74 +903,202 @@ segptridx_t find_point_seg(const vms_vector &p,const segptridx_t segnum)
 
 int	Connected_segment_distance;
 
-#if defined(DXX_BUILD_DESCENT_I)
-static inline void add_to_fcd_cache(int seg0, int seg1, int depth, vm_distance dist)
+namespace {
+
+struct fcd_key
 {
-	(void)(seg0||seg1||depth||dist);
-}
-#elif defined(DXX_BUILD_DESCENT_II)
-#define	MIN_CACHE_FCD_DIST	(F1_0*80)	//	Must be this far apart for cache lookup to succeed.  Recognizes small changes in distance matter at small distances.
-#define	MAX_FCD_CACHE	8
+	segnum_t seg0, seg1;
+	unsigned wid_flag;
+	int max_depth;
+	bool operator==(const fcd_key &rhs) const
+	{
+		return seg0 == rhs.seg0 && seg1 == rhs.seg1 && wid_flag == rhs.wid_flag && max_depth == rhs.max_depth;
+	}
+};
 
-namespace {
+//	The path is stored rather than its length, so that a hit gives the
+//	same answer a new search would give for the new endpoints.
+struct fcd_data
+{
+	fcd_key key;
+	uint16_t hash_next, lru_prev, lru_next;
+	int csd;			//	value for Connected_segment_distance
+	bool reachable;
+	vms_vector near_p0, near_p1;	//	centers of the path segments next to seg0 and seg1
+	vm_distance inner;	//	length of the path between near_p1 and near_p0
+};
 
-struct fcd_data {
-	segnum_t	seg0, seg1;
-	int csd;
-	vm_distance dist;
+//	Least recently used cache of find_connected_distance results.  It is
+//	flushed whenever a wall changes in a way which could change
+//	WALL_IS_DOORWAY, so entries never go stale.
+class fcd_cache_t
+{
+	static const unsigned size = 256;
+	static const uint16_t none = UINT16_MAX;
+	array<fcd_data, size> entries;
+	array<uint16_t, size> bucket_head;
+	uint16_t lru_head, lru_tail;		//	head is the most recently used
+	unsigned used;
+	static unsigned hash(const fcd_key &k)
+	{
+		return ((k.seg0 * 31u + k.seg1) * 7u + k.wid_flag + static_cast<unsigned>(k.max_depth)) % size;
+	}
+	void lru_unlink(const uint16_t i)
+	{
+		auto &e = entries[i];
+		(e.lru_prev == none ? lru_head : entries[e.lru_prev].lru_next) = e.lru_next;
+		(e.lru_next == none ? lru_tail : entries[e.lru_next].lru_prev) = e.lru_prev;
+	}
+	void lru_push_front(const uint16_t i)
+	{
+		auto &e = entries[i];
+		e.lru_prev = none;
+		e.lru_next = lru_head;
+		(lru_head == none ? lru_tail : entries[lru_head].lru_prev) = i;
+		lru_head = i;
+	}
+	void hash_unlink(const uint16_t i)
+	{
+		for (auto *p = &bucket_head[hash(entries[i].key)]; *p != none; p = &entries[*p].hash_next)
+			if (*p == i)
+			{
+				*p = entries[i].hash_next;
+				return;
+			}
+	}
+public:
+	fcd_cache_stats stats;
+	fcd_cache_t() :
+		stats{}
+	{
+		flush();
+	}
+	void flush()
+	{
+		bucket_head.fill(none);
+		lru_head = lru_tail = none;
+		used = 0;
+	}
+	const fcd_data *find(const fcd_key &k)
+	{
+		for (auto i = bucket_head[hash(k)]; i != none; i = entries[i].hash_next)
+			if (entries[i].key == k)
+			{
+				++ stats.hits;
+				lru_unlink(i);
+				lru_push_front(i);
+				return &entries[i];
+			}
+		++ stats.misses;
+		return nullptr;
+	}
+	fcd_data &insert(const fcd_key &k)
+	{
+		uint16_t i;
+		if (used < size)
+			i = used++;
+		else
+		{
+			i = lru_tail;
+			hash_unlink(i);
+			lru_unlink(i);
+		}
+		auto &e = entries[i];
+		e.key = k;
+		auto &head = bucket_head[hash(k)];
+		e.hash_next = head;
+		head = i;
+		lru_push_front(i);
+		return e;
+	}
 };
 
+const uint16_t fcd_cache_t::none;
+
 }
 
-int	Fcd_index = 0;
-static array<fcd_data, MAX_FCD_CACHE> Fcd_cache;
-fix64	Last_fcd_flush_time;
+static fcd_cache_t Fcd_cache;
+//	Reused by every search, so that starting one does not need to clear them.
+static visited_segment_generation_t Fcd_visited;
+static array<seg_seg, MAX_SEGMENTS> Fcd_seg_queue;
+static array<short, MAX_SEGMENTS> Fcd_depth;
 
 //	----------------------------------------------------------------------------------------------------------
 void flush_fcd_cache(void)
 {
-	Fcd_index = 0;
+	Fcd_cache.flush();
+}
 
-	range_for (auto &i, Fcd_cache)
-		i.seg0 = segment_none;
+fcd_cache_stats get_fcd_cache_stats()
+{
+	return Fcd_cache.stats;
 }
 
-//	----------------------------------------------------------------------------------------------------------
-static void add_to_fcd_cache(int seg0, int seg1, int depth, vm_distance dist)
+static connected_route unreachable_route()
 {
-	if (dist > MIN_CACHE_FCD_DIST) {
-		Fcd_cache[Fcd_index].seg0 = seg0;
-		Fcd_cache[Fcd_index].seg1 = seg1;
-		Fcd_cache[Fcd_index].csd = depth;
-		Fcd_cache[Fcd_index].dist = dist;
+	connected_route r;
+	r.reachable = false;
+	r.direct = false;
+	return r;
+}
 
-		Fcd_index++;
+static connected_route direct_route(const vms_vector &p0)
+{
+	connected_route r;
+	r.reachable = true;
+	r.direct = true;
+	r.p0 = p0;
+	return r;
+}
 
-		if (Fcd_index >= MAX_FCD_CACHE)
-			Fcd_index = 0;
-	} else {
-		//	If it's in the cache, remove it.
-		range_for (auto &i, Fcd_cache)
-			if (i.seg0 == seg0)
-				if (i.seg1 == seg1) {
-					Fcd_cache[Fcd_index].seg0 = segment_none;
-					break;
-				}
-	}
+static connected_route add_unreachable_to_fcd_cache(const fcd_key &k)
+{
+	auto &e = Fcd_cache.insert(k);
+	e.csd = Connected_segment_distance = 1000;
+	e.reachable = false;
+	return unreachable_route();
+}
 
+static connected_route fcd_route(const fcd_data &e, const vms_vector &p0)
+{
+	Connected_segment_distance = e.csd;
+	if (!e.reachable)
+		return unreachable_route();
+	connected_route r;
+	r.reachable = true;
+	r.direct = false;
+	r.near_p1 = e.near_p1;
+	r.p0_distance = vm_vec_dist_quick(p0, e.near_p0);
+	r.p0_distance += e.inner;
+	return r;
+}
+
+vm_distance connected_route_distance(const connected_route &r, const vms_vector &p1)
+{
+	if (!r.reachable)
+		return vm_distance::maximum_value();
+	if (r.direct)
+		return vm_vec_dist_quick(r.p0, p1);
+	auto dist = vm_vec_dist_quick(p1, r.near_p1);
+	dist += r.p0_distance;
+	return dist;
 }
-#endif
 
 //	----------------------------------------------------------------------------------------------------------
 //	Determine whether seg0 and seg1 are reachable in a way that allows sound to pass.
 //	Search up to a maximum depth of max_depth.
 //	Return the distance.
 vm_distance find_connected_distance(const vms_vector &p0, const vcsegptridx_t seg0, const vms_vector &p1, const vcsegptridx_t seg1, int max_depth, WALL_IS_DOORWAY_mask_t wid_flag)
+{
+	return connected_route_distance(find_connected_route(p0, seg0, seg1, max_depth, wid_flag), p1);
+}
+
+connected_route find_connected_route(const vms_vector &p0, const vcsegptridx_t seg0, const vcsegptridx_t seg1, int max_depth, WALL_IS_DOORWAY_mask_t wid_flag)
 {
 	segnum_t		cur_seg;
 	int		qtail = 0, qhead = 0;
-	seg_seg	seg_queue[MAX_SEGMENTS];
-	short		depth[MAX_SEGMENTS];
+	auto &seg_queue = Fcd_seg_queue;
+	auto &depth = Fcd_depth;
 	int		cur_depth;
 	int		num_points;
 	point_seg	point_segs[MAX_LOC_POINT_SEGS];
@@ -785,7 +1114,7 @@ vm_distance find_connected_distance(const vms_vector &p0, const vcsegptridx_t se
 
 	if (seg0 == seg1) {
 		Connected_segment_distance = 0;
-		return vm_vec_dist_quick(p0, p1);
+		return direct_route(p0);
 	} else {
 		auto conn_side = find_connect_side(seg0, seg1);
 		if (conn_side != -1) {
@@ -794,34 +1123,22 @@ vm_distance find_connected_distance(const vms_vector &p0, const vcsegptridx_t se
 #endif
 			{
 				Connected_segment_distance = 1;
-				return vm_vec_dist_quick(p0, p1);
+				return direct_route(p0);
 			}
 		}
 	}
 
-#if defined(DXX_BUILD_DESCENT_II)
-	//	Periodically flush cache.
-	if ((GameTime64 - Last_fcd_flush_time > F1_0*2) || (GameTime64 < Last_fcd_flush_time)) {
-		flush_fcd_cache();
-		Last_fcd_flush_time = GameTime64;
-	}
-
-	//	Can't quickly get distance, so see if in Fcd_cache.
-	range_for (auto &i, Fcd_cache)
-		if (i.seg0 == seg0 && i.seg1 == seg1)
-		{
-			Connected_segment_distance = i.csd;
-			return i.dist;
-		}
-#endif
+	const fcd_key key{seg0, seg1, wid_flag.value, max_depth};
+	if (const auto cached = Fcd_cache.find(key))
+		return fcd_route(*cached, p0);
 
 	num_points = 0;
 
-	visited_segment_bitarray_t visited;
-	memset(depth, 0, sizeof(depth[0]) * (Highest_segment_index+1));
+	auto &visited = Fcd_visited;
+	visited.next_generation();
 
 	cur_seg = seg0;
-	visited[cur_seg] = true;
+	visited.mark(cur_seg);
 	cur_depth = 0;
 
 	while (cur_seg != seg1) {
@@ -835,17 +1152,13 @@ vm_distance find_connected_distance(const vms_vector &p0, const vcsegptridx_t se
 				continue;
 			if (!wid_flag.value || (WALL_IS_DOORWAY(segp, snum) & wid_flag))
 			{
-				if (!visited[this_seg]) {
+				if (visited.mark(this_seg)) {
 					seg_queue[qtail].start = cur_seg;
 					seg_queue[qtail].end = this_seg;
-					visited[this_seg] = true;
 					depth[qtail++] = cur_depth+1;
 					if (max_depth != -1) {
-						if (depth[qtail-1] == max_depth) {
-							Connected_segment_distance = 1000;
-							add_to_fcd_cache(seg0, seg1, Connected_segment_distance, vm_distance::maximum_value());
-							return vm_distance::maximum_value();
-						}
+						if (depth[qtail-1] == max_depth)
+							return add_unreachable_to_fcd_cache(key);
 					} else if (this_seg == seg1) {
 						goto fcd_done1;
 					}
@@ -854,11 +1167,8 @@ vm_distance find_connected_distance(const vms_vector &p0, const vcsegptridx_t se
 			}
 		}	//	for (sidenum...
 
-		if (qhead >= qtail) {
-			Connected_segment_distance = 1000;
-			add_to_fcd_cache(seg0, seg1, Connected_segment_distance, vm_distance::maximum_value());
-			return vm_distance::maximum_value();
-		}
+		if (qhead >= qtail)
+			return add_unreachable_to_fcd_cache(key);
 
 		cur_seg = seg_queue[qhead].end;
 		cur_depth = depth[qhead];
@@ -869,11 +1179,8 @@ fcd_done1: ;
 
 	//	Set qtail to the segment which ends at the goal.
 	while (seg_queue[--qtail].end != seg1)
-		if (qtail < 0) {
-			Connected_segment_distance = 1000;
-			add_to_fcd_cache(seg0, seg1, Connected_segment_distance, vm_distance::maximum_value());
-			return vm_distance::maximum_value();
-		}
+		if (qtail < 0)
+			return add_unreachable_to_fcd_cache(key);
 
 	while (qtail >= 0) {
 		segnum_t	parent_seg, this_seg;
@@ -897,20 +1204,20 @@ fcd_done1: ;
 
 	if (num_points == 1) {
 		Connected_segment_distance = num_points;
-		return vm_vec_dist_quick(p0, p1);
+		return direct_route(p0);
+	}
+	vm_distance inner{0};
+	for (int i=1; i<num_points-2; i++) {
+		inner += vm_vec_dist_quick(point_segs[i].point, point_segs[i+1].point);
 	}
-	auto dist = vm_vec_dist_quick(p1, point_segs[1].point);
-		dist += vm_vec_dist_quick(p0, point_segs[num_points-2].point);
-
-		for (int i=1; i<num_points-2; i++) {
-			dist += vm_vec_dist_quick(point_segs[i].point, point_segs[i+1].point);
-		}
-
-	Connected_segment_distance = num_points;
-	add_to_fcd_cache(seg0, seg1, num_points, dist);
-
-	return dist;
 
+	auto &e = Fcd_cache.insert(key);
+	e.csd = num_points;
+	e.reachable = true;
+	e.near_p1 = point_segs[1].point;
+	e.near_p0 = point_segs[num_points-2].point;
+	e.inner = inner;
+	return fcd_route(e, p0);
 }
 
 static sbyte convert_to_byte(fix f)
@@ -1449,19 +1756,46 @@ void validate_segment(const vsegptridx_t sp)
 //	Validate all segments.
 //	Highest_segment_index must be set.
 //	For all used segments (number <= Highest_segment_index), segnum field must be != -1.
+//	A segment's sides depend only on its own vertices and children, so the
+//	segments are shared out among threads in batches.
 void validate_segment_all(void)
 {
-	range_for (const auto s, highest_valid(Segments))
-	{
-		const auto &&segp = vsegptridx(static_cast<segnum_t>(s));
-		#ifdef EDITOR
-		if (segp->segnum != segment_none)
-		#endif
-			validate_segment(segp);
-	}
+	const unsigned num_segments = Highest_segment_index + 1;
+	const unsigned batch = 64;
+	std::atomic<unsigned> next_segment(0);
+	const auto validate_batches = [num_segments, &next_segment]() {
+		for (unsigned first; (first = next_segment.fetch_add(batch)) < num_segments;)
+		{
+			const auto last = std::min(first + batch, num_segments);
+			for (segnum_t s = first; s != last; ++s)
+			{
+				const auto &&segp = vsegptridx(s);
+				#ifdef EDITOR
+				if (segp->segnum == segment_none)
+					continue;
+				#endif
+				for (int side = 0; side < MAX_SIDES_PER_SEGMENT; side++)
+					validate_segment_side(segp, side);
+			}
+		}
+	};
+	const unsigned threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), (num_segments + batch - 1) / batch);
+	std::vector<std::thread> helpers;
+	for (unsigned i = 1; i < threads; ++i)
+		helpers.emplace_back(validate_batches);
+	validate_batches();
+	range_for (auto &t, helpers)
+		t.join();
 
 	#ifdef EDITOR
 	{
+		//	Sets Degenerate_segment_found, so not done on the threads.
+		range_for (const auto s, highest_valid(Segments))
+		{
+			const auto &&segp = vcsegptr(static_cast<segnum_t>(s));
+			if (segp->segnum != segment_none)
+				check_for_degenerate_segment(segp);
+		}
 		for (int s=Highest_segment_index+1; s<MAX_SEGMENTS; s++)
 			if (Segments[s].segnum != segment_none) {
 				Segments[s].segnum = segment_none;
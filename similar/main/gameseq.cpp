@@ -111,6 +111,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "segment.h"
 #include "gameseg.h"
 #include "fmtcheck.h"
+#include "segment_pvs.h"
 
 #include "compiler-range_for.h"
 #include "highest_valid.h"
@@ -758,7 +759,10 @@ void LoadLevel(int level_num,int page_in_textures)
 		piggy_load_level_data();
 #endif
 
+	compute_max_object_light();
+
 	my_segments_checksum = netmisc_calc_checksum();
+	segment_pvs_load_level(level_name, my_segments_checksum);
 
 	reset_network_objects();
 
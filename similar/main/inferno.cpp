@@ -134,6 +134,7 @@ static void print_commandline_help()
 	printf( "  -auto-record-demo             Start recording on level entry\n");
 	printf( "  -record-demo-format           Set demo name automatically\n");
 	printf( "  -autodemo                     Start in demo mode\n");
+	printf( "  -timedemo <s>                 Play demo <s> unthrottled, print frame timings and exit\n");
 	printf( "  -window                       Run the game in a window\n");
 	printf( "  -noborders                    Don't show borders in window mode\n");
 #if defined(DXX_BUILD_DESCENT_I)
@@ -156,10 +157,12 @@ static void print_commandline_help()
 #endif
 #ifdef    USE_SDLMIXER
 	printf( "  -nosdlmixer                   Disable Sound output via SDL_mixer\n");
+	printf( "  -sndpreconvert                Convert all sounds for SDL_mixer when loaded,\n\t\t\t\tcaching the result on disk\n");
 #endif // USE SDLMIXER
 
 	printf( "\n Graphics:\n\n");
 	printf( "  -lowresfont                   Force use of low resolution fonts\n");
+	printf( "  -texmerge_cache <n>           Keep up to <n> KB of merged textures (default: %i)\n", TEXMERGE_CACHE_KB_DEFAULT);
 #if defined(DXX_BUILD_DESCENT_II)
 	printf( "  -lowresgraphics               Force use of low resolution graphics\n");
 	printf( "  -lowresmovies                 Play low resolution movies if available (for slow machines)\n");
@@ -181,6 +184,12 @@ static void print_commandline_help()
 	printf( "  -udp_hostaddr <s>             Use IP address/Hostname <s> for manual game joining\n\t\t\t\t(default: %s)\n", UDP_MANUAL_ADDR_DEFAULT);
 	printf( "  -udp_hostport <n>             Use UDP port <n> for manual game joining (default: %i)\n", UDP_PORT_DEFAULT);
 	printf( "  -udp_myport <n>               Set my own UDP port to <n> (default: %i)\n", UDP_PORT_DEFAULT);
+	printf( "  -udp_nothread                 Send and receive packets on the game thread\n");
+	printf( "  -udp_interp <n>               Draw other ships and robots <n> ms behind the latest update,\n\t\t\t\tsmoothed (default: 0, off)\n");
+	printf( "  -udp_synth <n>                When hosting, add <n> synthetic players for load testing\n");
+	printf( "  -udp_synth_pps <n>            Position packets per second of each synthetic player\n\t\t\t\t(default: the game's packets per second)\n");
+	printf( "  -udp_synth_fire <n>           Shots per second of each synthetic player (default: 2)\n");
+	printf( "  -udp_synth_mdata <n>          Acknowledged messages per second of each synthetic player\n\t\t\t\t(default: 5)\n");
 	printf( "  -no-tracker                   Disable tracker (unless overridden by later -tracker_hostaddr)\n");
 #ifdef USE_TRACKER
 	printf( "  -tracker_hostaddr <n>         Address of tracker server to register/query games to/from\n\t\t\t\t(default: %s)\n", TRACKER_ADDR_DEFAULT);
@@ -207,7 +216,7 @@ static void print_commandline_help()
 	printf( "  -no-grab                      Never grab keyboard/mouse\n");
 	printf( "  -renderstats                  Enable renderstats info by default\n");
 	printf( "  -text <s>                     Specify alternate .tex file\n");
-	printf( "  -tmap <s>                     Select texmapper <s> to use\n\t\t\t\t(default: c, available: c, fp, quad)\n");
+	printf( "  -tmap <s>                     Select texmapper <s> to use\n\t\t\t\t(default: sse2 or neon if supported, else c,\n\t\t\t\tavailable: c, sse2, avx2, neon, sub, fp, quad,\n\t\t\t\tcompare:<s> to count pixels differing from c)\n");
 	printf( "  -showmeminfo                  Show memory statistics\n");
 	printf( "  -nodoublebuffer               Disable Doublebuffering\n");
 	printf( "  -bigpig                       Use uncompressed RLE bitmaps\n");
@@ -222,6 +231,8 @@ static void print_commandline_help()
 #else
 	printf( "  -hwsurface                    Use SDL HW Surface\n");
 	printf( "  -asyncblit                    Use queued blits over SDL. Can speed up rendering\n");
+	printf( "  -tmap_threads <n>             Draw with <n> threads (default: 0, one per CPU)\n");
+	printf( "  -tmap_verify                  Check threaded drawing against one thread\n");
 #endif // OGL
 
 	printf( "\n Help:\n\n");
@@ -437,6 +448,9 @@ int main(int argc, char *argv[])
 	arch_init();
 
 	select_tmap(GameArg.DbgTexMap);
+#ifndef OGL
+	tmap_band_init(GameArg.DbgTmapThreads, GameArg.DbgTmapVerify);
+#endif
 
 #if defined(DXX_BUILD_DESCENT_II)
 	Lighting_on = 1;
@@ -481,7 +495,7 @@ int main(int argc, char *argv[])
 		return(0);
 
 	con_printf( CON_DEBUG, "\nInitializing texture caching system..." );
-	texmerge_init( 10 );		// 10 cache bitmaps
+	texmerge_init(static_cast<std::size_t>(GameArg.GfxTexmergeCacheKB) * 1024);
 
 #if defined(DXX_BUILD_DESCENT_II)
 	piggy_init_pigfile("groupa.pig");	//get correct pigfile
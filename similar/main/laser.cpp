@@ -26,6 +26,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <vector>
 
 #include "inferno.h"
 #include "game.h"
@@ -59,6 +60,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "fwd-wall.h"
 #include "reverse.h"
 #include "playsave.h"
+#include "object_broadphase.h"
 
 #include "compiler-range_for.h"
 #include "highest_valid.h"
@@ -1101,17 +1103,24 @@ objptridx_t find_homing_object_complete(const vms_vector &curpos, const vobjptri
 
 	const fix64 HOMING_MAX_TRACKABLE_DIST = F1_0*250;
 	vm_distance_squared max_trackable_dist{HOMING_MAX_TRACKABLE_DIST * HOMING_MAX_TRACKABLE_DIST};
+	fix max_trackable_radius = HOMING_MAX_TRACKABLE_DIST;
 	fix min_trackable_dot = HOMING_MAX_TRACKABLE_DOT;
 
 #if defined(DXX_BUILD_DESCENT_II)
 	if (tracker->id == OMEGA_ID) {
 		max_trackable_dist = OMEGA_MAX_TRACKABLE_DIST * OMEGA_MAX_TRACKABLE_DIST;
+		max_trackable_radius = OMEGA_MAX_TRACKABLE_DIST;
 		min_trackable_dot = OMEGA_MIN_TRACKABLE_DOT;
 	}
 #endif
 
+	//	Anything trackable must be visible from the tracker and within range of curpos,
+	//	so it is linked into a segment near the tracker.
+	static std::vector<objnum_t> candidates;
+	find_objects_within_radius(candidates, vcsegptridx(tracker->segnum), tracker->pos, max_trackable_radius + vm_vec_dist(curpos, tracker->pos));
+
 	objptridx_t	best_objnum = object_none;
-	range_for (const auto objnum, highest_valid(Objects))
+	range_for (const auto objnum, candidates)
 	{
 		int			is_proximity = 0;
 		fix			dot;
@@ -57,6 +57,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"
 #include "rle.h"
 #include "wall.h"
+#include "perf_timer.h"
 
 #include "compiler-range_for.h"
 #include "highest_valid.h"
@@ -469,6 +470,45 @@ static g3s_lrgb compute_light_emission(const vobjptridx_t obj)
 	return lemission;
 }
 
+static fix Max_object_light;
+
+//	The brightest light an object other than a player can give off, as
+//	compute_light_emission finds it.  Lights made by matcens are the only
+//	OBJ_LIGHT objects.
+void compute_max_object_light()
+{
+	fix m = F1_0;	//colored lights are made at least this bright
+	range_for (auto &v, partial_range(Vclip, Num_vclips))
+	{
+		//fireballs fade from 4 seconds left, which may be more than play_time
+		if (v.play_time > 0 && v.play_time < F1_0*4)
+			m = max(m, fixmul(fixdiv(F1_0*4, v.play_time), v.light_value));
+		else
+			m = max(m, v.light_value);
+	}
+	range_for (auto &w, partial_range(Weapon_info, N_weapon_types))
+		m = max(m, w.light);
+	m = max(m, 2*(Weapon_info[FLARE_ID].light + 0x3fff));
+#if defined(DXX_BUILD_DESCENT_II)
+	range_for (auto &r, partial_range(Robot_info, N_robot_types))
+		m = max(m, F1_0*r.lightcast);
+	m = max(m, F1_0*4);	//markers
+#endif
+	range_for (auto &p, partial_range(Powerup_info, N_powerup_types))
+		m = max(m, p.light);
+	Max_object_light = max(m, i2f(8));	//matcen lights
+}
+
+//	Whether pos is within reach of the box from bmin to bmax.
+static bool point_within_box_reach(const vms_vector &pos, const vms_vector &bmin, const vms_vector &bmax, const int64_t reach)
+{
+	const auto axis = [](const fix p, const fix lo, const fix hi) -> int64_t {
+		return p < lo ? static_cast<int64_t>(lo) - p : (p > hi ? static_cast<int64_t>(p) - hi : 0);
+	};
+	const auto dx = axis(pos.x, bmin.x, bmax.x), dy = axis(pos.y, bmin.y, bmax.y), dz = axis(pos.z, bmin.z, bmax.z);
+	return static_cast<uint64_t>(dx * dx) + static_cast<uint64_t>(dy * dy) + static_cast<uint64_t>(dz * dz) <= static_cast<uint64_t>(reach * reach);
+}
+
 // ----------------------------------------------------------------------------------------------
 void set_dynamic_light(render_state_t &rstate)
 {
@@ -481,6 +521,8 @@ void set_dynamic_light(render_state_t &rstate)
 	if (!Do_dynamic_light)
 		return;
 
+	perf_scope perf(perf_subsystem::lighting);
+
 	light_time += FrameTime;
 	if (light_time < (F1_0/60)) // it's enough to stress the CPU 60 times per second
 		return;
@@ -490,7 +532,9 @@ void set_dynamic_light(render_state_t &rstate)
 
 	//	Create list of vertices that need to be looked at for setting of ambient light.
 	uint_fast32_t n_render_vertices = 0;
-	range_for (const auto segnum, partial_range(rstate.Render_list, rstate.N_render_segs))
+	const auto &render_list = rstate.Render_list;
+	vms_vector render_min{}, render_max{};
+	range_for (const auto segnum, partial_range(render_list, rstate.N_render_segs))
 	{
 		if (segnum != segment_none) {
 			auto &vp = Segments[segnum].verts;
@@ -504,6 +548,15 @@ void set_dynamic_light(render_state_t &rstate)
 				if (!b)
 				{
 					b = true;
+					const auto &vert = Vertices[vnum];
+					if (!n_render_vertices)
+						render_min = render_max = vert;
+					render_min.x = min(render_min.x, vert.x);
+					render_min.y = min(render_min.y, vert.y);
+					render_min.z = min(render_min.z, vert.z);
+					render_max.x = max(render_max.x, vert.x);
+					render_max.y = max(render_max.y, vert.y);
+					render_max.z = max(render_max.z, vert.z);
 					render_vertices[n_render_vertices] = vnum;
 					vert_segnum_list[n_render_vertices] = segnum;
 					n_render_vertices++;
@@ -515,9 +568,22 @@ void set_dynamic_light(render_state_t &rstate)
 
 	cast_muzzle_flash_light(n_render_vertices, render_vertices, vert_segnum_list);
 
+	/* Skip objects too far from every vertex being drawn for even the
+	 * brightest light to reach, before working out what they emit.
+	 * apply_light lights a vertex when its quick distance from the light
+	 * is under 64 times the intensity, and a quick distance is at least
+	 * 0.9 of the true one, so the result is the same as lighting from
+	 * every object.  Players are always included, because their
+	 * headlights reach much further and are also used to light objects.
+	 */
+	if (!Max_object_light)
+		compute_max_object_light();
+	const int64_t light_reach = static_cast<int64_t>(Max_object_light) * 72;
 	range_for (const auto objnum, highest_valid(Objects))
 	{
 		const auto &&obj = vobjptridx(static_cast<objnum_t>(objnum));
+		if (obj->type != OBJ_PLAYER && (!n_render_vertices || !point_within_box_reach(obj->pos, render_min, render_max, light_reach)))
+			continue;
 		const auto &&obj_light_emission = compute_light_emission(obj);
 
 		if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
@@ -48,6 +48,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "palette.h"
 #include "args.h"
 #include "newdemo.h"
+#include "newdemo_index.h"
 #include "timer.h"
 #include "sounds.h"
 #include "gameseq.h"
@@ -58,6 +59,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "playsave.h"
 #include "kconfig.h"
 #include "titles.h"
+#include "timedemo.h"
 #include "credits.h"
 #include "texmap.h"
 #include "polyobj.h"
@@ -436,7 +438,7 @@ static int main_menu_handler(newmenu *menu,const d_event &event, int *menu_choic
 		case EVENT_WINDOW_ACTIVATED:
 			load_palette(MENU_PALETTE,0,1);		//get correct palette
 
-			if (!*static_cast<const char *>(get_local_player().callsign))
+			if (!*static_cast<const char *>(get_local_player().callsign) && GameArg.SysTimeDemo.empty())
 				RegisterPlayer();
 			else
 				keyd_time_when_last_pressed = timer_query();		// .. 20 seconds from now!
@@ -456,6 +458,11 @@ static int main_menu_handler(newmenu *menu,const d_event &event, int *menu_choic
 			break;
 
 		case EVENT_IDLE:
+			if (!GameArg.SysTimeDemo.empty())
+			{
+				timedemo_start();
+				break;
+			}
 #if defined(DXX_BUILD_DESCENT_I)
 #define DXX_DEMO_KEY_DELAY	45
 #elif defined(DXX_BUILD_DESCENT_II)
@@ -696,7 +703,13 @@ static int demo_menu_keycommand( listbox *lb,const d_event &event )
 					if (ret)
 						nm_messagebox( NULL, 1, TXT_OK, "%s %s %s", TXT_COULDNT, TXT_DELETE_DEMO, items[citem]+((items[citem][0]=='$')?1:0) );
 					else
+					{
+						char index_name[PATH_MAX];
+
+						demo_index_filename(index_name, name);
+						PHYSFS_delete(index_name);
 						listbox_delete_item(lb, citem);
+					}
 				}
 
 				return 1;
@@ -722,6 +735,17 @@ static int demo_menu_keycommand( listbox *lb,const d_event &event )
 				return 1;
 			}
 			break;
+
+		case KEY_CTRLED+KEY_I:
+			if (citem >= 0)
+			{
+				if (newdemo_write_index(items[citem]))
+					nm_messagebox( NULL, 1, TXT_OK, "Indexed %s", items[citem]+((items[citem][0]=='$')?1:0) );
+				else
+					nm_messagebox( NULL, 1, TXT_OK, "Could not index %s", items[citem]+((items[citem][0]=='$')?1:0) );
+				return 1;
+			}
+			break;
 	}
 
 	return 0;
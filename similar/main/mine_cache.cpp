@@ -0,0 +1,180 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Cache of derived mine data.
+ *
+ * validate_segment_all finds the triangulation and normals of every side
+ * from nothing but the vertices and how the segments use and join them.
+ * Those are hashed, and the results kept in the cache directory under
+ * the hash, so a level which has been played before gets them back in
+ * one read.
+ *
+ */
+
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include "physfsx.h"
+#include "console.h"
+#include "segment.h"
+#include "gameseg.h"
+#include "byteutil.h"
+#include "makesig.h"
+#include "read_cursor.h"
+#include "mine_cache.h"
+
+#include "compiler-range_for.h"
+#include "highest_valid.h"
+#include "partial_range.h"
+
+#define MINE_CACHE_DIR	"cache/"
+#define MINE_CACHE_FILE_ID	MAKE_SIG('S','D','I','S')
+static const unsigned MINE_CACHE_FILE_VERSION = 1;
+//id, version, segments, vertices, hash
+static const std::size_t mine_cache_header_size = 5 * 4;
+//type, then two normals
+static const std::size_t mine_cache_side_size = 1 + 2 * 3 * 4;
+
+namespace {
+
+struct mine_cache_header
+{
+	uint32_t num_segments, num_vertices, mine_hash;
+};
+
+}
+
+static void hash_add(uint32_t &h, const uint32_t v)
+{
+	h ^= v;
+	h *= 16777619u;
+}
+
+//Everything validate_segment_all reads
+static uint32_t hash_mine()
+{
+	uint32_t h = 2166136261u;
+	range_for (auto &v, partial_range(Vertices, Num_vertices))
+	{
+		hash_add(h, v.x);
+		hash_add(h, v.y);
+		hash_add(h, v.z);
+	}
+	range_for (const auto s, highest_valid(Segments))
+	{
+		const auto &&segp = vcsegptr(static_cast<segnum_t>(s));
+		range_for (const auto v, segp->verts)
+			hash_add(h, v);
+		range_for (const auto c, segp->children)
+			hash_add(h, c);
+	}
+	return h;
+}
+
+static void get_cache_filename(array<char, PATH_MAX> &filename, const char *const level_filename, const uint32_t mine_hash)
+{
+	const char *const slash = strrchr(level_filename, '/');
+	snprintf(filename.data(), filename.size(), MINE_CACHE_DIR "%s-%08x.sides", slash ? slash + 1 : level_filename, mine_hash);
+}
+
+static bool read_mine_cache(const char *const filename, const mine_cache_header &expected)
+{
+	auto fp = PHYSFSX_openReadBuffered(filename);
+	if (!fp)
+		return false;
+	const std::size_t size = mine_cache_header_size + expected.num_segments * MAX_SIDES_PER_SEGMENT * mine_cache_side_size;
+	if (PHYSFS_fileLength(fp) != static_cast<PHYSFS_sint64>(size))
+		return false;
+	std::vector<uint8_t> buf(size);
+	if (PHYSFS_read(fp, buf.data(), 1, size) != static_cast<PHYSFS_sint64>(size))
+		return false;
+	read_cursor c(buf.data(), size, filename);
+	if (c.read_u32() != MINE_CACHE_FILE_ID ||
+		c.read_u32() != MINE_CACHE_FILE_VERSION ||
+		c.read_u32() != expected.num_segments ||
+		c.read_u32() != expected.num_vertices ||
+		c.read_u32() != expected.mine_hash)
+		return false;
+	//	Check the types before any side is changed, so that a bad file
+	//	leaves the mine for validate_segment_all.
+	for (std::size_t i = 0, n = expected.num_segments * MAX_SIDES_PER_SEGMENT; i != n; ++i)
+	{
+		switch (buf[mine_cache_header_size + i * mine_cache_side_size])
+		{
+			case SIDE_IS_QUAD:
+			case SIDE_IS_TRI_02:
+			case SIDE_IS_TRI_13:
+				break;
+			default:
+				return false;
+		}
+	}
+	range_for (auto &seg, partial_range(Segments, expected.num_segments))
+		range_for (auto &side, seg.sides)
+		{
+			side.set_type(static_cast<unsigned>(c.read_u8()));
+			c.read_vector(side.normals[0]);
+			c.read_vector(side.normals[1]);
+		}
+	return true;
+}
+
+static void write_mine_cache(const char *const filename, const mine_cache_header &h)
+{
+	std::vector<uint8_t> buf(mine_cache_header_size + h.num_segments * MAX_SIDES_PER_SEGMENT * mine_cache_side_size);
+	auto p = buf.data();
+	const auto put_int = [&p](const uint32_t v) {
+		PUT_INTEL_INT(p, v);
+		p += 4;
+	};
+	put_int(MINE_CACHE_FILE_ID);
+	put_int(MINE_CACHE_FILE_VERSION);
+	put_int(h.num_segments);
+	put_int(h.num_vertices);
+	put_int(h.mine_hash);
+	range_for (auto &seg, partial_range(Segments, h.num_segments))
+		range_for (auto &side, seg.sides)
+		{
+			*p++ = side.get_type();
+			range_for (auto &n, side.normals)
+			{
+				put_int(n.x);
+				put_int(n.y);
+				put_int(n.z);
+			}
+		}
+	PHYSFS_mkdir(MINE_CACHE_DIR);	//try making directory
+	auto fp = PHYSFSX_openWriteBuffered(filename);
+	if (!fp)
+		return;
+	const bool ok = PHYSFS_write(fp, buf.data(), 1, buf.size()) == static_cast<PHYSFS_sint64>(buf.size());
+	if (!fp.close() || !ok)
+	{
+		con_printf(CON_URGENT, "Failed to write mine cache %s", filename);
+		PHYSFS_delete(filename);
+	}
+}
+
+void mine_cache_validate_segment_all(const char *const level_filename)
+{
+	const mine_cache_header h{static_cast<uint32_t>(Highest_segment_index + 1), static_cast<uint32_t>(Num_vertices), hash_mine()};
+	array<char, PATH_MAX> filename;
+	get_cache_filename(filename, level_filename, h.mine_hash);
+	if (read_mine_cache(filename.data(), h))
+	{
+		con_printf(CON_VERBOSE, "Loaded sides of %u segments from %s", h.num_segments, filename.data());
+#ifdef EDITOR
+		for (int s=Highest_segment_index+1; s<MAX_SEGMENTS; s++)
+			Segments[s].segnum = segment_none;
+#endif
+		return;
+	}
+	validate_segment_all();
+	write_mine_cache(filename.data(), h);
+}
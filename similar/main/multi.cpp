@@ -66,6 +66,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "text.h"
 #include "kmatrix.h"
 #include "multibot.h"
+#include "multiinterp.h"
 #include "gameseq.h"
 #include "physics.h"
 #include "config.h"
@@ -185,7 +186,6 @@ const char GMNamesShrt[MULTI_GAME_TYPE_COUNT][8]={
 // For rejoin object syncing (used here and all protocols - globally)
 
 int	Network_send_objects = 0;  // Are we in the process of sending objects to a player?
-int	Network_send_object_mode = 0; // What type of objects are we sending, static or dynamic?
 int 	Network_send_objnum = -1;   // What object are we sending next?
 int     Network_rejoined = 0;       // Did WE rejoin this game?
 int     Network_sending_extras=0;
@@ -1633,6 +1633,7 @@ static void multi_do_position(const playernum_t pnum, const ubyte *buf)
 	qpp.rotvel.y = GET_INTEL_INT(&buf[count]);					count += 4;
 	qpp.rotvel.z = GET_INTEL_INT(&buf[count]);					count += 4;
         extract_quaternionpos(obj, &qpp, 0);
+	multi_interp_add(obj, qpp);
 
 	if (obj->movement_type == MT_PHYSICS)
 		set_thrust_from_velocity(obj);
@@ -3325,6 +3326,7 @@ void multi_prep_level(void)
 	Bounty_target = 0;
 
 	multi_consistency_error(1);
+	multi_interp_reset();
 
 	for (i=0;i<MAX_PLAYERS;i++)
 	{
@@ -3743,6 +3745,7 @@ static void multi_do_wall_status (const ubyte *buf)
 	Walls[wallnum].flags=flag;
 	//Assert(state <= 4);
 	Walls[wallnum].state=state;
+	flush_fcd_cache();
 
 	if (Walls[wallnum].type==WALL_OPEN)
 	{
@@ -3873,6 +3876,7 @@ static void multi_do_light (const ubyte *buf)
 			side_array[i].tmap_num2 = GET_INTEL_SHORT(&buf[6 + (2 * i)]);
 		}
 	}
+	flush_fcd_cache();
 }
 
 static void multi_do_flags (const playernum_t pnum, const ubyte *buf)
@@ -31,6 +31,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "vecmat.h"
 #include "object.h"
 #include "multibot.h"
+#include "multiinterp.h"
 #include "game.h"
 #include "multi.h"
 #include "laser.h"
@@ -799,6 +800,7 @@ void multi_do_robot_position(const playernum_t pnum, const ubyte *buf)
 	qpp.rotvel.y = GET_INTEL_INT(&buf[loc]);					loc += 4;
 	qpp.rotvel.z = GET_INTEL_INT(&buf[loc]);					loc += 4;
         extract_quaternionpos(robot, &qpp, 0);
+	multi_interp_add(robot, qpp);
 }
 
 static inline vms_vector calc_gun_point(const vcobjptr_t obj,int gun_num)
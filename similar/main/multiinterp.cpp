@@ -0,0 +1,279 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Smooth drawing of objects moved by other players.
+ *
+ * Only the drawn position, and the segment the object is linked to
+ * while it is drawn, change.  Between frames every object stays
+ * where the last packet and the physics put it, so collisions, firing
+ * and everything sent to other players are unaffected.
+ *
+ */
+
+#include <algorithm>
+#include "multiinterp.h"
+#include "object.h"
+#include "gameseg.h"
+#include "player.h"
+#include "multi.h"
+#include "newdemo.h"
+#include "args.h"
+#include "timer.h"
+#include "vecmat.h"
+#include "console.h"
+#include "compiler-range_for.h"
+#include "highest_valid.h"
+#include "partial_range.h"
+
+namespace {
+
+struct interp_snapshot
+{
+	fix64 time;
+	quaternionpos qpp;
+};
+
+struct interp_buffer
+{
+	object_signature_t signature;
+	//snapshots held, and the slot of the newest
+	unsigned count, newest;
+	array<interp_snapshot, MULTI_INTERP_SNAPSHOTS> snapshots;
+	fix64 interval, jitter, extrapolation, max_extrapolation;
+	//where the object really is while it is drawn elsewhere
+	vms_vector saved_pos;
+	vms_matrix saved_orient;
+	segnum_t saved_segnum;
+	//age 0 is the newest snapshot
+	interp_snapshot &get(const unsigned age)
+	{
+		return snapshots[(newest + MULTI_INTERP_SNAPSHOTS - age) % MULTI_INTERP_SNAPSHOTS];
+	}
+};
+
+}
+
+//a position this far from the last one is a respawn or a teleport, not movement
+const fix interp_max_jump = i2f(80);
+//never guess further ahead than this
+const fix64 interp_max_extrapolation = F1_0/4;
+
+static array<interp_buffer, MAX_OBJECTS> Interp_buffers;
+static array<objnum_t, MAX_OBJECTS> Interp_moved;
+static unsigned Interp_num_moved;
+static multi_interp_stats Interp_stats;
+
+static fix64 interp_delay()
+{
+	return static_cast<fix64>(GameArg.MplUdpInterpDelay) * F1_0 / 1000;
+}
+
+static bool interp_object_wanted(const vcobjptr_t objp, const interp_buffer &b)
+{
+	if (objp->signature != b.signature || (objp->flags & (OF_EXPLODING | OF_SHOULD_BE_DEAD)))
+		return false;
+	if (objp->type == OBJ_PLAYER)
+		return objp->id != Player_num;
+	if (objp->type == OBJ_ROBOT)
+	{
+		//only robots which another player moves
+		const int owner = objp->ctype.ai_info.REMOTE_OWNER;
+		return owner >= 0 && owner != Player_num;
+	}
+	return false;
+}
+
+void multi_interp_add(const vobjptridx_t objp, const quaternionpos &qpp)
+{
+	if (!GameArg.MplUdpInterpDelay)
+		return;
+	auto &b = Interp_buffers[objp];
+	const fix64 now = timer_query();
+	if (b.count && b.signature == objp->signature)
+	{
+		auto &last = b.get(0);
+		const fix64 gap = now - last.time;
+		if (gap > F1_0 || vm_vec_dist_quick(last.qpp.pos, qpp.pos) > interp_max_jump)
+			b.count = 0;
+		else if (!gap)
+		{
+			//several packets handled in one frame; only the latest matters
+			last.qpp = qpp;
+			return;
+		}
+		else if (b.count == 1)
+			b.interval = gap;
+		else
+		{
+			const fix64 deviation = gap - b.interval;
+			b.jitter += ((deviation < 0 ? -deviation : deviation) - b.jitter) / 16;
+			b.interval += deviation / 8;
+		}
+	}
+	else
+		b.count = 0;
+	if (!b.count)
+	{
+		b.signature = objp->signature;
+		b.newest = 0;
+		b.interval = b.jitter = b.extrapolation = b.max_extrapolation = 0;
+	}
+	else
+		b.newest = (b.newest + 1) % MULTI_INTERP_SNAPSHOTS;
+	auto &s = b.snapshots[b.newest];
+	s.time = now;
+	s.qpp = qpp;
+	if (b.count < MULTI_INTERP_SNAPSHOTS)
+		++b.count;
+}
+
+void multi_interp_reset()
+{
+	range_for (auto &b, Interp_buffers)
+		b.count = 0;
+	Interp_num_moved = 0;
+	Interp_stats = {};
+}
+
+static void interp_pose(const interp_snapshot &from, const interp_snapshot &to, const fix64 t, vms_vector &pos, vms_matrix &orient)
+{
+	const fix k = fixdiv(t - from.time, to.time - from.time);
+	const auto &a = from.qpp, &b = to.qpp;
+	vm_vec_scale_add(pos, a.pos, vm_vec_sub(b.pos, a.pos), k);
+	/* q and -q are the same rotation; blend toward whichever is nearer.
+	 * The result need not be of unit length, since
+	 * vms_matrix_from_quaternion normalizes it.
+	 */
+	const int sign = (a.orient.w * b.orient.w + a.orient.x * b.orient.x + a.orient.y * b.orient.y + a.orient.z * b.orient.z) < 0 ? -1 : 1;
+	const auto blend = [k, sign](const short qa, const short qb) -> short {
+		return qa + fixmul(qb * sign - qa, k);
+	};
+	vms_quaternion q;
+	q.w = blend(a.orient.w, b.orient.w);
+	q.x = blend(a.orient.x, b.orient.x);
+	q.y = blend(a.orient.y, b.orient.y);
+	q.z = blend(a.orient.z, b.orient.z);
+	vms_matrix_from_quaternion(&orient, &q);
+}
+
+void multi_interp_begin_render()
+{
+	Interp_num_moved = 0;
+	if (!GameArg.MplUdpInterpDelay || !(Game_mode & GM_MULTI) || Newdemo_state == ND_STATE_PLAYBACK)
+		return;
+	const fix64 now = timer_query();
+	const fix64 delay = interp_delay();
+	//the time which is drawn
+	const fix64 t = now - delay;
+	++Interp_stats.frames;
+	range_for (const auto i, highest_valid(Objects))
+	{
+		auto &b = Interp_buffers[i];
+		if (!b.count)
+			continue;
+		const auto &&objp = vobjptridx(static_cast<objnum_t>(i));
+		if (!interp_object_wanted(objp, b))
+		{
+			b.count = 0;
+			continue;
+		}
+		auto &newest = b.get(0);
+		//updates stopped; leave it to the physics
+		if (newest.time + interp_max_extrapolation < t)
+			continue;
+		vms_vector pos;
+		vms_matrix orient;
+		b.extrapolation = 0;
+		if (newest.time <= t)
+		{
+			b.extrapolation = t - newest.time;
+			pos = vm_vec_scale_add(newest.qpp.pos, newest.qpp.vel, b.extrapolation);
+			vms_matrix_from_quaternion(&orient, &newest.qpp.orient);
+			b.max_extrapolation = std::max(b.max_extrapolation, b.extrapolation);
+			++Interp_stats.extrapolated_frames;
+			Interp_stats.max_extrapolation = std::max(Interp_stats.max_extrapolation, b.extrapolation);
+		}
+		else
+		{
+			unsigned age = 1;
+			for (; age < b.count && b.get(age).time > t; ++age)
+			{
+			}
+			if (age == b.count)
+			{
+				//older than anything held; draw the oldest
+				auto &oldest = b.get(b.count - 1);
+				pos = oldest.qpp.pos;
+				vms_matrix_from_quaternion(&orient, &oldest.qpp.orient);
+			}
+			else
+				interp_pose(b.get(age), b.get(age - 1), t, pos, orient);
+		}
+		/* The mine is drawn segment by segment, so the object must be
+		 * linked to the segment holding the drawn position.  A position
+		 * between two points in the mine can still cut through a
+		 * corner of solid rock; such frames are drawn where the
+		 * physics put the object.
+		 */
+		const auto &&segp = find_point_seg(pos, vsegptridx(objp->segnum));
+		if (segp == segment_none)
+			continue;
+		b.saved_pos = objp->pos;
+		b.saved_orient = objp->orient;
+		b.saved_segnum = objp->segnum;
+		objp->pos = pos;
+		objp->orient = orient;
+		if (segp != b.saved_segnum)
+			obj_relink(objp, segp);
+		Interp_moved[Interp_num_moved++] = objp;
+	}
+	Interp_stats.objects = std::max(Interp_stats.objects, Interp_num_moved);
+}
+
+void multi_interp_end_render()
+{
+	range_for (const auto i, partial_range(Interp_moved, Interp_num_moved))
+	{
+		const auto &&objp = vobjptridx(i);
+		const auto &b = Interp_buffers[i];
+		objp->pos = b.saved_pos;
+		objp->orient = b.saved_orient;
+		if (objp->segnum != b.saved_segnum)
+			obj_relink(objp, vsegptridx(b.saved_segnum));
+	}
+	Interp_num_moved = 0;
+}
+
+bool multi_interp_get_object_stats(const objnum_t objnum, multi_interp_object_stats &stats)
+{
+	if (objnum >= Interp_buffers.size())
+		return false;
+	const auto &b = Interp_buffers[objnum];
+	if (!b.count)
+		return false;
+	stats.snapshots = b.count;
+	stats.interval = b.interval;
+	stats.jitter = b.jitter;
+	stats.extrapolation = b.extrapolation;
+	stats.max_extrapolation = b.max_extrapolation;
+	return true;
+}
+
+multi_interp_stats multi_interp_get_stats()
+{
+	auto r = Interp_stats;
+	range_for (const auto i, highest_valid(Objects))
+	{
+		const auto &b = Interp_buffers[i];
+		if (b.count)
+			r.max_jitter = std::max(r.max_jitter, b.jitter);
+	}
+	Interp_stats = {};
+	return r;
+}
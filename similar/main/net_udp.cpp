@@ -44,6 +44,7 @@
 #include "kmatrix.h"
 #include "newdemo.h"
 #include "multibot.h"
+#include "multiinterp.h"
 #include "wall.h"
 #include "bm.h"
 #include "effects.h"
@@ -58,6 +59,10 @@
 #include "config.h"
 #include "vers_id.h"
 #include "u_mem.h"
+#include "net_udp_pdata.h"
+#include "net_udp_io.h"
+#include "net_udp_snapshot.h"
+#include "net_udp_synth.h"
 
 #include "dxxsconf.h"
 #include "compiler-array.h"
@@ -87,6 +92,7 @@ static void net_udp_flush();
 static void net_udp_update_netgame(void);
 static void net_udp_send_objects(void);
 static void net_udp_send_rejoin_sync(int player_num);
+static void net_udp_send_snapshot_ack(const _sockaddr &addr, fix64 time);
 static void net_udp_do_refuse_stuff (UDP_sequence_packet *their);
 static void net_udp_read_sync_packet(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
 static void net_udp_ping_frame(fix64 time);
@@ -98,12 +104,16 @@ static void net_udp_process_mdata (uint8_t *data, uint_fast32_t data_len, const
 static void net_udp_send_pdata();
 static void net_udp_process_pdata (const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
 static void net_udp_read_pdata_packet(UDP_frame_info *pd);
+static void net_udp_process_pdata_delta(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_pdata_delta_reset(unsigned player_num);
 static void net_udp_timeout_check(fix64 time);
 static int net_udp_get_new_player_num ();
 static void net_udp_noloss_got_ack(const uint8_t *data, uint_fast32_t data_len);
 static void net_udp_noloss_init_mdata_queue(void);
 static void net_udp_noloss_clear_mdata_trace(ubyte player_num);
 static void net_udp_noloss_process_queue(fix64 time);
+static unsigned net_udp_noloss_queue_depth();
+static void net_udp_process_mdata_multi(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
 static void net_udp_send_extras ();
 static void net_udp_broadcast_game_info(ubyte info_upid);
 static void net_udp_process_game_info(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &game_addr, int lite_info);
@@ -111,12 +121,28 @@ static int net_udp_start_game(void);
 
 // Variables
 static int UDP_num_sendto, UDP_len_sendto, UDP_num_recvfrom, UDP_len_recvfrom;
+static int UDP_pdata_num_sendto, UDP_pdata_len_sendto, UDP_pdata_num_recvfrom, UDP_pdata_len_recvfrom;
+// How long the packet being processed waited for us, and whether the network thread already answered it
+static fix64 UDP_packet_wait;
+static bool UDP_packet_answered;
+static bool UDP_io_unavailable;
 static UDP_mdata_info		UDP_MData;
 static UDP_sequence_packet UDP_Seq;
-static unsigned UDP_mdata_queue_highest;
 static array<UDP_mdata_store, UDP_MDATA_STOR_QUEUE_SIZE> UDP_mdata_queue;
+static uint32_t UDP_mdata_queue_head, UDP_mdata_queue_tail;
+static uint8_t UDP_mdata_ack_mask;
+// Packet loss prevention queue counters, reset by udp_traffic_stat
+static struct
+{
+	unsigned added, acked, retired, timed_out, resent, resend_packets, max_depth, depth_samples;
+	uint64_t depth_total;
+} UDP_mdata_stats;
 static array<UDP_mdata_check, MAX_PLAYERS> UDP_mdata_trace;
 static UDP_sequence_packet UDP_sync_player; // For rejoin object syncing
+static snapshot_tx UDP_snapshot_tx; // Level state being sent to UDP_sync_player
+static snapshot_rx UDP_snapshot_rx; // Level state being received from the host
+static fix64 UDP_sync_start_time, UDP_snapshot_applied_time;
+static unsigned UDP_snapshot_builds;
 static array<UDP_netgame_info_lite, UDP_MAX_NETGAMES> Active_udp_games;
 static unsigned num_active_udp_games;
 static int num_active_udp_changed;
@@ -453,7 +479,10 @@ public:
 
 ssize_t dxx_sendto_t::apply(int sockfd, const void *msg, size_t len, int flags, const sockaddr &to, socklen_t tolen)
 {
-	ssize_t rv = sendto(sockfd, reinterpret_cast<const char *>(msg), len, flags, &to, tolen);
+	// Hand the packet to the network thread if it runs; it is sent at the next kick.
+	ssize_t rv = (!flags && net_udp_io_send(sockfd, msg, len, to, tolen))
+		? len
+		: sendto(sockfd, reinterpret_cast<const char *>(msg), len, flags, &to, tolen);
 
 	UDP_num_sendto++;
 	if (rv > 0)
@@ -485,7 +514,31 @@ static void udp_traffic_stat()
 	{
 		last_traf_time = timer_query();
 		con_printf(CON_DEBUG, "P#%u TRAFFIC - OUT: %fKB/s %iPPS IN: %fKB/s %iPPS",Player_num, (float)UDP_len_sendto/1024, UDP_num_sendto, (float)UDP_len_recvfrom/1024, UDP_num_recvfrom);
+		con_printf(CON_DEBUG, "P#%u PDATA - OUT: %fKB/s %iPPS IN: %fKB/s %iPPS",Player_num, (float)UDP_pdata_len_sendto/1024, UDP_pdata_num_sendto, (float)UDP_pdata_len_recvfrom/1024, UDP_pdata_num_recvfrom);
+		if (net_udp_synth_active())
+		{
+			const auto s = net_udp_synth_get_stats();
+			const double ms = std::chrono::duration<double, std::milli>(s.host_time).count();
+			con_printf(CON_NORMAL, "SYNTH - %u/%u playing, host frame avg %.3fms max %.3fms in %u frames, OUT: %.1fKB/s IN: %.1fKB/s, PLP queue %u, SENT pdata %u fire %u mdata %u acks %u resent %u", s.playing, s.clients, s.frames ? ms / s.frames : 0., std::chrono::duration<double, std::milli>(s.host_max).count(), s.frames, (float)UDP_len_sendto/1024, (float)UDP_len_recvfrom/1024, net_udp_noloss_queue_depth(), s.pdata, s.fires, s.mdata, s.acks, s.resent);
+		}
 		UDP_num_sendto = UDP_len_sendto = UDP_num_recvfrom = UDP_len_recvfrom = 0;
+		UDP_pdata_num_sendto = UDP_pdata_len_sendto = UDP_pdata_num_recvfrom = UDP_pdata_len_recvfrom = 0;
+		if (Netgame.PacketLossPrevention && (Game_mode & GM_NETWORK))
+		{
+			auto &q = UDP_mdata_stats;
+			con_printf(CON_DEBUG, "P#%u PLP - QUEUE: %u now, %u avg, %u max ADDED: %u ACKED: %u RETIRED: %u TIMEOUT: %u RESENT: %u in %u packets", Player_num, net_udp_noloss_queue_depth(), q.depth_samples ? static_cast<unsigned>(q.depth_total / q.depth_samples) : 0, q.max_depth, q.added, q.acked, q.retired, q.timed_out, q.resent, q.resend_packets);
+			q = {};
+		}
+		if (net_udp_io_running())
+		{
+			const auto io = net_udp_io_get_stats();
+			con_printf(CON_DEBUG, "P#%u NETIO - IN: %u packets in %u calls, waited avg %ums max %ums, %u queued max, %u overflows OUT: %u packets in %u calls, %u pings answered", Player_num, io.received, io.receive_calls, io.drained ? static_cast<unsigned>(io.total_wait * 1000 / F1_0 / io.drained) : 0, static_cast<unsigned>(io.max_wait * 1000 / F1_0), io.max_queued, io.overflows, io.sent, io.send_calls, io.answered);
+		}
+		if (GameArg.MplUdpInterpDelay)
+		{
+			const auto interp = multi_interp_get_stats();
+			con_printf(CON_DEBUG, "P#%u INTERP - %u objects, %u frames, %u extrapolated, extrapolation max %ums, jitter max %ums", Player_num, interp.objects, interp.frames, interp.extrapolated_frames, static_cast<unsigned>(interp.max_extrapolation * 1000 / F1_0), static_cast<unsigned>(interp.max_jitter * 1000 / F1_0));
+		}
 	}
 }
 
@@ -592,6 +645,8 @@ static int udp_open_socket(RAIIsocket &sock, int port)
 {
 	int bcast = 1;
 
+	// The network thread polls the old set of sockets. It restarts with the next frame.
+	net_udp_io_stop();
 	// close stale socket
 	sock.reset();
 	struct _sockaddr sAddr{};   // my address information
@@ -1340,6 +1395,7 @@ void net_udp_init()
 }
 #endif
 
+	net_udp_io_stop();
 	UDP_Socket[0].reset();
 	UDP_Socket[1].reset();
 
@@ -1347,6 +1403,8 @@ void net_udp_init()
 	UDP_Seq = {};
 	UDP_MData = {};
 	net_udp_noloss_init_mdata_queue();
+	for (unsigned i = 0; i < MAX_PLAYERS; i++)
+		net_udp_pdata_delta_reset(i);
 	UDP_Seq.type = UPID_REQUEST;
 	UDP_Seq.player.callsign = get_local_player().callsign;
 
@@ -1361,6 +1419,8 @@ void net_udp_init()
 
 void net_udp_close()
 {
+	net_udp_synth_stop();
+	net_udp_io_stop();
 	range_for (auto &i, UDP_Socket)
 		i.reset();
 #ifdef _WIN32
@@ -1499,6 +1559,7 @@ void net_udp_disconnect_player(int playernum)
 		VerifyPlayerJoined=-1;
 
 	net_udp_noloss_clear_mdata_trace(playernum);
+	net_udp_pdata_delta_reset(playernum);
 }
 
 void
@@ -1559,6 +1620,7 @@ static net_udp_new_player(UDP_sequence_packet *their)
 #endif
 
 	net_udp_noloss_clear_mdata_trace(pnum);
+	net_udp_pdata_delta_reset(pnum);
 }
 
 static void net_udp_welcome_player(UDP_sequence_packet *their)
@@ -1586,7 +1648,7 @@ static void net_udp_welcome_player(UDP_sequence_packet *their)
 
 	// Joining a running game will need quite a few packets on the mdata-queue, so let players only join if we have enough space.
 	if (Netgame.PacketLossPrevention)
-		if ((UDP_MDATA_STOR_QUEUE_SIZE - UDP_mdata_queue_highest) < UDP_MDATA_STOR_MIN_FREE_2JOIN)
+		if ((UDP_MDATA_STOR_QUEUE_SIZE - net_udp_noloss_queue_depth()) < UDP_MDATA_STOR_MIN_FREE_2JOIN)
 			return;
 
 	if (their->player.connected != Current_level_num)
@@ -1696,6 +1758,7 @@ static void net_udp_welcome_player(UDP_sequence_packet *their)
 		multi_send_score();
 
 		net_udp_noloss_clear_mdata_trace(player_num);
+		net_udp_pdata_delta_reset(player_num);
 	}
 
 	Players[player_num].KillGoalCount=0;
@@ -1708,29 +1771,20 @@ static void net_udp_welcome_player(UDP_sequence_packet *their)
 	Network_send_objects = 1;
 	Network_send_objnum = -1;
 	Netgame.players[player_num].LastPacketTime = timer_query();
+	UDP_sync_start_time = timer_query();
+	UDP_snapshot_builds = 0;
 
 	net_udp_send_objects();
 }
 
-int net_udp_objnum_is_past(objnum_t objnum)
+/*
+ * Whether a change to objnum happened after the joining player's copy of it was taken.
+ * The snapshot takes all objects at once, so this is true of every object from the time it is built, and the caller's
+ * Network_send_objnum = -1 makes it be built again.  objnum is not looked at.
+ */
+int net_udp_objnum_is_past(objnum_t)
 {
-	// determine whether or not a given object number has already been sent
-	// to a re-joining player.
-	
-	int player_num = UDP_sync_player.player.connected;
-	int obj_mode = !((object_owner[objnum] == -1) || (object_owner[objnum] == player_num));
-
-	if (!Network_send_objects)
-		return 0; // We're not sending objects to a new player
-
-	if (obj_mode > Network_send_object_mode)
-		return 0;
-	else if (obj_mode < Network_send_object_mode)
-		return 1;
-	else if (objnum < Network_send_objnum)
-		return 1;
-	else
-		return 0;
+	return Network_send_objects && Network_send_objnum != -1;
 }
 
 #if defined(DXX_BUILD_DESCENT_I)
@@ -1869,6 +1923,89 @@ static int net_udp_create_monitor_vector(void)
 	return(vector);
 }
 
+/*
+ * Serialize everything a player joining the game needs to know about the level: objects, walls, doors and triggers.
+ * The objects the new player will own come first, as in net_udp_apply_snapshot.
+ */
+static void net_udp_build_snapshot(std::vector<uint8_t> &raw, playernum_t player_num, unsigned &obj_count)
+{
+	snapshot_writer w(raw);
+	w.put8(player_num);
+	const auto count_pos = raw.size();
+	w.put16(0);
+	for (int mode = 0; mode < 2; mode++)
+	{
+		range_for (const auto i, highest_valid(Objects))
+		{
+			const auto &&objp = vobjptr(static_cast<objnum_t>(i));
+			if ((objp->type != OBJ_POWERUP) && (objp->type != OBJ_PLAYER) &&
+					(objp->type != OBJ_CNTRLCEN) && (objp->type != OBJ_GHOST) &&
+					(objp->type != OBJ_ROBOT) && (objp->type != OBJ_HOSTAGE)
+#if defined(DXX_BUILD_DESCENT_II)
+					&& !(objp->type == OBJ_WEAPON && get_weapon_id(objp) == PMINE_ID)
+#endif
+					)
+				continue;
+			if (mode == ((object_owner[i] == -1) || (object_owner[i] == player_num)))
+				continue;
+
+			sbyte owner;
+			const auto remote_objnum = objnum_local_to_remote(i, &owner);
+			Assert(owner == object_owner[i]);
+			w.put8(owner);
+			w.put32(remote_objnum);
+			// use object_rw to send objects for now. if object sometime contains some day contains something useful the client should know about, we should use it. but by now it's also easier to use object_rw because then we also do not need fix64 timer values.
+			object_rw obj_rw;
+			multi_object_to_object_rw(objp, &obj_rw);
+			if (words_bigendian)
+				object_rw_swap(&obj_rw, 1);
+			w.put(&obj_rw, sizeof(obj_rw));
+			obj_count++;
+		}
+	}
+	raw[count_pos] = obj_count;
+	raw[count_pos + 1] = obj_count >> 8;
+
+	w.put16(Num_walls);
+	range_for (const auto &wl, partial_range(Walls, Num_walls))
+	{
+		w.put8(wl.type);
+		w.put8(wl.flags);
+		w.put8(wl.state);
+		w.put32(wl.hps);
+#if defined(DXX_BUILD_DESCENT_II)
+		w.put8(wl.cloak_value);
+#endif
+		w.put16(vcsegptr(wl.segnum)->sides[wl.sidenum].tmap_num2);
+	}
+	w.put16(Num_open_doors);
+	range_for (const auto &d, partial_range(ActiveDoors, Num_open_doors))
+	{
+		w.put8(d.n_parts);
+		range_for (const auto i, d.front_wallnum)
+			w.put16(i);
+		range_for (const auto i, d.back_wallnum)
+			w.put16(i);
+		w.put32(d.time);
+	}
+#if defined(DXX_BUILD_DESCENT_II)
+	w.put16(Num_cloaking_walls);
+	range_for (const auto &c, partial_range(CloakingWalls, Num_cloaking_walls))
+	{
+		w.put16(c.front_wallnum);
+		w.put16(c.back_wallnum);
+		range_for (const auto i, c.front_ls)
+			w.put32(i);
+		range_for (const auto i, c.back_ls)
+			w.put32(i);
+		w.put32(c.time);
+	}
+#endif
+	w.put16(Num_triggers);
+	range_for (const auto &t, partial_range(Triggers, Num_triggers))
+		w.put16(t.flags);
+}
+
 static void net_udp_stop_resync(UDP_sequence_packet *their)
 {
 	if (UDP_sync_player.player.protocol.udp.addr == their->player.protocol.udp.addr &&
@@ -1879,133 +2016,83 @@ static void net_udp_stop_resync(UDP_sequence_packet *their)
 		Network_rejoined=0;
 		Player_joining_extras=-1;
 		Network_send_objnum = -1;
+		UDP_snapshot_tx.clear();
 	}
 }
 
 void net_udp_send_objects(void)
 {
-	sbyte owner, player_num = UDP_sync_player.player.connected;
-	static int obj_count = 0;
-	int loc = 0, remote_objnum = 0, obj_count_frame = 0;
-	static fix64 last_send_time = 0;
-	
-	if (last_send_time + (F1_0/50) > timer_query())
-		return;
-	last_send_time = timer_query();
-
-	// Send clear objects array trigger and send player num
+	const playernum_t player_num = UDP_sync_player.player.connected;
+	const auto &addr = UDP_sync_player.player.protocol.udp.addr;
+	const fix64 time = timer_query();
 
 	Assert(Network_send_objects != 0);
-	Assert(player_num >= 0);
 	Assert(player_num < Netgame.max_numplayers);
 
 	if ((Network_status == NETSTAT_ENDLEVEL) || Control_center_destroyed)
 	{
 		// Endlevel started before we finished sending the goods, we'll
 		// have to stop and try again after the level.
-		net_udp_dump_player(UDP_sync_player.player.protocol.udp.addr, DUMP_ENDLEVEL);
+		net_udp_dump_player(addr, DUMP_ENDLEVEL);
 		Network_send_objects = 0; 
+		UDP_snapshot_tx.clear();
 		return;
 	}
 
-	array<uint8_t, UPID_MAX_SIZE> object_buffer;
-	object_buffer = {};
-	object_buffer[0] = UPID_OBJECT_DATA;
-	loc = 5;
-
+	// Build the snapshot, or build it again if something in it changed before the new player got all of it
 	if (Network_send_objnum == -1)
 	{
-		obj_count = 0;
-		Network_send_object_mode = 0;
-		PUT_INTEL_INT(&object_buffer[loc], -1);                       loc += 4;
-		object_buffer[loc] = player_num;                            loc += 1;
-		/* Placeholder for remote_objnum, not used here */          loc += 4;
+		std::vector<uint8_t> raw;
+		unsigned obj_count = 0;
+		net_udp_build_snapshot(raw, player_num, obj_count);
+		if (!UDP_snapshot_tx.start(raw, time))
+		{
+			con_printf(CON_URGENT, "Level state of %u bytes is too big to send", static_cast<unsigned>(raw.size()));
+			net_udp_dump_player(addr, DUMP_ABORTED);
+			Network_send_objects = 0;
+			return;
+		}
+		if (UDP_snapshot_builds++)
+			con_printf(CON_VERBOSE, "P#%u: Level state changed while sending it to pnum %u - starting over", Player_num, player_num);
+		con_printf(CON_VERBOSE, "P#%u: Sending level state to pnum %u: %u objects, %u bytes, %u compressed in %u packets", Player_num, player_num, obj_count, static_cast<unsigned>(raw.size()), static_cast<unsigned>(UDP_snapshot_tx.data.size()), UDP_snapshot_tx.chunks);
 		Network_send_objnum = 0;
-		obj_count_frame = 1;
-	}
-	
-	objnum_t i;
-	for (i = Network_send_objnum; i <= Highest_object_index; i++)
-	{
-		if ((Objects[i].type != OBJ_POWERUP) && (Objects[i].type != OBJ_PLAYER) &&
-				(Objects[i].type != OBJ_CNTRLCEN) && (Objects[i].type != OBJ_GHOST) &&
-				(Objects[i].type != OBJ_ROBOT) && (Objects[i].type != OBJ_HOSTAGE)
-#if defined(DXX_BUILD_DESCENT_II)
-				&& !(Objects[i].type == OBJ_WEAPON && get_weapon_id(Objects[i]) == PMINE_ID)
-#endif
-				)
-			continue;
-		if ((Network_send_object_mode == 0) && ((object_owner[i] != -1) && (object_owner[i] != player_num)))
-			continue;
-		if ((Network_send_object_mode == 1) && ((object_owner[i] == -1) || (object_owner[i] == player_num)))
-			continue;
-
-		if ( loc + sizeof(object_rw) + 9 > UPID_MAX_SIZE-1 )
-			break; // Not enough room for another object
-
-		obj_count_frame++;
-		obj_count++;
-
-		remote_objnum = objnum_local_to_remote(i, &owner);
-		Assert(owner == object_owner[i]);
-
-		PUT_INTEL_INT(&object_buffer[loc], i);                        loc += 4;
-		object_buffer[loc] = owner;                                 loc += 1;
-		PUT_INTEL_INT(&object_buffer[loc], remote_objnum);            loc += 4;
-		// use object_rw to send objects for now. if object sometime contains some day contains something useful the client should know about, we should use it. but by now it's also easier to use object_rw because then we also do not need fix64 timer values.
-		multi_object_to_object_rw(vobjptr(i), (object_rw *)&object_buffer[loc]);
-		if (words_bigendian)
-			object_rw_swap(reinterpret_cast<object_rw *>(&object_buffer[loc]), 1);
-		loc += sizeof(object_rw);
 	}
 
-	if (obj_count_frame) // Send any objects we've buffered
-	{
-		Network_send_objnum = i;
-		PUT_INTEL_INT(&object_buffer[1], obj_count_frame);
-
-		Assert(loc <= UPID_MAX_SIZE);
-
-		dxx_sendto(UDP_sync_player.player.protocol.udp.addr, UDP_Socket[0], &object_buffer[0], loc, 0);
-	}
+	array<uint8_t, 1 + UDP_SNAPSHOT_CHUNK_HEADER + UDP_SNAPSHOT_CHUNK_SIZE> buf;
+	buf[0] = UPID_SNAPSHOT_DATA;
+	while (const auto len = UDP_snapshot_tx.next_chunk(time, &buf[1]))
+		dxx_sendto(addr, UDP_Socket[0], buf.data(), 1 + len, 0);
 
-	if (i > Highest_object_index)
+	if (UDP_snapshot_tx.done())
 	{
-		if (Network_send_object_mode == 0)
-		{
-			Network_send_objnum = 0;
-			Network_send_object_mode = 1; // go to next mode
-		}
-		else 
-		{
-			Assert(Network_send_object_mode == 1); 
-
-			// Send count so other side can make sure he got them all
-			object_buffer[0] = UPID_OBJECT_DATA;
-			PUT_INTEL_INT(&object_buffer[1], 1);
-			PUT_INTEL_INT(&object_buffer[5], -2);
-			object_buffer[9] = player_num;
-			PUT_INTEL_INT(&object_buffer[10], obj_count);
-			dxx_sendto(UDP_sync_player.player.protocol.udp.addr, UDP_Socket[0], &object_buffer[0], 14, 0);
+		con_printf(CON_VERBOSE, "P#%u: pnum %u got the level state %ums after joining: %u packets, %u resent, built %u times", Player_num, player_num, static_cast<unsigned>((time - UDP_sync_start_time) * 1000 / F1_0), UDP_snapshot_tx.packets, UDP_snapshot_tx.resent, UDP_snapshot_builds);
+		UDP_snapshot_tx.clear();
 
-			// Send sync packet which tells the player who he is and to start!
-			net_udp_send_rejoin_sync(player_num);
+		// Send sync packet which tells the player who he is and to start!
+		net_udp_send_rejoin_sync(player_num);
 
-			// Turn off send object mode
-			Network_send_objnum = -1;
-			Network_send_objects = 0;
-			obj_count = 0;
+		// Turn off send object mode
+		Network_send_objnum = -1;
+		Network_send_objects = 0;
 
+		// Doors, walls and triggers went with the snapshot, but may have changed since it was built, so send them again
 #if defined(DXX_BUILD_DESCENT_I)
-			Network_sending_extras=3; // start to send extras
+		Network_sending_extras=3; // start to send extras
 #elif defined(DXX_BUILD_DESCENT_II)
-			Network_sending_extras=9; // start to send extras
+		Network_sending_extras=9; // start to send extras
 #endif
-			VerifyPlayerJoined = Player_joining_extras = player_num;
+		VerifyPlayerJoined = Player_joining_extras = player_num;
+		return;
+	}
 
-			return;
-		} // mode == 1;
-	} // i > Highest_object_index
+	if (UDP_snapshot_tx.last_progress + UDP_TIMEOUT <= time)
+	{
+		con_printf(CON_VERBOSE, "P#%u: pnum %u stopped taking the level state", Player_num, player_num);
+		net_udp_dump_player(addr, DUMP_PKTTIMEOUT);
+		UDP_snapshot_tx.clear();
+		Network_send_objnum = -1;
+		Network_send_objects = 0;
+	}
 }
 
 static int net_udp_verify_objects(int remote, int local)
@@ -2028,94 +2115,176 @@ static int net_udp_verify_objects(int remote, int local)
 	return(1);
 }
 
-static void net_udp_read_object_packet( ubyte *data )
+static bool net_udp_snapshot_door_wall_valid(unsigned wallnum)
 {
-	// Object from another net player we need to sync with
-	sbyte obj_owner;
-	static int mode = 0, object_count = 0, my_pnum = 0;
-	int remote_objnum = 0, nobj = 0, loc = 5;
-	
-	nobj = GET_INTEL_INT(data + 1);
+	return wallnum < Num_walls;
+}
 
-	for (int i = 0; i < nobj; i++)
-	{
-		objnum_t objnum = GET_INTEL_INT(data + loc);                         loc += 4;
-		obj_owner = data[loc];                                      loc += 1;
-		remote_objnum = GET_INTEL_INT(data + loc);                  loc += 4;
+/*
+ * Put the level state from the host into the level.
+ * Objects owned by us or by nobody come first, so we can put them back into their old slots. Other objects get new slots.
+ */
+static bool net_udp_apply_snapshot(const std::vector<uint8_t> &raw)
+{
+	snapshot_reader r(raw.data(), raw.size());
+	const playernum_t my_pnum = r.get8();
+	const unsigned nobj = r.get16();
+	unsigned object_count = 0;
+	bool mine = true;
 
-		if (objnum == object_none) 
+	if (r.failed() || my_pnum >= MAX_PLAYERS)
+		return false;
+
+	// Clear object array
+	init_objects();
+	Network_rejoined = 1;
+	change_playernum_to(my_pnum);
+
+	for (unsigned n = 0; n < nobj; n++)
+	{
+		const sbyte obj_owner = r.get8();
+		const int remote_objnum = static_cast<int32_t>(r.get32());
+		object_rw obj_rw;
+		if (!r.get(&obj_rw, sizeof(obj_rw)))
+			return false;
+		object_count++;
+		objnum_t objnum;
+		if ((obj_owner == my_pnum) || (obj_owner == -1)) 
 		{
-			// Clear object array
-			init_objects();
-			Network_rejoined = 1;
-			my_pnum = obj_owner;
-			change_playernum_to(my_pnum);
-			mode = 1;
-			object_count = 0;
+			if (!mine)
+				Int3(); // SEE ROB
+			if (remote_objnum < 0 || remote_objnum >= MAX_OBJECTS)
+				return false;
+			objnum = remote_objnum;
 		}
-		else if (objnum == object_guidebot_cannot_reach)
+		else
 		{
-			// Special debug checksum marker for entire send
-			if (mode == 1)
+			if (mine)
 			{
 				special_reset_objects();
-				mode = 0;
-			}
-			if (remote_objnum != object_count) {
-				Int3();
-			}
-			if (net_udp_verify_objects(remote_objnum, object_count))
-			{
-				// Failed to sync up 
-				nm_messagebox(NULL, 1, TXT_OK, TXT_NET_SYNC_FAILED);
-				Network_status = NETSTAT_MENU;                          
-				return;
+				mine = false;
 			}
+			objnum = obj_allocate();
 		}
-		else 
+		if (objnum == object_none)
+			continue;
+		auto obj = vobjptridx(objnum);
+		if (obj->segnum != segment_none)
 		{
-			object_count++;
-			if ((obj_owner == my_pnum) || (obj_owner == -1)) 
-			{
-				if (mode != 1)
-					Int3(); // SEE ROB
-				objnum = remote_objnum;
-			}
-			else {
-				if (mode == 1)
-				{
-					special_reset_objects();
-					mode = 0;
-				}
-				objnum = obj_allocate();
-			}
-			if (objnum != object_none) {
-				auto obj = vobjptridx(objnum);
-				if (obj->segnum != segment_none)
-				{
-					obj_unlink(obj);
-					Assert(obj->segnum == segment_none);
-				}
-				Assert(objnum < MAX_OBJECTS);
-				if (words_bigendian)
-					object_rw_swap(reinterpret_cast<object_rw *>(&data[loc]), 1);
-				multi_object_rw_to_object((object_rw *)&data[loc], obj);
-				loc += sizeof(object_rw);
-				auto segnum = obj->segnum;
-				obj->next = obj->prev = object_none;
-				obj->segnum = segment_none;
-				obj->attached_obj = object_none;
-				if (segnum != segment_none)
-					obj_link(obj,segnum);
-				if (obj_owner == my_pnum) 
-					map_objnum_local_to_local(objnum);
-				else if (obj_owner != -1)
-					map_objnum_local_to_remote(objnum, remote_objnum, obj_owner);
-				else
-					object_owner[objnum] = -1;
-			}
-		} // For a standard onbject
-	} // For each object in packet
+			obj_unlink(obj);
+			Assert(obj->segnum == segment_none);
+		}
+		if (words_bigendian)
+			object_rw_swap(&obj_rw, 1);
+		multi_object_rw_to_object(&obj_rw, obj);
+		auto segnum = obj->segnum;
+		obj->next = obj->prev = object_none;
+		obj->segnum = segment_none;
+		obj->attached_obj = object_none;
+		if (segnum != segment_none)
+			obj_link(obj,segnum);
+		if (obj_owner == my_pnum) 
+			map_objnum_local_to_local(objnum);
+		else if (obj_owner != -1)
+			map_objnum_local_to_remote(objnum, remote_objnum, obj_owner);
+		else
+			object_owner[objnum] = -1;
+	}
+	if (mine)
+		special_reset_objects();
+	if (net_udp_verify_objects(nobj, object_count))
+		return false;
+
+	if (r.get16() != Num_walls)
+		return false;
+	range_for (auto &w, partial_range(Walls, Num_walls))
+	{
+		w.type = r.get8();
+		w.flags = r.get8();
+		w.state = r.get8();
+		w.hps = r.get32();
+#if defined(DXX_BUILD_DESCENT_II)
+		w.cloak_value = r.get8();
+#endif
+		vsegptr(w.segnum)->sides[w.sidenum].tmap_num2 = r.get16();
+	}
+
+	const unsigned ndoors = r.get16();
+	if (ndoors > MAX_DOORS)
+		return false;
+	Num_open_doors = ndoors;
+	range_for (auto &d, partial_range(ActiveDoors, ndoors))
+	{
+		d.n_parts = r.get8();
+		range_for (auto &i, d.front_wallnum)
+			i = r.get16();
+		range_for (auto &i, d.back_wallnum)
+			i = r.get16();
+		d.time = r.get32();
+		if (d.n_parts < 1 || d.n_parts > 2)
+			return false;
+		for (int i = 0; i < d.n_parts; i++)
+			if (!net_udp_snapshot_door_wall_valid(d.front_wallnum[i]) || !net_udp_snapshot_door_wall_valid(d.back_wallnum[i]))
+				return false;
+	}
+
+#if defined(DXX_BUILD_DESCENT_II)
+	const unsigned ncloaking = r.get16();
+	if (ncloaking > MAX_CLOAKING_WALLS)
+		return false;
+	Num_cloaking_walls = ncloaking;
+	range_for (auto &c, partial_range(CloakingWalls, ncloaking))
+	{
+		c.front_wallnum = r.get16();
+		c.back_wallnum = r.get16();
+		range_for (auto &i, c.front_ls)
+			i = r.get32();
+		range_for (auto &i, c.back_ls)
+			i = r.get32();
+		c.time = r.get32();
+		if (!net_udp_snapshot_door_wall_valid(c.front_wallnum) || !net_udp_snapshot_door_wall_valid(c.back_wallnum))
+			return false;
+	}
+#endif
+
+	if (r.get16() != Num_triggers)
+		return false;
+	range_for (auto &t, partial_range(Triggers, Num_triggers))
+		t.flags = r.get16();
+	// Distances found through doors which were closed at level load may be wrong now
+	flush_fcd_cache();
+	return r.done();
+}
+
+static void net_udp_send_snapshot_ack(const _sockaddr &addr, fix64 time)
+{
+	array<uint8_t, 1 + UDP_SNAPSHOT_ACK_MAX> buf;
+	buf[0] = UPID_SNAPSHOT_ACK;
+	const auto len = UDP_snapshot_rx.make_ack(time, &buf[1]);
+	dxx_sendto(addr, UDP_Socket[0], buf.data(), 1 + len, 0);
+}
+
+static void net_udp_read_snapshot_packet(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	const fix64 time = timer_query();
+	if (!UDP_snapshot_rx.add(data, data_len))
+	{
+		if (UDP_snapshot_rx.want_ack(time))
+			net_udp_send_snapshot_ack(sender_addr, time);
+		return;
+	}
+	// Let the host know at once, so it can go on
+	net_udp_send_snapshot_ack(sender_addr, time);
+	std::vector<uint8_t> raw;
+	if (!UDP_snapshot_rx.decompress(raw) || !net_udp_apply_snapshot(raw))
+	{
+		// Failed to sync up 
+		nm_messagebox(NULL, 1, TXT_OK, TXT_NET_SYNC_FAILED);
+		Network_status = NETSTAT_MENU;                          
+		return;
+	}
+	UDP_snapshot_applied_time = time;
+	con_printf(CON_VERBOSE, "P#%u: Got level state of %u bytes, %u compressed in %u packets", Player_num, static_cast<unsigned>(raw.size()), static_cast<unsigned>(UDP_snapshot_rx.data.size()), UDP_snapshot_rx.chunks);
 }
 
 void net_udp_send_rejoin_sync(int player_num)
@@ -2559,6 +2728,7 @@ static uint_fast32_t net_udp_prepare_heavy_game_info(const _sockaddr *addr, ubyt
 		PUT_INTEL_SHORT(buf + len, Netgame.PacketsPerSec);				len += 2;
 		buf[len] = Netgame.PacketLossPrevention;					len++;
 		buf[len] = Netgame.NoFriendlyFire;						len++;
+		buf[len] = Netgame.PdataDelta;							len++;
 		copy_from_ntstring(buf, len, Netgame.game_name);
 		copy_from_ntstring(buf, len, Netgame.mission_title);
 		copy_from_ntstring(buf, len, Netgame.mission_name);
@@ -2790,6 +2960,7 @@ static void net_udp_process_game_info(const uint8_t *data, uint_fast32_t, const
 		Netgame.PacketsPerSec = GET_INTEL_SHORT(&(data[len]));				len += 2;
 		Netgame.PacketLossPrevention = data[len];					len++;
 		Netgame.NoFriendlyFire = data[len];						len++;
+		Netgame.PdataDelta = data[len];							len++;
 		copy_to_ntstring(data, len, Netgame.game_name);
 		copy_to_ntstring(data, len, Netgame.mission_title);
 		copy_to_ntstring(data, len, Netgame.mission_name);
@@ -2943,10 +3114,15 @@ static void net_udp_process_packet(ubyte *data, const _sockaddr &sender_addr, in
 				break;
 			net_udp_read_sync_packet(data, length, sender_addr);
 			break;
-		case UPID_OBJECT_DATA:
-			if (multi_i_am_master() || length > UPID_MAX_SIZE || Network_status != NETSTAT_WAITING)
+		case UPID_SNAPSHOT_DATA:
+			if (multi_i_am_master() || length > UPID_MAX_SIZE || Network_status != NETSTAT_WAITING || Netgame.players[0].protocol.udp.addr != sender_addr)
 				break;
-			net_udp_read_object_packet(data);
+			net_udp_read_snapshot_packet(data + 1, length - 1, sender_addr);
+			break;
+		case UPID_SNAPSHOT_ACK:
+			if (!multi_i_am_master() || !Network_send_objects || length > 1 + UDP_SNAPSHOT_ACK_MAX || UDP_sync_player.player.protocol.udp.addr != sender_addr)
+				break;
+			UDP_snapshot_tx.ack(data + 1, length - 1, timer_query());
 			break;
 		case UPID_PING:
 			if (multi_i_am_master() || length != UPID_PING_SIZE)
@@ -2969,12 +3145,18 @@ static void net_udp_process_packet(ubyte *data, const _sockaddr &sender_addr, in
 		case UPID_PDATA:
 			net_udp_process_pdata( data, length, sender_addr );
 			break;
+		case UPID_PDATA_DELTA:
+			net_udp_process_pdata_delta( data, length, sender_addr );
+			break;
 		case UPID_MDATA_PNORM:
 			net_udp_process_mdata( data, length, sender_addr, 0 );
 			break;
 		case UPID_MDATA_PNEEDACK:
 			net_udp_process_mdata( data, length, sender_addr, 1 );
 			break;
+		case UPID_MDATA_PNEEDACK_MULTI:
+			net_udp_process_mdata_multi( data, length, sender_addr );
+			break;
 		case UPID_MDATA_ACK:
 			net_udp_noloss_got_ack(data, length);
 			break;
@@ -3078,6 +3260,10 @@ static int net_udp_sync_poll( newmenu *,const d_event &event, const unused_newme
 		return 0;
 	net_udp_listen();
 
+	// Acknowledge level state packets which were not acknowledged right away
+	if (UDP_snapshot_rx.want_ack(timer_query()))
+		net_udp_send_snapshot_ack(Netgame.players[0].protocol.udp.addr, timer_query());
+
 	// Leave if Host disconnects
 	if (Netgame.players[0].connected == CONNECT_DISCONNECTED)
 		rval = -2;
@@ -3085,7 +3271,7 @@ static int net_udp_sync_poll( newmenu *,const d_event &event, const unused_newme
 	if (Network_status != NETSTAT_WAITING)	// Status changed to playing, exit the menu
 		rval = -2;
 
-	if (Network_status != NETSTAT_MENU && !Network_rejoined && (timer_query() > t1+F1_0*2))
+	if (Network_status != NETSTAT_MENU && !Network_rejoined && !UDP_snapshot_rx.active && (timer_query() > t1+F1_0*2))
 	{
 		// Poll time expired, re-send request
 		
@@ -3246,6 +3432,7 @@ const unsigned reactor_invul_time_scale = 5 * reactor_invul_time_mini_scale;
 	DXX_##VERB##_TEXT("Network Options", network_label)	               \
 	DXX_##VERB##_TEXT("Packets per second (" DXX_STRINGIZE_PPS(MIN_PPS) " - " DXX_STRINGIZE_PPS(MAX_PPS) ")", opt_label_pps)	\
 	DXX_##VERB##_INPUT(packstring, opt_packets)	\
+	DXX_##VERB##_CHECK("Compact position packets", opt_pdata_delta, Netgame.PdataDelta)	\
 	DXX_##VERB##_TEXT("Network port", opt_label_port)	\
 	DXX_##VERB##_INPUT(portstring, opt_port)	\
 	DXX_UDP_MENU_TRACKER_OPTION(VERB)
@@ -3788,6 +3975,7 @@ int net_udp_setup_game()
 	Netgame.AllowedItems = NETFLAG_DOPOWERUP;
 	Netgame.PacketLossPrevention = 1;
 	Netgame.NoFriendlyFire = 0;
+	Netgame.PdataDelta = 1;
 
 #ifdef USE_TRACKER
 	Netgame.Tracker = 1;
@@ -4351,6 +4539,8 @@ static int net_udp_wait_for_sync(void)
 		nm_item_text(text),
 		nm_item_text(TXT_NET_LEAVE),
 	}};
+	UDP_snapshot_rx.clear();
+	const fix64 start_time = timer_query();
 	auto i = net_udp_send_request();
 
 	if (i >= MAX_PLAYERS)
@@ -4364,6 +4554,10 @@ static int net_udp_wait_for_sync(void)
 		choice=newmenu_do( NULL, TXT_WAIT, m, net_udp_sync_poll, unused_newmenu_userdata );
 	}
 
+	if (Network_status == NETSTAT_PLAYING && Network_rejoined)
+		con_printf(CON_VERBOSE, "P#%u: Joined game in progress after %ums, level state took %ums", Player_num, static_cast<unsigned>((timer_query() - start_time) * 1000 / F1_0), static_cast<unsigned>((UDP_snapshot_applied_time - start_time) * 1000 / F1_0));
+	UDP_snapshot_rx.clear();
+
 	if (Network_status != NETSTAT_PLAYING)
 	{
 		UDP_sequence_packet me{};
@@ -4450,6 +4644,8 @@ net_udp_level_sync(void)
 
 	UDP_MData = {};
 	net_udp_noloss_init_mdata_queue();
+	for (unsigned i = 0; i < MAX_PLAYERS; i++)
+		net_udp_pdata_delta_reset(i);
 
 	net_udp_flush(); // Flush any old packets
 
@@ -4590,6 +4786,7 @@ void net_udp_flush()
 	ubyte packet[UPID_MAX_SIZE];
 	struct _sockaddr sender_addr; 
 
+	net_udp_io_discard();
 	if (UDP_Socket[0])
 		while (udp_receive_packet(UDP_Socket[0], packet, UPID_MAX_SIZE, &sender_addr) > 0);
 
@@ -4600,9 +4797,32 @@ void net_udp_flush()
 void net_udp_listen()
 {
 	int size;
-	ubyte packet[UPID_MAX_SIZE];
+	ubyte packet[UPID_MAX_SIZE + 1];
 	struct _sockaddr sender_addr;
 
+	if (net_udp_io_running())
+	{
+		// Copy each packet out before processing it, since handlers may listen again.
+		fix64 wait;
+		while (const auto p = net_udp_io_peek(wait))
+		{
+			size = p->size;
+			sender_addr = p->addr;
+			UDP_packet_answered = p->answered;
+			memcpy(packet, p->data.data(), size + 1);
+			net_udp_io_pop();
+			UDP_num_recvfrom++;
+			UDP_len_recvfrom += size;
+			UDP_packet_wait = wait;
+			net_udp_process_packet( packet, sender_addr, size );
+		}
+		UDP_packet_wait = 0;
+		UDP_packet_answered = false;
+		// Send the replies
+		net_udp_io_kick();
+		return;
+	}
+
 	if (UDP_Socket[0])
 	{
 		size = udp_receive_packet(UDP_Socket[0], packet, UPID_MAX_SIZE, &sender_addr );
@@ -4689,6 +4909,28 @@ void net_udp_do_frame(int force, int listen)
 
 	const fix64 time = timer_update();
 
+	// The synthetic clients' own work is not part of the host's frame time
+	net_udp_synth_frame(time, UDP_MyPort);
+	const bool synth = net_udp_synth_active();
+	const auto frame_start = synth ? perf_clock::now() : perf_clock::time_point();
+
+	if (!GameArg.MplUdpNoThread && !UDP_io_unavailable)
+	{
+		if (!net_udp_io_running())
+		{
+			array<udp_io_socket_t, 2 + require_tracker_socket> sockets;
+			unsigned count = 0;
+			range_for (auto &i, UDP_Socket)
+				if (i)
+					sockets[count++] = i;
+			UDP_io_unavailable = !net_udp_io_start(sockets.data(), count);
+		}
+		if (multi_i_am_master())
+			net_udp_io_clear_ping_reply();
+		else
+			net_udp_io_set_ping_reply(Netgame.players[0].protocol.udp.addr, Player_num);
+	}
+
 	if (WaitForRefuseAnswer && time>(RefuseTimeLimit+(F1_0*12)))
 		WaitForRefuseAnswer=0;
 
@@ -4779,11 +5021,67 @@ void net_udp_do_frame(int force, int listen)
 			net_udp_send_extras();
 	}
 
+	// Send everything this frame produced in one batch
+	net_udp_io_kick();
+	if (synth)
+		net_udp_synth_host_frame(perf_clock::now() - frame_start);
 	udp_traffic_stat();
 }
 
 /* CODE FOR PACKET LOSS PREVENTION - START */
 /* This code tries to make sure that packets with opcode UPID_MDATA_PNEEDACK aren't lost and sent and received in order. */
+/*
+ * The stored packets form a sliding window in UDP_mdata_queue.  Positions count up from UDP_mdata_queue_head (the oldest packet) to UDP_mdata_queue_tail (the next free slot), and wrap around the queue.
+ * Each player's pkt_nums are handed out in order, so a pkt_num also indexes UDP_mdata_trace, which lets us find the packet an ACK refers to without searching.
+ */
+static_assert(!(UDP_MDATA_STOR_QUEUE_SIZE & (UDP_MDATA_STOR_QUEUE_SIZE - 1)), "UDP_MDATA_STOR_QUEUE_SIZE must be a power of 2");
+static_assert(MAX_PLAYERS <= 8, "UDP_mdata_store::pending_ack has too few bits");
+
+static unsigned net_udp_noloss_queue_depth()
+{
+	return UDP_mdata_queue_tail - UDP_mdata_queue_head;
+}
+
+static UDP_mdata_store &net_udp_noloss_queue_at(uint32_t pos)
+{
+	return UDP_mdata_queue[pos & (UDP_MDATA_STOR_QUEUE_SIZE - 1)];
+}
+
+/* Players who can still ACK our packets: connected and playing, and as a Client only the Host */
+static uint8_t net_udp_noloss_ack_mask()
+{
+	uint8_t mask = 0;
+	for (unsigned plc = 0; plc < MAX_PLAYERS; plc++)
+		if (Players[plc].connected == CONNECT_PLAYING && plc != Player_num && (multi_i_am_master() || plc == 0))
+			mask |= 1 << plc;
+	return mask;
+}
+
+/* We failed to get an important packet through. As Host, kick everyone who did not ACK it. As Client, leave. */
+static void net_udp_noloss_give_up(uint8_t missing)
+{
+	if (multi_i_am_master())
+	{
+		for ( int plc=1; plc<N_players; plc++ )
+			if (missing & (1 << plc))
+				net_udp_dump_player(Netgame.players[plc].protocol.udp.addr, DUMP_PKTTIMEOUT);
+	}
+	else
+	{
+		Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
+		if (Network_status==NETSTAT_PLAYING)
+			multi_leave_game();
+		if (Game_wind)
+			window_set_visible(Game_wind, 0);
+		nm_messagebox(NULL, 1, TXT_OK, "You left the game. You failed\nsending important packets.\nSorry.");
+		if (Game_wind)
+			window_set_visible(Game_wind, 1);
+		multi_quit_game = 1;
+		game_leave_menus();
+		multi_reset_stuff();
+	}
+}
+
 /*
  * Adds a packet to our queue. Should be called when an IMPORTANT mdata packet is created.
  * player_ack is an array which should contain 0 for each player that needs to send an ACK signal.
@@ -4796,54 +5094,46 @@ static void net_udp_noloss_add_queue_pkt(fix64 time, const ubyte *data, ushort d
 	if (!Netgame.PacketLossPrevention)
 		return;
 
-	if (UDP_mdata_queue_highest == UDP_MDATA_STOR_QUEUE_SIZE) // The list is full. That should not happen. But if it does, we must do something.
+	if (net_udp_noloss_queue_depth() == UDP_MDATA_STOR_QUEUE_SIZE) // The list is full. That should not happen. But if it does, we must do something.
 	{
 		con_printf(CON_VERBOSE, "P#%u: MData store list is full!", Player_num);
-		if (multi_i_am_master()) // I am host. I will kick everyone who did not ACK the first packet and then remove it.
-		{
-			for ( int i=1; i<N_players; i++ )
-				if (UDP_mdata_queue[0].player_ack[i] == 0)
-					net_udp_dump_player(Netgame.players[i].protocol.udp.addr, DUMP_PKTTIMEOUT);
-			std::move(std::next(UDP_mdata_queue.begin()), UDP_mdata_queue.end(), UDP_mdata_queue.begin());
-			UDP_mdata_queue[UDP_MDATA_STOR_QUEUE_SIZE - 1] = {};
-			UDP_mdata_queue_highest--;
-		}
-		else // I am just a client. I gotta go.
-		{
-			Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
-			if (Network_status==NETSTAT_PLAYING)
-				multi_leave_game();
-			if (Game_wind)
-				window_set_visible(Game_wind, 0);
-			nm_messagebox(NULL, 1, TXT_OK, "You left the game. You failed\nsending important packets.\nSorry.");
-			if (Game_wind)
-				window_set_visible(Game_wind, 1);
-			multi_quit_game = 1;
-			game_leave_menus();
-			multi_reset_stuff();
-		}
-		Assert(UDP_mdata_queue_highest == (UDP_MDATA_STOR_QUEUE_SIZE - 1));
+		// Drop the oldest packet. Whoever did not ACK it is kicked, or if I am just a client, I gotta go.
+		const uint8_t missing = net_udp_noloss_queue_at(UDP_mdata_queue_head).pending_ack;
+		UDP_mdata_queue_head++;
+		UDP_mdata_stats.timed_out++;
+		net_udp_noloss_give_up(missing);
 	}
 
 	con_printf(CON_VERBOSE, "P#%u: Adding MData pkt_num [%i,%i,%i,%i,%i,%i,%i,%i], type %i from P#%i to MData store list", Player_num, UDP_mdata_trace[0].pkt_num_tosend,UDP_mdata_trace[1].pkt_num_tosend,UDP_mdata_trace[2].pkt_num_tosend,UDP_mdata_trace[3].pkt_num_tosend,UDP_mdata_trace[4].pkt_num_tosend,UDP_mdata_trace[5].pkt_num_tosend,UDP_mdata_trace[6].pkt_num_tosend,UDP_mdata_trace[7].pkt_num_tosend, data[0], pnum);
-	UDP_mdata_queue[UDP_mdata_queue_highest].used = 1;
-	UDP_mdata_queue[UDP_mdata_queue_highest].pkt_initial_timestamp = time;
+	const uint32_t pos = UDP_mdata_queue_tail++;
+	auto &pkt = net_udp_noloss_queue_at(pos);
+	const uint8_t ack_mask = net_udp_noloss_ack_mask();
+	pkt.pkt_initial_timestamp = time;
+	pkt.pending_ack = 0;
 	for (int i = 0; i < MAX_PLAYERS; i++)
 	{
 		if (i == Player_num || player_ack[i] || Players[i].connected == CONNECT_DISCONNECTED) // if player me, is not playing or does not require an ACK, do not add timestamp or increment pkt_num
 			continue;
 		
-		UDP_mdata_queue[UDP_mdata_queue_highest].pkt_timestamp[i] = time;
-		UDP_mdata_queue[UDP_mdata_queue_highest].pkt_num[i] = UDP_mdata_trace[i].pkt_num_tosend;
-		UDP_mdata_trace[i].pkt_num_tosend++;
-		if (UDP_mdata_trace[i].pkt_num_tosend > UDP_MDATA_PKT_NUM_MAX)
-			UDP_mdata_trace[i].pkt_num_tosend = UDP_MDATA_PKT_NUM_MIN;
-	}
-	UDP_mdata_queue[UDP_mdata_queue_highest].Player_num = pnum;
-	memcpy( &UDP_mdata_queue[UDP_mdata_queue_highest].player_ack, player_ack, sizeof(ubyte)*MAX_PLAYERS); 
-	memcpy( &UDP_mdata_queue[UDP_mdata_queue_highest].data, data, sizeof(char)*data_size );
-	UDP_mdata_queue[UDP_mdata_queue_highest].data_size = data_size;
-	UDP_mdata_queue_highest++;
+		auto &trace = UDP_mdata_trace[i];
+		if (ack_mask & (1 << i))
+			pkt.pending_ack |= 1 << i;
+		pkt.pkt_timestamp[i] = time;
+		pkt.pkt_num[i] = trace.pkt_num_tosend;
+		trace.queue_pos[trace.pkt_num_tosend & (UDP_MDATA_STOR_QUEUE_SIZE - 1)] = pos;
+		if (!trace.next_resend || trace.next_resend > time + (F1_0/4))
+			trace.next_resend = time + (F1_0/4);
+		trace.pkt_num_tosend++;
+		if (trace.pkt_num_tosend > UDP_MDATA_PKT_NUM_MAX)
+			trace.pkt_num_tosend = UDP_MDATA_PKT_NUM_MIN;
+	}
+	pkt.Player_num = pnum;
+	memcpy( &pkt.data, data, sizeof(char)*data_size );
+	pkt.data_size = data_size;
+	UDP_mdata_stats.added++;
+	const auto depth = net_udp_noloss_queue_depth();
+	if (UDP_mdata_stats.max_depth < depth)
+		UDP_mdata_stats.max_depth = depth;
 }
 
 /*
@@ -4874,14 +5164,11 @@ static int net_udp_noloss_validate_mdata(uint32_t pkt_num, ubyte sender_pnum, co
         // Make sure this is the packet we are expecting!
         if (UDP_mdata_trace[sender_pnum].pkt_num_torecv != pkt_num)
         {
-                range_for (auto &i, partial_range(UDP_mdata_trace[sender_pnum].pkt_num, (uint32_t)UDP_MDATA_STOR_QUEUE_SIZE))
+                if (UDP_mdata_trace[sender_pnum].pkt_num[pkt_num & (UDP_MDATA_STOR_QUEUE_SIZE - 1)] == pkt_num) // We got this packet already - need to REsend ACK
                 {
-                        if (pkt_num == i) // We got this packet already - need to REsend ACK
-                        {
-                                con_printf(CON_VERBOSE, "P#%u: Resending MData ACK for pkt %i we already got by pnum %i",Player_num, pkt_num, sender_pnum);
-                                dxx_sendto(sender_addr, UDP_Socket[0], buf, len, 0);
-                                return 0;
-                        }
+                        con_printf(CON_VERBOSE, "P#%u: Resending MData ACK for pkt %i we already got by pnum %i",Player_num, pkt_num, sender_pnum);
+                        dxx_sendto(sender_addr, UDP_Socket[0], buf, len, 0);
+                        return 0;
                 }
                 con_printf(CON_VERBOSE, "P#%u: Rejecting MData pkt %i - expected %i by pnum %i",Player_num, pkt_num, UDP_mdata_trace[sender_pnum].pkt_num_torecv, sender_pnum);
                 return 0; // Not the right packet and we haven't gotten it, yet either. So bail out and wait for the right one.
@@ -4890,10 +5177,7 @@ static int net_udp_noloss_validate_mdata(uint32_t pkt_num, ubyte sender_pnum, co
 	con_printf(CON_VERBOSE, "P#%u: Sending MData ACK for pkt %i by pnum %i",Player_num, pkt_num, sender_pnum);
 	dxx_sendto(sender_addr, UDP_Socket[0], buf, len, 0);
 
-	UDP_mdata_trace[sender_pnum].cur_slot++;
-	if (UDP_mdata_trace[sender_pnum].cur_slot >= UDP_MDATA_STOR_QUEUE_SIZE)
-		UDP_mdata_trace[sender_pnum].cur_slot = 0;
-	UDP_mdata_trace[sender_pnum].pkt_num[UDP_mdata_trace[sender_pnum].cur_slot] = pkt_num;
+	UDP_mdata_trace[sender_pnum].pkt_num[pkt_num & (UDP_MDATA_STOR_QUEUE_SIZE - 1)] = pkt_num;
 	UDP_mdata_trace[sender_pnum].pkt_num_torecv++;
 	if (UDP_mdata_trace[sender_pnum].pkt_num_torecv > UDP_MDATA_PKT_NUM_MAX)
 		UDP_mdata_trace[sender_pnum].pkt_num_torecv = UDP_MDATA_PKT_NUM_MIN;
@@ -4915,21 +5199,26 @@ void net_udp_noloss_got_ack(const uint8_t *data, uint_fast32_t data_len)
 	dest_pnum = data[len];												len++;
 	pkt_num = GET_INTEL_INT(&data[len]);										len += 4;
 
-	for (int i = 0; i < UDP_mdata_queue_highest; i++)
-	{
-		if ((pkt_num == UDP_mdata_queue[i].pkt_num[sender_pnum]) && (dest_pnum == UDP_mdata_queue[i].Player_num))
-		{
-			con_printf(CON_VERBOSE, "P#%u: Got MData ACK for pkt_num %i from pnum %i for pnum %i",Player_num, pkt_num, sender_pnum, dest_pnum);
-			UDP_mdata_queue[i].player_ack[sender_pnum] = 1;
-			break;
-		}
-	}
+	if (sender_pnum >= MAX_PLAYERS)
+		return;
+
+	// The packet may have been removed from the queue since, and its slot reused
+	const uint32_t pos = UDP_mdata_trace[sender_pnum].queue_pos[pkt_num & (UDP_MDATA_STOR_QUEUE_SIZE - 1)];
+	if (pos - UDP_mdata_queue_head >= net_udp_noloss_queue_depth())
+		return;
+	auto &pkt = net_udp_noloss_queue_at(pos);
+	if (!(pkt.pending_ack & (1 << sender_pnum)) || pkt.pkt_num[sender_pnum] != pkt_num || pkt.Player_num != dest_pnum)
+		return;
+	con_printf(CON_VERBOSE, "P#%u: Got MData ACK for pkt_num %i from pnum %i for pnum %i",Player_num, pkt_num, sender_pnum, dest_pnum);
+	pkt.pending_ack &= ~(1 << sender_pnum);
+	UDP_mdata_stats.acked++;
 }
 
 /* Init/Free the queue. Call at start and end of a game or level. */
 void net_udp_noloss_init_mdata_queue(void)
 {
-	UDP_mdata_queue_highest=0;
+	UDP_mdata_queue_head = UDP_mdata_queue_tail = 0;
+	UDP_mdata_ack_mask = 0;
 	con_printf(CON_VERBOSE, "P#%u: Clearing MData store/trace list",Player_num);
 	UDP_mdata_queue = {};
 	for (int i = 0; i < MAX_PLAYERS; i++)
@@ -4941,107 +5230,142 @@ void net_udp_noloss_clear_mdata_trace(ubyte player_num)
 {
 	con_printf(CON_VERBOSE, "P#%u: Clearing trace list for %i",Player_num, player_num);
 	UDP_mdata_trace[player_num].pkt_num = {};
-	UDP_mdata_trace[player_num].cur_slot = 0;
+	UDP_mdata_trace[player_num].next_resend = 0;
 	UDP_mdata_trace[player_num].pkt_num_torecv = UDP_MDATA_PKT_NUM_MIN;
 	UDP_mdata_trace[player_num].pkt_num_tosend = UDP_MDATA_PKT_NUM_MIN;
 }
 
+/*
+ * Resend all packets to plc which waited too long for an ACK, in one datagram.
+ * A player only takes packets in order, so start with the oldest and stop when the datagram is full. The rest goes out with the next frame.
+ */
+static void net_udp_noloss_resend(unsigned plc, fix64 time)
+{
+	const uint8_t bit = 1 << plc;
+	array<uint8_t, UPID_MAX_SIZE> buf;
+	const UDP_mdata_store *first = nullptr;
+	unsigned count = 0, len = 2;
+	bool full = false;
+	fix64 next_resend = 0;
+
+	for (uint32_t pos = UDP_mdata_queue_head; pos != UDP_mdata_queue_tail; pos++)
+	{
+		auto &pkt = net_udp_noloss_queue_at(pos);
+		if (!(pkt.pending_ack & bit))
+			continue;
+		if (!full && pkt.pkt_timestamp[plc] + (F1_0/4) <= time)
+		{
+			if (len + 7 + pkt.data_size > buf.size() || count == UINT8_MAX)
+				full = true;
+			else
+			{
+				con_printf(CON_VERBOSE, "P#%u: Resending pkt_num %i from pnum %i to pnum %i",Player_num, pkt.pkt_num[plc], pkt.Player_num, plc);
+				pkt.pkt_timestamp[plc] = time;
+				if (!count)
+					first = &pkt;
+				buf[len] = pkt.Player_num;										len++;
+				PUT_INTEL_INT(&buf[len], pkt.pkt_num[plc]);								len += 4;
+				PUT_INTEL_SHORT(&buf[len], pkt.data_size);								len += 2;
+				memcpy(&buf[len], pkt.data.data(), sizeof(char)*pkt.data_size);				len += pkt.data_size;
+				count++;
+			}
+		}
+		if (!next_resend || next_resend > pkt.pkt_timestamp[plc] + (F1_0/4))
+			next_resend = pkt.pkt_timestamp[plc] + (F1_0/4);
+	}
+	UDP_mdata_trace[plc].next_resend = next_resend;
+
+	if (!count)
+		return;
+	if (count == 1)
+	{
+		// Send a single packet as it was sent the first time
+		len = 0;
+		buf[len] = UPID_MDATA_PNEEDACK;											len++;
+		buf[len] = first->Player_num;										len++;
+		PUT_INTEL_INT(&buf[len], first->pkt_num[plc]);							len += 4;
+		memcpy(&buf[len], first->data.data(), sizeof(char)*first->data_size);		len += first->data_size;
+	}
+	else
+	{
+		buf[0] = UPID_MDATA_PNEEDACK_MULTI;
+		buf[1] = count;
+	}
+	dxx_sendto(Netgame.players[plc].protocol.udp.addr, UDP_Socket[0], buf.data(), len, 0);
+	UDP_mdata_stats.resent += count;
+	UDP_mdata_stats.resend_packets++;
+}
+
 /*
  * The main queue-process function.
  * Check if we can remove a packet from queue, and check if there are packets in queue which we need to re-send
  */
 void net_udp_noloss_process_queue(fix64 time)
 {
-	int total_len = 0;
-
 	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
 		return;
 
 	if (!Netgame.PacketLossPrevention)
 		return;
 
-	for (int queuec = 0; queuec < UDP_mdata_queue_highest; queuec++)
-	{
-		int needack = 0;
-
-		// This might happen if we get out ACK's in the wrong order. So ignore that packet for now. It'll resolve itself.
-		if (!UDP_mdata_queue[queuec].used)
-			continue;
+	// If a player is not playing anymore, he will not ACK anything. Also make sure Clients do not send to anyone else than Host
+	const uint8_t ack_mask = net_udp_noloss_ack_mask();
+	if (UDP_mdata_ack_mask & ~ack_mask)
+		for (uint32_t pos = UDP_mdata_queue_head; pos != UDP_mdata_queue_tail; pos++)
+			net_udp_noloss_queue_at(pos).pending_ack &= ack_mask;
+	UDP_mdata_ack_mask = ack_mask;
 
-		// Check if at least one connected player has not ACK'd the packet
-		for (int plc = 0; plc < MAX_PLAYERS; plc++)
+	// Remove packets from the top of the list which were ACK'd by everyone or timed out. Packets are added in order, so the oldest times out first.
+	while (UDP_mdata_queue_head != UDP_mdata_queue_tail)
+	{
+		auto &pkt = net_udp_noloss_queue_at(UDP_mdata_queue_head);
+		const uint8_t missing = pkt.pending_ack;
+		if (missing && pkt.pkt_initial_timestamp + UDP_TIMEOUT > time)
+			break;
+		con_printf(CON_VERBOSE, "P#%u: Removing stored pkt_num [%i,%i,%i,%i,%i,%i,%i,%i] - missing ACKs: %#x",Player_num, pkt.pkt_num[0],pkt.pkt_num[1],pkt.pkt_num[2],pkt.pkt_num[3],pkt.pkt_num[4],pkt.pkt_num[5],pkt.pkt_num[6],pkt.pkt_num[7], missing);
+		UDP_mdata_queue_head++;
+		UDP_mdata_stats.retired++;
+		if (missing) // packet timed out but still not all have ack'd.
 		{
-			// If player is not playing anymore, we can remove him from list. Also remove *me* (even if that should have been done already). Also make sure Clients do not send to anyone else than Host
-			if ((Players[plc].connected != CONNECT_PLAYING || plc == Player_num) || (!multi_i_am_master() && plc > 0))
-				UDP_mdata_queue[queuec].player_ack[plc] = 1;
-
-			if (!UDP_mdata_queue[queuec].player_ack[plc])
-			{
-				// Resend if enough time has passed.
-				if (UDP_mdata_queue[queuec].pkt_timestamp[plc] + (F1_0/4) <= time)
-				{
-					ubyte buf[sizeof(UDP_mdata_info)];
-					int len = 0;
-					
-					con_printf(CON_VERBOSE, "P#%u: Resending pkt_num %i from pnum %i to pnum %i",Player_num, UDP_mdata_queue[queuec].pkt_num[plc], UDP_mdata_queue[queuec].Player_num, plc);
-					
-					UDP_mdata_queue[queuec].pkt_timestamp[plc] = time;
-					memset(&buf, 0, sizeof(UDP_mdata_info));
-					
-					// Prepare the packet and send it
-					buf[len] = UPID_MDATA_PNEEDACK;													len++;
-					buf[len] = UDP_mdata_queue[queuec].Player_num;								len++;
-					PUT_INTEL_INT(buf + len, UDP_mdata_queue[queuec].pkt_num[plc]);					len += 4;
-					memcpy(&buf[len], UDP_mdata_queue[queuec].data.data(), sizeof(char)*UDP_mdata_queue[queuec].data_size);
-																								len += UDP_mdata_queue[queuec].data_size;
-					dxx_sendto(Netgame.players[plc].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
-					total_len += len;
-				}
-				needack++;
-			}
+			UDP_mdata_stats.timed_out++;
+			net_udp_noloss_give_up(missing);
+			if (!Netgame.PacketLossPrevention)
+				return;
 		}
+	}
 
-		// Check if we can remove that packet due to to it had no resend's or Timeout
-		if (needack==0 || (UDP_mdata_queue[queuec].pkt_initial_timestamp + UDP_TIMEOUT <= time))
-		{
-			if (needack) // packet timed out but still not all have ack'd.
-			{
-				if (multi_i_am_master()) // We are host, so we kick the remaining players.
-				{
-					for ( int plc=1; plc<N_players; plc++ )
-						if (UDP_mdata_queue[queuec].player_ack[plc] == 0)
-							net_udp_dump_player(Netgame.players[plc].protocol.udp.addr, DUMP_PKTTIMEOUT);
-				}
-				else // We are client, so we gotta go.
-				{
-					Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
-					if (Network_status==NETSTAT_PLAYING)
-						multi_leave_game();
-					if (Game_wind)
-						window_set_visible(Game_wind, 0);
-					nm_messagebox(NULL, 1, TXT_OK, "You left the game. You failed\nsending important packets.\nSorry.");
-					if (Game_wind)
-						window_set_visible(Game_wind, 1);
-					multi_quit_game = 1;
-					game_leave_menus();
-					multi_reset_stuff();
-				}
-			}
-			con_printf(CON_VERBOSE, "P#%u: Removing stored pkt_num [%i,%i,%i,%i,%i,%i,%i,%i] - missing ACKs: %i",Player_num, UDP_mdata_queue[queuec].pkt_num[0],UDP_mdata_queue[queuec].pkt_num[1],UDP_mdata_queue[queuec].pkt_num[2],UDP_mdata_queue[queuec].pkt_num[3],UDP_mdata_queue[queuec].pkt_num[4],UDP_mdata_queue[queuec].pkt_num[5],UDP_mdata_queue[queuec].pkt_num[6],UDP_mdata_queue[queuec].pkt_num[7], needack); // Just *marked* for removal. The actual process happens further below.
-			UDP_mdata_queue[queuec].used = 0;
-		}
+	UDP_mdata_stats.depth_total += net_udp_noloss_queue_depth();
+	UDP_mdata_stats.depth_samples++;
 
-		// Send up to half our max packet size
-		if (total_len >= (UPID_MAX_SIZE/2))
-			break;
+	for (unsigned plc = 0; plc < MAX_PLAYERS; plc++)
+	{
+		// Resend if enough time has passed.
+		const auto next_resend = UDP_mdata_trace[plc].next_resend;
+		if ((ack_mask & (1 << plc)) && next_resend && next_resend <= time)
+			net_udp_noloss_resend(plc, time);
 	}
+}
 
-	// Now that we are done processing the queue, actually remove all unused packets from the top of the list.
-	while (!UDP_mdata_queue[0].used && UDP_mdata_queue_highest > 0)
+/* Several packets resent to us at once. Take them one after another, as if each had come alone. */
+static void net_udp_process_mdata_multi(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	if (data_len < 2)
+		return;
+	uint_fast32_t len = 2;
+	for (unsigned count = data[1]; count; count--)
 	{
-		std::move(std::next(UDP_mdata_queue.begin()), UDP_mdata_queue.end(), UDP_mdata_queue.begin());
-		UDP_mdata_queue[UDP_MDATA_STOR_QUEUE_SIZE - 1] = {};
-		UDP_mdata_queue_highest--;
+		if (data_len - len < 7)
+			return;
+		const unsigned data_size = GET_INTEL_SHORT(&data[len + 5]);
+		if (data_size > UPID_MDATA_BUF_SIZE || data_len - len - 7 < data_size)
+			return;
+		array<uint8_t, 6 + UPID_MDATA_BUF_SIZE> buf;
+		buf[0] = UPID_MDATA_PNEEDACK;
+		buf[1] = data[len];
+		memcpy(&buf[2], &data[len + 1], 4);
+		memcpy(&buf[6], &data[len + 7], data_size);
+		net_udp_process_mdata(buf.data(), 6 + data_size, sender_addr, 1);
+		len += 7 + data_size;
 	}
 }
 /* CODE FOR PACKET LOSS PREVENTION - END */
@@ -5212,6 +5536,120 @@ void net_udp_process_mdata(uint8_t *data, uint_fast32_t data_len, const _sockadd
 	multi_process_bigdata(pnum, data+dataoffset, data_len-dataoffset );
 }
 
+/*
+ * UPID_PDATA_DELTA is laid out as
+ *	type, owner of the position, connect state, ack count, acks, block
+ * Each ack is the number of a stream and the newest seq decoded from it.
+ * If bit 7 of the stream number is set, the last block could not be
+ * decoded and the sender must send a keyframe.
+ * The host decodes each block and codes it again for every receiver, so
+ * the state is kept per receiver and player.  Clients only talk to the
+ * host, and use receiver 0.
+ */
+static array<array<pdata_delta_tx, MAX_PLAYERS>, MAX_PLAYERS> UDP_pdata_tx;
+static array<pdata_delta_rx, MAX_PLAYERS> UDP_pdata_rx;
+
+void net_udp_pdata_delta_reset(const unsigned player_num)
+{
+	UDP_pdata_rx[player_num].reset();
+	range_for (auto &tx, UDP_pdata_tx[player_num])
+		tx.reset();
+	range_for (auto &r, UDP_pdata_tx)
+		r[player_num].reset();
+}
+
+static void net_udp_send_pdata_delta(const unsigned receiver, const unsigned pnum, const ubyte connected, const quaternionpos &qpp)
+{
+	array<uint8_t, 4 + (2 * MAX_PLAYERS) + UDP_PDATA_DELTA_MAX_BLOCK> buf;
+	unsigned len = 0;
+
+	buf[len] = UPID_PDATA_DELTA;								len++;
+	buf[len] = pnum;									len++;
+	buf[len] = connected;									len++;
+	const auto ack_count = len++;
+	buf[ack_count] = 0;
+	for (unsigned i = 0; i < MAX_PLAYERS; i++)
+	{
+		// The host only acks what came from this receiver. A client acks everything the host relayed.
+		if (multi_i_am_master() ? i != receiver : i == Player_num)
+			continue;
+		auto &rx = UDP_pdata_rx[i];
+		if (rx.nack_pending)
+		{
+			buf[len] = i | 0x80;							len++;
+			buf[len] = 0;								len++;
+		}
+		else if (rx.ack_pending)
+		{
+			buf[len] = i;								len++;
+			buf[len] = rx.last_seq;							len++;
+		}
+		else
+			continue;
+		rx.ack_pending = rx.nack_pending = false;
+		buf[ack_count]++;
+	}
+	len += pdata_delta_encode(UDP_pdata_tx[receiver][pnum], qpp, &buf[len]);
+
+	dxx_sendto(Netgame.players[receiver].protocol.udp.addr, UDP_Socket[0], buf.data(), len, 0);
+	UDP_pdata_num_sendto++;
+	UDP_pdata_len_sendto += len;
+}
+
+void net_udp_process_pdata_delta(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	UDP_frame_info pd{};
+	uint_fast32_t len = 1;
+
+	if ( !( Game_mode & GM_NETWORK && ( Network_status == NETSTAT_PLAYING || Network_status == NETSTAT_ENDLEVEL ) ) )
+		return;
+	if (data_len < 4)
+		return;
+
+	pd.Player_num = data[len];								len++;
+	pd.connected = data[len];								len++;
+	if (pd.Player_num >= MAX_PLAYERS)
+		return;
+	const unsigned from = multi_i_am_master() ? pd.Player_num : 0;
+	if (sender_addr != Netgame.players[from].protocol.udp.addr)
+		return;
+
+	UDP_pdata_num_recvfrom++;
+	UDP_pdata_len_recvfrom += data_len;
+
+	const unsigned acks = data[len];							len++;
+	if (data_len < len + (2 * acks))
+		return;
+	for (unsigned i = 0; i < acks; i++, len += 2)
+	{
+		const unsigned stream = data[len] & 0x7f;
+		if (stream >= MAX_PLAYERS)
+			continue;
+		auto &tx = UDP_pdata_tx[from][stream];
+		if (data[len] & 0x80)
+			tx.nack();
+		else
+			tx.ack(data[len + 1]);
+	}
+
+	if (pdata_delta_decode(UDP_pdata_rx[pd.Player_num], &data[len], data_len - len, pd.qpp) != pdata_delta_result::ok)
+		return;
+
+	if (multi_i_am_master()) // I am host - must relay this position to others!
+	{
+		if (pd.Player_num > 0 && pd.Player_num <= N_players && Players[pd.Player_num].connected == CONNECT_PLAYING) // some checking wether this packet is legal
+		{
+			for (unsigned i = 1; i < MAX_PLAYERS; i++)
+			{
+				if (i != pd.Player_num && Players[i].connected != CONNECT_DISCONNECTED) // not to sender or disconnected players - right.
+					net_udp_send_pdata_delta(i, pd.Player_num, pd.connected, pd.qpp);
+			}
+		}
+	}
+
+	net_udp_read_pdata_packet (&pd);
+}
+
 void net_udp_send_pdata()
 {
 	ubyte buf[sizeof(UDP_frame_info)];
@@ -5224,14 +5662,28 @@ void net_udp_send_pdata()
 	if ( !( Network_status == NETSTAT_PLAYING || Network_status == NETSTAT_ENDLEVEL ) )
 		return;
 
+	quaternionpos qpp{};
+	create_quaternionpos(&qpp, vobjptr(get_local_player().objnum), 0);
+
+	if (Netgame.PdataDelta)
+	{
+		if (multi_i_am_master())
+		{
+			for (unsigned i = 1; i < MAX_PLAYERS; i++)
+				if (Players[i].connected != CONNECT_DISCONNECTED)
+					net_udp_send_pdata_delta(i, Player_num, get_local_player().connected, qpp);
+		}
+		else
+			net_udp_send_pdata_delta(0, Player_num, get_local_player().connected, qpp);
+		return;
+	}
+
 	memset(&buf, 0, sizeof(UDP_frame_info));
 	
 	buf[len] = UPID_PDATA;									len++;
 	buf[len] = Player_num;									len++;
 	buf[len] = get_local_player().connected;						len++;
 
-	quaternionpos qpp{};
-	create_quaternionpos(&qpp, vobjptr(get_local_player().objnum), 0);
 	PUT_INTEL_SHORT(buf+len, qpp.orient.w);							len += 2;
 	PUT_INTEL_SHORT(buf+len, qpp.orient.x);							len += 2;
 	PUT_INTEL_SHORT(buf+len, qpp.orient.y);							len += 2;
@@ -5251,11 +5703,17 @@ void net_udp_send_pdata()
 	{
 		for (int i = 1; i < MAX_PLAYERS; i++)
 			if (Players[i].connected != CONNECT_DISCONNECTED)
+			{
 				dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
+				UDP_pdata_num_sendto++;
+				UDP_pdata_len_sendto += len;
+			}
 	}
 	else
 	{
 		dxx_sendto(Netgame.players[0].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
+		UDP_pdata_num_sendto++;
+		UDP_pdata_len_sendto += len;
 	}
 }
 
@@ -5276,6 +5734,9 @@ void net_udp_process_pdata(const uint8_t *data, uint_fast32_t data_len, const _s
 	if (data_len != UPID_PDATA_SIZE)
 		return;
 
+	UDP_pdata_num_recvfrom++;
+	UDP_pdata_len_recvfrom += data_len;
+
 	if (sender_addr != Netgame.players[((multi_i_am_master())?(data[len]):(0))].protocol.udp.addr)
 		return;
 
@@ -5303,7 +5764,11 @@ void net_udp_process_pdata(const uint8_t *data, uint_fast32_t data_len, const _s
 			for (int i = 1; i < MAX_PLAYERS; i++)
 			{
 				if (i != pd.Player_num && Players[i].connected != CONNECT_DISCONNECTED) // not to sender or disconnected players - right.
+				{
 					dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], data, data_len, 0);
+					UDP_pdata_num_sendto++;
+					UDP_pdata_len_sendto += data_len;
+				}
 			}
 		}
 	}
@@ -5349,6 +5814,7 @@ void net_udp_read_pdata_packet(UDP_frame_info *pd)
 			multi_send_score();
 
 			net_udp_noloss_clear_mdata_trace(TheirPlayernum);
+			net_udp_pdata_delta_reset(TheirPlayernum);
 		}
 	}
 
@@ -5373,6 +5839,7 @@ void net_udp_read_pdata_packet(UDP_frame_info *pd)
 	//------------ Read the player's ship's object info ----------------------
 
 	extract_quaternionpos(TheirObj, &pd->qpp, 0);
+	multi_interp_add(TheirObj, pd->qpp);
 	if (TheirObj->movement_type == MT_PHYSICS)
 		set_thrust_from_velocity(TheirObj);
 }
@@ -5449,6 +5916,8 @@ void net_udp_process_ping(const uint8_t *data, const _sockaddr &sender_addr)
 		i.ping = GET_INTEL_INT(&(data[len]));		len += 4;
 	}
 	
+	if (UDP_packet_answered)
+		return;
 	buf[0] = UPID_PONG;
 	buf[1] = Player_num;
 	memcpy(&buf[2], &host_ping_time, 8);
@@ -5466,7 +5935,8 @@ void net_udp_process_pong(const uint8_t *data, const _sockaddr &sender_addr)
 		return;
 	fix64 client_pong_time;
 	memcpy(&client_pong_time, &data[2], 8);
-	const fix64 delta64 = timer_update() - client_pong_time;
+	// Measure to when the pong arrived, not to when we got around to it
+	const fix64 delta64 = timer_update() - UDP_packet_wait - client_pong_time;
 	const fix delta = static_cast<fix>(delta64);
 	fix result;
 	if (likely(delta64 == static_cast<fix64>(delta)))
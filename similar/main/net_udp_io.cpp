@@ -0,0 +1,449 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Background thread which moves UDP packets between the sockets and the
+ * game thread.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include "console.h"
+#include "net_udp.h"
+#include "net_udp_io.h"
+#include "spsc_ring.h"
+
+#include "compiler-exchange.h"
+#include "compiler-range_for.h"
+
+#define UDP_IO_RING_SIZE	256
+//Most packets moved by one recvmmsg or sendmmsg
+#define UDP_IO_BATCH	16
+/* With no kick, queued packets are still sent this often.  Windows has
+ * no way to wake the thread, so it relies on this alone.
+ */
+#ifdef _WIN32
+static const int UDP_IO_IDLE_MS = 1;
+#else
+static const int UDP_IO_IDLE_MS = 10;
+#endif
+
+static_assert(UDP_IO_MAX_PACKET == UPID_MAX_SIZE, "packet buffers must hold the largest packet");
+
+namespace {
+
+typedef spsc_ring<udp_io_packet, UDP_IO_RING_SIZE> udp_io_ring;
+
+struct udp_io_counters
+{
+	std::atomic<unsigned> received, receive_calls, sent, send_calls, answered, overflows;
+	udp_io_counters() :
+		received(0), receive_calls(0), sent(0), send_calls(0), answered(0), overflows(0)
+	{
+	}
+};
+
+class udp_io_thread
+{
+	std::thread thread;
+	std::atomic<bool> exiting, wake_pending;
+	std::vector<udp_io_socket_t> sockets;
+#ifndef _WIN32
+	array<int, 2> wake_pipe;
+#endif
+	std::mutex ping_mutex;
+	bool ping_reply;
+	uint8_t ping_player;
+	_sockaddr ping_host;
+	void run();
+	bool receive(udp_io_socket_t s);
+	void received_packet(udp_io_packet &p, udp_io_socket_t s, std::size_t size, socklen_t addrlen, std::chrono::steady_clock::time_point now);
+	void send_queued();
+public:
+	//thread to game thread
+	udp_io_ring received;
+	//game thread to thread
+	udp_io_ring queued;
+	udp_io_counters counters;
+	udp_io_stats drain_stats;
+	udp_io_thread() :
+		exiting(false), wake_pending(false), ping_reply(false), ping_player(0), ping_host{}, drain_stats{}
+	{
+	}
+	~udp_io_thread()
+	{
+		stop();
+	}
+	bool running() const
+	{
+		return thread.joinable();
+	}
+	bool start(const udp_io_socket_t *s, unsigned count);
+	void stop();
+	void kick();
+	void set_ping_reply(const _sockaddr &host, uint8_t player_num);
+	void clear_ping_reply();
+};
+
+}
+
+static udp_io_thread Udp_io;
+
+bool udp_io_thread::start(const udp_io_socket_t *const s, const unsigned count)
+{
+	if (running())
+		return true;
+#ifndef _WIN32
+	if (pipe(wake_pipe.data()) < 0)
+	{
+		con_printf(CON_URGENT, "Cannot create pipe for network thread: %s", strerror(errno));
+		return false;
+	}
+	range_for (const auto fd, wake_pipe)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+	sockets.assign(s, s + count);
+	received.clear();
+	queued.clear();
+	exiting = false;
+	wake_pending = false;
+	thread = std::thread(&udp_io_thread::run, this);
+	con_printf(CON_VERBOSE, "Started network thread for %u socket%s", count, count == 1 ? "" : "s");
+	return true;
+}
+
+void udp_io_thread::stop()
+{
+	if (!running())
+		return;
+	exiting = true;
+	wake_pending = false;
+	kick();
+	thread.join();
+#ifndef _WIN32
+	range_for (const auto fd, wake_pipe)
+		close(fd);
+#endif
+	received.clear();
+	queued.clear();
+	clear_ping_reply();
+	con_printf(CON_VERBOSE, "Stopped network thread");
+}
+
+void udp_io_thread::kick()
+{
+	if (wake_pending.exchange(true))
+		return;
+#ifndef _WIN32
+	const char c = 0;
+	(void)write(wake_pipe[1], &c, 1);
+#endif
+}
+
+void udp_io_thread::set_ping_reply(const _sockaddr &host, const uint8_t player_num)
+{
+	std::lock_guard<std::mutex> lock(ping_mutex);
+	ping_reply = true;
+	ping_host = host;
+	ping_player = player_num;
+}
+
+void udp_io_thread::clear_ping_reply()
+{
+	std::lock_guard<std::mutex> lock(ping_mutex);
+	ping_reply = false;
+}
+
+/* Stamp a packet, and answer it at once if it is a ping from the host.
+ * The game thread still reads the ping list from it.
+ */
+void udp_io_thread::received_packet(udp_io_packet &p, const udp_io_socket_t s, const std::size_t size, const socklen_t addrlen, const std::chrono::steady_clock::time_point now)
+{
+	p.socket = s;
+	p.size = size;
+	p.addrlen = addrlen;
+	p.time = now;
+	p.answered = false;
+	//Handlers may treat the packet as a string, as with udp_receive_packet
+	p.data[size] = 0;
+	if (size != UPID_PING_SIZE || p.data[0] != UPID_PING)
+		return;
+	array<uint8_t, UPID_PONG_SIZE> pong;
+	{
+		std::lock_guard<std::mutex> lock(ping_mutex);
+		if (!ping_reply || memcmp(&p.addr, &ping_host, sizeof(p.addr)))
+			return;
+		pong[1] = ping_player;
+	}
+	pong[0] = UPID_PONG;
+	memcpy(&pong[2], &p.data[1], 8);
+	if (sendto(s, reinterpret_cast<const char *>(pong.data()), pong.size(), 0, &p.addr.sa, addrlen) > 0)
+	{
+		p.answered = true;
+		++ counters.answered;
+	}
+}
+
+//Returns false if the ring filled before the socket was empty
+bool udp_io_thread::receive(const udp_io_socket_t s)
+{
+	for (;;)
+	{
+		const std::size_t n = std::min<std::size_t>(received.writable(), UDP_IO_BATCH);
+		if (!n)
+		{
+			++ counters.overflows;
+			return false;
+		}
+#ifdef DXX_HAVE_SENDMMSG
+		array<mmsghdr, UDP_IO_BATCH> msgs;
+		array<iovec, UDP_IO_BATCH> iov;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			auto &p = received.slot(i);
+			p.addr = {};
+			iov[i].iov_base = p.data.data();
+			iov[i].iov_len = UDP_IO_MAX_PACKET;
+			auto &h = msgs[i].msg_hdr;
+			h = {};
+			h.msg_name = &p.addr;
+			h.msg_namelen = sizeof(p.addr);
+			h.msg_iov = &iov[i];
+			h.msg_iovlen = 1;
+		}
+		const int r = recvmmsg(s, msgs.data(), n, MSG_DONTWAIT, nullptr);
+		++ counters.receive_calls;
+		if (r <= 0)
+			return true;
+		const auto now = std::chrono::steady_clock::now();
+		for (int i = 0; i < r; ++i)
+			received_packet(received.slot(i), s, msgs[i].msg_len, msgs[i].msg_hdr.msg_namelen, now);
+		received.publish(r);
+		counters.received += r;
+		if (static_cast<std::size_t>(r) < n)
+			return true;
+#else
+		auto &p = received.slot(0);
+		p.addr = {};
+		socklen_t addrlen = sizeof(p.addr);
+		int flags = 0;
+#ifdef MSG_DONTWAIT
+		flags |= MSG_DONTWAIT;
+#else
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(s, &set);
+		timeval tv{};
+		if (select(s + 1, &set, NULL, NULL, &tv) <= 0)
+			return true;
+#endif
+		const auto r = recvfrom(s, reinterpret_cast<char *>(p.data.data()), UDP_IO_MAX_PACKET, flags, &p.addr.sa, &addrlen);
+		++ counters.receive_calls;
+		if (r < 0)
+			return true;
+		received_packet(p, s, r, addrlen, std::chrono::steady_clock::now());
+		received.publish(1);
+		++ counters.received;
+#endif
+	}
+}
+
+void udp_io_thread::send_queued()
+{
+	while (const std::size_t readable = queued.readable())
+	{
+		//Batch consecutive packets for the same socket
+		const auto s = queued.front().socket;
+		std::size_t n = 1;
+		while (n < readable && n < UDP_IO_BATCH && queued.front(n).socket == s)
+			++ n;
+#ifdef DXX_HAVE_SENDMMSG
+		array<mmsghdr, UDP_IO_BATCH> msgs;
+		array<iovec, UDP_IO_BATCH> iov;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			auto &p = queued.front(i);
+			iov[i].iov_base = p.data.data();
+			iov[i].iov_len = p.size;
+			auto &h = msgs[i].msg_hdr;
+			h = {};
+			h.msg_name = &p.addr;
+			h.msg_namelen = p.addrlen;
+			h.msg_iov = &iov[i];
+			h.msg_iovlen = 1;
+		}
+		const int r = sendmmsg(s, msgs.data(), n, 0);
+		++ counters.send_calls;
+		/* Drop a packet which cannot be sent, as the game thread would
+		 * have done, so that one bad address cannot stall the queue.
+		 */
+		if (r > 0)
+			counters.sent += r;
+		queued.consume(r > 0 ? r : 1);
+#else
+		(void)n;
+		auto &p = queued.front();
+		if (sendto(s, reinterpret_cast<const char *>(p.data.data()), p.size, 0, &p.addr.sa, p.addrlen) > 0)
+			++ counters.sent;
+		++ counters.send_calls;
+		queued.consume();
+#endif
+	}
+}
+
+void udp_io_thread::run()
+{
+#ifndef _WIN32
+	std::vector<pollfd> fds;
+	range_for (const auto s, sockets)
+		fds.push_back({s, POLLIN, 0});
+	fds.push_back({wake_pipe[0], POLLIN, 0});
+#endif
+	while (!exiting)
+	{
+		bool overflowed = false;
+#ifndef _WIN32
+		if (poll(fds.data(), fds.size(), UDP_IO_IDLE_MS) > 0)
+		{
+			if (fds.back().revents & POLLIN)
+			{
+				char buf[64];
+				while (read(wake_pipe[0], buf, sizeof(buf)) > 0)
+				{
+				}
+			}
+			wake_pending = false;
+			for (std::size_t i = 0; i < sockets.size(); ++i)
+				if ((fds[i].revents & POLLIN) && !receive(sockets[i]))
+					overflowed = true;
+		}
+		else
+			wake_pending = false;
+#else
+		fd_set set;
+		FD_ZERO(&set);
+		udp_io_socket_t highest = 0;
+		range_for (const auto s, sockets)
+		{
+			FD_SET(s, &set);
+			highest = std::max(highest, s);
+		}
+		timeval tv{0, UDP_IO_IDLE_MS * 1000};
+		wake_pending = false;
+		if (select(highest + 1, &set, NULL, NULL, &tv) > 0)
+			range_for (const auto s, sockets)
+				if (FD_ISSET(s, &set) && !receive(s))
+					overflowed = true;
+#endif
+		send_queued();
+		//The game thread has fallen behind; let it catch up instead of spinning
+		if (overflowed)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	//Deliver anything queued before the stop, such as a disconnect notice
+	send_queued();
+}
+
+bool net_udp_io_start(const udp_io_socket_t *const sockets, const unsigned count)
+{
+	return Udp_io.start(sockets, count);
+}
+
+void net_udp_io_stop()
+{
+	Udp_io.stop();
+}
+
+bool net_udp_io_running()
+{
+	return Udp_io.running();
+}
+
+const udp_io_packet *net_udp_io_peek(fix64 &wait)
+{
+	const auto readable = Udp_io.received.readable();
+	if (!readable)
+		return nullptr;
+	const auto &p = Udp_io.received.front();
+	const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - p.time).count();
+	wait = static_cast<fix64>(us) * F1_0 / 1000000;
+	auto &s = Udp_io.drain_stats;
+	++ s.drained;
+	s.max_queued = std::max(s.max_queued, static_cast<unsigned>(readable));
+	s.total_wait += wait;
+	s.max_wait = std::max(s.max_wait, wait);
+	return &p;
+}
+
+void net_udp_io_pop()
+{
+	Udp_io.received.consume();
+}
+
+void net_udp_io_discard()
+{
+	Udp_io.received.consume(Udp_io.received.readable());
+}
+
+bool net_udp_io_send(const udp_io_socket_t socket, const void *const msg, const std::size_t len, const sockaddr &to, const socklen_t tolen)
+{
+	if (!Udp_io.running() || len > UDP_IO_MAX_PACKET || tolen > sizeof(_sockaddr))
+		return false;
+	auto &q = Udp_io.queued;
+	if (!q.writable())
+		return false;
+	auto &p = q.slot(0);
+	p.socket = socket;
+	p.addr = {};
+	memcpy(&p.addr, &to, tolen);
+	p.addrlen = tolen;
+	p.size = len;
+	memcpy(p.data.data(), msg, len);
+	q.publish(1);
+	return true;
+}
+
+void net_udp_io_kick()
+{
+	if (Udp_io.running())
+		Udp_io.kick();
+}
+
+void net_udp_io_set_ping_reply(const _sockaddr &host, const uint8_t player_num)
+{
+	Udp_io.set_ping_reply(host, player_num);
+}
+
+void net_udp_io_clear_ping_reply()
+{
+	Udp_io.clear_ping_reply();
+}
+
+udp_io_stats net_udp_io_get_stats()
+{
+	auto s = exchange(Udp_io.drain_stats, udp_io_stats{});
+	auto &c = Udp_io.counters;
+	s.received = c.received.exchange(0);
+	s.receive_calls = c.receive_calls.exchange(0);
+	s.sent = c.sent.exchange(0);
+	s.send_calls = c.send_calls.exchange(0);
+	s.answered = c.answered.exchange(0);
+	s.overflows = c.overflows.exchange(0);
+	return s;
+}
@@ -0,0 +1,348 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Delta coding of player position packets.
+ *
+ * A block is laid out as
+ *	seq, flags0, flags1, [base seq], orient, pos, vel, rotvel, [segment]
+ * flags0 holds a two bit code for each of orient, pos, vel and rotvel,
+ * in that order from the low bits.  flags1 bit 0 is set when the
+ * segment follows, and bit 1 when the block is a keyframe, which is
+ * coded against an all zero state instead of a base seq.
+ *
+ * Velocities are quantized before they are compared, so the codes mean:
+ *	same	all components equal the base; the base is kept
+ *	small	each component is a delta from the base
+ *	medium	the same, with wider deltas
+ *	full	each component is sent as it is
+ *
+ */
+
+#include <cstdint>
+#include "net_udp_pdata.h"
+
+#include "compiler-range_for.h"
+
+namespace {
+
+enum : unsigned
+{
+	field_same = 0,
+	field_small = 1,
+	field_medium = 2,
+	field_full = 3,
+};
+
+enum : uint8_t
+{
+	block_segment = 1,
+	block_keyframe = 2,
+};
+
+struct field_format
+{
+	//medium_bits is 0 if the field has no medium code
+	uint8_t small_bits, medium_bits, full_bits, shift;
+};
+
+const field_format orient_format{8, 0, 16, 0};
+const field_format pos_format{16, 24, 32, 0};
+//1/512 unit per second
+const field_format vel_format{8, 16, 32, 7};
+const field_format rotvel_format{8, 16, 32, 4};
+
+class block_writer
+{
+	uint8_t *p;
+public:
+	block_writer(uint8_t *const buf) :
+		p(buf)
+	{
+	}
+	uint8_t *get() const
+	{
+		return p;
+	}
+	void put(const int32_t v, const unsigned bits)
+	{
+		const uint32_t u = v;
+		for (unsigned b = 0; b < bits; b += 8)
+			*p++ = u >> b;
+	}
+};
+
+class block_reader
+{
+	const uint8_t *p, *const end;
+	bool overrun;
+public:
+	block_reader(const uint8_t *const buf, const std::size_t len) :
+		p(buf), end(buf + len), overrun(false)
+	{
+	}
+	bool done() const
+	{
+		return !overrun && p == end;
+	}
+	bool failed() const
+	{
+		return overrun;
+	}
+	int32_t get(const unsigned bits)
+	{
+		if (static_cast<std::size_t>(end - p) < bits / 8)
+		{
+			overrun = true;
+			return 0;
+		}
+		uint32_t u = 0;
+		for (unsigned b = 0; b < bits; b += 8)
+			u |= static_cast<uint32_t>(*p++) << b;
+		if (bits < 32)
+		{
+			//sign extend
+			const uint32_t sign = UINT32_C(1) << (bits - 1);
+			u = (u ^ sign) - sign;
+		}
+		return u;
+	}
+};
+
+template <std::size_t N>
+using field_t = array<int32_t, N>;
+
+}
+
+static bool fits(const int64_t v, const unsigned bits)
+{
+	const int64_t limit = INT64_C(1) << (bits - 1);
+	return v >= -limit && v < limit;
+}
+
+static int64_t quantize(const int32_t v, const unsigned shift)
+{
+	return shift ? (static_cast<int64_t>(v) + (1 << (shift - 1))) >> shift : v;
+}
+
+static int64_t dequantize(const int64_t q, const unsigned shift)
+{
+	return q * (INT64_C(1) << shift);
+}
+
+/* Write the components of cur which differ from base, and set r to what
+ * the receiver will rebuild.  Returns the code of the field.
+ */
+template <std::size_t N>
+static unsigned encode_field(block_writer &w, const field_format &f, const field_t<N> &cur, const field_t<N> &base, field_t<N> &r)
+{
+	array<int64_t, N> d;
+	bool same = true, small = true, medium = f.medium_bits != 0;
+	for (std::size_t i = 0; i < N; ++i)
+	{
+		const auto qb = quantize(base[i], f.shift);
+		const auto q = quantize(cur[i], f.shift);
+		d[i] = q - qb;
+		if (d[i])
+			same = false;
+		if (!fits(dequantize(q, f.shift), 32))
+			small = medium = false;
+		if (!fits(d[i], f.small_bits))
+			small = false;
+		if (medium && !fits(d[i], f.medium_bits))
+			medium = false;
+	}
+	if (same)
+	{
+		r = base;
+		return field_same;
+	}
+	if (small || medium)
+	{
+		const unsigned bits = small ? f.small_bits : f.medium_bits;
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			w.put(d[i], bits);
+			r[i] = dequantize(quantize(base[i], f.shift) + d[i], f.shift);
+		}
+		return small ? field_small : field_medium;
+	}
+	range_for (const auto v, cur)
+		w.put(v, f.full_bits);
+	r = cur;
+	return field_full;
+}
+
+template <std::size_t N>
+static bool decode_field(block_reader &rd, const field_format &f, const unsigned code, const field_t<N> &base, field_t<N> &r)
+{
+	switch (code)
+	{
+		case field_same:
+			r = base;
+			return true;
+		case field_medium:
+			if (!f.medium_bits)
+				return false;
+			/* fall through */
+		case field_small:
+		{
+			const unsigned bits = (code == field_small) ? f.small_bits : f.medium_bits;
+			for (std::size_t i = 0; i < N; ++i)
+			{
+				const auto q = quantize(base[i], f.shift) + rd.get(bits);
+				const auto v = dequantize(q, f.shift);
+				if (!fits(v, 32))
+					return false;
+				r[i] = v;
+			}
+			return !rd.failed();
+		}
+		default:
+			range_for (auto &v, r)
+				v = rd.get(f.full_bits);
+			return !rd.failed();
+	}
+}
+
+static field_t<4> get_orient(const quaternionpos &q)
+{
+	return {{q.orient.w, q.orient.x, q.orient.y, q.orient.z}};
+}
+
+static field_t<3> get_vector(const vms_vector v)
+{
+	return {{v.x, v.y, v.z}};
+}
+
+static void set_orient(quaternionpos &q, const field_t<4> &f)
+{
+	q.orient.w = f[0];
+	q.orient.x = f[1];
+	q.orient.y = f[2];
+	q.orient.z = f[3];
+}
+
+static vms_vector make_vector(const field_t<3> &f)
+{
+	return {f[0], f[1], f[2]};
+}
+
+static quaternionpos keyframe_base()
+{
+	quaternionpos base{};
+	base.segment = -1;
+	return base;
+}
+
+void pdata_delta_tx::ack(const uint8_t seq)
+{
+	//ignore acks for states not sent yet, or already overwritten
+	const uint8_t age = next_seq - seq;
+	if (!age || age > UDP_PDATA_HISTORY)
+		return;
+	if (have_ack && static_cast<int8_t>(seq - acked_seq) <= 0)
+		return;
+	acked_seq = seq;
+	have_ack = true;
+}
+
+std::size_t pdata_delta_encode(pdata_delta_tx &tx, const quaternionpos &qpp, uint8_t *const buf)
+{
+	const bool keyframe = !tx.have_ack || static_cast<uint8_t>(tx.next_seq - tx.acked_seq) >= UDP_PDATA_HISTORY;
+	const auto base = keyframe ? keyframe_base() : tx.history[tx.acked_seq % UDP_PDATA_HISTORY];
+	const uint8_t seq = tx.next_seq++;
+	block_writer w(buf);
+	w.put(seq, 8);
+	const auto flags = w.get();
+	w.put(0, 16);
+	if (!keyframe)
+		w.put(tx.acked_seq, 8);
+	quaternionpos r{};
+	field_t<4> orient;
+	field_t<3> pos, vel, rotvel;
+	unsigned flags0 = encode_field(w, orient_format, get_orient(qpp), get_orient(base), orient);
+	flags0 |= encode_field(w, pos_format, get_vector(qpp.pos), get_vector(base.pos), pos) << 2;
+	flags0 |= encode_field(w, vel_format, get_vector(qpp.vel), get_vector(base.vel), vel) << 4;
+	flags0 |= encode_field(w, rotvel_format, get_vector(qpp.rotvel), get_vector(base.rotvel), rotvel) << 6;
+	set_orient(r, orient);
+	r.pos = make_vector(pos);
+	r.vel = make_vector(vel);
+	r.rotvel = make_vector(rotvel);
+	uint8_t flags1 = keyframe ? block_keyframe : 0;
+	r.segment = qpp.segment;
+	if (qpp.segment != base.segment)
+	{
+		flags1 |= block_segment;
+		w.put(qpp.segment, 16);
+	}
+	flags[0] = flags0;
+	flags[1] = flags1;
+	const auto slot = seq % UDP_PDATA_HISTORY;
+	tx.history_seq[slot] = seq;
+	tx.history[slot] = r;
+	return w.get() - buf;
+}
+
+pdata_delta_result pdata_delta_decode(pdata_delta_rx &rx, const uint8_t *const buf, const std::size_t len, quaternionpos &qpp)
+{
+	block_reader rd(buf, len);
+	const uint8_t seq = rd.get(8);
+	const uint8_t flags0 = rd.get(8);
+	const uint8_t flags1 = rd.get(8);
+	if (rd.failed() || (flags1 & ~(block_segment | block_keyframe)))
+		return pdata_delta_result::malformed;
+	const bool keyframe = flags1 & block_keyframe;
+	/* Keyframes are always taken, since the sender may have started
+	 * counting again from 0.
+	 */
+	if (!keyframe && rx.have_last && static_cast<int8_t>(seq - rx.last_seq) <= 0)
+		return pdata_delta_result::stale;
+	quaternionpos base;
+	if (keyframe)
+		base = keyframe_base();
+	else
+	{
+		const uint8_t base_seq = rd.get(8);
+		if (rd.failed())
+			return pdata_delta_result::malformed;
+		const auto slot = base_seq % UDP_PDATA_HISTORY;
+		if (!rx.history_valid[slot] || rx.history_seq[slot] != base_seq)
+		{
+			rx.nack_pending = true;
+			return pdata_delta_result::missing_base;
+		}
+		base = rx.history[slot];
+	}
+	quaternionpos r{};
+	field_t<4> orient;
+	field_t<3> pos, vel, rotvel;
+	if (!decode_field(rd, orient_format, flags0 & 3, get_orient(base), orient) ||
+		!decode_field(rd, pos_format, (flags0 >> 2) & 3, get_vector(base.pos), pos) ||
+		!decode_field(rd, vel_format, (flags0 >> 4) & 3, get_vector(base.vel), vel) ||
+		!decode_field(rd, rotvel_format, (flags0 >> 6) & 3, get_vector(base.rotvel), rotvel))
+		return pdata_delta_result::malformed;
+	set_orient(r, orient);
+	r.pos = make_vector(pos);
+	r.vel = make_vector(vel);
+	r.rotvel = make_vector(rotvel);
+	r.segment = (flags1 & block_segment) ? static_cast<short>(rd.get(16)) : base.segment;
+	if (!rd.done())
+		return pdata_delta_result::malformed;
+	if (keyframe)
+		rx.history_valid = {};
+	const auto slot = seq % UDP_PDATA_HISTORY;
+	rx.history_valid[slot] = true;
+	rx.history_seq[slot] = seq;
+	rx.history[slot] = r;
+	rx.last_seq = seq;
+	rx.have_last = true;
+	rx.ack_pending = true;
+	qpp = r;
+	return pdata_delta_result::ok;
+}
@@ -0,0 +1,306 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Transfer of the level state to a player joining a game in progress.
+ *
+ * A chunk is laid out as
+ *	id, index, chunk count, raw size, compressed size, data
+ * and an ack as
+ *	id, bitmap of the chunks received
+ *
+ * The compressed stream is a series of sequences, each a token, extra
+ * literal length bytes, literals, a two byte offset, and extra match
+ * length bytes.  The high nibble of the token is the number of literals
+ * and the low nibble the match length less 4.  A nibble of 15 is
+ * continued by bytes which are added on, up to and including the first
+ * one below 255.  The last sequence has only literals.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "net_udp_snapshot.h"
+
+namespace {
+
+const unsigned lz_min_match = 4;
+const unsigned lz_hash_bits = 12;
+const std::size_t lz_max_offset = 0xffff;
+//do not trust a raw size much larger than any level state can be
+const uint32_t snapshot_max_raw_size = 1 << 22;
+
+class snapshot_chunk_header
+{
+public:
+	uint8_t id;
+	unsigned index, chunks;
+	uint32_t raw_size, compressed_size;
+	snapshot_chunk_header(snapshot_reader &r) :
+		id(r.get8()), index(r.get16()), chunks(r.get16()), raw_size(r.get32()), compressed_size(r.get32())
+	{
+	}
+};
+
+}
+
+static uint32_t lz_read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned lz_hash(const uint32_t v)
+{
+	return (v * UINT32_C(2654435761)) >> (32 - lz_hash_bits);
+}
+
+static void lz_put_length(std::vector<uint8_t> &out, std::size_t n)
+{
+	for (; n >= 255; n -= 255)
+		out.push_back(255);
+	out.push_back(n);
+}
+
+static void lz_put_sequence(std::vector<uint8_t> &out, const uint8_t *literals, const std::size_t nliterals, const std::size_t offset, const std::size_t match)
+{
+	const std::size_t m = match ? match - lz_min_match : 0;
+	out.push_back((std::min<std::size_t>(nliterals, 15) << 4) | std::min<std::size_t>(m, 15));
+	if (nliterals >= 15)
+		lz_put_length(out, nliterals - 15);
+	out.insert(out.end(), literals, literals + nliterals);
+	if (!match)
+		return;
+	out.push_back(offset);
+	out.push_back(offset >> 8);
+	if (m >= 15)
+		lz_put_length(out, m - 15);
+}
+
+void snapshot_compress(const uint8_t *const in, const std::size_t len, std::vector<uint8_t> &out)
+{
+	//positions are stored one higher, so that 0 means empty
+	array<uint32_t, 1 << lz_hash_bits> table{};
+	out.clear();
+	out.reserve(len / 2 + 16);
+	std::size_t anchor = 0, i = 0;
+	while (i + lz_min_match <= len)
+	{
+		const auto v = lz_read32(&in[i]);
+		auto &slot = table[lz_hash(v)];
+		const std::size_t candidate = slot;
+		slot = i + 1;
+		if (!candidate || i - (candidate - 1) > lz_max_offset || lz_read32(&in[candidate - 1]) != v)
+		{
+			++i;
+			continue;
+		}
+		const auto m = candidate - 1;
+		std::size_t match = lz_min_match;
+		while (i + match < len && in[m + match] == in[i + match])
+			++match;
+		lz_put_sequence(out, &in[anchor], i - anchor, i - m, match);
+		i += match;
+		anchor = i;
+	}
+	lz_put_sequence(out, &in[anchor], len - anchor, 0, 0);
+}
+
+static bool lz_get_length(const uint8_t *&p, const uint8_t *const end, std::size_t &n)
+{
+	for (;;)
+	{
+		if (p == end)
+			return false;
+		const auto b = *p++;
+		n += b;
+		if (b != 255)
+			return true;
+	}
+}
+
+bool snapshot_decompress(const uint8_t *p, const std::size_t len, const std::size_t raw_size, std::vector<uint8_t> &out)
+{
+	const auto end = p + len;
+	out.clear();
+	out.reserve(raw_size);
+	while (p != end)
+	{
+		const auto token = *p++;
+		std::size_t nliterals = token >> 4;
+		if (nliterals == 15 && !lz_get_length(p, end, nliterals))
+			return false;
+		if (static_cast<std::size_t>(end - p) < nliterals || raw_size - out.size() < nliterals)
+			return false;
+		out.insert(out.end(), p, p + nliterals);
+		p += nliterals;
+		if (p == end)
+			break;
+		if (end - p < 2)
+			return false;
+		const std::size_t offset = p[0] | (p[1] << 8);
+		p += 2;
+		std::size_t match = token & 15;
+		if (match == 15 && !lz_get_length(p, end, match))
+			return false;
+		match += lz_min_match;
+		if (!offset || offset > out.size() || raw_size - out.size() < match)
+			return false;
+		//the match may overlap what it copies
+		for (auto from = out.size() - offset; match; --match)
+			out.push_back(out[from++]);
+	}
+	return out.size() == raw_size;
+}
+
+bool snapshot_tx::start(const std::vector<uint8_t> &raw, const fix64 time)
+{
+	snapshot_compress(raw.data(), raw.size(), data);
+	chunks = (data.size() + UDP_SNAPSHOT_CHUNK_SIZE - 1) / UDP_SNAPSHOT_CHUNK_SIZE;
+	if (chunks > UDP_SNAPSHOT_MAX_CHUNKS)
+	{
+		clear();
+		return false;
+	}
+	++id;
+	raw_size = raw.size();
+	acked = {};
+	times_sent = {};
+	srtt = F1_0/10;
+	last_progress = time;
+	acked_chunks = packets = resent = 0;
+	return true;
+}
+
+void snapshot_tx::clear()
+{
+	chunks = 0;
+	std::vector<uint8_t>().swap(data);
+}
+
+std::size_t snapshot_tx::next_chunk(const fix64 time, uint8_t *const buf)
+{
+	const fix64 rto = std::min<fix64>(std::max<fix64>(srtt * 2, F1_0/20), F1_0);
+	unsigned outstanding = 0, due = chunks, fresh = chunks;
+	for (unsigned i = 0; i < chunks; ++i)
+	{
+		if (acked[i])
+			continue;
+		if (!times_sent[i])
+		{
+			if (fresh == chunks)
+				fresh = i;
+		}
+		else if (sent_time[i] + rto <= time)
+		{
+			//lost; send it again before anything new
+			if (due == chunks)
+				due = i;
+		}
+		else
+			++outstanding;
+	}
+	const unsigned i = (due != chunks) ? due : (outstanding < UDP_SNAPSHOT_WINDOW ? fresh : chunks);
+	if (i == chunks)
+		return 0;
+	if (times_sent[i])
+		++resent;
+	if (times_sent[i] != UINT8_MAX)
+		++times_sent[i];
+	sent_time[i] = time;
+	++packets;
+	auto p = buf;
+	const auto put = [&p](const uint32_t v, const unsigned bytes) {
+		for (unsigned b = 0; b < bytes; ++b)
+			*p++ = v >> (b * 8);
+	};
+	put(id, 1);
+	put(i, 2);
+	put(chunks, 2);
+	put(raw_size, 4);
+	put(data.size(), 4);
+	const std::size_t offset = i * UDP_SNAPSHOT_CHUNK_SIZE;
+	const std::size_t size = std::min(UDP_SNAPSHOT_CHUNK_SIZE, data.size() - offset);
+	std::copy(&data[offset], &data[offset] + size, &buf[UDP_SNAPSHOT_CHUNK_HEADER]);
+	return UDP_SNAPSHOT_CHUNK_HEADER + size;
+}
+
+void snapshot_tx::ack(const uint8_t *const buf, const std::size_t len, const fix64 time)
+{
+	if (!chunks || len != 1 + (chunks + 7) / 8 || buf[0] != id)
+		return;
+	bool progress = false;
+	for (unsigned i = 0; i < chunks; ++i)
+	{
+		if (acked[i] || !(buf[1 + i / 8] & (1 << (i % 8))))
+			continue;
+		acked[i] = true;
+		++acked_chunks;
+		progress = true;
+		//only chunks sent once tell how long the round trip is
+		if (times_sent[i] == 1)
+			srtt = (srtt * 7 + (time - sent_time[i])) / 8;
+	}
+	if (progress)
+		last_progress = time;
+}
+
+bool snapshot_rx::add(const uint8_t *const buf, const std::size_t len)
+{
+	snapshot_reader r(buf, len);
+	const snapshot_chunk_header h(r);
+	if (r.failed() || !h.chunks || h.chunks > UDP_SNAPSHOT_MAX_CHUNKS || h.index >= h.chunks || h.raw_size > snapshot_max_raw_size)
+		return false;
+	if (h.compressed_size > h.chunks * UDP_SNAPSHOT_CHUNK_SIZE || h.compressed_size <= (h.chunks - 1) * UDP_SNAPSHOT_CHUNK_SIZE)
+		return false;
+	const std::size_t offset = h.index * UDP_SNAPSHOT_CHUNK_SIZE;
+	const std::size_t size = std::min<std::size_t>(UDP_SNAPSHOT_CHUNK_SIZE, h.compressed_size - offset);
+	if (len != UDP_SNAPSHOT_CHUNK_HEADER + size)
+		return false;
+	if (!active || h.id != id)
+	{
+		//a chunk of an older snapshot, which arrived late
+		if (active && static_cast<int8_t>(h.id - id) < 0)
+			return false;
+		active = true;
+		id = h.id;
+		chunks = h.chunks;
+		raw_size = h.raw_size;
+		data.assign(h.compressed_size, 0);
+		have = {};
+		received = unacked = 0;
+	}
+	else if (h.chunks != chunks || h.raw_size != raw_size || h.compressed_size != data.size())
+		return false;
+	//even a chunk we have means our ack went missing
+	++unacked;
+	if (have[h.index])
+		return false;
+	have[h.index] = true;
+	std::copy(&buf[UDP_SNAPSHOT_CHUNK_HEADER], &buf[len], &data[offset]);
+	return ++received == chunks;
+}
+
+bool snapshot_rx::want_ack(const fix64 time) const
+{
+	return active && unacked && (complete() || unacked >= 8 || last_ack + F1_0/20 <= time);
+}
+
+std::size_t snapshot_rx::make_ack(const fix64 time, uint8_t *const buf)
+{
+	const std::size_t len = 1 + (chunks + 7) / 8;
+	std::fill(buf, buf + len, 0);
+	buf[0] = id;
+	for (unsigned i = 0; i < chunks; ++i)
+		if (have[i])
+			buf[1 + i / 8] |= 1 << (i % 8);
+	unacked = 0;
+	last_ack = time;
+	return len;
+}
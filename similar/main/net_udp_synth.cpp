@@ -0,0 +1,630 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Synthetic clients for load testing the host.
+ *
+ * The clients cannot run the real client code, which keeps its state in
+ * the same globals as the host.  Instead each keeps the little state a
+ * client needs to stay in a game: its player number, the snapshot it is
+ * taking, and the sequence numbers of its acknowledged messages.  Where
+ * a real client would read its own copy of the level, they read the
+ * host's, which is the same level.
+ *
+ */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+#include "net_udp.h"
+#include "net_udp_pdata.h"
+#include "net_udp_snapshot.h"
+#include "net_udp_synth.h"
+#include "multiinternal.h"
+#include "object.h"
+#include "player.h"
+#include "gameseq.h"
+#include "cntrlcen.h"
+#include "args.h"
+#include "console.h"
+#include "byteutil.h"
+#include "vecmat.h"
+
+#include "compiler-range_for.h"
+
+#ifndef _WIN32
+const int INVALID_SOCKET = -1;
+#endif
+
+//how often a client asks to join while the host does not answer
+const fix64 SYNTH_REQUEST_INTERVAL = F1_0;
+//how long a client waits after being turned away
+const fix64 SYNTH_RETRY_DELAY = F1_0 * 2;
+const fix64 SYNTH_RESEND_DELAY = F1_0 / 4;
+//acknowledged messages a client may have in flight
+const unsigned SYNTH_MDATA_WINDOW = 32;
+//largest message a client sends
+const std::size_t SYNTH_MDATA_MAX = 32;
+
+namespace {
+
+enum class synth_state : uint8_t
+{
+	//waiting for the host to be in a level
+	idle,
+	//asking to join, and taking the level state
+	joining,
+	playing,
+};
+
+struct synth_mdata
+{
+	uint32_t pkt_num;
+	fix64 sent;
+	uint8_t size;
+	array<uint8_t, SYNTH_MDATA_MAX> data;
+};
+
+class synth_client
+{
+#ifdef _WIN32
+	typedef SOCKET socket_t;
+#else
+	typedef int socket_t;
+#endif
+	socket_t s;
+	_sockaddr host;
+public:
+	array<char, CALLSIGN_LEN + 1> callsign;
+	synth_state state;
+	playernum_t pnum;
+	int level;
+	fix64 next_request, join_start, next_pdata, next_fire, next_mdata;
+	snapshot_rx snapshot;
+	pdata_delta_tx pdata_tx;
+	array<pdata_delta_rx, MAX_PLAYERS> pdata_rx;
+	//messages not acknowledged by the host, oldest first
+	std::vector<synth_mdata> unacked;
+	uint32_t mdata_tosend;
+	vms_vector origin;
+	vms_matrix origin_orient;
+	segnum_t segnum;
+	synth_client(unsigned index, const _sockaddr &host_addr);
+	synth_client(const synth_client &) = delete;
+	synth_client &operator=(const synth_client &) = delete;
+	~synth_client()
+	{
+		if (s == INVALID_SOCKET)
+			return;
+#ifdef _WIN32
+		closesocket(s);
+#else
+		close(s);
+#endif
+	}
+	bool open() const
+	{
+		return s != INVALID_SOCKET;
+	}
+	void send(const uint8_t *buf, std::size_t len);
+	int receive(uint8_t *buf, std::size_t len);
+};
+
+}
+
+static std::vector<std::unique_ptr<synth_client>> Synth_clients;
+static udp_synth_stats Synth_stats;
+static bool Synth_failed;
+//for the summary when the clients stop
+static unsigned Synth_joins, Synth_total_frames;
+static fix64 Synth_join_time_total, Synth_join_time_max;
+static perf_clock::duration Synth_total_host_time, Synth_total_host_max;
+
+synth_client::synth_client(const unsigned index, const _sockaddr &host_addr) :
+	s(socket(host_addr.address_family(), SOCK_DGRAM, 0)), host(host_addr), state(synth_state::idle), pnum(0), level(0), next_request(0), join_start(0), mdata_tosend(UDP_MDATA_PKT_NUM_MIN)
+{
+	callsign = {};
+	snprintf(callsign.data(), callsign.size(), "SYNTH%u", index + 1);
+	snapshot.clear();
+	if (s == INVALID_SOCKET)
+		return;
+	//bind to the loopback interface, so that the host sees the same address we send from
+	_sockaddr local = host_addr;
+#ifdef IPv6
+	local.sin6.sin6_port = 0;
+#else
+	local.sin.sin_port = 0;
+#endif
+	bool ok = bind(s, &local.sa, sizeof(local)) == 0;
+#ifdef _WIN32
+	u_long nonblocking = 1;
+	ok = ok && ioctlsocket(s, FIONBIO, &nonblocking) == 0;
+#else
+	ok = ok && fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+	if (!ok)
+	{
+#ifdef _WIN32
+		closesocket(s);
+#else
+		close(s);
+#endif
+		s = INVALID_SOCKET;
+	}
+}
+
+void synth_client::send(const uint8_t *const buf, const std::size_t len)
+{
+	sendto(s, reinterpret_cast<const char *>(buf), len, 0, &host.sa, sizeof(host));
+}
+
+int synth_client::receive(uint8_t *const buf, const std::size_t len)
+{
+	_sockaddr from;
+	socklen_t fromlen = sizeof(from);
+	const auto r = recvfrom(s, reinterpret_cast<char *>(buf), len, 0, &from.sa, &fromlen);
+	if (r <= 0)
+		return 0;
+	//only the host talks to us
+#ifdef IPv6
+	if (from.sin6.sin6_port != host.sin6.sin6_port)
+#else
+	if (from.sin.sin_port != host.sin.sin_port)
+#endif
+		return -1;
+	return r;
+}
+
+static void synth_send_request(synth_client &c)
+{
+	array<uint8_t, UPID_SEQUENCE_SIZE> buf{};
+	buf[0] = UPID_REQUEST;
+	memcpy(&buf[1], c.callsign.data(), CALLSIGN_LEN + 1);
+	//a player joining a game in progress says which level it is on
+	buf[CALLSIGN_LEN + 2] = c.level;
+	buf[CALLSIGN_LEN + 3] = 0;
+	c.send(buf.data(), buf.size());
+}
+
+static void synth_send_mdata(synth_client &c, const uint8_t *const data, const std::size_t size, const fix64 time)
+{
+	array<uint8_t, 6 + SYNTH_MDATA_MAX> buf;
+	if (!Netgame.PacketLossPrevention)
+	{
+		buf[0] = UPID_MDATA_PNORM;
+		buf[1] = c.pnum;
+		memcpy(&buf[2], data, size);
+		c.send(buf.data(), 2 + size);
+		return;
+	}
+	synth_mdata m;
+	m.pkt_num = c.mdata_tosend;
+	m.sent = time;
+	m.size = size;
+	memcpy(m.data.data(), data, size);
+	if (++c.mdata_tosend > UDP_MDATA_PKT_NUM_MAX)
+		c.mdata_tosend = UDP_MDATA_PKT_NUM_MIN;
+	buf[0] = UPID_MDATA_PNEEDACK;
+	buf[1] = c.pnum;
+	PUT_INTEL_INT(&buf[2], m.pkt_num);
+	memcpy(&buf[6], data, size);
+	c.send(buf.data(), 6 + size);
+	c.unacked.push_back(m);
+}
+
+static void synth_resend_mdata(synth_client &c, const fix64 time)
+{
+	range_for (auto &m, c.unacked)
+	{
+		if (m.sent + SYNTH_RESEND_DELAY > time)
+			continue;
+		array<uint8_t, 6 + SYNTH_MDATA_MAX> buf;
+		buf[0] = UPID_MDATA_PNEEDACK;
+		buf[1] = c.pnum;
+		PUT_INTEL_INT(&buf[2], m.pkt_num);
+		memcpy(&buf[6], m.data.data(), m.size);
+		c.send(buf.data(), 6 + m.size);
+		m.sent = time;
+		Synth_stats.resent++;
+	}
+}
+
+static void synth_send_ack(synth_client &c, const uint8_t sender, const uint8_t *const pkt_num)
+{
+	array<uint8_t, 7> buf;
+	buf[0] = UPID_MDATA_ACK;
+	buf[1] = c.pnum;
+	buf[2] = sender;
+	memcpy(&buf[3], pkt_num, 4);
+	c.send(buf.data(), buf.size());
+	Synth_stats.acks++;
+}
+
+static void synth_leave(synth_client &c, const fix64 time)
+{
+	if (c.state == synth_state::playing)
+	{
+		array<uint8_t, command_length<MULTI_QUIT>::value> quit;
+		quit[0] = MULTI_QUIT;
+		quit[1] = c.pnum;
+		synth_send_mdata(c, quit.data(), quit.size(), time);
+	}
+	c.state = synth_state::idle;
+	c.snapshot.clear();
+	c.unacked.clear();
+}
+
+static void synth_start_playing(synth_client &c, const playernum_t pnum, const fix64 time)
+{
+	c.state = synth_state::playing;
+	c.pnum = pnum;
+	c.snapshot.clear();
+	c.unacked.clear();
+	// The host clears its trace of our messages when it lets us in
+	c.mdata_tosend = UDP_MDATA_PKT_NUM_MIN;
+	c.pdata_tx.reset();
+	range_for (auto &rx, c.pdata_rx)
+		rx.reset();
+	const auto &plrobj = *vcobjptr(Players[pnum].objnum);
+	c.origin = plrobj.pos;
+	c.origin_orient = plrobj.orient;
+	c.segnum = plrobj.segnum;
+	c.next_pdata = c.next_fire = c.next_mdata = time;
+	const fix64 join_time = time - c.join_start;
+	Synth_joins++;
+	Synth_join_time_total += join_time;
+	Synth_join_time_max = std::max(Synth_join_time_max, join_time);
+	con_printf(CON_VERBOSE, "SYNTH: %s joined as pnum %u after %ums", c.callsign.data(), pnum, static_cast<unsigned>(join_time * 1000 / F1_0));
+	// Come out of hiding, as a player does when it enters the level
+	array<uint8_t, command_length<MULTI_REAPPEAR>::value> reappear{};
+	reappear[0] = MULTI_REAPPEAR;
+	reappear[1] = pnum;
+	PUT_INTEL_SHORT(&reappear[2], Players[pnum].objnum);
+	synth_send_mdata(c, reappear.data(), reappear.size(), time);
+}
+
+static void synth_process_pdata_delta(synth_client &c, const uint8_t *const data, const std::size_t len)
+{
+	if (len < 4)
+		return;
+	const unsigned owner = data[1];
+	const unsigned acks = data[3];
+	std::size_t pos = 4;
+	if (owner >= MAX_PLAYERS || len < pos + (2 * acks))
+		return;
+	for (unsigned i = 0; i < acks; i++, pos += 2)
+	{
+		if ((data[pos] & 0x7f) != c.pnum)
+			continue;
+		if (data[pos] & 0x80)
+			c.pdata_tx.nack();
+		else
+			c.pdata_tx.ack(data[pos + 1]);
+	}
+	quaternionpos qpp;
+	pdata_delta_decode(c.pdata_rx[owner], &data[pos], len - pos, qpp);
+}
+
+static void synth_process_packet(synth_client &c, uint8_t *const data, const std::size_t len, const fix64 time)
+{
+	switch (data[0])
+	{
+		case UPID_SNAPSHOT_DATA:
+			if (c.state != synth_state::joining)
+				break;
+			c.snapshot.add(data + 1, len - 1);
+			if (c.snapshot.want_ack(time))
+			{
+				array<uint8_t, 1 + UDP_SNAPSHOT_ACK_MAX> buf;
+				buf[0] = UPID_SNAPSHOT_ACK;
+				c.send(buf.data(), 1 + c.snapshot.make_ack(time, &buf[1]));
+			}
+			break;
+		case UPID_SYNC:
+		{
+			// Version, then the index of the player it was sent to
+			if (len < 8 || data[7] >= MAX_PLAYERS)
+				break;
+			if (c.state == synth_state::joining)
+				synth_start_playing(c, data[7], time);
+			break;
+		}
+		case UPID_DUMP:
+			if (len != UPID_DUMP_SIZE)
+				break;
+			con_printf(CON_VERBOSE, "SYNTH: %s turned away by the host, reason %u", c.callsign.data(), data[1]);
+			c.state = synth_state::idle;
+			c.snapshot.clear();
+			c.unacked.clear();
+			c.next_request = time + SYNTH_RETRY_DELAY;
+			break;
+		case UPID_PING:
+		{
+			if (c.state != synth_state::playing || len != UPID_PING_SIZE)
+				break;
+			array<uint8_t, UPID_PONG_SIZE> buf;
+			buf[0] = UPID_PONG;
+			buf[1] = c.pnum;
+			memcpy(&buf[2], &data[1], 8);
+			c.send(buf.data(), buf.size());
+			break;
+		}
+		case UPID_PDATA_DELTA:
+			if (c.state == synth_state::playing)
+				synth_process_pdata_delta(c, data, len);
+			break;
+		case UPID_MDATA_PNEEDACK:
+			if (c.state == synth_state::playing && len >= 6)
+				synth_send_ack(c, data[1], &data[2]);
+			break;
+		case UPID_MDATA_PNEEDACK_MULTI:
+		{
+			if (c.state != synth_state::playing || len < 2)
+				break;
+			std::size_t pos = 2;
+			for (unsigned count = data[1]; count && len - pos >= 7; count--)
+			{
+				const std::size_t size = GET_INTEL_SHORT(&data[pos + 5]);
+				if (len - pos - 7 < size)
+					break;
+				synth_send_ack(c, data[pos], &data[pos + 1]);
+				pos += 7 + size;
+			}
+			break;
+		}
+		case UPID_MDATA_ACK:
+		{
+			if (len != 7 || data[2] != c.pnum)
+				break;
+			const uint32_t pkt_num = GET_INTEL_INT(&data[3]);
+			c.unacked.erase(std::remove_if(c.unacked.begin(), c.unacked.end(), [pkt_num](const synth_mdata &m) { return m.pkt_num == pkt_num; }), c.unacked.end());
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static quaternionpos synth_position(const synth_client &c, const fix64 time)
+{
+	// Turn in place and bob a little, which stays inside any segment
+	const vms_angvec turn{0, 0, static_cast<fixang>(time / 4)};
+	const auto orient = vm_matrix_x_matrix(c.origin_orient, vm_angles_2_matrix(turn));
+	const auto bob = fix_sincos(static_cast<fixang>(time));
+	quaternionpos qpp{};
+	vms_quaternion_from_matrix(&qpp.orient, &orient);
+	qpp.pos = vm_vec_scale_add(c.origin, orient.uvec, bob.sin / 2);
+	qpp.segment = c.segnum;
+	qpp.vel = vm_vec_copy_scale(orient.uvec, bob.cos / 2);
+	return qpp;
+}
+
+static void synth_send_pdata(synth_client &c, const fix64 time)
+{
+	const auto qpp = synth_position(c, time);
+	array<uint8_t, 4 + (2 * MAX_PLAYERS) + UDP_PDATA_DELTA_MAX_BLOCK> buf;
+	std::size_t len = 0;
+	if (Netgame.PdataDelta)
+	{
+		buf[len++] = UPID_PDATA_DELTA;
+		buf[len++] = c.pnum;
+		buf[len++] = CONNECT_PLAYING;
+		const auto ack_count = len++;
+		buf[ack_count] = 0;
+		for (unsigned i = 0; i < MAX_PLAYERS; i++)
+		{
+			auto &rx = c.pdata_rx[i];
+			if (i == c.pnum || !(rx.ack_pending || rx.nack_pending))
+				continue;
+			buf[len++] = rx.nack_pending ? (i | 0x80) : i;
+			buf[len++] = rx.nack_pending ? 0 : rx.last_seq;
+			rx.ack_pending = rx.nack_pending = false;
+			buf[ack_count]++;
+		}
+		len += pdata_delta_encode(c.pdata_tx, qpp, &buf[len]);
+	}
+	else
+	{
+		buf[len++] = UPID_PDATA;
+		buf[len++] = c.pnum;
+		buf[len++] = CONNECT_PLAYING;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.w);		len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.x);		len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.y);		len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.z);		len += 2;
+		PUT_INTEL_INT(&buf[len], qpp.pos.x);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.pos.y);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.pos.z);			len += 4;
+		PUT_INTEL_SHORT(&buf[len], qpp.segment);		len += 2;
+		PUT_INTEL_INT(&buf[len], qpp.vel.x);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.vel.y);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.vel.z);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.x);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.y);			len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.z);			len += 4;
+	}
+	c.send(buf.data(), len);
+	Synth_stats.pdata++;
+}
+
+static void synth_send_fire(synth_client &c, const fix64 time)
+{
+	const auto qpp = synth_position(c, time);
+	vms_matrix orient;
+	vms_matrix_from_quaternion(&orient, &qpp.orient);
+	array<uint8_t, command_length<MULTI_FIRE>::value> fire{};
+	fire[0] = MULTI_FIRE;
+	fire[1] = c.pnum;
+	//laser, level 1, one shot
+	fire[5] = 1;
+	PUT_INTEL_INT(&fire[6], orient.fvec.x);
+	PUT_INTEL_INT(&fire[10], orient.fvec.y);
+	PUT_INTEL_INT(&fire[14], orient.fvec.z);
+	// Shots are not acknowledged
+	array<uint8_t, 2 + command_length<MULTI_FIRE>::value> buf;
+	buf[0] = UPID_MDATA_PNORM;
+	buf[1] = c.pnum;
+	memcpy(&buf[2], fire.data(), fire.size());
+	c.send(buf.data(), buf.size());
+	Synth_stats.fires++;
+}
+
+static void synth_send_typing(synth_client &c, const fix64 time)
+{
+	if (c.unacked.size() >= SYNTH_MDATA_WINDOW)
+		return;
+	array<uint8_t, command_length<MULTI_TYPING_STATE>::value> typing;
+	typing[0] = MULTI_TYPING_STATE;
+	typing[1] = c.pnum;
+	typing[2] = msgsend_none;
+	synth_send_mdata(c, typing.data(), typing.size(), time);
+	Synth_stats.mdata++;
+}
+
+static bool synth_due(fix64 &next, const unsigned rate, const fix64 time)
+{
+	if (!rate || next > time)
+		return false;
+	// Do not make up for frames which came late
+	next = std::max(next + F1_0 / rate, time - F1_0 / 10);
+	return true;
+}
+
+static void synth_client_frame(synth_client &c, const fix64 time)
+{
+	array<uint8_t, UPID_MAX_SIZE + 1> buf;
+	for (int len; (len = c.receive(buf.data(), UPID_MAX_SIZE)) != 0;)
+		if (len > 0)
+			synth_process_packet(c, buf.data(), len, time);
+
+	const bool level_running = Network_status == NETSTAT_PLAYING && !Control_center_destroyed;
+	if (c.state != synth_state::idle && (!level_running || c.level != Current_level_num))
+		synth_leave(c, time);
+	if (!level_running)
+		return;
+	if (c.state == synth_state::idle)
+	{
+		if (c.next_request > time)
+			return;
+		c.state = synth_state::joining;
+		c.level = Current_level_num;
+		c.join_start = time;
+		c.next_request = time;
+	}
+	if (c.state == synth_state::joining)
+	{
+		// The host serves one player at a time, and ignores the rest until it is done
+		if (!c.snapshot.active && c.next_request <= time)
+		{
+			synth_send_request(c);
+			c.next_request = time + SYNTH_REQUEST_INTERVAL;
+		}
+		return;
+	}
+	synth_resend_mdata(c, time);
+	const unsigned pps = GameArg.MplUdpSynthPps ? GameArg.MplUdpSynthPps : Netgame.PacketsPerSec;
+	if (synth_due(c.next_pdata, pps, time))
+		synth_send_pdata(c, time);
+	if (synth_due(c.next_fire, GameArg.MplUdpSynthFire, time))
+		synth_send_fire(c, time);
+	if (synth_due(c.next_mdata, GameArg.MplUdpSynthMdata, time))
+		synth_send_typing(c, time);
+}
+
+static void synth_start(const uint16_t host_port)
+{
+	_sockaddr host{};
+	host.sa.sa_family = host.address_family();
+#ifdef IPv6
+	host.sin6.sin6_addr = in6addr_loopback;
+	host.sin6.sin6_port = htons(host_port);
+#else
+	host.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	host.sin.sin_port = htons(host_port);
+#endif
+	const unsigned count = std::min(GameArg.MplUdpSynthClients, static_cast<unsigned>(MAX_PLAYERS - 1));
+	for (unsigned i = 0; i < count; i++)
+	{
+		std::unique_ptr<synth_client> c(new synth_client(i, host));
+		if (!c->open())
+		{
+			con_printf(CON_URGENT, "SYNTH: could not open a socket for client %u", i + 1);
+			Synth_clients.clear();
+			Synth_failed = true;
+			return;
+		}
+		Synth_clients.emplace_back(std::move(c));
+	}
+	Synth_stats = {};
+	Synth_joins = Synth_total_frames = 0;
+	Synth_join_time_total = Synth_join_time_max = 0;
+	Synth_total_host_time = Synth_total_host_max = {};
+	con_printf(CON_NORMAL, "SYNTH: starting %u synthetic clients against port %u", count, host_port);
+}
+
+void net_udp_synth_frame(const fix64 time, const uint16_t host_port)
+{
+	if (!GameArg.MplUdpSynthClients || !multi_i_am_master())
+		return;
+	if (Synth_clients.empty())
+	{
+		if (Synth_failed || Network_status != NETSTAT_PLAYING)
+			return;
+		synth_start(host_port);
+	}
+	range_for (auto &c, Synth_clients)
+		synth_client_frame(*c, time);
+}
+
+static double synth_ms(const perf_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void net_udp_synth_stop()
+{
+	Synth_failed = false;
+	if (Synth_clients.empty())
+		return;
+	Synth_clients.clear();
+	Synth_total_frames += Synth_stats.frames;
+	Synth_total_host_time += Synth_stats.host_time;
+	Synth_total_host_max = std::max(Synth_total_host_max, Synth_stats.host_max);
+	con_printf(CON_NORMAL, "SYNTH: %u joins, join time avg %ums max %ums; host network frame avg %.3fms max %.3fms over %u frames",
+		Synth_joins, Synth_joins ? static_cast<unsigned>(Synth_join_time_total * 1000 / F1_0 / Synth_joins) : 0, static_cast<unsigned>(Synth_join_time_max * 1000 / F1_0),
+		Synth_total_frames ? synth_ms(Synth_total_host_time) / Synth_total_frames : 0., synth_ms(Synth_total_host_max), Synth_total_frames);
+}
+
+bool net_udp_synth_active()
+{
+	return !Synth_clients.empty();
+}
+
+void net_udp_synth_host_frame(const perf_clock::duration d)
+{
+	Synth_stats.frames++;
+	Synth_stats.host_time += d;
+	Synth_stats.host_max = std::max(Synth_stats.host_max, d);
+}
+
+udp_synth_stats net_udp_synth_get_stats()
+{
+	auto r = Synth_stats;
+	r.clients = Synth_clients.size();
+	r.playing = std::count_if(Synth_clients.begin(), Synth_clients.end(), [](const std::unique_ptr<synth_client> &c) { return c->state == synth_state::playing; });
+	Synth_total_frames += Synth_stats.frames;
+	Synth_total_host_time += Synth_stats.host_time;
+	Synth_total_host_max = std::max(Synth_total_host_max, Synth_stats.host_max);
+	Synth_stats = {};
+	return r;
+}
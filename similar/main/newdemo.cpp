@@ -87,6 +87,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "console.h"
 #include "controls.h"
 #include "playsave.h"
+#include "timedemo.h"
+#include "timer.h"
+#include "newdemo_index.h"
 
 #ifdef EDITOR
 #include "editor/editor.h"
@@ -212,6 +215,10 @@ static ubyte nd_playback_v_dead = 0, nd_playback_v_rear = 0;
 static ubyte nd_playback_v_guided = 0;
 int nd_playback_v_juststarted=0;
 #endif
+// frame index of the demo being played, if it has one
+static demo_index nd_playback_v_index;
+static bool nd_playback_v_indexed;
+static array<char, PATH_MAX> nd_playback_v_index_name;
 
 // record variables
 #define REC_DELAY F1_0/20
@@ -254,6 +261,11 @@ int newdemo_get_percent_done()	{
 	return 0;
 }
 
+fix newdemo_get_recorded_frame_time()
+{
+	return nd_recorded_time;
+}
+
 #define VEL_PRECISION 12
 
 static void my_extract_shortpos(const vobjptr_t objp, shortpos *spp)
@@ -1901,6 +1913,7 @@ static void newdemo_pop_ctrlcen_triggers()
 			seg->sides[side].tmap_num2 = csegp->sides[cside].tmap_num2 = WallAnims[anim_num].frames[n-1];
 		}
 	}
+	flush_fcd_cache();
 }
 
 static int newdemo_read_frame_information(int rewrite)
@@ -2627,7 +2640,10 @@ static int newdemo_read_frame_information(int rewrite)
 				break;
 			}
 			if ((Newdemo_vcr_state != ND_STATE_PAUSED) && (Newdemo_vcr_state != ND_STATE_REWINDING) && (Newdemo_vcr_state != ND_STATE_ONEFRAMEBACKWARD))
+			{
 				Segments[seg].sides[side].tmap_num = Segments[cseg].sides[cside].tmap_num = tmap;
+				flush_fcd_cache();
+			}
 			break;
 		}
 
@@ -2652,6 +2668,7 @@ static int newdemo_read_frame_information(int rewrite)
 			if ((Newdemo_vcr_state != ND_STATE_PAUSED) && (Newdemo_vcr_state != ND_STATE_REWINDING) && (Newdemo_vcr_state != ND_STATE_ONEFRAMEBACKWARD)) {
 				Assert(tmap!=0 && Segments[seg].sides[side].tmap_num2!=0);
 				Segments[seg].sides[side].tmap_num2 = Segments[cseg].sides[cside].tmap_num2 = tmap;
+				flush_fcd_cache();
 			}
 			break;
 		}
@@ -2933,6 +2950,7 @@ static int newdemo_read_frame_information(int rewrite)
 				} else {
 					segp->sides[side].tmap_num2 = csegp->sides[cside].tmap_num2 = WallAnims[anim_num].frames[0];
 				}
+				flush_fcd_cache();
 			}
 			break;
 		}
@@ -2988,6 +3006,7 @@ static int newdemo_read_frame_information(int rewrite)
 				break;
 			}
 
+			flush_fcd_cache();
 			Walls[front_wall_num].type = type;
 			Walls[front_wall_num].state = state;
 			Walls[front_wall_num].cloak_value = cloak_value;
@@ -3343,6 +3362,141 @@ static void newdemo_back_frames(int frames)
 
 }
 
+static void newdemo_capture_keyframe(const unsigned frame)
+{
+	auto &idx = nd_playback_v_index;
+	idx.keyframes.emplace_back();
+	auto &k = idx.keyframes.back();
+	k.frame = frame;
+	demo_keyframe_capture(k);
+	k.cntrlcen_destroyed = nd_playback_v_cntrlcen_destroyed;
+	k.dead = nd_playback_v_dead;
+	k.rear = nd_playback_v_rear;
+#if defined(DXX_BUILD_DESCENT_II)
+	k.guided = nd_playback_v_guided;
+#else
+	k.guided = 0;
+#endif
+}
+
+/*
+ *  Decode the whole demo once, noting where each frame ends, and take a
+ *  keyframe every DEMO_KEYFRAME_INTERVAL of recorded time and whenever
+ *  the level changes.  Leaves the demo at its end.
+ */
+static bool newdemo_build_index()
+{
+	auto &idx = nd_playback_v_index;
+	idx.clear();
+	nd_playback_v_indexed = false;
+	idx.demo_size = nd_playback_v_demosize;
+	idx.demo_hash = demo_index_hash(infile);
+	PHYSFS_seek(infile, 0);
+	Newdemo_vcr_state = ND_STATE_PLAYBACK;
+	if (newdemo_read_demo_start(PURPOSE_CHOSE_PLAY))
+		return false;
+	Newdemo_vcr_state = ND_STATE_FASTFORWARD;
+	nd_playback_v_at_eof = 0;
+	fix time = 0;
+	while (newdemo_read_frame_information(0) != -1)
+	{
+		time += nd_recorded_time;
+		const unsigned frame = idx.frames.size();
+		idx.frames.push_back({static_cast<uint32_t>(PHYSFS_tell(infile)), time, static_cast<int8_t>(Current_level_num)});
+		if (idx.keyframes.empty() || idx.keyframes.back().level != Current_level_num ||
+			time - idx.frames[idx.keyframes.back().frame].time >= DEMO_KEYFRAME_INTERVAL)
+			newdemo_capture_keyframe(frame);
+	}
+	HUD_clear_messages();
+	if (!nd_playback_v_at_eof || idx.frames.empty())
+	{
+		idx.clear();
+		return false;
+	}
+	nd_playback_v_indexed = true;
+	return true;
+}
+
+/*
+ *  Put the demo just after the given frame: restore the keyframe before
+ *  it, then decode only the frames in between.
+ */
+static void newdemo_seek_frame(const unsigned frame, const int vcr_state)
+{
+	auto &idx = nd_playback_v_index;
+	const auto k = idx.keyframe_before(frame);
+	if (!k)
+	{
+		newdemo_goto_beginning();
+		Newdemo_vcr_state = vcr_state;
+		return;
+	}
+	if (k->level != Current_level_num)
+	{
+		if ((k->level < Last_secret_level) || (k->level > Last_level)) {
+			nm_messagebox( NULL, 1, TXT_OK, "%s\n%s\n%s", TXT_CANT_PLAYBACK, TXT_LEVEL_CANT_LOAD, TXT_DEMO_OLD_CORRUPT );
+			Current_mission.reset();
+			newdemo_stop_playback();
+			return;
+		}
+		LoadLevel(k->level,1);
+	}
+	if (!demo_keyframe_restore(*k))
+	{
+		// The index does not fit this demo after all.
+		idx.clear();
+		nd_playback_v_indexed = false;
+		newdemo_goto_beginning();
+		Newdemo_vcr_state = vcr_state;
+		return;
+	}
+	nd_playback_v_cntrlcen_destroyed = k->cntrlcen_destroyed;
+	nd_playback_v_dead = k->dead;
+	nd_playback_v_rear = k->rear;
+#if defined(DXX_BUILD_DESCENT_II)
+	nd_playback_v_guided = k->guided;
+	nd_playback_v_juststarted = 0;
+#endif
+	PHYSFS_seek(infile, idx.frames[k->frame].offset);
+	nd_playback_v_at_eof = 0;
+	Newdemo_vcr_state = ND_STATE_FASTFORWARD;
+	for (auto i = k->frame; i != frame; ++i)
+		if (newdemo_read_frame_information(0) == -1)
+		{
+			if (!nd_playback_v_at_eof)
+			{
+				newdemo_stop_playback();
+				return;
+			}
+			break;
+		}
+	nd_recorded_total = nd_playback_total = idx.frames[frame].time;
+	nd_playback_v_style = NORMAL_PLAYBACK;
+	Newdemo_vcr_state = vcr_state;
+}
+
+void newdemo_seek_relative(const fix delta)
+{
+	if (Newdemo_state != ND_STATE_PLAYBACK)
+		return;
+	const uint32_t offset = PHYSFS_tell(infile);
+	const int vcr_state = (Newdemo_vcr_state == ND_STATE_PAUSED) ? ND_STATE_PAUSED : ND_STATE_PLAYBACK;
+	auto &idx = nd_playback_v_index;
+	if (!nd_playback_v_indexed)
+	{
+		const auto start = timer_query();
+		if (!newdemo_build_index())
+		{
+			newdemo_stop_playback();
+			return;
+		}
+		con_printf(CON_VERBOSE, "Indexed demo: %u frames, %u keyframes in %u ms", static_cast<unsigned>(idx.frames.size()), static_cast<unsigned>(idx.keyframes.size()), static_cast<unsigned>(((timer_query() - start) * 1000) / F1_0));
+		idx.write(nd_playback_v_index_name.data());
+	}
+	const auto current = idx.frame_at_offset(offset);
+	newdemo_seek_frame(idx.frame_at_time(idx.frames[current].time + delta), vcr_state);
+}
+
 /*
  *  routine to interpolate the viewer position.  the current position is
  *  stored in the Viewer object.  Save this position, and read the next
@@ -3937,6 +4091,8 @@ void newdemo_start_playback(const char * filename)
 	Newdemo_state = ND_STATE_PLAYBACK;
 	Newdemo_vcr_state = ND_STATE_PLAYBACK;
 	nd_playback_v_demosize = PHYSFS_fileLength(infile);
+	demo_index_filename(nd_playback_v_index_name.data(), filename2);
+	nd_playback_v_indexed = nd_playback_v_index.read(nd_playback_v_index_name.data(), nd_playback_v_demosize, demo_index_hash(infile));
 	nd_playback_v_bad_read = 0;
 	nd_playback_v_at_eof = 0;
 	nd_playback_v_framecount = 0;
@@ -3960,6 +4116,8 @@ void newdemo_start_playback(const char * filename)
 void newdemo_stop_playback()
 {
 	infile.reset();
+	nd_playback_v_index.clear();
+	nd_playback_v_indexed = false;
 	Newdemo_state = ND_STATE_NORMAL;
 	change_playernum_to(0);             //this is reality
 	get_local_player().callsign = nd_playback_v_save_callsign;
@@ -3975,9 +4133,38 @@ void newdemo_stop_playback()
 	
 	if (Game_wind)
 		window_close(Game_wind);               // Exit game loop
+	timedemo_finish();
 }
 
 
+int newdemo_write_index(const char *filename)
+{
+	char demoname[PATH_MAX+FILENAME_LEN] = DEMO_DIR;
+
+	strcat(demoname, filename);
+	infile = PHYSFSX_openReadBuffered(demoname);
+	if (!infile)
+		return 0;
+
+	change_playernum_to(0);
+	nd_playback_v_save_callsign = get_local_player().callsign;
+	Newdemo_state = ND_STATE_PLAYBACK;
+	nd_playback_v_demosize = PHYSFS_fileLength(infile);
+	nd_playback_v_bad_read = 0;
+	nd_playback_v_framecount = 0;
+	nd_playback_v_cntrlcen_destroyed = 0;
+#if defined(DXX_BUILD_DESCENT_II)
+	nd_playback_v_guided = 0;
+#endif
+	nd_playback_v_dead = nd_playback_v_rear = 0;
+	demo_index_filename(nd_playback_v_index_name.data(), demoname);
+	const int ok = newdemo_build_index() && nd_playback_v_index.write(nd_playback_v_index_name.data());
+	if (ok)
+		con_printf(CON_NORMAL, "Indexed demo %s: %u frames, %u keyframes", filename, static_cast<unsigned>(nd_playback_v_index.frames.size()), static_cast<unsigned>(nd_playback_v_index.keyframes.size()));
+	newdemo_stop_playback();
+	return ok;
+}
+
 int newdemo_swap_endian(const char *filename)
 {
 	char inpath[PATH_MAX+FILENAME_LEN] = DEMO_DIR;
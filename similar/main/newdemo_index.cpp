@@ -0,0 +1,427 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Frame index of a demo.
+ *
+ * The file is laid out as
+ *	id, version, demo size, demo hash, frame count, keyframe count
+ *	per frame: offset, time, level
+ *	per keyframe: the fields of demo_keyframe in order, then the walls,
+ *	then the paste-on textures of sides without walls
+ * with everything little endian.
+ *
+ */
+
+#include <algorithm>
+#include <iterator>
+#include "newdemo_index.h"
+#include "gameseq.h"
+#include "gameseg.h"
+#include "segment.h"
+#include "wall.h"
+#include "cntrlcen.h"
+#include "controls.h"
+#include "strutil.h"
+#include "console.h"
+#include "makesig.h"
+#include "compiler-range_for.h"
+#include "partial_range.h"
+#include "highest_valid.h"
+
+#define DEMO_INDEX_ID	MAKE_SIG('I','M','D','N')
+static const unsigned DEMO_INDEX_VERSION = 2;
+//how much of each end of the demo the hash covers
+static const unsigned DEMO_INDEX_HASH_SPAN = 64 * 1024;
+
+void demo_index::clear()
+{
+	demo_size = demo_hash = 0;
+	frames.clear();
+	keyframes.clear();
+}
+
+unsigned demo_index::frame_at_offset(const uint32_t offset) const
+{
+	const auto i = std::upper_bound(frames.begin(), frames.end(), offset, [](const uint32_t o, const demo_index_frame &f) {
+		return o < f.offset;
+	});
+	return i == frames.begin() ? 0 : std::distance(frames.begin(), i) - 1;
+}
+
+unsigned demo_index::frame_at_time(const fix t) const
+{
+	if (frames.empty())
+		return 0;
+	const auto i = std::lower_bound(frames.begin(), frames.end(), t, [](const demo_index_frame &f, const fix t) {
+		return f.time < t;
+	});
+	return i == frames.end() ? frames.size() - 1 : std::distance(frames.begin(), i);
+}
+
+const demo_keyframe *demo_index::keyframe_before(const unsigned frame) const
+{
+	const auto i = std::lower_bound(keyframes.begin(), keyframes.end(), frame, [](const demo_keyframe &k, const unsigned f) {
+		return k.frame < f;
+	});
+	return i == keyframes.begin() ? nullptr : &*std::prev(i);
+}
+
+static void hash_bytes(uint32_t &h, const uint8_t *const p, const std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		h = (h ^ p[i]) * 16777619u;
+}
+
+uint32_t demo_index_hash(PHYSFS_File *const fp)
+{
+	const auto pos = PHYSFS_tell(fp);
+	const auto size = PHYSFS_fileLength(fp);
+	uint32_t h = 2166136261u;
+	const uint32_t size32 = size;
+	hash_bytes(h, reinterpret_cast<const uint8_t *>(&size32), sizeof(size32));
+	std::vector<uint8_t> buf(DEMO_INDEX_HASH_SPAN);
+	const auto hash_span = [&](const PHYSFS_sint64 start) {
+		if (!PHYSFS_seek(fp, start))
+			return;
+		const auto n = PHYSFS_read(fp, buf.data(), 1, buf.size());
+		if (n > 0)
+			hash_bytes(h, buf.data(), n);
+	};
+	hash_span(0);
+	if (size > DEMO_INDEX_HASH_SPAN)
+		hash_span(std::max<PHYSFS_sint64>(DEMO_INDEX_HASH_SPAN, size - DEMO_INDEX_HASH_SPAN));
+	PHYSFS_seek(fp, pos);
+	return h;
+}
+
+void demo_index_filename(char *const index_name, const char *const demo_name)
+{
+	change_filename_extension(index_name, demo_name, DEMO_INDEX_EXT);
+}
+
+//sides whose paste-on texture a keyframe holds; the walls hold the rest
+template <typename F>
+static void for_each_blowup_side(F f)
+{
+	range_for (const auto s, highest_valid(Segments))
+		range_for (auto &side, vsegptr(static_cast<segnum_t>(s))->sides)
+			if (side.wall_num == wall_none && side.tmap_num2)
+				f(side);
+}
+
+void demo_keyframe_capture(demo_keyframe &k)
+{
+	k.level = Current_level_num;
+	k.primary_weapon = Primary_weapon;
+	k.secondary_weapon = Secondary_weapon;
+	k.n_players = N_players;
+	k.control_center_destroyed = Control_center_destroyed;
+	k.countdown_seconds_left = Countdown_seconds_left;
+#if defined(DXX_BUILD_DESCENT_II)
+	k.afterburner_charge = Afterburner_charge;
+#else
+	k.afterburner_charge = 0;
+#endif
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		const auto &p = Players[i];
+		auto &kp = k.players[i];
+		kp.callsign = p.callsign;
+		kp.connected = p.connected;
+		kp.flags = p.flags;
+		kp.energy = p.energy;
+		kp.shields = p.shields;
+		kp.laser_level = p.laser_level;
+		kp.primary_weapon_flags = p.primary_weapon_flags;
+		kp.secondary_weapon_flags = p.secondary_weapon_flags;
+		kp.vulcan_ammo = p.vulcan_ammo;
+		kp.secondary_ammo = p.secondary_ammo;
+		kp.score = p.score;
+		kp.net_killed_total = p.net_killed_total;
+		kp.net_kills_total = p.net_kills_total;
+		kp.hostages_on_board = p.hostages_on_board;
+	}
+	k.walls.clear();
+	k.walls.reserve(Num_walls);
+	range_for (const auto &w, partial_range(Walls, Num_walls))
+	{
+		const auto &side = Segments[w.segnum].sides[w.sidenum];
+		demo_keyframe_wall kw;
+		kw.type = w.type;
+		kw.flags = w.flags;
+		kw.state = w.state;
+#if defined(DXX_BUILD_DESCENT_II)
+		kw.cloak_value = w.cloak_value;
+#else
+		kw.cloak_value = 0;
+#endif
+		kw.tmap_num = side.tmap_num;
+		kw.tmap_num2 = side.tmap_num2;
+		for (unsigned i = 0; i < 4; ++i)
+			kw.light[i] = side.uvls[i].l;
+		k.walls.push_back(kw);
+	}
+	k.side_tmap_num2.clear();
+	for_each_blowup_side([&k](const side &side) {
+		k.side_tmap_num2.push_back(side.tmap_num2);
+	});
+}
+
+bool demo_keyframe_restore(const demo_keyframe &k)
+{
+	if (k.level != Current_level_num || k.walls.size() != Num_walls)
+		return false;
+	//a blown up side keeps a texture, so the same sides are counted
+	std::size_t num_sides = 0;
+	for_each_blowup_side([&num_sides](const side &) {
+		++num_sides;
+	});
+	if (num_sides != k.side_tmap_num2.size())
+		return false;
+	Primary_weapon = static_cast<primary_weapon_index_t>(k.primary_weapon);
+	Secondary_weapon = k.secondary_weapon;
+	N_players = k.n_players;
+	Control_center_destroyed = k.control_center_destroyed;
+	Countdown_seconds_left = k.countdown_seconds_left;
+#if defined(DXX_BUILD_DESCENT_II)
+	Afterburner_charge = k.afterburner_charge;
+#endif
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		auto &p = Players[i];
+		const auto &kp = k.players[i];
+		p.callsign = kp.callsign;
+		p.connected = kp.connected;
+		p.flags = kp.flags;
+		p.energy = kp.energy;
+		p.shields = kp.shields;
+		p.laser_level = stored_laser_level(kp.laser_level);
+		p.primary_weapon_flags = kp.primary_weapon_flags;
+		p.secondary_weapon_flags = kp.secondary_weapon_flags;
+		p.vulcan_ammo = kp.vulcan_ammo;
+		p.secondary_ammo = kp.secondary_ammo;
+		p.score = kp.score;
+		p.net_killed_total = kp.net_killed_total;
+		p.net_kills_total = kp.net_kills_total;
+		p.hostages_on_board = kp.hostages_on_board;
+		if (!(p.flags & PLAYER_FLAGS_CLOAKED))
+			p.cloak_time = 0;
+	}
+	auto kw = k.walls.begin();
+	range_for (auto &w, partial_range(Walls, Num_walls))
+	{
+		auto &side = Segments[w.segnum].sides[w.sidenum];
+		w.type = kw->type;
+		w.flags = kw->flags;
+		w.state = kw->state;
+#if defined(DXX_BUILD_DESCENT_II)
+		w.cloak_value = kw->cloak_value;
+#endif
+		side.tmap_num = kw->tmap_num;
+		side.tmap_num2 = kw->tmap_num2;
+		for (unsigned i = 0; i < 4; ++i)
+			side.uvls[i].l = kw->light[i];
+		++kw;
+	}
+	auto ktmap = k.side_tmap_num2.begin();
+	for_each_blowup_side([&ktmap](side &side) {
+		side.tmap_num2 = *ktmap++;
+	});
+	flush_fcd_cache();
+	return true;
+}
+
+static bool read_u8(PHYSFS_File *const fp, uint8_t &v)
+{
+	return PHYSFS_read(fp, &v, 1, 1) == 1;
+}
+
+static bool read_s8(PHYSFS_File *const fp, int8_t &v)
+{
+	return PHYSFS_read(fp, &v, 1, 1) == 1;
+}
+
+static bool read_keyframe(PHYSFS_File *const fp, demo_keyframe &k)
+{
+	uint32_t num_walls;
+	if (!PHYSFS_readULE32(fp, &k.frame) ||
+		!read_s8(fp, k.level) ||
+		!read_u8(fp, k.cntrlcen_destroyed) ||
+		!read_u8(fp, k.dead) ||
+		!read_u8(fp, k.rear) ||
+		!read_u8(fp, k.guided) ||
+		!read_s8(fp, k.primary_weapon) ||
+		!read_s8(fp, k.secondary_weapon) ||
+		!read_u8(fp, k.n_players) ||
+		!PHYSFS_readSLE32(fp, &k.control_center_destroyed) ||
+		!PHYSFS_readSLE32(fp, &k.countdown_seconds_left) ||
+		!PHYSFS_readSLE32(fp, &k.afterburner_charge))
+		return false;
+	if (k.n_players > MAX_PLAYERS)
+		return false;
+	range_for (auto &kp, k.players)
+	{
+		if (PHYSFS_read(fp, kp.callsign.a.data(), 1, kp.callsign.a.size()) != static_cast<PHYSFS_sint64>(kp.callsign.a.size()) ||
+			!read_s8(fp, kp.connected) ||
+			!PHYSFS_readULE32(fp, &kp.flags) ||
+			!PHYSFS_readSLE32(fp, &kp.energy) ||
+			!PHYSFS_readSLE32(fp, &kp.shields) ||
+			!read_u8(fp, kp.laser_level) ||
+			!PHYSFS_readULE16(fp, &kp.primary_weapon_flags) ||
+			!PHYSFS_readULE16(fp, &kp.secondary_weapon_flags) ||
+			!PHYSFS_readULE16(fp, &kp.vulcan_ammo) ||
+			PHYSFS_read(fp, kp.secondary_ammo.data(), 1, kp.secondary_ammo.size()) != static_cast<PHYSFS_sint64>(kp.secondary_ammo.size()) ||
+			!PHYSFS_readSLE32(fp, &kp.score) ||
+			!PHYSFS_readSLE16(fp, &kp.net_killed_total) ||
+			!PHYSFS_readSLE16(fp, &kp.net_kills_total) ||
+			!read_u8(fp, kp.hostages_on_board))
+			return false;
+		kp.callsign.a.back() = 0;
+	}
+	if (!PHYSFS_readULE32(fp, &num_walls) || num_walls > MAX_WALLS)
+		return false;
+	k.walls.resize(num_walls);
+	range_for (auto &kw, k.walls)
+	{
+		if (!read_u8(fp, kw.type) ||
+			!read_u8(fp, kw.flags) ||
+			!read_u8(fp, kw.state) ||
+			!read_s8(fp, kw.cloak_value) ||
+			!PHYSFS_readSLE16(fp, &kw.tmap_num) ||
+			!PHYSFS_readSLE16(fp, &kw.tmap_num2))
+			return false;
+		range_for (auto &l, kw.light)
+			if (!PHYSFS_readSLE32(fp, &l))
+				return false;
+	}
+	uint32_t num_sides;
+	if (!PHYSFS_readULE32(fp, &num_sides) || num_sides > MAX_SEGMENTS * MAX_SIDES_PER_SEGMENT)
+		return false;
+	k.side_tmap_num2.resize(num_sides);
+	range_for (auto &t, k.side_tmap_num2)
+		if (!PHYSFS_readSLE16(fp, &t))
+			return false;
+	return true;
+}
+
+static bool write_keyframe(PHYSFS_File *const fp, const demo_keyframe &k)
+{
+	if (!PHYSFS_writeULE32(fp, k.frame) ||
+		!PHYSFSX_writeU8(fp, k.level) ||
+		!PHYSFSX_writeU8(fp, k.cntrlcen_destroyed) ||
+		!PHYSFSX_writeU8(fp, k.dead) ||
+		!PHYSFSX_writeU8(fp, k.rear) ||
+		!PHYSFSX_writeU8(fp, k.guided) ||
+		!PHYSFSX_writeU8(fp, k.primary_weapon) ||
+		!PHYSFSX_writeU8(fp, k.secondary_weapon) ||
+		!PHYSFSX_writeU8(fp, k.n_players) ||
+		!PHYSFS_writeSLE32(fp, k.control_center_destroyed) ||
+		!PHYSFS_writeSLE32(fp, k.countdown_seconds_left) ||
+		!PHYSFS_writeSLE32(fp, k.afterburner_charge))
+		return false;
+	range_for (auto &kp, k.players)
+	{
+		if (PHYSFS_write(fp, kp.callsign.a.data(), 1, kp.callsign.a.size()) != static_cast<PHYSFS_sint64>(kp.callsign.a.size()) ||
+			!PHYSFSX_writeU8(fp, kp.connected) ||
+			!PHYSFS_writeULE32(fp, kp.flags) ||
+			!PHYSFS_writeSLE32(fp, kp.energy) ||
+			!PHYSFS_writeSLE32(fp, kp.shields) ||
+			!PHYSFSX_writeU8(fp, kp.laser_level) ||
+			!PHYSFS_writeULE16(fp, kp.primary_weapon_flags) ||
+			!PHYSFS_writeULE16(fp, kp.secondary_weapon_flags) ||
+			!PHYSFS_writeULE16(fp, kp.vulcan_ammo) ||
+			PHYSFS_write(fp, kp.secondary_ammo.data(), 1, kp.secondary_ammo.size()) != static_cast<PHYSFS_sint64>(kp.secondary_ammo.size()) ||
+			!PHYSFS_writeSLE32(fp, kp.score) ||
+			!PHYSFS_writeSLE16(fp, kp.net_killed_total) ||
+			!PHYSFS_writeSLE16(fp, kp.net_kills_total) ||
+			!PHYSFSX_writeU8(fp, kp.hostages_on_board))
+			return false;
+	}
+	if (!PHYSFS_writeULE32(fp, k.walls.size()))
+		return false;
+	range_for (auto &kw, k.walls)
+	{
+		if (!PHYSFSX_writeU8(fp, kw.type) ||
+			!PHYSFSX_writeU8(fp, kw.flags) ||
+			!PHYSFSX_writeU8(fp, kw.state) ||
+			!PHYSFSX_writeU8(fp, kw.cloak_value) ||
+			!PHYSFS_writeSLE16(fp, kw.tmap_num) ||
+			!PHYSFS_writeSLE16(fp, kw.tmap_num2))
+			return false;
+		range_for (auto &l, kw.light)
+			if (!PHYSFS_writeSLE32(fp, l))
+				return false;
+	}
+	if (!PHYSFS_writeULE32(fp, k.side_tmap_num2.size()))
+		return false;
+	range_for (const auto t, k.side_tmap_num2)
+		if (!PHYSFS_writeSLE16(fp, t))
+			return false;
+	return true;
+}
+
+static bool read_index(PHYSFS_File *const fp, demo_index &idx, const uint32_t expected_size, const uint32_t expected_hash)
+{
+	uint32_t id, version, num_frames, num_keyframes;
+	if (!PHYSFS_readULE32(fp, &id) || id != DEMO_INDEX_ID ||
+		!PHYSFS_readULE32(fp, &version) || version != DEMO_INDEX_VERSION ||
+		!PHYSFS_readULE32(fp, &idx.demo_size) || idx.demo_size != expected_size ||
+		!PHYSFS_readULE32(fp, &idx.demo_hash) || idx.demo_hash != expected_hash ||
+		!PHYSFS_readULE32(fp, &num_frames) ||
+		!PHYSFS_readULE32(fp, &num_keyframes))
+		return false;
+	//every frame has at least its header, so a demo has no more frames than that
+	if (num_frames > idx.demo_size / 11 + 1 || num_keyframes > num_frames)
+		return false;
+	idx.frames.resize(num_frames);
+	range_for (auto &f, idx.frames)
+		if (!PHYSFS_readULE32(fp, &f.offset) || !PHYSFS_readSLE32(fp, &f.time) || !read_s8(fp, f.level) || f.offset > idx.demo_size)
+			return false;
+	idx.keyframes.resize(num_keyframes);
+	range_for (auto &k, idx.keyframes)
+		if (!read_keyframe(fp, k) || k.frame >= num_frames)
+			return false;
+	return true;
+}
+
+bool demo_index::read(const char *const filename, const uint32_t expected_size, const uint32_t expected_hash)
+{
+	clear();
+	auto fp = PHYSFSX_openReadBuffered(filename);
+	if (!fp)
+		return false;
+	if (read_index(fp, *this, expected_size, expected_hash))
+		return true;
+	clear();
+	return false;
+}
+
+bool demo_index::write(const char *const filename) const
+{
+	auto fp = PHYSFSX_openWriteBuffered(filename);
+	if (!fp)
+		return false;
+	bool ok = PHYSFS_writeULE32(fp, DEMO_INDEX_ID) &&
+		PHYSFS_writeULE32(fp, DEMO_INDEX_VERSION) &&
+		PHYSFS_writeULE32(fp, demo_size) &&
+		PHYSFS_writeULE32(fp, demo_hash) &&
+		PHYSFS_writeULE32(fp, frames.size()) &&
+		PHYSFS_writeULE32(fp, keyframes.size());
+	for (auto i = frames.begin(); ok && i != frames.end(); ++i)
+		ok = PHYSFS_writeULE32(fp, i->offset) && PHYSFS_writeSLE32(fp, i->time) && PHYSFSX_writeU8(fp, i->level);
+	for (auto i = keyframes.begin(); ok && i != keyframes.end(); ++i)
+		ok = write_keyframe(fp, *i);
+	if (!fp.close() || !ok)
+	{
+		con_printf(CON_URGENT, "Failed to write demo index %s", filename);
+		PHYSFS_delete(filename);
+		return false;
+	}
+	return true;
+}
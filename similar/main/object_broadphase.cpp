@@ -0,0 +1,71 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Segment and object neighbourhood queries.
+ *
+ */
+
+#include <algorithm>
+#include "vecmat.h"
+#include "segment.h"
+#include "gameseg.h"
+#include "object.h"
+#include "object_broadphase.h"
+#include "segiter.h"
+
+#include "compiler-range_for.h"
+
+/* Shared by every walk in this file.  None of them can start another
+ * walk while running.
+ */
+static visited_segment_generation_t Visit_marks;
+
+//whether some point of the bounding sphere of seg is within radius of pos
+static bool segment_within_radius(const vcsegptridx_t seg, const vms_vector &pos, const fix radius)
+{
+	const auto &&b = get_segment_bounding_sphere(seg);
+	const uint64_t reach = static_cast<int64_t>(b.radius) + radius;
+	return static_cast<uint64_t>(vm_vec_dist2(b.center, pos).d2) <= reach * reach;
+}
+
+void find_segments_within_radius(std::vector<segnum_t> &result, const vcsegptridx_t start, const vms_vector &pos, const fix radius)
+{
+	Visit_marks.next_generation();
+	auto qi = result.size();
+	Visit_marks.mark(start);
+	result.emplace_back(start);
+	for (; qi < result.size(); ++qi)
+	{
+		range_for (const auto child, vcsegptr(result[qi])->children)
+		{
+			if (!IS_CHILD(child) || !Visit_marks.mark(child))
+				continue;
+			if (!segment_within_radius(vcsegptridx(child), pos, radius))
+				continue;
+			result.emplace_back(child);
+		}
+	}
+}
+
+void gather_objects_in_segments(std::vector<objnum_t> &result, const std::vector<segnum_t> &segments)
+{
+	result.clear();
+	range_for (const auto s, segments)
+		range_for (const auto objp, objects_in(*vcsegptr(s)))
+			result.emplace_back(objp);
+	std::sort(result.begin(), result.end());
+}
+
+void find_objects_within_radius(std::vector<objnum_t> &result, const vcsegptridx_t start, const vms_vector &pos, const fix radius)
+{
+	static std::vector<segnum_t> segments;
+	segments.clear();
+	find_segments_within_radius(segments, start, pos, radius);
+	gather_objects_in_segments(result, segments);
+}
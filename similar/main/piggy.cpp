@@ -40,6 +40,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "hash.h"
 #include "common/2d/bitmap.h"
 #include "args.h"
+#ifdef USE_SDLMIXER
+#include "digi_mixer.h"
+#endif
 #include "palette.h"
 #include "gamefont.h"
 #include "gamepal.h"
@@ -56,6 +59,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "newmenu.h"
 #include "makesig.h"
 #include "console.h"
+#ifndef OGL
+#include "texmap.h"
+#endif
 #include "compiler-range_for.h"
 #include "compiler-make_unique.h"
 #include "compiler-static_assert.h"
@@ -140,10 +146,13 @@ static array<uint16_t, MAX_BITMAP_FILES> GameBitmapXlat;
 #define PIGGY_BUFFER_SIZE (2400*1024)
 #endif
 #define PIGGY_SMALL_BUFFER_SIZE (1400*1024)		// size of buffer when GameArg.SysLowMem is set
+#define PIGGY_MAPPED_READ_BUFFER (64*1024)		// PhysFS buffer for Piggy_fp when the pig is mapped
 
 int piggy_page_flushed = 0;
 
 static RAIIPHYSFS_File Piggy_fp;
+//The pig which Piggy_fp reads, if it is a plain file which could be mapped.
+static PHYSFSX_mapped_file Piggy_map;
 
 ubyte bogus_bitmap_initialized=0;
 array<uint8_t, 64 * 64> bogus_data;
@@ -386,8 +395,102 @@ int piggy_find_sound(const char *name)
 	return i;
 }
 
+static bool piggy_bitmap_is_mapped(const grs_bitmap &bm)
+{
+	const auto d = bm.get_bitmap_data();
+	return Piggy_map && d >= Piggy_map.data() && d < Piggy_map.data() + Piggy_map.size();
+}
+
+/* Pigs whose colors are swapped as bitmaps are paged in cannot be
+ * used in place, so they are read into the bitmap cache instead.
+ */
+static bool piggy_needs_color_swap()
+{
+#if defined(DXX_BUILD_DESCENT_I)
+	//the cache also holds RLE sizes in native byte order
+	return MacPig || words_bigendian;
+#elif defined(DXX_BUILD_DESCENT_II)
+#ifndef MACDATA
+	switch (PHYSFS_fileLength(Piggy_fp)) {
+	default:
+		return GameArg.EdiMacData;
+	case MAC_ALIEN1_PIGSIZE:
+	case MAC_ALIEN2_PIGSIZE:
+	case MAC_FIRE_PIGSIZE:
+	case MAC_GROUPA_PIGSIZE:
+	case MAC_ICE_PIGSIZE:
+	case MAC_WATER_PIGSIZE:
+		return true;
+	}
+#else
+	return false;
+#endif
+#endif
+}
+
+//Map the pig which was just opened as Piggy_fp, so bitmaps can be paged in without copying.
+static void piggy_map_pigfile(const char *filename)
+{
+	if (piggy_needs_color_swap())
+		return;
+	auto m = PHYSFSX_mapRead(filename);
+	if (!m || m.size() != static_cast<std::size_t>(PHYSFS_fileLength(Piggy_fp)))
+		return;
+	Piggy_map = std::move(m);
+	//only headers and sounds are read through PhysFS now
+	PHYSFS_setBuffer(Piggy_fp, PIGGY_MAPPED_READ_BUFFER);
+	con_printf(CON_VERBOSE, "Paging bitmaps directly from %s", filename);
+}
+
+static void piggy_unmap_pigfile()
+{
+	if (!Piggy_map)
+		return;
+#ifndef OGL
+	tmap_batch_flush();
+#endif
+	range_for (auto &bm, partial_range(GameBitmaps, static_cast<unsigned>(Num_bitmap_files)))
+		if (piggy_bitmap_is_mapped(bm))
+		{
+			bm.bm_flags = BM_FLAG_PAGED_OUT;
+#if defined(DXX_BUILD_DESCENT_I)
+			gr_set_bitmap_data(bm, Piggy_bitmap_cache_data);
+#elif defined(DXX_BUILD_DESCENT_II)
+			gr_set_bitmap_data(bm, NULL);
+#endif
+		}
+	Piggy_map.reset();
+}
+
+/* Point bmp straight into the mapped pig, which holds each bitmap just
+ * as the bitmap cache would.  Returns false if the pig is not mapped, or
+ * the bitmap runs past its end.
+ */
+static bool piggy_bitmap_map_in(grs_bitmap &bmp, const unsigned i)
+{
+	if (!Piggy_map)
+		return false;
+	const std::size_t offset = GameBitmapOffset[i];
+	const auto size = Piggy_map.size();
+	if (offset >= size)
+		return false;
+	const auto data = Piggy_map.data() + offset;
+	const auto flags = GameBitmapFlags[i];
+	std::size_t length;
+	if (flags & BM_FLAG_RLE)
+		length = size - offset < 4 ? SIZE_MAX : GET_INTEL_INT(data);
+	else
+		length = bmp.bm_w * bmp.bm_h;
+	if (length > size - offset)
+		return false;
+	gr_set_bitmap_flags(bmp, flags);
+	gr_set_bitmap_data(bmp, data);
+	return true;
+}
+
 static void piggy_close_file()
 {
+	piggy_unmap_pigfile();
 	if (Piggy_fp)
 	{
 		Piggy_fp.reset();
@@ -492,6 +595,7 @@ int properties_init()
 	}
 	
 	HiresGFXAvailable = MacPig;	// for now at least
+	piggy_map_pigfile(DEFAULT_PIGFILE_REGISTERED);
 
 	if (PCSharePig)
 		retval = PIGGY_PC_SHAREWARE;	// run gamedata_read_tbl in shareware mode
@@ -620,11 +724,12 @@ void piggy_init_pigfile(const char *filename)
 
 	piggy_close_file();             //close old pig if still open
 
+	const char *opened = filename;
 	Piggy_fp = PHYSFSX_openReadBuffered(filename);
 	
 	//try pigfile for shareware
 	if (!Piggy_fp)
-		Piggy_fp = PHYSFSX_openReadBuffered(DEFAULT_PIGFILE_SHAREWARE);
+		Piggy_fp = PHYSFSX_openReadBuffered(opened = DEFAULT_PIGFILE_SHAREWARE);
 
 	if (Piggy_fp) {                         //make sure pig is valid type file & is up-to-date
 		int pig_id,pig_version;
@@ -647,6 +752,7 @@ void piggy_init_pigfile(const char *filename)
 	}
 
 	strncpy(Current_pigfile,filename,sizeof(Current_pigfile));
+	piggy_map_pigfile(opened);
 
 	N_bitmaps = PHYSFSX_readInt(Piggy_fp);
 
@@ -727,11 +833,12 @@ void piggy_new_pigfile(char *pigname)
 
 	strncpy(Current_pigfile,pigname,sizeof(Current_pigfile));
 
+	const char *opened = pigname;
 	Piggy_fp = PHYSFSX_openReadBuffered(pigname);
 
 	//try pigfile for shareware
 	if (!Piggy_fp)
-		Piggy_fp = PHYSFSX_openReadBuffered(DEFAULT_PIGFILE_SHAREWARE);
+		Piggy_fp = PHYSFSX_openReadBuffered(opened = DEFAULT_PIGFILE_SHAREWARE);
 	
 	if (Piggy_fp) {  //make sure pig is valid type file & is up-to-date
 		int pig_id,pig_version;
@@ -750,6 +857,7 @@ void piggy_new_pigfile(char *pigname)
 #endif
 
 	if (Piggy_fp) {
+		piggy_map_pigfile(opened);
 
 		N_bitmaps = PHYSFSX_readInt(Piggy_fp);
 
@@ -1295,6 +1403,13 @@ void piggy_bitmap_page_in( bitmap_index bitmap )
 	if ( bmp->bm_flags & BM_FLAG_PAGED_OUT ) {
 		pause_game_world_time p;
 
+		if (piggy_bitmap_map_in(*bmp, i))
+		{
+			compute_average_rgb(bmp, bmp->avg_color_rgb);
+			if ( GameArg.SysLowMem && org_i != i )
+				GameBitmaps[org_i] = GameBitmaps[i];
+			return;
+		}
 	ReDoIt:
 		PHYSFSX_fseek( Piggy_fp, GameBitmapOffset[i], SEEK_SET );
 
@@ -1428,6 +1543,10 @@ void piggy_bitmap_page_out_all()
 {
 	int i;
 	
+#ifndef OGL
+	//queued polygons point into the cache which is about to be reused
+	tmap_batch_flush();
+#endif
 	Piggy_bitmap_cache_next = 0;
 
 	piggy_page_flushed++;
@@ -1437,6 +1556,9 @@ void piggy_bitmap_page_out_all()
 
 	for (i=0; i<Num_bitmap_files; i++ ) {
 		if ( GameBitmapOffset[i] > 0 ) {	// Don't page out bitmaps read from disk!!!
+			//bitmaps in the mapped pig stay valid until it is unmapped
+			if (piggy_bitmap_is_mapped(GameBitmaps[i]))
+				continue;
 			GameBitmaps[i].bm_flags = BM_FLAG_PAGED_OUT;
 #if defined(DXX_BUILD_DESCENT_I)
 			gr_set_bitmap_data (GameBitmaps[i], Piggy_bitmap_cache_data);
@@ -1578,6 +1700,10 @@ void piggy_close()
 	custom_close();
 #endif
 	piggy_close_file();
+#ifdef USE_SDLMIXER
+	if (!GameArg.SndDisableSdlMixer)
+		digi_mixer_preconvert_stop();
+#endif
 	BitmapBits.reset();
 	SoundBits.reset();
 	for (i = 0; i < Num_sound_files; i++)
@@ -82,6 +82,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define ControlInvulTimeStr "control_invul_time"
 #define PacketsPerSecStr "PacketsPerSec"
 #define NoFriendlyFireStr "NoFriendlyFire"
+#define PdataDeltaStr "PdataDelta"
 #define TrackerStr "Tracker"
 #define NGPVersionStr "ngp version"
 
@@ -1420,6 +1421,8 @@ void read_netgame_profile(netgame_info *ng)
 			convert_integer(ng->PacketsPerSec, value);
 		else if (cmp(lb, eq, NoFriendlyFireStr))
 			convert_integer(ng->NoFriendlyFire, value);
+		else if (cmp(lb, eq, PdataDeltaStr))
+			convert_integer(ng->PdataDelta, value);
 #ifdef USE_TRACKER
 		else if (cmp(lb, eq, TrackerStr))
 			convert_integer(ng->Tracker, value);
@@ -1458,6 +1461,7 @@ void write_netgame_profile(netgame_info *ng)
 	PHYSFSX_printf(file, ControlInvulTimeStr "=%i\n", ng->control_invul_time);
 	PHYSFSX_printf(file, PacketsPerSecStr "=%i\n", ng->PacketsPerSec);
 	PHYSFSX_printf(file, NoFriendlyFireStr "=%i\n", ng->NoFriendlyFire);
+	PHYSFSX_printf(file, PdataDeltaStr "=%i\n", ng->PdataDelta);
 #ifdef USE_TRACKER
 	PHYSFSX_printf(file, TrackerStr "=%i\n", ng->Tracker);
 #else
@@ -65,6 +65,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "ogl_init.h"
 #endif
 #include "args.h"
+#include "perf_timer.h"
+#include "segment_pvs.h"
 
 #include "compiler-integer_sequence.h"
 #include "compiler-range_for.h"
@@ -111,7 +113,7 @@ int	Bottom_bitmap_num = 9;
 #endif
 
 //Global vars for window clip test
-int Window_clip_left,Window_clip_top,Window_clip_right,Window_clip_bot;
+thread_local int Window_clip_left,Window_clip_top,Window_clip_right,Window_clip_bot;
 
 #ifdef EDITOR
 int _search_mode = 0;			//true if looking for curseg,side,face
@@ -1048,11 +1050,36 @@ static void sort_seg_children(const vcsegptridx_t seg, const partial_range_t<sor
 
 static void add_obj_to_seglist(render_state_t &rstate, objnum_t objnum, segnum_t segnum)
 {
-	auto p = rstate.render_seg_map.emplace(segnum, render_state_t::per_segment_state_t{});
-	auto &o = p.first->second.objects;
-	if (p.second)
-		o.reserve(16);
-	o.emplace_back(render_state_t::per_segment_state_t::distant_object{objnum});
+	auto &v = rstate.pending_objects;
+	if (v.size() == v.capacity())
+		++ rstate.heap_allocations;
+	v.emplace_back(render_state_t::pending_object{segnum, objnum});
+}
+
+//copy the pending (segment, object) pairs into object_arena so that
+//each segment's objects are contiguous, in the order they were added
+static void gather_segment_object_lists(render_state_t &rstate)
+{
+	range_for (const auto &p, rstate.pending_objects)
+		++ rstate.render_seg_map[p.segnum].num_objects;
+	uint_fast32_t n_objects = 0;
+	range_for (const auto segnum, partial_range(rstate.Render_list, rstate.N_render_segs))
+	{
+		if (segnum == segment_none)
+			continue;
+		auto &srsm = rstate.render_seg_map[segnum];
+		srsm.first_object = n_objects;
+		n_objects += exchange(srsm.num_objects, 0);
+	}
+	auto &arena = rstate.object_arena;
+	if (n_objects > arena.capacity())
+		++ rstate.heap_allocations;
+	arena.resize(n_objects);
+	range_for (const auto &p, rstate.pending_objects)
+	{
+		auto &srsm = rstate.render_seg_map[p.segnum];
+		arena[srsm.first_object + srsm.num_objects++].objnum = p.objnum;
+	}
 }
 
 namespace {
@@ -1072,9 +1099,9 @@ class render_compare_context_t
 public:
 	array_t::reference operator[](std::size_t i) { return a[i]; }
 	array_t::const_reference operator[](std::size_t i) const { return a[i]; }
-	render_compare_context_t(const render_state_t::per_segment_state_t &segstate)
+	render_compare_context_t(const render_state_t::object_range &objects)
 	{
-		range_for (const auto t, segstate.objects)
+		range_for (const auto t, objects)
 		{
 			const auto &&objp = vobjptr(t.objnum);
 			auto &e = (*this)[t.objnum];
@@ -1129,15 +1156,15 @@ bool render_compare_context_t::operator()(const distant_object &a, const distant
 
 }
 
-static void sort_segment_object_list(render_state_t::per_segment_state_t &segstate)
+static void sort_segment_object_list(const render_state_t::object_range &v)
 {
-	render_compare_context_t context(segstate);
-	auto &v = segstate.objects;
+	render_compare_context_t context(v);
 	std::sort(v.begin(), v.end(), std::cref(context));
 }
 
 static void build_object_lists(render_state_t &rstate)
 {
+	perf_scope perf(perf_subsystem::object_lists);
 	int nn;
 	const auto viewer = Viewer;
 	for (nn=0;nn < rstate.N_render_segs;nn++) {
@@ -1212,11 +1239,13 @@ static void build_object_lists(render_state_t &rstate)
 		}
 	}
 
+	gather_segment_object_lists(rstate);
+
 	//now that there's a list for each segment, sort the items in those lists
 	range_for (const auto segnum, partial_range(rstate.Render_list, rstate.N_render_segs))
 	{
 		if (segnum != segment_none) {
-			sort_segment_object_list(rstate.render_seg_map[segnum]);
+			sort_segment_object_list(rstate.objects(rstate.render_seg_map[segnum]));
 		}
 	}
 }
@@ -1231,6 +1260,7 @@ fix Zoom_factor=F1_0;
 //renders onto current canvas
 void render_frame(fix eye_offset, window_rendered_data &window)
 {
+	perf_scope perf(perf_subsystem::render);
 	if (Endlevel_sequence) {
 		render_endlevel_frame(eye_offset);
 		return;
@@ -1313,6 +1343,12 @@ void render_frame(fix eye_offset, window_rendered_data &window)
 }
 
 static unsigned first_terminal_seg;
+static render_state_t s_render_state;
+
+unsigned get_render_state_heap_allocations()
+{
+	return s_render_state.heap_allocations;
+}
 
 #if defined(DXX_BUILD_DESCENT_II)
 void update_rendered_data(window_rendered_data &window, const vobjptr_t viewer, int rear_view_flag)
@@ -1330,21 +1366,31 @@ static void build_segment_list(render_state_t &rstate, visited_twobit_array_t &v
 	int	lcnt,scnt,ecnt;
 	int	l;
 
-	rstate.render_pos.fill(-1);
-
 	#ifndef NDEBUG
 	visited2 = {};
 	#endif
 
 	lcnt = scnt = 0;
 
+	/* The PVS describes what can be seen from inside the start segment.
+	 * When the eye is elsewhere (endlevel, terrain, a viewer which has
+	 * left the mine) fall back to the unrestricted walk.
+	 */
+	auto pvs = segment_pvs_get(start_seg_num);
+	#ifdef EDITOR
+	if (EditorWindow)
+		pvs = {};
+	#endif
+	if (pvs && get_seg_masks(Viewer_eye, vcsegptr(start_seg_num), 0).centermask)
+		pvs = {};
+
 	rstate.Render_list[lcnt] = start_seg_num;
 	visited[start_seg_num]=1;
 	lcnt++;
 	ecnt = lcnt;
-	rstate.render_pos[start_seg_num] = 0;
 	{
 		auto &rsm_start_seg = rstate.render_seg_map[start_seg_num];
+		rsm_start_seg.render_pos = 0;
 		auto &rw = rsm_start_seg.render_window;
 		rw.left = rw.top = 0;
 		rw.right = grd_curcanv->cv_bitmap.bm_w-1;
@@ -1384,6 +1430,8 @@ static void build_segment_list(render_state_t &rstate, visited_twobit_array_t &v
 				auto wid = WALL_IS_DOORWAY(seg, c);
 				if (wid & WID_RENDPAST_FLAG)
 				{
+					if (pvs && !pvs[seg->children[c]])
+						continue;
 					if (auto codes_and = uor)
 					{
 						range_for (const auto i, Side_to_verts[c])
@@ -1426,7 +1474,8 @@ static void build_segment_list(render_state_t &rstate, visited_twobit_array_t &v
 							codes_and_2d &= code_window_point(_x,_y,check_w);
 						}
 						if (no_proj_flag || (!codes_and_3d && !codes_and_2d)) {	//maybe add this segment
-							auto rp = rstate.render_pos[ch];
+							auto &chrsm = rstate.render_seg_map[ch];
+							const auto rp = chrsm.render_pos;
 							rect nw;
 
 							if (no_proj_flag)
@@ -1454,7 +1503,7 @@ static void build_segment_list(render_state_t &rstate, visited_twobit_array_t &v
 
 									{
 										//no_render_flag[lcnt] = 1;
-										rstate.render_seg_map[ch].processed = false;		//force reprocess
+										chrsm.processed = false;		//force reprocess
 										rstate.Render_list[lcnt] = segment_none;
 										old_w = nw;		//get updated window
 										goto no_add;
@@ -1462,13 +1511,10 @@ static void build_segment_list(render_state_t &rstate, visited_twobit_array_t &v
 								}
 								else goto no_add;
 							}
-							rstate.render_pos[ch] = lcnt;
+							chrsm.render_pos = lcnt;
 							rstate.Render_list[lcnt] = ch;
-							{
-								auto &chrsm = rstate.render_seg_map[ch];
-								chrsm.Seg_depth = l;
-								chrsm.render_window = nw;
-							}
+							chrsm.Seg_depth = l;
+							chrsm.render_window = nw;
 							lcnt++;
 							if (lcnt >= MAX_RENDER_SEGS) {goto done_list;}
 							visited[ch] = 1;
@@ -1499,7 +1545,11 @@ done_list:
 void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &window)
 {
 	using std::advance;
-	render_state_t rstate;
+	/* Kept across frames so that the segment table and object arena
+	 * are reused instead of reallocated on every render.
+	 */
+	auto &rstate = s_render_state;
+	rstate.begin_frame();
 	#ifndef NDEBUG
 	object_rendered = {};
 	#endif
@@ -1592,6 +1642,9 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 		}
 	}
 #ifndef OGL
+	//search mode reads back pixels after drawing each face, so it cannot queue them
+	if (!_search_mode)
+		tmap_batch_begin();
 	range_for (const auto segnum, reversed_render_range)
 	{
 		// Interpolation_method = 0;
@@ -1612,7 +1665,8 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 
 			render_segment(vcsegptridx(segnum));
 			visited[segnum]=3;
-			if (srsm.objects.empty())
+			const auto &&objects = rstate.objects(srsm);
+			if (objects.empty())
 				continue;
 
 			{		//reset for objects
@@ -1624,7 +1678,7 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 			{
 				//int n_expl_objs=0,expl_objs[5],i;
 				const auto save_linear_depth = exchange(Max_linear_depth, Max_linear_depth_objects);
-				range_for (auto &v, srsm.objects)
+				range_for (auto &v, objects)
 				{
 					do_render_object(v.objnum, window);	// note link to above else
 				}
@@ -1633,6 +1687,7 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 
 		}
 	}
+	tmap_batch_end();
 #else
 	struct render_subrange : partial_range_t<std::reverse_iterator<segnum_t *>>
 	{
@@ -1686,7 +1741,7 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 #endif
 		{
 			Current_seg_depth = srsm.Seg_depth;
-			if (!srsm.objects.empty())
+			if (srsm.num_objects)
 				rr.record_object(iter);
 			//set global render window vars
 
@@ -1739,7 +1794,8 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 	range_for (const auto segnum, rr.reversed_object_render_range)
 	{
 		auto &srsm = rstate.render_seg_map[segnum];
-		if (srsm.objects.empty())
+		const auto &&objects = rstate.objects(srsm);
+		if (objects.empty())
 			continue;
 
 #if defined(DXX_BUILD_DESCENT_I)
@@ -1761,7 +1817,7 @@ void render_mine(segnum_t start_seg_num,fix eye_offset, window_rendered_data &wi
 
 			// render objects
 			{
-				range_for (auto &v, srsm.objects)
+				range_for (auto &v, objects)
 				{
 					do_render_object(v.objnum, window);	// note link to above else
 				}
@@ -0,0 +1,401 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Potentially visible set computation.
+ *
+ * For every segment, find the segments which could be seen by an eye
+ * anywhere inside it, assuming every connected side is open.  The walk
+ * from a segment follows one exit side at a time.  A side may be
+ * crossed after another only if a straight line could pass through
+ * both in order: some vertex of the later side must lie beyond the
+ * earlier side, and some vertex of the earlier side must lie in front
+ * of the later side.  Each crossing is checked against the side it
+ * came through and against the first exit side, which keeps the test
+ * conservative while making the result independent of the order in
+ * which the walk reaches a side.
+ *
+ * Rows are written to the cache directory so that a level only pays
+ * for the computation the first time it is played.  That computation
+ * runs on a worker thread, from a copy of the mine's portals, and the
+ * render walk goes unculled until it is done.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include "physfsx.h"
+#include "console.h"
+#include "segment.h"
+#include "gameseg.h"
+#include "byteutil.h"
+#include "makesig.h"
+#include "perf_timer.h"
+#include "segment_pvs.h"
+
+#include "compiler-make_unique.h"
+#include "compiler-range_for.h"
+#include "partial_range.h"
+
+#define PVS_CACHE_DIR	"cache/"
+#define PVS_FILE_ID	MAKE_SIG('S','V','P','D')
+static const unsigned PVS_FILE_VERSION = 1;
+/* Same as the tolerance used by get_seg_masks.  Points within this
+ * distance of a plane count as being on both sides of it.
+ */
+static const fix PVS_PLANE_TOLERANCE = 250;
+
+namespace {
+
+struct pvs_state
+{
+	unsigned num_segments;
+	std::size_t stride;
+	std::vector<uint8_t> bits;
+	void clear()
+	{
+		num_segments = 0;
+		stride = 0;
+		bits.clear();
+	}
+	uint8_t *row(const std::size_t s)
+	{
+		return &bits[s * stride];
+	}
+};
+
+struct portal_geometry
+{
+	array<vms_vector, 4> verts;
+	array<vms_vector, 2> normals;
+	vms_vector plane_point;
+	uint_fast32_t num_faces;
+};
+
+struct pvs_file_header
+{
+	uint32_t num_segments, num_vertices, vertex_hash, segments_checksum;
+};
+
+/* Everything the worker needs, copied from the mine so that the game
+ * may go on changing it, and what the worker reports back.
+ */
+struct pvs_job
+{
+	std::vector<portal_geometry> geometry;
+	std::vector<array<segnum_t, MAX_SIDES_PER_SEGMENT>> children;
+	array<char, PATH_MAX> filename;
+	pvs_file_header header;
+	perf_clock::duration elapsed;
+	bool written;
+};
+
+}
+
+static pvs_state Pvs;
+/* Pvs.bits belongs to the worker while Pvs_thread is running and
+ * Pvs_done is clear.  Pvs_ready is set once the game thread has seen
+ * Pvs_done and joined the worker.
+ */
+static std::unique_ptr<pvs_job> Pvs_job;
+static std::thread Pvs_thread;
+static std::atomic<bool> Pvs_done, Pvs_cancel;
+static bool Pvs_ready;
+
+static void set_bit(uint8_t *const row, const segnum_t s)
+{
+	row[s >> 3] |= 1 << (s & 7);
+}
+
+static bool test_bit(const uint8_t *const row, const segnum_t s)
+{
+	return row[s >> 3] & (1 << (s & 7));
+}
+
+static uint_fast32_t portal_index(const segnum_t segnum, const uint_fast32_t sidenum)
+{
+	return (segnum * MAX_SIDES_PER_SEGMENT) + sidenum;
+}
+
+static void build_portal_geometry(portal_geometry &g, const vcsegptridx_t seg, const uint_fast32_t sidenum)
+{
+	const auto &s = seg->sides[sidenum];
+	const auto v = create_abs_vertex_lists(seg, &s, sidenum);
+	const auto &vertex_list = v.second;
+	g.num_faces = v.first;
+	g.normals = s.normals;
+	//use the same plane point as get_seg_masks, which lies on both faces
+	const auto vertnum = (g.num_faces == 2)
+		? std::min(vertex_list[0], vertex_list[2])
+		: *std::min_element(vertex_list.begin(), std::next(vertex_list.begin(), 4));
+	g.plane_point = Vertices[vertnum];
+	const auto &sv = Side_to_verts[sidenum];
+	for (unsigned i = 0; i < 4; ++i)
+		g.verts[i] = Vertices[seg->verts[sv[i]]];
+}
+
+//side normals point into the segment, so "beyond" is the negative side
+static bool point_beyond(const portal_geometry &g, const vms_vector &p)
+{
+	range_for (auto &n, partial_range(g.normals, g.num_faces))
+		if (vm_dist_to_plane(p, n, g.plane_point) < PVS_PLANE_TOLERANCE)
+			return true;
+	return false;
+}
+
+static bool point_in_front(const portal_geometry &g, const vms_vector &p)
+{
+	range_for (auto &n, partial_range(g.normals, g.num_faces))
+		if (vm_dist_to_plane(p, n, g.plane_point) > -PVS_PLANE_TOLERANCE)
+			return true;
+	return false;
+}
+
+//can a line which crosses portal a go on to cross portal b?
+static bool portal_can_follow(const portal_geometry &a, const portal_geometry &b)
+{
+	const auto beyond_a = [&a](const vms_vector &p) { return point_beyond(a, p); };
+	if (std::none_of(b.verts.begin(), b.verts.end(), beyond_a))
+		return false;
+	const auto front_of_b = [&b](const vms_vector &p) { return point_in_front(b, p); };
+	return std::any_of(a.verts.begin(), a.verts.end(), front_of_b);
+}
+
+static uint32_t hash_vertices()
+{
+	uint32_t h = 2166136261u;
+	range_for (auto &v, partial_range(Vertices, Num_vertices))
+	{
+		for (const uint32_t c : {v.x, v.y, v.z})
+		{
+			h ^= c;
+			h *= 16777619u;
+		}
+	}
+	return h;
+}
+
+//Copy what compute_pvs needs from the mine.
+static void prepare_pvs_job(pvs_job &job)
+{
+	const auto num_segments = Pvs.num_segments;
+	job.geometry.resize(num_segments * MAX_SIDES_PER_SEGMENT);
+	job.children.resize(num_segments);
+	for (segnum_t seg = 0; seg < num_segments; ++seg)
+	{
+		const auto &&segp = vcsegptridx(seg);
+		job.children[seg] = segp->children;
+		for (uint_fast32_t sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; ++sidenum)
+			if (IS_CHILD(segp->children[sidenum]))
+				build_portal_geometry(job.geometry[portal_index(seg, sidenum)], segp, sidenum);
+	}
+}
+
+//Returns false if Pvs_cancel was set before the sets were complete.
+static bool compute_pvs(const pvs_job &job)
+{
+	const auto num_segments = Pvs.num_segments;
+	const auto &geometry = job.geometry;
+	const auto &children = job.children;
+	/* visited[p] == stamp when portal p has been reached through the
+	 * current first exit side.
+	 */
+	std::vector<uint32_t> visited(geometry.size());
+	uint32_t stamp = 0;
+	std::vector<uint_fast32_t> queue;
+	queue.reserve(geometry.size());
+	for (segnum_t source = 0; source < num_segments; ++source)
+	{
+		if (Pvs_cancel)
+			return false;
+		const auto row = Pvs.row(source);
+		set_bit(row, source);
+		const auto &source_children = children[source];
+		for (uint_fast32_t side0 = 0; side0 < MAX_SIDES_PER_SEGMENT; ++side0)
+		{
+			const auto child0 = source_children[side0];
+			if (!IS_CHILD(child0))
+				continue;
+			set_bit(row, child0);
+			const auto p0 = portal_index(source, side0);
+			const auto &g0 = geometry[p0];
+			++ stamp;
+			visited[p0] = stamp;
+			queue.clear();
+			queue.emplace_back(p0);
+			for (std::size_t qi = 0; qi < queue.size(); ++qi)
+			{
+				const auto pi = queue[qi];
+				const segnum_t from = pi / MAX_SIDES_PER_SEGMENT;
+				const auto &gi = geometry[pi];
+				const auto segnum = children[from][pi % MAX_SIDES_PER_SEGMENT];
+				const auto &seg_children = children[segnum];
+				for (uint_fast32_t sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; ++sidenum)
+				{
+					const auto child = seg_children[sidenum];
+					if (!IS_CHILD(child) || child == from)
+						continue;
+					const auto pj = portal_index(segnum, sidenum);
+					if (visited[pj] == stamp)
+						continue;
+					const auto &gj = geometry[pj];
+					if (!portal_can_follow(gi, gj))
+						continue;
+					if (pi != p0 && !portal_can_follow(g0, gj))
+						continue;
+					visited[pj] = stamp;
+					set_bit(row, child);
+					queue.emplace_back(pj);
+				}
+			}
+		}
+	}
+	/* Objects may poke through a portal into a segment which cannot
+	 * itself be seen, so grow each set by one segment.
+	 */
+	std::vector<uint8_t> original(Pvs.stride);
+	for (segnum_t source = 0; source < num_segments; ++source)
+	{
+		const auto row = Pvs.row(source);
+		std::copy_n(row, Pvs.stride, original.begin());
+		for (segnum_t s = 0; s < num_segments; ++s)
+		{
+			if (!test_bit(original.data(), s))
+				continue;
+			range_for (const auto child, children[s])
+				if (IS_CHILD(child))
+					set_bit(row, child);
+		}
+	}
+	return true;
+}
+
+static void get_cache_filename(array<char, PATH_MAX> &filename, const char *const level_name, const uint16_t segments_checksum)
+{
+	snprintf(filename.data(), filename.size(), PVS_CACHE_DIR "%s-%04x.pvs", level_name, segments_checksum);
+}
+
+static bool read_pvs_cache(const char *const filename, const pvs_file_header &expected)
+{
+	auto fp = PHYSFSX_openReadBuffered(filename);
+	if (!fp)
+		return false;
+	uint32_t id, version;
+	pvs_file_header h;
+	if (!PHYSFS_readULE32(fp, &id) || id != PVS_FILE_ID ||
+		!PHYSFS_readULE32(fp, &version) || version != PVS_FILE_VERSION ||
+		!PHYSFS_readULE32(fp, &h.num_segments) ||
+		!PHYSFS_readULE32(fp, &h.num_vertices) ||
+		!PHYSFS_readULE32(fp, &h.vertex_hash) ||
+		!PHYSFS_readULE32(fp, &h.segments_checksum))
+		return false;
+	if (h.num_segments != expected.num_segments ||
+		h.num_vertices != expected.num_vertices ||
+		h.vertex_hash != expected.vertex_hash ||
+		h.segments_checksum != expected.segments_checksum)
+		return false;
+	return PHYSFS_read(fp, Pvs.bits.data(), 1, Pvs.bits.size()) == static_cast<PHYSFS_sint64>(Pvs.bits.size());
+}
+
+static bool write_pvs_cache(const char *const filename, const pvs_file_header &h)
+{
+	PHYSFS_mkdir(PVS_CACHE_DIR);	//try making directory
+	auto fp = PHYSFSX_openWriteBuffered(filename);
+	if (!fp)
+		return false;
+	const bool ok = PHYSFS_writeULE32(fp, PVS_FILE_ID) &&
+		PHYSFS_writeULE32(fp, PVS_FILE_VERSION) &&
+		PHYSFS_writeULE32(fp, h.num_segments) &&
+		PHYSFS_writeULE32(fp, h.num_vertices) &&
+		PHYSFS_writeULE32(fp, h.vertex_hash) &&
+		PHYSFS_writeULE32(fp, h.segments_checksum) &&
+		PHYSFS_write(fp, Pvs.bits.data(), 1, Pvs.bits.size()) == static_cast<PHYSFS_sint64>(Pvs.bits.size());
+	if (!fp.close() || !ok)
+	{
+		PHYSFS_delete(filename);
+		return false;
+	}
+	return true;
+}
+
+static void segment_pvs_worker(pvs_job &job)
+{
+	const auto start = perf_clock::now();
+	if (!compute_pvs(job))
+		return;
+	job.elapsed = perf_clock::now() - start;
+	job.written = write_pvs_cache(job.filename.data(), job.header);
+	Pvs_done = true;
+}
+
+//	Join a worker which has finished, and start using its sets.
+static void segment_pvs_finish()
+{
+	Pvs_thread.join();
+	Pvs_done = false;
+	Pvs_ready = true;
+	const auto job = std::move(Pvs_job);
+	con_printf(CON_VERBOSE, "Computed visibility sets for %u segments in %u ms", Pvs.num_segments, static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(job->elapsed).count()));
+	if (!job->written)
+		con_printf(CON_URGENT, "Failed to write visibility cache %s", job->filename.data());
+}
+
+void segment_pvs_invalidate()
+{
+	if (Pvs_thread.joinable())
+	{
+		Pvs_cancel = true;
+		Pvs_thread.join();
+		Pvs_cancel = false;
+		Pvs_done = false;
+		Pvs_job.reset();
+	}
+	Pvs_ready = false;
+	Pvs.clear();
+}
+
+void segment_pvs_load_level(const char *const level_name, const uint16_t segments_checksum)
+{
+	segment_pvs_invalidate();
+	const unsigned num_segments = Highest_segment_index + 1;
+	Pvs.num_segments = num_segments;
+	Pvs.stride = (num_segments + 7) / 8;
+	Pvs.bits.assign(num_segments * Pvs.stride, 0);
+	auto job = make_unique<pvs_job>();
+	job->header = {num_segments, Num_vertices, hash_vertices(), segments_checksum};
+	get_cache_filename(job->filename, level_name, segments_checksum);
+	const auto start = perf_clock::now();
+	if (read_pvs_cache(job->filename.data(), job->header))
+	{
+		Pvs_ready = true;
+		con_printf(CON_VERBOSE, "Loaded visibility sets for %u segments from %s in %u ms", num_segments, job->filename.data(), static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(perf_clock::now() - start).count()));
+		return;
+	}
+	std::fill(Pvs.bits.begin(), Pvs.bits.end(), 0);
+	prepare_pvs_job(*job);
+	con_printf(CON_VERBOSE, "Prepared visibility sets for %u segments in %u ms; computing them in the background", num_segments, static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(perf_clock::now() - start).count()));
+	Pvs_job = std::move(job);
+	Pvs_thread = std::thread(segment_pvs_worker, std::ref(*Pvs_job));
+}
+
+segment_pvs_row segment_pvs_get(const segnum_t segnum)
+{
+	if (!Pvs_ready)
+	{
+		if (!Pvs_done)
+			return {};
+		segment_pvs_finish();
+	}
+	if (segnum >= Pvs.num_segments || Pvs.num_segments != static_cast<unsigned>(Highest_segment_index + 1))
+		return {};
+	return segment_pvs_row(Pvs.row(segnum));
+}
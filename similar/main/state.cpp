@@ -27,6 +27,10 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include "pstypes.h"
 #include "inferno.h"
@@ -73,11 +77,15 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "state.h"
 #include "multi.h"
 #include "gr.h"
+#include "console.h"
 #ifdef OGL
 #include "ogl_init.h"
 #endif
 
+#include "perf_timer.h"
+
 #include "compiler-exchange.h"
+#include "compiler-make_unique.h"
 #include "compiler-range_for.h"
 #include "highest_valid.h"
 #include "partial_range.h"
@@ -659,6 +667,7 @@ static int state_get_savegame_filename(char * fname, char * dsc, const char * ca
 	char id[5], dummy_callsign[CALLSIGN_LEN+1];
 	int valid;
 
+	state_save_wait();
 	nsaves=0;
 	nm_set_item_text(m[0], "\n\n\n\n");
 	for (i=0;i<NUM_SAVES; i++ )	{
@@ -867,6 +876,7 @@ int state_save_all(const secret_save secret, const blind_save blind_save)
 
 			snprintf(temp_fname, sizeof(temp_fname), PLAYER_DIRECTORY_STRING("%csecret.sgc"), fc);
 
+			state_save_wait();
 			if (PHYSFSX_exists(temp_fname,0))
 			{
 				if (!PHYSFS_delete(temp_fname))
@@ -885,6 +895,9 @@ int state_save_all(const secret_save secret, const blind_save blind_save)
 	}
 
 	rval = state_save_all_sub(filename, desc);
+	//	The secret level code looks for these files as soon as this returns.
+	if (secret != secret_save::none)
+		state_save_wait();
 
 	if (rval && secret == secret_save::none)
 		HUD_init_message_literal(HM_DEFAULT, "Game saved");
@@ -893,6 +906,99 @@ int state_save_all(const secret_save secret, const blind_save blind_save)
 }
 
 
+namespace {
+
+/* What is left of a save once the game state has been written into the
+ * file's buffer: quantizing the thumbnail, writing the buffer out, and
+ * putting the file in place of the old one.
+ */
+struct state_save_job
+{
+	RAIIPHYSFS_File fp;
+	array<char, PATH_MAX> filename, temp_filename;
+#if defined(OGL)
+	//where the thumbnail goes, and what was read back for it
+	PHYSFS_sint64 thumbnail_offset;
+	std::unique_ptr<uint8_t[]> thumbnail_rgba;
+	palette_array_t palette;
+#endif
+	bool ok;
+	//bytes serialized on the game thread
+	PHYSFS_sint64 size;
+	perf_clock::duration thumbnail_elapsed, write_elapsed, rename_elapsed;
+};
+
+}
+
+static std::unique_ptr<state_save_job> State_save_job;
+static std::thread State_save_thread;
+static std::atomic<bool> State_save_done;
+
+static void state_save_finish(state_save_job &job)
+{
+	auto start = perf_clock::now();
+	bool ok = true;
+#if defined(OGL)
+	array<uint8_t, THUMBNAIL_W * THUMBNAIL_H> quantized, thumbnail;
+	gr_find_closest_colors(job.palette, job.thumbnail_rgba.get(), quantized.size(), 4, quantized.data());
+	//GL reads the rows bottom up
+	for (unsigned y = 0; y < THUMBNAIL_H; y++)
+		std::copy_n(&quantized[THUMBNAIL_W * (THUMBNAIL_H - 1 - y)], THUMBNAIL_W, &thumbnail[THUMBNAIL_W * y]);
+	ok = PHYSFS_seek(job.fp, job.thumbnail_offset) &&
+		PHYSFS_write(job.fp, thumbnail.data(), thumbnail.size(), 1) == 1;
+#endif
+	auto now = perf_clock::now();
+	job.thumbnail_elapsed = now - start;
+	start = now;
+	ok = job.fp.close() && ok;
+	now = perf_clock::now();
+	job.write_elapsed = now - start;
+	start = now;
+	if (ok)
+	{
+		//	rename replaces the old save at once where it can; elsewhere
+		//	it will not replace a file, so remove the old one first.
+		if (!PHYSFSX_rename(job.temp_filename.data(), job.filename.data()))
+		{
+			PHYSFS_delete(job.filename.data());
+			ok = PHYSFSX_rename(job.temp_filename.data(), job.filename.data());
+		}
+	}
+	else
+		PHYSFS_delete(job.temp_filename.data());
+	job.ok = ok;
+	job.rename_elapsed = perf_clock::now() - start;
+	State_save_done = true;
+}
+
+//	Wait for a save still being written, and report how it went.
+void state_save_wait()
+{
+	if (!State_save_thread.joinable())
+		return;
+	const bool blocked = !State_save_done;
+	const auto start = perf_clock::now();
+	State_save_thread.join();
+	const auto waited = perf_clock::now() - start;
+	State_save_done = false;
+	const auto job = std::move(State_save_job);
+	const auto us = [](const perf_clock::duration d) {
+		return static_cast<unsigned>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+	};
+	//	Before the worker, the game thread did all three steps itself.
+	con_printf(CON_VERBOSE, "Savegame %s: %u bytes; thumbnail %u us, write %u us, rename %u us on the save thread", job->filename.data(), static_cast<unsigned>(job->size), us(job->thumbnail_elapsed), us(job->write_elapsed), us(job->rename_elapsed));
+	if (blocked)
+		con_printf(CON_VERBOSE, "Game thread waited %u us for the savegame", us(waited));
+	if (!job->ok)
+		nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
+}
+
+void state_save_poll()
+{
+	if (State_save_done)
+		state_save_wait();
+}
+
 int state_save_all_sub(const char *filename, const char *desc)
 {
 	int i;
@@ -904,7 +1010,15 @@ int state_save_all_sub(const char *filename, const char *desc)
 		Int3();
 	#endif
 
-	auto fp = PHYSFSX_openWriteBuffered(filename);
+	state_save_wait();
+	const auto start = perf_clock::now();
+	auto job = make_unique<state_save_job>();
+	snprintf(job->filename.data(), job->filename.size(), "%s", filename);
+	snprintf(job->temp_filename.data(), job->temp_filename.size(), "%s.tmp", filename);
+	//	Everything below is written into the buffer, which is much larger
+	//	than a save; the disk is not touched until state_save_finish.
+	job->fp = PHYSFSX_openWriteBuffered(job->temp_filename.data());
+	auto &fp = job->fp;
 	if ( !fp ) {
 		nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
 		return 0;
@@ -941,26 +1055,21 @@ int state_save_all_sub(const char *filename, const char *desc)
 		render_frame(0);
 
 #if defined(OGL)
-		RAIIdmem<uint8_t[]> buf;
-		MALLOC(buf, uint8_t[], THUMBNAIL_W * THUMBNAIL_H * 4);
+		job->thumbnail_rgba = make_unique<uint8_t[]>(THUMBNAIL_W * THUMBNAIL_H * 4);
 #ifndef OGLES
 		GLint gl_draw_buffer;
  		glGetIntegerv(GL_DRAW_BUFFER, &gl_draw_buffer);
  		glReadBuffer(gl_draw_buffer);
 #endif
-		glReadPixels(0, SHEIGHT - THUMBNAIL_H, THUMBNAIL_W, THUMBNAIL_H, GL_RGBA, GL_UNSIGNED_BYTE, buf.get());
-		int k;
-		k = THUMBNAIL_H;
-		for (i = 0; i < THUMBNAIL_W * THUMBNAIL_H; i++) {
-			int j;
-			if (!(j = i % THUMBNAIL_W))
-				k--;
-			cnv->cv_bitmap.get_bitmap_data()[THUMBNAIL_W * k + j] =
-				gr_find_closest_color(buf[4*i]/4, buf[4*i+1]/4, buf[4*i+2]/4);
-		}
-#endif
-
+		glReadPixels(0, SHEIGHT - THUMBNAIL_H, THUMBNAIL_W, THUMBNAIL_H, GL_RGBA, GL_UNSIGNED_BYTE, job->thumbnail_rgba.get());
+		//	Quantized by state_save_finish; leave room for it.
+		job->palette = gr_palette;
+		job->thumbnail_offset = PHYSFS_tell(fp);
+		const array<uint8_t, THUMBNAIL_W * THUMBNAIL_H> blank_thumbnail{};
+		PHYSFS_write(fp, blank_thumbnail.data(), blank_thumbnail.size(), 1);
+#else
 		PHYSFS_write(fp, cnv->cv_bitmap.bm_data, THUMBNAIL_W * THUMBNAIL_H, 1);
+#endif
 
 		gr_set_current_canvas(cnv_save);
 #if defined(DXX_BUILD_DESCENT_II)
@@ -1146,7 +1255,11 @@ int state_save_all_sub(const char *filename, const char *desc)
 
 	range_for (int m, MarkerObject)
 		PHYSFS_write(fp, &m, sizeof(m), 1);
-	PHYSFS_seek(fp, PHYSFS_tell(fp) + (NUM_MARKERS)*(CALLSIGN_LEN+1)); // PHYSFS_write(fp, MarkerOwner, sizeof(MarkerOwner), 1); MarkerOwner is obsolete
+	{
+		// MarkerOwner is obsolete.  Seeking past it would flush the buffer here.
+		const array<char, NUM_MARKERS * (CALLSIGN_LEN + 1)> marker_owner{};
+		PHYSFS_write(fp, marker_owner.data(), marker_owner.size(), 1);
+	}
 	range_for (auto &i, MarkerMessage)
 		PHYSFS_write(fp, i.data(), i.size(), 1);
 
@@ -1203,6 +1316,10 @@ int state_save_all_sub(const char *filename, const char *desc)
 		PHYSFS_write(fp, &Netgame.numconnected, sizeof(ubyte), 1);
 		PHYSFS_write(fp, &Netgame.level_time, sizeof(int), 1);
 	}
+	con_printf(CON_VERBOSE, "Game state saved in %u us on the game thread", static_cast<unsigned>(std::chrono::duration_cast<std::chrono::microseconds>(perf_clock::now() - start).count()));
+	job->size = PHYSFS_tell(fp);
+	State_save_job = std::move(job);
+	State_save_thread = std::thread(state_save_finish, std::ref(*State_save_job));
 	return 1;
 }
 
@@ -1333,6 +1450,7 @@ int state_restore_all_sub(const char *filename, const secret_restore secret)
 		Int3();
 	#endif
 
+	state_save_wait();
 	auto fp = PHYSFSX_openReadBuffered(filename);
 	if ( !fp ) return 0;
 
@@ -1760,6 +1878,7 @@ int state_restore_all_sub(const char *filename, const secret_restore secret)
 			segp->sides[j].tmap_num2 = TempTmapNum2[i][j];
 		}
 	}
+	flush_fcd_cache();
 
 // Read Coop Info
 	if (Game_mode & GM_MULTI_COOP)
@@ -1873,6 +1992,7 @@ int state_get_game_id(const char *filename)
 	if (!(Game_mode & GM_MULTI_COOP))
 		return 0;
 
+	state_save_wait();
 	auto fp = PHYSFSX_openReadBuffered(filename);
 	if ( !fp ) return 0;
 
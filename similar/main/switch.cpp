@@ -278,7 +278,7 @@ static int do_change_walls(uint8_t trigger_num)
 						Walls[csegp->sides[cside].wall_num].type = new_wall_type;
 					break;
 			}
-
+			flush_fcd_cache();
 
 			kill_stuck_objects(segp->sides[side].wall_num);
 			if (cside > -1 && csegp->sides[cside].wall_num != wall_none)
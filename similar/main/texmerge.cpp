@@ -24,46 +24,222 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
 
 
+#include <algorithm>
+#include <vector>
 #include "gr.h"
 #include "dxxerror.h"
 #include "game.h"
 #include "textures.h"
 #include "rle.h"
-#include "timer.h"
 #include "piggy.h"
 #include "texmerge.h"
-#include "piggy.h"
 
 #include "compiler-range_for.h"
-#include "partial_range.h"
 
 #ifdef OGL
 #include "ogl_init.h"
-#define MAX_NUM_CACHE_BITMAPS 200
 #else
-#define MAX_NUM_CACHE_BITMAPS 50
+#include "texmap.h"
 #endif
 
-//static grs_bitmap * cache_bitmaps[MAX_NUM_CACHE_BITMAPS];                     
-
 namespace {
 
+struct texmerge_key
+{
+	const grs_bitmap *bottom_bmp, *top_bmp;
+	int orient;
+	bool operator==(const texmerge_key &rhs) const
+	{
+		return bottom_bmp == rhs.bottom_bmp && top_bmp == rhs.top_bmp && orient == rhs.orient;
+	}
+};
+
 struct TEXTURE_CACHE {
 	grs_bitmap_ptr bitmap;
-	grs_bitmap * bottom_bmp;
-	grs_bitmap * top_bmp;
-	int 		orient;
-	fix64		last_time_used;
+	texmerge_key key;		//bottom_bmp is NULL if the entry holds no texture
+	uint16_t hash_next, lru_prev, lru_next;
 };
 
-}
+/* Merged textures, looked up through hash bucket chains and evicted in
+ * least recently used order.  The cache grows until the merged bitmaps
+ * fill the memory budget.  After that, a miss reuses the buffer of the
+ * least recently used entry if it has the right size, and otherwise
+ * frees entries until the new texture fits.
+ */
+class texmerge_cache_t
+{
+	static const uint16_t none = UINT16_MAX;
+	std::vector<TEXTURE_CACHE> entries;
+	std::vector<uint16_t> bucket_head;
+	uint16_t lru_head, lru_tail;		//head is the most recently used
+	uint16_t free_head;					//entries with no bitmap, chained through hash_next
+	std::size_t budget, bytes;
+	unsigned hash(const texmerge_key &k) const
+	{
+		const unsigned bottom = k.bottom_bmp - GameBitmaps.data();
+		const unsigned top = k.top_bmp - GameBitmaps.data();
+		return ((bottom * 31u + top) * 4u + k.orient) & (bucket_head.size() - 1);
+	}
+	void lru_unlink(const uint16_t i)
+	{
+		auto &e = entries[i];
+		(e.lru_prev == none ? lru_head : entries[e.lru_prev].lru_next) = e.lru_next;
+		(e.lru_next == none ? lru_tail : entries[e.lru_next].lru_prev) = e.lru_prev;
+	}
+	void lru_push_front(const uint16_t i)
+	{
+		auto &e = entries[i];
+		e.lru_prev = none;
+		e.lru_next = lru_head;
+		(lru_head == none ? lru_tail : entries[lru_head].lru_prev) = i;
+		lru_head = i;
+	}
+	void hash_unlink(const uint16_t i)
+	{
+		auto &e = entries[i];
+		if (!e.key.bottom_bmp)
+			return;
+		for (auto *p = &bucket_head[hash(e.key)]; *p != none; p = &entries[*p].hash_next)
+			if (*p == i)
+			{
+				*p = e.hash_next;
+				break;
+			}
+		e.key.bottom_bmp = nullptr;
+	}
+	void hash_insert(const uint16_t i, const texmerge_key &k)
+	{
+		auto &e = entries[i];
+		e.key = k;
+		auto &head = bucket_head[hash(k)];
+		e.hash_next = head;
+		head = i;
+	}
+	void evict(const uint16_t i)
+	{
+		auto &e = entries[i];
+		hash_unlink(i);
+		lru_unlink(i);
+		++ stats.evictions;
+		bytes -= e.bitmap->bm_w * e.bitmap->bm_h;
+#ifndef OGL
+		//queued polygons may still be drawing from the old bitmap
+		tmap_batch_retire(std::move(e.bitmap));
+#endif
+		e.bitmap.reset();
+		e.hash_next = free_head;
+		free_head = i;
+	}
+	texmerge_cache_stats stats;
+public:
+	texmerge_cache_t() :
+		lru_head(none), lru_tail(none), free_head(none), budget(0), bytes(0), stats{}
+	{
+	}
+	void init(const std::size_t budget_bytes)
+	{
+		close();
+		budget = budget_bytes;
+		//about one bucket per 64x64 texture which fits in the budget
+		std::size_t buckets = 64;
+		while (buckets < 4096 && buckets * 64 * 64 < budget)
+			buckets *= 2;
+		bucket_head.assign(buckets, none);
+		stats = {};
+	}
+	void close()
+	{
+		entries.clear();
+		std::fill(bucket_head.begin(), bucket_head.end(), none);
+		lru_head = lru_tail = free_head = none;
+		bytes = 0;
+	}
+	//Forget every texture, but keep the buffers for reuse.
+	void flush()
+	{
+		std::fill(bucket_head.begin(), bucket_head.end(), none);
+		range_for (auto &e, entries)
+			e.key.bottom_bmp = nullptr;
+	}
+	grs_bitmap *find(const texmerge_key &k)
+	{
+		if (bucket_head.empty())
+			return nullptr;
+		for (auto i = bucket_head[hash(k)]; i != none; i = entries[i].hash_next)
+			if (entries[i].key == k)
+			{
+				++ stats.hits;
+				lru_unlink(i);
+				lru_push_front(i);
+				return entries[i].bitmap.get();
+			}
+		++ stats.misses;
+		return nullptr;
+	}
+	/* Return a w*h bitmap for k.  Its contents and flags are undefined,
+	 * and must be filled in by the caller.
+	 */
+	grs_bitmap &insert(const texmerge_key &k, const uint16_t w, const uint16_t h)
+	{
+		const std::size_t need = w * h;
+		if (lru_tail != none && bytes + need > budget)
+		{
+			const auto i = lru_tail;
+			auto &e = entries[i];
+			auto &bm = *e.bitmap.get();
+			if (bm.bm_w == w && bm.bm_h == h)
+			{
+				hash_unlink(i);
+				lru_unlink(i);
+				++ stats.evictions;
+#ifdef OGL
+				ogl_freebmtexture(bm);
+#else
+				//queued polygons may still be drawing from this buffer
+				tmap_batch_flush();
+#endif
+				hash_insert(i, k);
+				lru_push_front(i);
+				return bm;
+			}
+		}
+		while (lru_tail != none && (bytes + need > budget || (free_head == none && entries.size() >= none)))
+			evict(lru_tail);
+		uint16_t i;
+		if (free_head != none)
+		{
+			i = free_head;
+			free_head = entries[i].hash_next;
+		}
+		else
+		{
+			i = entries.size();
+			entries.emplace_back();
+		}
+		auto &e = entries[i];
+		e.bitmap = gr_create_bitmap(w, h);
+		bytes += need;
+		hash_insert(i, k);
+		lru_push_front(i);
+		return *e.bitmap.get();
+	}
+	texmerge_cache_stats get_stats() const
+	{
+		auto r = stats;
+		r.entries = entries.size();
+		for (auto i = free_head; i != none; i = entries[i].hash_next)
+			-- r.entries;
+		r.bytes = bytes;
+		r.budget = budget;
+		return r;
+	}
+};
 
-static array<TEXTURE_CACHE, MAX_NUM_CACHE_BITMAPS> Cache;
+const uint16_t texmerge_cache_t::none;
 
-static unsigned num_cache_entries;
+}
 
-static int cache_hits = 0;
-static int cache_misses = 0;
+static texmerge_cache_t Cache;
 
 static void merge_textures_super_xparent(int type, const grs_bitmap &bottom_bmp, const grs_bitmap &top_bmp,
 											 ubyte *dest_data);
@@ -72,76 +248,42 @@ static void merge_textures_new(int type, const grs_bitmap &bottom_bmp, const grs
 
 //----------------------------------------------------------------------
 
-int texmerge_init(int num_cached_textures)
+int texmerge_init(std::size_t budget_bytes)
 {
-	if ( num_cached_textures <= MAX_NUM_CACHE_BITMAPS )
-		num_cache_entries = num_cached_textures;
-	else
-		num_cache_entries = MAX_NUM_CACHE_BITMAPS;
-	
-	range_for (auto &i, partial_range(Cache, num_cache_entries))
-	{
-		i.bitmap = NULL;
-		i.last_time_used = -1;
-		i.top_bmp = NULL;
-		i.bottom_bmp = NULL;
-		i.orient = -1;
-	}
-
+	Cache.init(budget_bytes);
 	return 1;
 }
 
 void texmerge_flush()
 {
-	range_for (auto &i, partial_range(Cache, num_cache_entries))
-	{
-		i.last_time_used = -1;
-		i.top_bmp = NULL;
-		i.bottom_bmp = NULL;
-		i.orient = -1;
-	}
+	Cache.flush();
 }
 
 
 //-------------------------------------------------------------------------
 void texmerge_close()
 {
-	range_for (auto &i, partial_range(Cache, num_cache_entries))
-	{
-		i.bitmap.reset();
-	}
+	Cache.close();
 }
 
-//--unused-- int info_printed = 0;
+texmerge_cache_stats texmerge_get_stats()
+{
+	return Cache.get_stats();
+}
 
 grs_bitmap &texmerge_get_cached_bitmap(unsigned tmap_bottom, unsigned tmap_top)
 {
 	grs_bitmap *bitmap_top, *bitmap_bottom;
 	int orient;
-	int lowest_time_used;
 
 	bitmap_top = &GameBitmaps[Textures[tmap_top&0x3FFF].index];
 	bitmap_bottom = &GameBitmaps[Textures[tmap_bottom].index];
 	
 	orient = ((tmap_top&0xC000)>>14) & 3;
 
-	lowest_time_used = Cache[0].last_time_used;
-	auto least_recently_used = &Cache.front();
-	range_for (auto &i, partial_range(Cache, num_cache_entries))
-	{
-		if ( (i.last_time_used > -1) && (i.top_bmp==bitmap_top) && (i.bottom_bmp==bitmap_bottom) && (i.orient==orient ))	{
-			cache_hits++;
-			i.last_time_used = timer_query();
-			return *i.bitmap.get();
-		}	
-		if ( i.last_time_used < lowest_time_used )	{
-			lowest_time_used = i.last_time_used;
-			least_recently_used = &i;
-		}
-	}
-
-	//---- Page out the LRU bitmap;
-	cache_misses++;
+	const texmerge_key key{bitmap_bottom, bitmap_top, orient};
+	if (const auto cached = Cache.find(key))
+		return *cached;
 
 	// Make sure the bitmaps are paged in...
 	piggy_page_flushed = 0;
@@ -160,26 +302,17 @@ grs_bitmap &texmerge_get_cached_bitmap(unsigned tmap_bottom, unsigned tmap_top)
 	if (bitmap_bottom->bm_w != bitmap_top->bm_w || bitmap_bottom->bm_h != bitmap_top->bm_h)
 		Error("Top and Bottom textures have different size!\n");
 
-	least_recently_used->bitmap = gr_create_bitmap(bitmap_bottom->bm_w,  bitmap_bottom->bm_h);
-#ifdef OGL
-	ogl_freebmtexture(*least_recently_used->bitmap.get());
-#endif
-
+	auto &bitmap = Cache.insert(key, bitmap_bottom->bm_w, bitmap_bottom->bm_h);
 	if (bitmap_top->bm_flags & BM_FLAG_SUPER_TRANSPARENT)	{
-		merge_textures_super_xparent( orient, *bitmap_bottom, *bitmap_top, least_recently_used->bitmap->get_bitmap_data() );
-		gr_set_bitmap_flags(*least_recently_used->bitmap.get(), BM_FLAG_TRANSPARENT);
-		least_recently_used->bitmap->avg_color = bitmap_top->avg_color;
+		merge_textures_super_xparent( orient, *bitmap_bottom, *bitmap_top, bitmap.get_bitmap_data() );
+		gr_set_bitmap_flags(bitmap, BM_FLAG_TRANSPARENT);
+		bitmap.avg_color = bitmap_top->avg_color;
 	} else	{
-		merge_textures_new( orient, *bitmap_bottom, *bitmap_top, least_recently_used->bitmap->get_bitmap_data() );
-		least_recently_used->bitmap->bm_flags = bitmap_bottom->bm_flags & (~BM_FLAG_RLE);
-		least_recently_used->bitmap->avg_color = bitmap_bottom->avg_color;
+		merge_textures_new( orient, *bitmap_bottom, *bitmap_top, bitmap.get_bitmap_data() );
+		bitmap.bm_flags = bitmap_bottom->bm_flags & (~BM_FLAG_RLE);
+		bitmap.avg_color = bitmap_bottom->avg_color;
 	}
-
-	least_recently_used->top_bmp = bitmap_top;
-	least_recently_used->bottom_bmp = bitmap_bottom;
-	least_recently_used->last_time_used = timer_query();
-	least_recently_used->orient = orient;
-	return *least_recently_used->bitmap.get();
+	return bitmap;
 }
 
 void merge_textures_new( int type, const grs_bitmap &rbottom_bmp, const grs_bitmap &rtop_bmp, ubyte * dest_data )
@@ -328,7 +328,7 @@ void load_text()
 				  
 			  case IDX_TEXT_OVERWRITTEN:
 				{
-				  static const char extra[] = "\n<Ctrl-C> converts format\nIntel <-> PowerPC";
+				  static const char extra[] = "\n<Ctrl-C> converts format\nIntel <-> PowerPC\n<Ctrl-I> indexes for seeking";
 				std::size_t l = strlen(ts);
 				overwritten_text = make_unique<char[]>(l + sizeof(extra));
 				char *o = overwritten_text.get();
@@ -0,0 +1,138 @@
+/*
+ * This file is part of the DXX-Rebirth project <http://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+
+/*
+ *
+ * Unthrottled demo playback benchmark
+ *
+ * Every demo frame is decoded and rendered exactly once, with game time
+ * advanced by the frame time stored in the demo, so repeated runs do
+ * the same work regardless of how fast the machine is.
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include "timedemo.h"
+#include "newdemo.h"
+#include "game.h"
+#include "inferno.h"
+#include "args.h"
+#include "console.h"
+#include "perf_timer.h"
+#include "texmap.h"
+#include "../texmap/scanline.h"
+
+#include "compiler-range_for.h"
+
+bool Timedemo_active;
+
+static std::string timedemo_filename;
+static std::vector<perf_clock::duration> timedemo_frame_times;
+static perf_durations timedemo_subsystem_times;
+static perf_clock::time_point timedemo_last_frame;
+static bool timedemo_have_last_frame;
+
+void timedemo_start()
+{
+	if (GameArg.SysTimeDemo.empty())
+		return;
+	timedemo_filename = std::move(GameArg.SysTimeDemo);
+	GameArg.SysTimeDemo.clear();
+	timedemo_frame_times.clear();
+	timedemo_frame_times.reserve(1 << 14);
+	timedemo_subsystem_times = {};
+	timedemo_have_last_frame = false;
+	// Interpolation would make the number of rendered frames depend on
+	// the frame rate.
+	Newdemo_do_interpolate = 0;
+	Perf_timers_enabled = true;
+	Timedemo_active = true;
+	newdemo_start_playback(timedemo_filename.c_str());
+	if (Newdemo_state != ND_STATE_PLAYBACK)
+	{
+		con_printf(CON_URGENT, "timedemo: cannot play demo \"%s\"", timedemo_filename.c_str());
+		timedemo_finish();
+	}
+}
+
+fix timedemo_frame()
+{
+	const auto now = perf_clock::now();
+	const auto spent = perf_timers_take();
+	// The first frame includes loading the level; do not count it.
+	if (timedemo_have_last_frame)
+	{
+		timedemo_frame_times.emplace_back(now - timedemo_last_frame);
+		for (std::size_t i = 0; i != spent.size(); ++i)
+			timedemo_subsystem_times[i] += spent[i];
+	}
+	timedemo_last_frame = now;
+	timedemo_have_last_frame = true;
+	const fix t = newdemo_get_recorded_frame_time();
+	return t > 0 ? t : DESIGNATED_GAME_FRAMETIME;
+}
+
+static double to_ms(const perf_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static void print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; ++s)
+	{
+		const char c = *s;
+		if (c == '"' || c == '\\')
+			putchar('\\');
+		if (static_cast<unsigned char>(c) >= ' ')
+			putchar(c);
+	}
+	putchar('"');
+}
+
+void timedemo_finish()
+{
+	if (!Timedemo_active)
+		return;
+	Timedemo_active = false;
+	Perf_timers_enabled = false;
+	perf_timers_take();
+	auto &v = timedemo_frame_times;
+	const std::size_t n = v.size();
+	printf("{\"demo\":");
+	print_json_string(timedemo_filename.c_str());
+	printf(",\"frames\":%lu", static_cast<unsigned long>(n));
+	if (n)
+	{
+		perf_clock::duration total{};
+		range_for (const auto d, v)
+			total += d;
+		std::sort(v.begin(), v.end());
+		// Nearest-rank percentile
+		const auto p99 = v[(n * 99 + 99) / 100 - 1];
+		printf(",\"total_ms\":%.3f,\"frame_ms\":{\"min\":%.3f,\"avg\":%.3f,\"p99\":%.3f,\"max\":%.3f},\"avg_fps\":%.2f,\"subsystem_ms_per_frame\":{",
+			to_ms(total), to_ms(v.front()), to_ms(total) / n, to_ms(p99), to_ms(v.back()), n * 1000.0 / to_ms(total));
+		for (std::size_t i = 0; i != timedemo_subsystem_times.size(); ++i)
+			printf("%s\"%s\":%.3f", i ? "," : "", perf_subsystem_name(static_cast<perf_subsystem>(i)), to_ms(timedemo_subsystem_times[i]) / n);
+		putchar('}');
+	}
+	const auto &tc = get_tmap_compare_stats();
+	if (tc.spans)
+		printf(",\"tmap_compare\":{\"spans\":%lu,\"pixels\":%lu,\"mismatched_spans\":%lu,\"mismatched_pixels\":%lu}", tc.spans, tc.pixels, tc.mismatched_spans, tc.mismatched_pixels);
+#ifndef OGL
+	const auto &tb = get_tmap_band_stats();
+	if (tb.batches)
+		printf(",\"tmap_bands\":{\"threads\":%u,\"batches\":%lu,\"commands\":%lu,\"verified_batches\":%lu,\"mismatched_batches\":%lu,\"mismatched_pixels\":%lu}", tb.threads, tb.batches, tb.commands, tb.verified_batches, tb.mismatched_batches, tb.mismatched_pixels);
+#endif
+	printf("}\n");
+	fflush(stdout);
+	Quitting = 1;
+}
@@ -163,6 +163,7 @@ void wall_set_tmap_num(const vsegptridx_t seg,int side,const vsegptridx_t csegp,
 
 	if ( Newdemo_state==ND_STATE_PLAYBACK ) return;
 
+	const auto old_transparency = check_transparency(seg->sides[side]);
 	if (anim->flags & WCF_TMAP1)	{
 		if (tmap != seg->sides[side].tmap_num || tmap != csegp->sides[cside].tmap_num)
 		{
@@ -179,6 +180,8 @@ void wall_set_tmap_num(const vsegptridx_t seg,int side,const vsegptridx_t csegp,
 				newdemo_record_wall_set_tmap_num2(seg,side,csegp,cside,tmap);
 		}
 	}
+	if (check_transparency(seg->sides[side]) != old_transparency)
+		flush_fcd_cache();
 }
 
 
@@ -211,6 +214,7 @@ static void blast_blastable_wall(const vsegptridx_t seg, int side)
 		Walls[seg->sides[side].wall_num].flags |= WALL_BLASTED;
 		if (cwall_num > -1)
 			Walls[cwall_num].flags |= WALL_BLASTED;
+		flush_fcd_cache();
 	}
 
 }
@@ -332,6 +336,7 @@ void wall_open_door(const vsegptridx_t seg, int side)
 
 
 	w->state = WALL_DOOR_OPENING;
+	flush_fcd_cache();
 
 	// So that door can't be shot while opening
 	const auto &&csegp = vcsegptr(seg->children[side]);
@@ -477,6 +482,7 @@ void start_wall_cloak(const vsegptridx_t seg, int side)
 			w->type = WALL_OPEN;
 			if (cwall_num > -1)
 				Walls[cwall_num].type = WALL_OPEN;
+			flush_fcd_cache();
 			return;
 		}
 		Num_cloaking_walls++;
@@ -720,6 +726,8 @@ void do_door_close(int door_num)
 		i = n-time_elapsed/one_frame-1;
 
 		if (i < n/2) {
+			if (Walls[seg->sides[side].wall_num].flags & WALL_DOOR_OPENED)
+				flush_fcd_cache();
 			Walls[seg->sides[side].wall_num].flags &= ~WALL_DOOR_OPENED;
 			Walls[csegp->sides[Connectside].wall_num].flags &= ~WALL_DOOR_OPENED;
 		}
@@ -814,6 +822,7 @@ void wall_close_door(const vsegptridx_t seg, int side)
 	}
 
 	w->state = WALL_DOOR_CLOSING;
+	flush_fcd_cache();
 
 	// So that door can't be shot while opening
 	const auto &&csegp = vcsegptr(seg->children[side]);
@@ -899,12 +908,15 @@ void do_door_open(int door_num)
 			wall_set_tmap_num(seg,side,csegp,Connectside,w->clip_num,i);
 
 		if (i> n/2) {
+			if (!(Walls[seg->sides[side].wall_num].flags & WALL_DOOR_OPENED))
+				flush_fcd_cache();
 			Walls[seg->sides[side].wall_num].flags |= WALL_DOOR_OPENED;
 			Walls[csegp->sides[Connectside].wall_num].flags |= WALL_DOOR_OPENED;
 		}
 
 		if (i >= n-1) {
 			wall_set_tmap_num(seg,side,csegp,Connectside,w->clip_num,n-1);
+			flush_fcd_cache();	//no longer WALL_DOOR_OPENING
 
 			// If our door is not automatic just remove it from the list.
 			if (!(Walls[seg->sides[side].wall_num].flags & WALL_DOOR_AUTO)) {
@@ -1000,6 +1012,8 @@ void do_door_close(int door_num)
 		i = n-time_elapsed/one_frame-1;
 
 		if (i < n/2) {
+			if (Walls[seg->sides[side].wall_num].flags & WALL_DOOR_OPENED)
+				flush_fcd_cache();
 			Walls[seg->sides[side].wall_num].flags &= ~WALL_DOOR_OPENED;
 			Walls[csegp->sides[Connectside].wall_num].flags &= ~WALL_DOOR_OPENED;
 		}
@@ -1035,6 +1049,7 @@ void wall_illusion_off(const vsegptridx_t seg, int side)
 
 	Walls[seg->sides[side].wall_num].flags |= WALL_ILLUSION_OFF;
 	Walls[csegp->sides[cside].wall_num].flags |= WALL_ILLUSION_OFF;
+	flush_fcd_cache();
 
 #if defined(DXX_BUILD_DESCENT_II)
 	kill_stuck_objects(seg->sides[side].wall_num);
@@ -1057,6 +1072,7 @@ void wall_illusion_on(const vsegptridx_t seg, int side)
 
 	Walls[seg->sides[side].wall_num].flags &= ~WALL_ILLUSION_OFF;
 	Walls[csegp->sides[cside].wall_num].flags &= ~WALL_ILLUSION_OFF;
+	flush_fcd_cache();
 }
 
 //	-----------------------------------------------------------------------------
@@ -1209,6 +1225,7 @@ void reset_walls()
 		w.trigger = -1;
 		w.clip_num = -1;
 		}
+	flush_fcd_cache();
 }
 
 #if defined(DXX_BUILD_DESCENT_II)
@@ -1239,6 +1256,7 @@ static void do_cloaking_wall_frame(int cloaking_wall_num)
 			wback->type = WALL_OPEN;
 			wback->state = WALL_DOOR_CLOSED;		//why closed? why not?
 		}
+		flush_fcd_cache();
 
 		for (i=cloaking_wall_num;i<Num_cloaking_walls;i++)
 			CloakingWalls[i] = CloakingWalls[i+1];
@@ -1258,6 +1276,7 @@ static void do_cloaking_wall_frame(int cloaking_wall_num)
 			wfront->type = WALL_CLOAKED;
 			if (wback)
 				wback->type = WALL_CLOAKED;
+			flush_fcd_cache();
 
 			for (i=0;i<4;i++) {
 				Segments[wfront->segnum].sides[wfront->sidenum].uvls[i].l = d->front_ls[i];
@@ -1325,6 +1344,8 @@ static void do_decloaking_wall_frame(int cloaking_wall_num)
 		fix light_scale;
 		int i;
 
+		if (wfront->type != WALL_CLOSED)
+			flush_fcd_cache();
 		wfront->type = wback->type = WALL_CLOSED;
 
 		light_scale = fixdiv(d->time-CLOAKING_WALL_TIME/2,CLOAKING_WALL_TIME/2);
@@ -1337,6 +1358,8 @@ static void do_decloaking_wall_frame(int cloaking_wall_num)
 	}
 	else {		//cloaking in
 		wfront->cloak_value = ((CLOAKING_WALL_TIME/2 - d->time) * (GR_FADE_LEVELS-2)) / (CLOAKING_WALL_TIME/2);
+		if (wfront->type != WALL_CLOAKED)
+			flush_fcd_cache();
 		wfront->type = WALL_CLOAKED;
 		if (wback) {
 			wback->cloak_value = wfront->cloak_value;
@@ -1370,6 +1393,8 @@ void wall_frame_process()
 			d->time += FrameTime;
 
 			// set flags to fix occasional netgame problem where door is waiting to close but open flag isn't set
+			if (!(w->flags & WALL_DOOR_OPENED))
+				flush_fcd_cache();
 			w->flags |= WALL_DOOR_OPENED;
 			if (d->back_wallnum[0] > -1)
 				Walls[d->back_wallnum[0]].flags |= WALL_DOOR_OPENED;
@@ -1510,10 +1535,6 @@ void kill_stuck_objects(int wallnum)
 		} else if (Stuck_objects[i].wallnum != -1) {
 			Num_stuck_objects++;
 		}
-	//	Ok, this is awful, but we need to do things whenever a door opens/closes/disappears, etc.
-#if defined(DXX_BUILD_DESCENT_II)
-	flush_fcd_cache();
-#endif
 
 }
 
@@ -155,11 +155,14 @@ static void arg_port_number(Arglist::iterator &pp, Arglist::const_iterator end,
 static void InitGameArg()
 {
 	GameArg.SysMaxFPS = MAXIMUM_FPS;
+	GameArg.GfxTexmergeCacheKB = TEXMERGE_CACHE_KB_DEFAULT;
 #if defined(DXX_BUILD_DESCENT_II)
 	GameArg.SndDigiSampleRate = SAMPLE_RATE_22K;
 #endif
 #ifdef USE_UDP
 	GameArg.MplUdpHostAddr = UDP_MANUAL_ADDR_DEFAULT;
+	GameArg.MplUdpSynthFire = 2;
+	GameArg.MplUdpSynthMdata = 5;
 #ifdef USE_TRACKER
 	GameArg.MplTrackerAddr = TRACKER_ADDR_DEFAULT;
 	GameArg.MplTrackerPort = TRACKER_PORT_DEFAULT;
@@ -235,6 +238,8 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 #endif
 		else if (!d_stricmp(p, "-autodemo"))
 			GameArg.SysAutoDemo 		= 1;
+		else if (!d_stricmp(p, "-timedemo"))
+			GameArg.SysTimeDemo = arg_string(pp, end);
 
 	// Control Options
 
@@ -263,11 +268,17 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 			GameArg.SndDisableSdlMixer = true;
 #endif
 		}
+#ifdef USE_SDLMIXER
+		else if (!d_stricmp(p, "-sndpreconvert"))
+			GameArg.SndPreconvert = true;
+#endif
 
 	// Graphics Options
 
 		else if (!d_stricmp(p, "-lowresfont"))
 			GameArg.GfxSkipHiresFNT	= 1;
+		else if (!d_stricmp(p, "-texmerge_cache"))
+			GameArg.GfxTexmergeCacheKB = arg_integer(pp, end);
 #if defined(DXX_BUILD_DESCENT_II)
 		else if (!d_stricmp(p, "-lowresgraphics"))
 			GameArg.GfxSkipHiresGFX	= 1;
@@ -299,6 +310,18 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 		{
 			arg_port_number(pp, end, GameArg.MplUdpMyPort, false);
 		}
+		else if (!d_stricmp(p, "-udp_nothread"))
+			GameArg.MplUdpNoThread = true;
+		else if (!d_stricmp(p, "-udp_interp"))
+			GameArg.MplUdpInterpDelay = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-udp_synth"))
+			GameArg.MplUdpSynthClients = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-udp_synth_pps"))
+			GameArg.MplUdpSynthPps = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-udp_synth_fire"))
+			GameArg.MplUdpSynthFire = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-udp_synth_mdata"))
+			GameArg.MplUdpSynthMdata = arg_integer(pp, end);
 		else if (!d_stricmp(p, "-no-tracker"))
 		{
 			/* Always recognized.  No-op if tracker support compiled
@@ -379,6 +402,10 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 			GameArg.DbgSdlHWSurface = 1;
 		else if (!d_stricmp(p, "-asyncblit"))
 			GameArg.DbgSdlASyncBlit = 1;
+		else if (!d_stricmp(p, "-tmap_threads"))
+			GameArg.DbgTmapThreads = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-tmap_verify"))
+			GameArg.DbgTmapVerify = true;
 #endif
 		else if (!d_stricmp(p, "-ini"))
 		{
@@ -408,6 +435,20 @@ static void PostProcessGameArg()
 	if (CGameArg.CtlNoStickyKeys) // Must happen before SDL_Init!
 		sdl_disable_lock_keys[sizeof(sdl_disable_lock_keys) - 1] = '1';
 	SDL_putenv(sdl_disable_lock_keys);
+
+	if (!GameArg.SysTimeDemo.empty())
+	{
+		GameArg.SysNoTitles = 1;
+		GameArg.SndNoSound = 1;
+		GameArg.SndNoMusic = 1;
+#ifndef OGL
+		// The software renderer draws into a system memory surface,
+		// so no real display is needed.
+		static char sdl_dummy_video[] = "SDL_VIDEODRIVER=dummy";
+		if (!getenv("SDL_VIDEODRIVER"))
+			SDL_putenv(sdl_dummy_video);
+#endif
+	}
 }
 
 static std::string ConstructIniStackExplanation(const Inilist &ini)
@@ -19,6 +19,14 @@
 #include <unistd.h>	// for chdir hack
 #include <HIServices/Processes.h>
 #endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "args.h"
 #include "newdemo.h"
@@ -535,6 +543,63 @@ RAIIPHYSFS_File PHYSFSX_openWriteBuffered(const char *filename)
 	return fp;
 }
 
+void PHYSFSX_mapped_file::unmap()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap(m_data, m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+PHYSFSX_mapped_file PHYSFSX_mapRead(const char *filename)
+{
+	char filename2[PATH_MAX];
+	snprintf(filename2, sizeof(filename2), "%s", filename);
+	PHYSFSEXT_locateCorrectCase(filename2);
+	/* If filename is in an archive, this gives a path under the
+	 * archive file, which cannot be opened.
+	 */
+	array<char, PATH_MAX> path;
+	if (!PHYSFS_exists(filename2) || !PHYSFSX_getRealPath(filename2, path))
+		return {};
+#ifdef _WIN32
+	const auto f = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE)
+		return {};
+	LARGE_INTEGER size;
+	uint8_t *p = nullptr;
+	if (GetFileSizeEx(f, &size) && size.QuadPart > 0 && static_cast<uint64_t>(size.QuadPart) <= SIZE_MAX)
+	{
+		if (const auto m = CreateFileMappingA(f, nullptr, PAGE_WRITECOPY, 0, 0, nullptr))
+		{
+			p = static_cast<uint8_t *>(MapViewOfFile(m, FILE_MAP_COPY, 0, 0, 0));
+			CloseHandle(m);	//the view keeps the mapping alive
+		}
+	}
+	CloseHandle(f);
+	if (!p)
+		return {};
+	return {p, static_cast<std::size_t>(size.QuadPart)};
+#else
+	const int fd = open(path.data(), O_RDONLY);
+	if (fd == -1)
+		return {};
+	struct stat st;
+	void *p = MAP_FAILED;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+		p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);	//the mapping keeps the file open
+	if (p == MAP_FAILED)
+		return {};
+	return {static_cast<uint8_t *>(p), static_cast<std::size_t>(st.st_size)};
+#endif
+}
+
 /* 
  * Add archives to the game.
  * 1) archives from Sharepath/Data to extend/replace builtin game content